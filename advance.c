@@ -0,0 +1,248 @@
+/** \file advance.c
+ *  This file contains advance_building(), which moves every lift in a building
+ *  forward by many updates at once. It gives exactly the same result as calling
+ *  update_lift() on every lift once per update, but does far less work.
+ *
+ *  Most updates of the finite state machine change nothing but the lift's timer,
+ *  and, if the lift is moving, its position. For every state it is easy to work out
+ *  how many updates will pass before the state changes: the timed door states
+ *  change when 'time' reaches their limit, a moving lift changes state on the update
+ *  after it reaches the next floor with a stop marker, and an idle lift changes state
+ *  on the first update after it has been given a stop. So the building is moved on
+ *  to just before the next lift changes state in one go, and only that update is
+ *  run through update_lift(). The work done is proportional to the number of state
+ *  changes rather than the number of updates.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "advance.h"
+#include "liftfsm.h"
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int updates_until(int time, int limit);
+static int open_updates(Lift *car);
+static int has_stops(Lift *car);
+static int next_stop_ahead(Lift *car);
+
+
+/* ============================================================================ *
+ * Closed form lift progression                                                 *
+ * ============================================================================ */
+
+/** Work out how many calls to update_lift() it will take for a lift to change state,
+ *  assuming no new stops are set. The state changes during the last of those updates.
+ *
+ *  \param car The lift to inspect.
+ *  \return The number of updates until the state changes (at least 1), or
+ *          NEVER_CHANGES if the lift will stay in its current state forever.
+ */
+int updates_to_change(Lift *car)
+{
+    int stop;
+
+    // Only putting it back into service moves a lift that is out of service
+    if(get_state(car) == STATE_OUT_OF_SERVICE) {
+        return NEVER_CHANGES;
+    }
+
+    switch(get_state(car)) {
+        case STATE_IDLE:
+            // Idle lifts leave STATE_IDLE on the first update after they get a stop
+            return has_stops(car) ? 1 : NEVER_CHANGES;
+
+        case STATE_MOVING:
+            // A lift at a stop floor opens on the next update. Otherwise it moves until
+            // it reaches the next stop in its direction, and opens on the update after.
+            if(at_stop(car)) {
+                return 1;
+            }
+
+            stop = next_stop_ahead(car);
+            if(stop == NO_STOPS || (abs((stop * FLOOR_HEIGHT) - get_position(car)) % get_speed(car))) {
+                return 1; // Nothing ahead, or a stop the lift can't land on; take it an update at a time
+            }
+
+            return (abs((stop * FLOOR_HEIGHT) - get_position(car)) / get_speed(car)) + 1;
+
+        case STATE_OPENING: return updates_until(get_time(car), OPENING_TIME);
+        case STATE_OPEN   : return open_updates(car);
+        case STATE_CLOSING: return updates_until(get_time(car), CLOSING_TIME);
+        case STATE_WAIT   : return updates_until(get_time(car), WAIT_TIME);
+
+        // Let update_lift() deal with anything else
+        default: return 1;
+    }
+}
+
+
+/** Move a lift forward by a number of updates during which it does not change state.
+ *  This is the same as calling update_lift() that many times, as long as 'updates' is
+ *  less than updates_to_change(car) and no stops are set in the meantime.
+ *
+ *  \param car     The lift to move on.
+ *  \param updates The number of updates to skip.
+ */
+void skip_updates(Lift *car, int updates)
+{
+    if(updates <= 0) {
+        return;
+    }
+
+    car -> time += updates;
+
+    if(get_state(car) == STATE_MOVING) {
+        if(get_direction(car) == DIR_UP) {
+            set_position(car, get_position(car) + (get_speed(car) * updates));
+        } else if(get_direction(car) == DIR_DOWN) {
+            set_position(car, get_position(car) - (get_speed(car) * updates));
+        }
+    }
+}
+
+
+/** Move every lift in a building forward by up to 'ticks' updates. This stops early,
+ *  after the update in which any lift opens its doors, as that is when passengers
+ *  in it may want to choose a floor. Callers with other events due (calls arriving
+ *  at a known time, say) should limit 'ticks' to the time until the next event.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param ticks      The most updates to move the building on by.
+ *  \return The number of updates the building was actually moved on by.
+ */
+int advance_building(Shaft **shafts, int shaftcount, int ticks)
+{
+    int done = 0;
+    int step, change, shaftnum, opened;
+    State before;
+
+    while(done < ticks) {
+        // How far can everything go before the first lift changes state?
+        step = ticks - done;
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            change = updates_to_change(shafts[shaftnum] -> car);
+            if(change < step) {
+                step = change;
+            }
+        }
+
+        // Everything up to that update is just time passing...
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            skip_updates(shafts[shaftnum] -> car, step - 1);
+        }
+
+        // ... and the update itself goes through the finite state machine
+        opened = 0;
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            before = get_state(shafts[shaftnum] -> car);
+            update_lift(shafts[shaftnum] -> car);
+
+            if(before != STATE_OPEN && get_state(shafts[shaftnum] -> car) == STATE_OPEN) {
+                opened = 1;
+            }
+        }
+
+        done += step;
+        if(opened) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Work out how many updates a timed state has left. The timer is increased at the
+ *  start of every update, and the state changes on the update where it equals the limit.
+ *
+ *  \param time  The current value of the lift's timer.
+ *  \param limit The time at which the state changes.
+ *  \return The number of updates until the state changes, or NEVER_CHANGES if the
+ *          timer has already passed the limit.
+ */
+static int updates_until(int time, int limit)
+{
+    if(time >= limit) {
+        return NEVER_CHANGES;
+    }
+
+    return limit - time;
+}
+
+
+/** Work out how many updates an open lift has left before it starts to close its
+ *  doors. A lift with its doors held is left to update_lift() one update at a time,
+ *  as is a copy of one whose timer has run past OPEN_TIME without the hold.
+ *
+ *  \param car The open lift.
+ *  \return The number of updates until the doors start to close.
+ */
+static int open_updates(Lift *car)
+{
+    if(door_hold(car) || get_time(car) >= OPEN_TIME) {
+        return 1;
+    }
+
+    return updates_until(get_time(car), OPEN_TIME);
+}
+
+
+/** Determine whether a lift has any stops set.
+ *
+ *  \param car The lift to inspect.
+ *  \return true if any stop marker is set, false otherwise.
+ */
+static int has_stops(Lift *car)
+{
+    int floor;
+
+    for(floor = 0; floor <= get_topfloor(car); ++floor) {
+        if(car -> stops[floor]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** Find the next floor with a stop marker in the lift's direction of travel, not
+ *  counting the position the lift is at now.
+ *
+ *  \param car The lift to inspect.
+ *  \return The floor number of the next stop, or NO_STOPS if there is none ahead.
+ */
+static int next_stop_ahead(Lift *car)
+{
+    int floor;
+    int position = get_position(car);
+
+    if(get_direction(car) == DIR_UP) {
+        // The first floor strictly above the lift
+        for(floor = (position / FLOOR_HEIGHT) + 1; floor <= get_topfloor(car); ++floor) {
+            if(car -> stops[floor]) {
+                return floor;
+            }
+        }
+    } else if(get_direction(car) == DIR_DOWN) {
+        // The first floor strictly below the lift
+        for(floor = (position - 1) / FLOOR_HEIGHT; position > 0 && floor >= 0; --floor) {
+            if(car -> stops[floor]) {
+                return floor;
+            }
+        }
+    }
+
+    return NO_STOPS;
+}
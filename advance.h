@@ -0,0 +1,19 @@
+/** \file advance.h
+ *  Declarations for moving a whole building forward many updates at once.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef ADVANCE_H
+#define ADVANCE_H
+
+#include "shaft.h"
+
+// updates_to_change() returns this for lifts that will never change state by themselves
+#define NEVER_CHANGES 0x7fffffff
+
+int updates_to_change(Lift *car);
+void skip_updates(Lift *car, int updates);
+int advance_building(Shaft **shafts, int shaftcount, int ticks);
+
+#endif
@@ -0,0 +1,308 @@
+/** \file benchmark.c
+ *  This file contains the handling capacity benchmark. Lift installations are
+ *  specified, and contracted on, with a handful of figures measured under standard
+ *  traffic:
+ *
+ *  - five-minute handling capacity: the most passengers the lifts can deliver in
+ *    five minutes, as a percentage of the building's population;
+ *  - average interval: the time between lifts leaving the lobby;
+ *  - round trip time: the time between one lift leaving the lobby and leaving it
+ *    again;
+ *  - average waiting time, and average time to destination, from calling a lift
+ *    to getting in, and to getting out at the destination floor.
+ *
+ *  Each traffic profile is run twice on a fresh building. The first run offers far
+ *  more passengers than the lifts can carry, and the busiest five minutes of it is
+ *  the handling capacity. The second offers DESIGN_LOAD percent of that capacity,
+ *  which is how hard lifts are meant to work, and the other figures come from it.
+ *  One update is taken to be one second, which is what the door times assume.
+ *
+ *  The results are written as JSON, so that runs with different buildings,
+ *  dispatchers, or versions of the program can be compared by other tools.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark.h"
+#include "passenger.h"
+#include "traffic.h"
+
+// Changes whenever the meaning of the results changes, so old ones are not compared with new
+#define RESULTS_FORMAT 1
+
+/** The standard traffic profiles, in the order they are run. */
+static const TrafficProfile profiles[] = {
+    { "uppeak", "everybody arriving at the lobby in the morning", 100, 0 },
+    { "mixed",  "lunchtime: out to the lobby, back up from it, and between floors", 45, 45 },
+};
+
+#define PROFILE_COUNT ((int)(sizeof(profiles) / sizeof(profiles[0])))
+
+/** The building and run the benchmark is for. */
+typedef struct {
+    int shaftcount;             //!< The number of shafts.
+    int topfloor;               //!< The top floor; floor 0 is the lobby.
+    int speed;                  //!< The speed of the lifts.
+    long ticks;                 //!< The number of updates in each run.
+    int capacity;               //!< The most passengers a lift can hold.
+    long population;            //!< The people on the floors above the lobby.
+    const Dispatcher *dispatcher;   //!< The dispatcher, or NULL for call_loaded().
+    uint64_t seed;              //!< The seed for the passengers.
+} Benchmark;
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void run_profile(const Benchmark *bench, const TrafficProfile *profile, double offered, ProfileRun *run);
+static void choose_trip(const TrafficProfile *profile, Traffic *traffic, int topfloor, int *from, int *to);
+static long busiest_window(const long *delivered, long ticks);
+static void print_figure(FILE *out, const char *name, double value, const char *after);
+
+
+/* ============================================================================ *
+ * Running the benchmark                                                        *
+ * ============================================================================ */
+
+/** Run every traffic profile on a building, and write out the results as JSON.
+ *
+ *  \param shaftcount      The number of shafts.
+ *  \param topfloor        The top floor of the building.
+ *  \param speed           The speed of the lifts.
+ *  \param ticks           The number of updates in each run, at least FIVE_MINUTES.
+ *  \param capacity        The most passengers each lift can hold.
+ *  \param floorpopulation The people on each floor above the lobby.
+ *  \param dispatcher      The dispatcher to make calls through, or NULL for call_loaded().
+ *  \param seed            The seed for the passengers.
+ *  \param out             The stream to write the results to.
+ */
+void run_benchmark(int shaftcount, int topfloor, int speed, long ticks, int capacity, int floorpopulation,
+                   const Dispatcher *dispatcher, uint64_t seed, FILE *out)
+{
+    Benchmark bench = { shaftcount, topfloor, speed, ticks < FIVE_MINUTES ? FIVE_MINUTES : ticks, capacity,
+                        (long)topfloor * floorpopulation, dispatcher, seed };
+    ProfileRun saturated, design;
+    double handled;
+    int i;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"format\": %d,\n", RESULTS_FORMAT);
+    fprintf(out, "  \"building\": { \"shafts\": %d, \"top_floor\": %d, \"speed\": %d, \"capacity\": %d, "
+                 "\"population\": %ld, \"dispatcher\": ", shaftcount, topfloor, speed, capacity, bench.population);
+    if(dispatcher) {
+        fprintf(out, "\"%s\" },\n", dispatcher -> name);
+    } else {
+        fprintf(out, "null },\n");
+    }
+    fprintf(out, "  \"run\": { \"updates\": %ld, \"seed\": %lu, \"seconds_per_update\": 1, "
+                 "\"saturating_demand_percent\": %d, \"design_load_percent\": %d },\n",
+            bench.ticks, (unsigned long)seed, SATURATING_DEMAND, DESIGN_LOAD);
+    fprintf(out, "  \"profiles\": [\n");
+
+    for(i = 0; i < PROFILE_COUNT; ++i) {
+        run_profile(&bench, &profiles[i], SATURATING_DEMAND, &saturated);
+        handled = bench.population ? 100.0 * saturated.busiest / bench.population : 0.0;
+        run_profile(&bench, &profiles[i], handled * DESIGN_LOAD / 100.0, &design);
+
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"name\": \"%s\",\n", profiles[i].name);
+        fprintf(out, "      \"incoming_percent\": %d, \"outgoing_percent\": %d, \"interfloor_percent\": %d,\n",
+                profiles[i].incoming, profiles[i].outgoing, 100 - profiles[i].incoming - profiles[i].outgoing);
+
+        // If the lifts kept up with the saturating demand, this is only a lower bound
+        fprintf(out, "      \"handling_capacity\": { \"percent\": %.2f, \"passengers\": %ld, \"saturated\": %s },\n",
+                handled, saturated.busiest, saturated.delivered < saturated.arrived * 9 / 10 ? "true" : "false");
+
+        fprintf(out, "      \"design_load\": { \"offered_percent\": %.2f, \"arrived\": %ld, \"delivered\": %ld, "
+                     "\"lobby_departures\": %ld,\n", design.offered, design.arrived, design.delivered, design.departures);
+        fprintf(out, "        ");
+        print_figure(out, "average_interval", design.interval, ", ");
+        print_figure(out, "round_trip_time", design.round_trip, ", ");
+        print_figure(out, "average_waiting_time", design.wait, ", ");
+        print_figure(out, "average_time_to_destination", design.destination, " }\n");
+        fprintf(out, "    }%s\n", i + 1 < PROFILE_COUNT ? "," : "");
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+
+/** Run one traffic profile on a fresh building, and measure how the lifts cope.
+ *
+ *  \param bench   The building and run.
+ *  \param profile The traffic profile.
+ *  \param offered The passengers to offer, in percent of the population every five minutes.
+ *  \param run     Where to store what was measured.
+ */
+static void run_profile(const Benchmark *bench, const TrafficProfile *profile, double offered, ProfileRun *run)
+{
+    Shaft *shafts[bench -> shaftcount];
+    int lastposition[bench -> shaftcount];
+    long lastdeparture[bench -> shaftcount];
+    long *delivered = (long *)calloc(bench -> ticks, sizeof(long));
+    long tick, served = 0, settledserved = 0, settledwait = 0, settledride = 0;
+    long lastlobby = -1, intervals = 0, trips = 0, triptime = 0;
+    long rate = (long)(offered / 100.0 * bench -> population * 1000.0 / FIVE_MINUTES);
+    int shaftnum, arriving, from, to;
+    Passengers *sim;
+    Traffic traffic;
+
+    if(!delivered) {
+        fprintf(stderr, "Unable to allocate space for the benchmark's delivery counts.\n");
+        exit(1);
+    }
+
+    for(shaftnum = 0; shaftnum < bench -> shaftcount; ++shaftnum) {
+        shafts[shaftnum] = create_shaft(bench -> topfloor, bench -> speed);
+        lastposition[shaftnum] = get_position(shafts[shaftnum] -> car);
+        lastdeparture[shaftnum] = -1;
+    }
+    sim = create_passengers(shafts, bench -> shaftcount, bench -> topfloor, bench -> seed + 1);
+    for(shaftnum = 0; shaftnum < bench -> shaftcount; ++shaftnum) {
+        set_capacity(sim, shaftnum, bench -> capacity);
+    }
+    if(bench -> dispatcher) {
+        use_dispatcher(sim, bench -> dispatcher);
+    }
+    init_traffic(&traffic, bench -> seed, bench -> topfloor, 0, 0);
+
+    run -> offered = offered;
+    run -> arrived = 0;
+    run -> departures = 0;
+
+    for(tick = 0; tick < bench -> ticks; ++tick) {
+        update_shafts(shafts, bench -> shaftcount);
+        passengers_tick(sim);
+
+        delivered[tick] = sim -> served - served;
+        served = sim -> served;
+
+        // Figures other than handling capacity leave out the first five minutes
+        if(tick == FIVE_MINUTES - 1) {
+            settledserved = sim -> served;
+            settledwait   = sim -> total_wait;
+            settledride   = sim -> total_ride;
+        }
+
+        // A lift leaves the lobby on the update it moves off the ground floor
+        for(shaftnum = 0; shaftnum < bench -> shaftcount; ++shaftnum) {
+            if(lastposition[shaftnum] == 0 && get_position(shafts[shaftnum] -> car) > 0) {
+                if(tick >= FIVE_MINUTES) {
+                    ++run -> departures;
+                    if(lastlobby >= 0) {
+                        intervals += tick - lastlobby;
+                    }
+                    if(lastdeparture[shaftnum] >= 0) {
+                        triptime += tick - lastdeparture[shaftnum];
+                        ++trips;
+                    }
+                }
+                lastlobby = tick;
+                lastdeparture[shaftnum] = tick;
+            }
+            lastposition[shaftnum] = get_position(shafts[shaftnum] -> car);
+        }
+
+        arriving = rate / 1000 + (traffic_random(&traffic, 1000) < rate % 1000);
+        while(arriving-- > 0) {
+            choose_trip(profile, &traffic, bench -> topfloor, &from, &to);
+            spawn_passenger_to(sim, from, to);
+            ++run -> arrived;
+        }
+    }
+
+    run -> delivered  = sim -> served;
+    run -> busiest    = busiest_window(delivered, bench -> ticks);
+    run -> interval   = run -> departures > 1 ? (double)intervals / (run -> departures - 1) : -1.0;
+    run -> round_trip = trips ? (double)triptime / trips : -1.0;
+    run -> wait        = sim -> served > settledserved ?
+                         (double)(sim -> total_wait - settledwait) / (sim -> served - settledserved) : -1.0;
+    run -> destination = sim -> served > settledserved ?
+                         (double)(sim -> total_wait + sim -> total_ride - settledwait - settledride) /
+                         (sim -> served - settledserved) : -1.0;
+
+    free_passengers(sim);
+    for(shaftnum = 0; shaftnum < bench -> shaftcount; ++shaftnum) {
+        free_shaft(shafts[shaftnum]);
+    }
+    free(delivered);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Choose where a passenger arriving under a traffic profile starts and ends up.
+ *  Floors above the lobby are all equally likely.
+ *
+ *  \param profile  The traffic profile.
+ *  \param traffic  The random number generator.
+ *  \param topfloor The top floor of the building.
+ *  \param from     A pointer to an int to store the floor they start on in.
+ *  \param to       A pointer to an int to store the floor they are going to in.
+ */
+static void choose_trip(const TrafficProfile *profile, Traffic *traffic, int topfloor, int *from, int *to)
+{
+    int roll = traffic_random(traffic, 100);
+    int upper = 1 + traffic_random(traffic, topfloor);
+    int other;
+
+    if(roll < profile -> incoming || topfloor < 2) {
+        *from = 0;
+        *to = upper;
+    } else if(roll < profile -> incoming + profile -> outgoing) {
+        *from = upper;
+        *to = 0;
+    } else {
+        // Any other floor above the lobby
+        other = 1 + traffic_random(traffic, topfloor - 1);
+        *from = upper;
+        *to = other >= upper ? other + 1 : other;
+    }
+}
+
+
+/** Find the most passengers delivered in any FIVE_MINUTES updates in a row.
+ *
+ *  \param delivered The passengers delivered on each update.
+ *  \param ticks     The number of updates.
+ *  \return The most delivered in any five minutes.
+ */
+static long busiest_window(const long *delivered, long ticks)
+{
+    long tick, window = 0, busiest = 0;
+
+    for(tick = 0; tick < ticks; ++tick) {
+        window += delivered[tick];
+        if(tick >= FIVE_MINUTES) {
+            window -= delivered[tick - FIVE_MINUTES];
+        }
+        if(window > busiest) {
+            busiest = window;
+        }
+    }
+
+    return busiest;
+}
+
+
+/** Write out one figure as a JSON member, or null if it could not be measured.
+ *
+ *  \param out   The stream to write to.
+ *  \param name  The name of the figure.
+ *  \param value The figure, or a negative number if it could not be measured.
+ *  \param after What to write after it.
+ */
+static void print_figure(FILE *out, const char *name, double value, const char *after)
+{
+    if(value < 0) {
+        fprintf(out, "\"%s\": null%s", name, after);
+    } else {
+        fprintf(out, "\"%s\": %.2f%s", name, value, after);
+    }
+}
@@ -0,0 +1,57 @@
+/** \file benchmark.h
+ *  Declarations for the handling capacity benchmark, which runs standard traffic
+ *  profiles and reports the figures lift installations are specified by.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "dispatch.h"
+
+// The people on each floor above the lobby, unless another population is given
+#define DEFAULT_FLOOR_POPULATION 80
+
+// Updates in five minutes, at one update a second (door times are in seconds too)
+#define FIVE_MINUTES 300
+
+// The demand offered to find handling capacity, in percent of the population every
+// five minutes: far more than any group of lifts carries, so they never catch up
+#define SATURATING_DEMAND 50
+
+// The percentage of handling capacity at which the other figures are measured, as
+// lifts are designed to run below their limit
+#define DESIGN_LOAD 80
+
+/** A traffic profile: where passengers come from and go to. Whatever is not
+ *  incoming or outgoing is interfloor traffic, between two floors above the lobby.
+ */
+typedef struct {
+    const char *name;           //!< Name used in the results.
+    const char *description;    //!< One line saying what the traffic is like.
+    int incoming;               //!< Percent of passengers going from the lobby to another floor.
+    int outgoing;               //!< Percent going from another floor to the lobby.
+} TrafficProfile;
+
+/** What one run of a traffic profile measured. Times are in updates, averaged over
+ *  the run after the first five minutes, when the lifts have settled down.
+ */
+typedef struct {
+    double offered;             //!< Passengers arriving, in percent of the population every five minutes.
+    long arrived;               //!< Passengers who arrived.
+    long delivered;             //!< Passengers who reached their destination.
+    long busiest;               //!< The most passengers delivered in any five minutes.
+    long departures;            //!< Times a lift left the lobby after the first five minutes.
+    double interval;            //!< Average time between lifts leaving the lobby, or -1.
+    double round_trip;          //!< Average time between one lift leaving the lobby and leaving it again, or -1.
+    double wait;                //!< Average time from calling a lift to getting in, or -1.
+    double destination;         //!< Average time from calling a lift to getting out, or -1.
+} ProfileRun;
+
+void run_benchmark(int shaftcount, int topfloor, int speed, long ticks, int capacity, int floorpopulation,
+                   const Dispatcher *dispatcher, uint64_t seed, FILE *out);
+
+#endif
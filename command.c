@@ -0,0 +1,306 @@
+/** \file command.c
+ *  This file contains a prompt that reads a whole line of commands at once, so that
+ *  a script piped into the simulation can make a burst of calls and stops, and skip
+ *  ahead, in one read rather than one prompt for every event. A line holds any
+ *  number of commands separated by spaces:
+ *
+ *      c<floor>[u|d]       call a lift to a floor, going up or down. The direction
+ *                          may be left off on the bottom and top floors.
+ *      s<shaft>:<floor>    set a stop for the lift in a shaft.
+ *      t+<updates>         let that many updates pass before the next prompt.
+ *      v+<floors>          scroll the view up (or down, with v-) by that many floors,
+ *                          for buildings taller than the terminal.
+ *      h+<shafts>          scroll the view right (or left, with h-) by that many shafts.
+ *      q                   stop the simulation.
+ *
+ *  For example "c3u c7d s2:5 s0:9 t+50". The whole line is checked before any of it
+ *  is acted on, so a mistake part way through a line does nothing at all. Calls and
+ *  stops are made in the order given, and an empty line moves on by one update. A
+ *  line that only scrolls the view redraws it without any time passing.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command.h"
+#include "notify.h"
+#include "profile.h"
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int parse_command(char *word, int shaftcount, int topfloor, Command *command);
+static int parse_number(char **text, int *value);
+static Command *add_command(Command **commands, int *capacity, int count);
+
+
+/* ============================================================================ *
+ * Parsing                                                                      *
+ * ============================================================================ */
+
+/** Split a line of input into commands, checking each one. Any problems are reported
+ *  on stderr.
+ *
+ *  \param line       The line to parse. It is split up in place.
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor that lifts can service.
+ *  \param commands   A pointer to a block of Commands to fill in, which is grown as
+ *                    needed. It may point to NULL to start with.
+ *  \param capacity   A pointer to the number of Commands there is room for.
+ *  \return The number of commands on the line, or -1 if any of them are not valid.
+ */
+int parse_commands(char *line, int shaftcount, int topfloor, Command **commands, int *capacity)
+{
+    char *word, *save;
+    int count = 0;
+    int valid = 1;
+
+    for(word = strtok_r(line, " \t\r\n", &save); word; word = strtok_r(NULL, " \t\r\n", &save)) {
+        if(!parse_command(word, shaftcount, topfloor, add_command(commands, capacity, count))) {
+            valid = 0;
+        }
+        ++count;
+    }
+
+    return valid ? count : -1;
+}
+
+
+/** Parse one command.
+ *
+ *  \param word       The text of the command, with no spaces.
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor that lifts can service.
+ *  \param command    The Command to fill in.
+ *  \return true if the command is valid, false if not.
+ */
+static int parse_command(char *word, int shaftcount, int topfloor, Command *command)
+{
+    char *text = word + 1;
+    int sign, distance;
+
+    switch(tolower((unsigned char)word[0])) {
+        case 'c':
+            command -> type = COMMAND_CALL;
+            if(!parse_number(&text, &command -> floor) || command -> floor > topfloor) {
+                fprintf(stderr, "'%s': call floor must be 0 to %d\n", word, topfloor);
+                return 0;
+            }
+
+            // The direction can only be left off where there is only one way to go
+            if(tolower((unsigned char)*text) == 'u' && command -> floor < topfloor) {
+                command -> direction = DIR_UP;
+                ++text;
+            } else if(tolower((unsigned char)*text) == 'd' && command -> floor > 0) {
+                command -> direction = DIR_DOWN;
+                ++text;
+            } else if(!*text && (command -> floor == 0 || command -> floor == topfloor)) {
+                command -> direction = command -> floor == 0 ? DIR_UP : DIR_DOWN;
+            } else {
+                fprintf(stderr, "'%s': call direction must be u or d, and possible from that floor\n", word);
+                return 0;
+            }
+            break;
+
+        case 's':
+            command -> type = COMMAND_STOP;
+            if(!parse_number(&text, &command -> shaft) || command -> shaft >= shaftcount || *text++ != ':') {
+                fprintf(stderr, "'%s': stops are given as s<shaft>:<floor>, with shaft 0 to %d\n", word, shaftcount - 1);
+                return 0;
+            }
+            if(!parse_number(&text, &command -> floor) || command -> floor > topfloor) {
+                fprintf(stderr, "'%s': stop floor must be 0 to %d\n", word, topfloor);
+                return 0;
+            }
+            break;
+
+        case 't':
+            command -> type = COMMAND_ADVANCE;
+            if(*text++ != '+' || !parse_number(&text, &command -> updates) || command -> updates < 1) {
+                fprintf(stderr, "'%s': time is advanced with t+<updates>\n", word);
+                return 0;
+            }
+            break;
+
+        case 'v':
+        case 'h':
+            command -> type = COMMAND_SCROLL;
+            sign = (*text == '-') ? -1 : 1;
+            if((*text != '+' && *text != '-') || (++text, !parse_number(&text, &distance))) {
+                fprintf(stderr, "'%s': the view is scrolled with v+<floors>, v-<floors>, h+<shafts> or h-<shafts>\n", word);
+                return 0;
+            }
+            command -> floors  = (tolower((unsigned char)word[0]) == 'v') ? sign * distance : 0;
+            command -> columns = (tolower((unsigned char)word[0]) == 'h') ? sign * distance : 0;
+            break;
+
+        case 'q':
+            command -> type = COMMAND_QUIT;
+            break;
+
+        default:
+            fprintf(stderr, "'%s': unknown command; use c<floor>[u|d], s<shaft>:<floor>, t+<updates>, v+<floors>, "
+                            "h+<shafts> or q\n", word);
+            return 0;
+    }
+
+    // Anything left over means the command was mistyped
+    if(*text) {
+        fprintf(stderr, "'%s': unexpected '%s' at the end\n", word, text);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/* ============================================================================ *
+ * Prompting                                                                    *
+ * ============================================================================ */
+
+/** Prompt the user for a line of commands, and make the calls and stops on it. This
+ *  takes the place of prompt_user() or prompt_zones() in the main loop; the line is
+ *  asked for again until it is valid.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor that lifts can service.
+ *  \param zones      The zoned building the shafts are split into, or NULL if they
+ *                    are not zoned.
+ *  \param view       The part of the building being drawn, moved by scrolling.
+ *  \return The number of updates to run before prompting again, 0 if the line only
+ *          scrolled the view, or COMMANDS_QUIT if the simulation should stop.
+ */
+int prompt_commands(Shaft **shafts, int shaftcount, int topfloor, ZonedBuilding *zones, Viewport *view)
+{
+    static char *line = NULL;
+    static size_t linesize = 0;
+    static Command *commands = NULL;
+    static int capacity = 0;
+    int count, num;
+    int updates = 0;
+    int viewonly;
+
+    printf("commands: c<floor>[u|d] call, s<shaft>:<floor> stop, t+<updates> wait, v+/-<floors> h+/-<shafts> scroll, "
+           "q quit: ");
+    fflush(stdout);
+
+    // Keep asking until the line makes sense
+    do {
+        if(getline(&line, &linesize, stdin) < 0) {
+            return COMMANDS_QUIT;
+        }
+    } while((count = parse_commands(line, shaftcount, topfloor, &commands, &capacity)) < 0);
+
+    viewonly = count > 0;
+    for(num = 0; num < count; ++num) {
+        uint64_t begin = profile_begin();
+
+        switch(commands[num].type) {
+            case COMMAND_CALL:
+                if(zones) {
+                    zone_call(zones, commands[num].floor, commands[num].direction);
+                } else {
+                    call_lift(shafts, shaftcount, commands[num].floor, commands[num].direction);
+                }
+                profile_end(PHASE_DISPATCH, begin);
+                notify_call(commands[num].floor, commands[num].direction);
+                break;
+
+            case COMMAND_STOP:
+                if(zones) {
+                    zone_stop(zones, commands[num].shaft, commands[num].floor);
+                } else {
+                    set_stop(shafts[commands[num].shaft] -> car, commands[num].floor);
+                }
+                profile_end(PHASE_DISPATCH, begin);
+                notify_stop(commands[num].shaft, commands[num].floor);
+                break;
+
+            case COMMAND_ADVANCE:
+                updates = (updates > INT_MAX - commands[num].updates) ? INT_MAX : updates + commands[num].updates;
+                break;
+
+            case COMMAND_SCROLL:
+                scroll_viewport(view, shafts, shaftcount, commands[num].floors, commands[num].columns);
+                break;
+
+            case COMMAND_QUIT:
+                return COMMANDS_QUIT;
+        }
+
+        if(commands[num].type != COMMAND_SCROLL) {
+            viewonly = 0;
+        }
+    }
+
+    if(viewonly) {
+        return 0;
+    }
+    return updates ? updates : 1;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Read a non-negative number from the start of some text, moving the text on past it.
+ *
+ *  \param text  A pointer to the text to read from.
+ *  \param value A pointer to the variable to store the number in.
+ *  \return true if a number was read, false if the text does not start with a digit
+ *          or the number is too big.
+ */
+static int parse_number(char **text, int *value)
+{
+    char *end;
+    long parsed;
+
+    if(!isdigit((unsigned char)**text)) {
+        return 0;
+    }
+
+    errno = 0;
+    parsed = strtol(*text, &end, 10);
+    if(errno || parsed > INT_MAX) {
+        return 0;
+    }
+
+    *value = (int)parsed;
+    *text = end;
+    return 1;
+}
+
+
+/** Make sure there is room for another command, and return it.
+ *
+ *  \param commands A pointer to the block of Commands, which may be reallocated.
+ *  \param capacity A pointer to the number of Commands there is room for.
+ *  \param count    The number of Commands in use.
+ *  \return A pointer to the next free Command.
+ */
+static Command *add_command(Command **commands, int *capacity, int count)
+{
+    if(count >= *capacity) {
+        int grown = *capacity ? *capacity * 2 : 16;
+        Command *bigger = (Command *)realloc(*commands, grown * sizeof(Command));
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to allocate space for commands!\n");
+            exit(1);
+        }
+
+        *commands = bigger;
+        *capacity = grown;
+    }
+
+    return &(*commands)[count];
+}
@@ -0,0 +1,42 @@
+/** \file command.h
+ *  Declarations for the command line prompt, which accepts any number of calls,
+ *  stops and fast-forwards on one line of input.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "lift.h"
+#include "shaft.h"
+#include "viewport.h"
+#include "zone.h"
+
+/** Returned by prompt_commands() when the user quits or the input ends. */
+#define COMMANDS_QUIT -1
+
+/** The things a command can ask for. */
+typedef enum {
+    COMMAND_CALL,       //!< A hall call: c<floor>[u|d]
+    COMMAND_STOP,       //!< A stop for one shaft's lift: s<shaft>:<floor>
+    COMMAND_ADVANCE,    //!< Let time pass before the next prompt: t+<updates>
+    COMMAND_SCROLL,     //!< Move the view up, down, left or right: v+<floors>, h-<shafts>
+    COMMAND_QUIT,       //!< Stop the simulation: q
+} CommandType;
+
+/** One parsed command. Only the fields its type uses are set. */
+typedef struct {
+    CommandType type;   //!< What the command asks for.
+    int shaft;          //!< The shaft a stop is for.
+    int floor;          //!< The floor of a call or stop.
+    Moving direction;   //!< The direction of a call.
+    int updates;        //!< The number of updates to advance by.
+    int floors;         //!< Floors to scroll the view up by; negative scrolls down.
+    int columns;        //!< Shafts to scroll the view right by; negative scrolls left.
+} Command;
+
+int parse_commands(char *line, int shaftcount, int topfloor, Command **commands, int *capacity);
+int prompt_commands(Shaft **shafts, int shaftcount, int topfloor, ZonedBuilding *zones, Viewport *view);
+
+#endif
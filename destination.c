@@ -0,0 +1,697 @@
+/** \file destination.c
+ *  This file contains destination dispatch. With ordinary hall calls a lift is
+ *  sent to a floor knowing only which way the caller wants to go, and finds out
+ *  where they are going once they are inside. Under destination control the
+ *  passenger enters their destination on the landing, and is told which lift to
+ *  wait for. Knowing every passenger's destination up front lets the dispatcher
+ *  put people going to the same or nearby floors in the same lift, so each lift
+ *  makes fewer stops per trip, which is what raises the number of people a bank
+ *  of lifts can move at busy times.
+ *
+ *  Each new call is given to the lift with the lowest combined cost: the time the
+ *  passenger would wait for it, the time they would ride in it, and the delay to
+ *  everybody already in it or waiting for it if it has to make extra stops. A lift
+ *  already stopping at both the passenger's floor and their destination costs the
+ *  others nothing, so passengers are grouped without any explicit grouping rule.
+ *
+ *  The cost of a lift changes as calls are given to it, so each time a lift takes
+ *  a new call the calls already waiting for that lift - and only that lift - are
+ *  looked at again, and moved if another lift could now take them a good deal
+ *  sooner. Lifts stop for their calls using the hall call bits in stops.h, so a
+ *  lift only opens for a waiting passenger when it is going their way.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "destination.h"
+#include "hallcall.h"
+#include "liftfsm.h"
+#include "passenger.h"
+#include "profile.h"
+#include "traffic.h"
+
+// Initial size of the call pool; it doubles whenever it fills up
+#define POOL_SIZE 1024
+
+// The index of a lift's count of waiting calls for a floor and direction, and of
+// a lift's count of waiting calls going to a floor
+#define PICKUP(building, shaftnum, floor, direction) \
+    ((((shaftnum) * ((building) -> topfloor + 1) + (floor)) * 2) + ((direction) == DIR_DOWN))
+#define DROPOFF(building, shaftnum, floor) (((shaftnum) * ((building) -> topfloor + 1)) + (floor))
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int choose_lift(Destinations *building, DestinationCall *call, int exclude, int crowded, int *cost);
+static int trip_cost(Destinations *building, int shaftnum, DestinationCall *call, int joining);
+static int passing(Destinations *building, int shaftnum, int floor);
+static int stops_between(Destinations *building, int shaftnum, int from, int to);
+static void reconsider(Destinations *building, int shaftnum, int except);
+static void attach(Destinations *building, int id, int shaftnum);
+static void detach(Destinations *building, int id);
+static void lift_open(Destinations *building, int shaftnum);
+static void mark_pickups(Destinations *building, int shaftnum);
+static int doors_busy(Lift *car, int floor);
+static int between(int from, int floor, int to);
+static int new_call(Destinations *building);
+static void release_call(Destinations *building, int id);
+
+
+/* ============================================================================ *
+ * Creating and releasing the building                                          *
+ * ============================================================================ */
+
+/** Set up destination control for a building with no calls waiting.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param capacity   The most passengers a lift can hold, at least 1.
+ *  \return A pointer to the new building.
+ */
+Destinations *create_destinations(Shaft **shafts, int shaftcount, int topfloor, int capacity)
+{
+    int i;
+    Destinations *building = (Destinations *)calloc(1, sizeof(Destinations));
+
+    if(building) {
+        building -> waiting  = (int *)malloc(shaftcount * sizeof(int));
+        building -> riding   = (int *)malloc(shaftcount * sizeof(int));
+        building -> load     = (int *)calloc(shaftcount, sizeof(int));
+        building -> booked   = (int *)calloc(shaftcount, sizeof(int));
+        building -> pickups  = (int *)calloc(shaftcount * (topfloor + 1) * 2, sizeof(int));
+        building -> dropoffs = (int *)calloc(shaftcount * (topfloor + 1), sizeof(int));
+    }
+    if(!building || !building -> waiting || !building -> riding || !building -> load ||
+       !building -> booked || !building -> pickups || !building -> dropoffs) {
+        fprintf(stderr, "Unable to allocate space for destination control.\n");
+        exit(1);
+    }
+
+    building -> shafts     = shafts;
+    building -> shaftcount = shaftcount;
+    building -> topfloor   = topfloor;
+    building -> capacity   = capacity > 0 ? capacity : 1;
+    building -> freelist   = NO_PASSENGER;
+
+    for(i = 0; i < shaftcount; ++i) {
+        building -> waiting[i] = NO_PASSENGER;
+        building -> riding[i]  = NO_PASSENGER;
+    }
+
+    return building;
+}
+
+
+/** Release the memory used by destination control. The shafts are left alone.
+ *
+ *  \param building The building to free.
+ */
+void free_destinations(Destinations *building)
+{
+    free(building -> pool);
+    free(building -> waiting);
+    free(building -> riding);
+    free(building -> load);
+    free(building -> booked);
+    free(building -> pickups);
+    free(building -> dropoffs);
+    free(building);
+}
+
+
+/* ============================================================================ *
+ * Making calls and moving passengers                                           *
+ * ============================================================================ */
+
+/** Make a destination call: a passenger on one floor asks to go to another, and
+ *  is given a lift to wait for. The calls already waiting for that lift are then
+ *  looked at again, as the lift now has more to do.
+ *
+ *  \param building    The building the call is made in.
+ *  \param floor       The floor the call is made on.
+ *  \param destination The floor the passenger wants to go to.
+ *  \return The shaft of the lift to wait for, or NO_CAR if the destination is
+ *          the floor the passenger is on.
+ */
+int destination_call(Destinations *building, int floor, int destination)
+{
+    DestinationCall *call;
+    long start = cpu_nanos();
+    int id, shaftnum, cost;
+
+    if(floor == destination) {
+        return NO_CAR;
+    }
+
+    id   = new_call(building);
+    call = &building -> pool[id];
+
+    call -> floor       = floor;
+    call -> destination = destination;
+    call -> direction   = (destination > floor) ? DIR_UP : DIR_DOWN;
+    call -> called      = building -> now;
+    call -> boarded     = 0;
+    ++building -> calls;
+
+    shaftnum = choose_lift(building, call, NO_CAR, 1, &cost);
+    attach(building, id, shaftnum);
+    reconsider(building, shaftnum, id);
+
+    building -> dispatch_nanos += cpu_nanos() - start;
+    return shaftnum;
+}
+
+
+/** Let passengers get in and out of the lifts after the latest update. This should
+ *  be called once after every update_shafts(). Passengers get out of any lift with
+ *  its doors open at their destination, and get into the lift they were given if
+ *  it is open on their floor and going their way. Each lift's hall call bits are
+ *  then brought up to date, as a lift may have filled up or have room again.
+ *
+ *  \param building The building to update.
+ */
+void destinations_tick(Destinations *building)
+{
+    int shaftnum;
+    Lift *car;
+
+    ++building -> now;
+
+    for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+        car = building -> shafts[shaftnum] -> car;
+
+        if(get_state(car) == STATE_OPEN) {
+            if(get_time(car) == 0) {
+                ++building -> openings;
+            }
+            lift_open(building, shaftnum);
+        }
+        mark_pickups(building, shaftnum);
+    }
+}
+
+
+/** Move passengers in and out of a lift with open doors. Riders for this floor get
+ *  out first, then the passengers waiting for this lift get in, in the order they
+ *  called, if it is going their way. A passenger who finds the lift full is given
+ *  another lift, or waits for this one to come back if there is no other.
+ *
+ *  \param building The building the lift is in.
+ *  \param shaftnum The shaft of the lift.
+ */
+static void lift_open(Destinations *building, int shaftnum)
+{
+    Lift *car = building -> shafts[shaftnum] -> car;
+    int floor = at_floor(car);
+    int id, next, other, cost, *link;
+    long wait, trip;
+
+    // Out first...
+    for(link = &building -> riding[shaftnum]; *link != NO_PASSENGER; ) {
+        DestinationCall *call = &building -> pool[*link];
+
+        if(call -> destination != floor) {
+            link = &call -> next;
+            continue;
+        }
+
+        id    = *link;
+        *link = call -> next;
+
+        wait = call -> boarded - call -> called;
+        trip = building -> now - call -> called;
+        ++building -> served;
+        building -> total_wait += wait;
+        building -> total_ride += building -> now - call -> boarded;
+        if(wait > building -> longest_wait) {
+            building -> longest_wait = wait;
+        }
+        if(trip > building -> longest_trip) {
+            building -> longest_trip = trip;
+        }
+
+        --building -> load[shaftnum];
+        ++building -> moved;
+        release_call(building, id);
+    }
+
+    // ...then in
+    for(id = building -> waiting[shaftnum]; id != NO_PASSENGER; id = next) {
+        DestinationCall *call = &building -> pool[id];
+
+        next = call -> next;
+        if(call -> floor != floor || !going_my_way(car, call -> direction)) {
+            continue;
+        }
+
+        if(building -> load[shaftnum] >= building -> capacity) {
+            if(get_time(car) == 0) {
+                ++building -> left_behind;
+            }
+            if((other = choose_lift(building, call, shaftnum, 1, &cost)) != NO_CAR) {
+                detach(building, id);
+                attach(building, id, other);
+                ++building -> reassigned;
+            }
+            continue;
+        }
+
+        detach(building, id);
+        call -> boarded = building -> now;
+        call -> next    = building -> riding[shaftnum];
+        building -> riding[shaftnum] = id;
+        ++building -> load[shaftnum];
+        ++building -> moved;
+        set_stop(car, call -> destination);
+    }
+}
+
+
+/* ============================================================================ *
+ * Choosing lifts                                                               *
+ * ============================================================================ */
+
+/** Find the lift that could take a passenger at the lowest combined cost. Lifts
+ *  that already have as many passengers riding and waiting as they can hold are
+ *  only used if every lift is that busy, and then only if 'crowded' allows it.
+ *
+ *  \param building The building.
+ *  \param call     The passenger's call.
+ *  \param exclude  A shaft whose lift must not be chosen, or NO_CAR.
+ *  \param crowded  true to fall back on busy lifts, false to only use lifts with room.
+ *  \param cost     A pointer to an int to store the chosen lift's cost in.
+ *  \return The shaft of the chosen lift, or NO_CAR if there is none.
+ */
+static int choose_lift(Destinations *building, DestinationCall *call, int exclude, int crowded, int *cost)
+{
+    int best = NO_CAR, bestcost = INT_MAX;
+    int shaftnum, estimate, pass;
+
+    for(pass = 0; pass < 1 + crowded && best == NO_CAR; ++pass) {
+        for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+            if(shaftnum == exclude ||
+               (!pass && building -> load[shaftnum] + building -> booked[shaftnum] >= building -> capacity)) {
+                continue;
+            }
+
+            // When every lift is busy, spread the queue out: each passenger a lift has
+            // beyond what it can hold counts as another stop's worth of delay
+            estimate = trip_cost(building, shaftnum, call, 1);
+            if(pass) {
+                estimate += (building -> load[shaftnum] + building -> booked[shaftnum] - building -> capacity + 1) *
+                            STOP_OVERHEAD;
+            }
+            if(estimate < bestcost) {
+                bestcost = estimate;
+                best = shaftnum;
+            }
+        }
+    }
+
+    *cost = bestcost;
+    return best;
+}
+
+
+/** Estimate the cost of a passenger travelling in a lift: how long they would wait
+ *  for it, plus how long they would ride in it. If the passenger is joining the
+ *  lift, each stop it would have to add costs STOP_OVERHEAD for every passenger
+ *  already riding in it or waiting for it whose journey passes that floor.
+ *
+ *  \param building The building.
+ *  \param shaftnum The shaft of the lift.
+ *  \param call     The passenger's call.
+ *  \param joining  true if the passenger has not been given this lift yet.
+ *  \return The estimated cost, in updates.
+ */
+static int trip_cost(Destinations *building, int shaftnum, DestinationCall *call, int joining)
+{
+    Lift *car = building -> shafts[shaftnum] -> car;
+    int bit = (call -> direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+    int cost;
+
+    cost = hall_eta(car, call -> floor, call -> direction) +
+           (abs(call -> destination - call -> floor) * FLOOR_HEIGHT) / get_speed(car) +
+           stops_between(building, shaftnum, call -> floor, call -> destination) * STOP_OVERHEAD;
+
+    if(joining) {
+        if(!(car -> stops[call -> floor] & (STOP_CAR | bit))) {
+            cost += passing(building, shaftnum, call -> floor) * STOP_OVERHEAD;
+        }
+        if(!(car -> stops[call -> destination] & STOP_CAR) &&
+           !building -> dropoffs[DROPOFF(building, shaftnum, call -> destination)]) {
+            cost += passing(building, shaftnum, call -> destination) * STOP_OVERHEAD;
+        }
+    }
+
+    return cost;
+}
+
+
+/** Count the passengers in a lift, or waiting for it, who would be held up if it
+ *  stopped at a floor: riders whose destination is beyond it, and waiting
+ *  passengers whose journey to the lift or in it goes past it.
+ *
+ *  \param building The building.
+ *  \param shaftnum The shaft of the lift.
+ *  \param floor    The floor the lift might stop at.
+ *  \return The number of passengers held up.
+ */
+static int passing(Destinations *building, int shaftnum, int floor)
+{
+    int here = get_position(building -> shafts[shaftnum] -> car) / FLOOR_HEIGHT;
+    int id, count = 0;
+
+    for(id = building -> riding[shaftnum]; id != NO_PASSENGER; id = building -> pool[id].next) {
+        count += between(here, floor, building -> pool[id].destination);
+    }
+    for(id = building -> waiting[shaftnum]; id != NO_PASSENGER; id = building -> pool[id].next) {
+        DestinationCall *call = &building -> pool[id];
+
+        count += between(here, floor, call -> floor) || between(call -> floor, floor, call -> destination);
+    }
+
+    return count;
+}
+
+
+/** Count the floors strictly between two floors where a lift will stop, either
+ *  because it has a stop there already or because a passenger waiting for it is
+ *  going there.
+ *
+ *  \param building The building.
+ *  \param shaftnum The shaft of the lift.
+ *  \param from     One floor.
+ *  \param to       The other floor.
+ *  \return The number of stops between them.
+ */
+static int stops_between(Destinations *building, int shaftnum, int from, int to)
+{
+    Lift *car = building -> shafts[shaftnum] -> car;
+    int low  = (from < to ? from : to) + 1;
+    int high = (from < to ? to : from) - 1;
+    int floor, count = 0;
+
+    for(floor = low; floor <= high; ++floor) {
+        count += car -> stops[floor] || building -> dropoffs[DROPOFF(building, shaftnum, floor)];
+    }
+
+    return count;
+}
+
+
+/** Look again at the calls waiting for a lift that has just been given a new one,
+ *  and move any that another lift with room could now take REASSIGN_MARGIN updates
+ *  sooner. Passengers whose lift is already open on their floor are left where
+ *  they are.
+ *
+ *  \param building The building.
+ *  \param shaftnum The shaft of the lift that took the new call.
+ *  \param except   The new call, which is left alone.
+ */
+static void reconsider(Destinations *building, int shaftnum, int except)
+{
+    Lift *car = building -> shafts[shaftnum] -> car;
+    int id, next, other, current, cost;
+
+    for(id = building -> waiting[shaftnum]; id != NO_PASSENGER; id = next) {
+        DestinationCall *call = &building -> pool[id];
+
+        next = call -> next;
+        if(id == except || doors_busy(car, call -> floor)) {
+            continue;
+        }
+
+        current = trip_cost(building, shaftnum, call, 0);
+        other   = choose_lift(building, call, shaftnum, 0, &cost);
+
+        if(other != NO_CAR && cost + REASSIGN_MARGIN < current) {
+            detach(building, id);
+            attach(building, id, other);
+            ++building -> reassigned;
+        }
+    }
+}
+
+
+/** Give a call to a lift: add it to the lift's waiting list, which is kept in the
+ *  order the calls were made so that a passenger who has been moved doesn't lose
+ *  their place, and make sure the lift stops on the caller's floor going their way.
+ *
+ *  \param building The building.
+ *  \param id       The call.
+ *  \param shaftnum The shaft of the lift.
+ */
+static void attach(Destinations *building, int id, int shaftnum)
+{
+    DestinationCall *call = &building -> pool[id];
+    int *link = &building -> waiting[shaftnum];
+
+    while(*link != NO_PASSENGER && building -> pool[*link].called <= call -> called) {
+        link = &building -> pool[*link].next;
+    }
+
+    call -> shaft = shaftnum;
+    call -> next  = *link;
+    *link = id;
+
+    ++building -> booked[shaftnum];
+    ++building -> pickups[PICKUP(building, shaftnum, call -> floor, call -> direction)];
+    ++building -> dropoffs[DROPOFF(building, shaftnum, call -> destination)];
+    mark_pickups(building, shaftnum);
+}
+
+
+/** Take a call off its lift's waiting list. If nobody else is waiting for the lift
+ *  on that floor going that way, the lift no longer needs to stop there.
+ *
+ *  \param building The building.
+ *  \param id       The call.
+ */
+static void detach(Destinations *building, int id)
+{
+    DestinationCall *call = &building -> pool[id];
+    int shaftnum = call -> shaft;
+    int *link = &building -> waiting[shaftnum];
+
+    while(*link != id) {
+        link = &building -> pool[*link].next;
+    }
+    *link = call -> next;
+
+    --building -> booked[shaftnum];
+    --building -> dropoffs[DROPOFF(building, shaftnum, call -> destination)];
+    if(--building -> pickups[PICKUP(building, shaftnum, call -> floor, call -> direction)] == 0) {
+        building -> shafts[shaftnum] -> car -> stops[call -> floor] &=
+            ~((call -> direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP);
+    }
+}
+
+
+/** Set a lift's hall call bits to match the calls waiting for it. A full lift has
+ *  the bits for the floor it is on taken away, or it would open its doors there
+ *  again and again with nobody able to get in; they come back once it has moved
+ *  on or has room. This also puts back a bit the lift cleared on arriving at a
+ *  floor where the passenger then couldn't get in, because a rider had given the
+ *  lift a stop the other way.
+ *
+ *  \param building The building.
+ *  \param shaftnum The shaft of the lift.
+ */
+static void mark_pickups(Destinations *building, int shaftnum)
+{
+    Lift *car = building -> shafts[shaftnum] -> car;
+    int full = building -> load[shaftnum] >= building -> capacity ? at_floor(car) : NOT_AT_FLOOR;
+    int floor;
+
+    for(floor = 0; floor <= building -> topfloor; ++floor) {
+        car -> stops[floor] &= ~(STOP_HALL_UP | STOP_HALL_DOWN);
+        if(floor != full && building -> pickups[PICKUP(building, shaftnum, floor, DIR_UP)]) {
+            car -> stops[floor] |= STOP_HALL_UP;
+        }
+        if(floor != full && building -> pickups[PICKUP(building, shaftnum, floor, DIR_DOWN)]) {
+            car -> stops[floor] |= STOP_HALL_DOWN;
+        }
+    }
+}
+
+
+/* ============================================================================ *
+ * Headless runs                                                                *
+ * ============================================================================ */
+
+/** Run a building under destination control without any user input, and print out
+ *  how long passengers waited and rode for, and how well they were grouped. The
+ *  same arrivals are then run through the ordinary passenger simulation on a fresh
+ *  set of lifts, for comparison. Passengers appear at 'rate' per 1000 updates.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param ticks      The number of updates to run for.
+ *  \param rate       Passengers arriving per 1000 updates.
+ *  \param capacity   The most passengers each lift can hold.
+ *  \param seed       The seed for the random arrivals and destinations.
+ */
+void run_destinations(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity, uint64_t seed)
+{
+    Destinations *building = create_destinations(shafts, shaftcount, topfloor, capacity);
+    Shaft *others[shaftcount];
+    Passengers *sim;
+    Traffic arrivals, destinations;
+    long tick, spawned = 0;
+    int arriving, floor, destination, shaftnum;
+    Moving direction;
+
+    // Arrivals are drawn as simulate_passengers() draws them, so both runs see the same ones
+    init_traffic(&arrivals, seed, topfloor, 1000, 0);
+    init_traffic(&destinations, seed + 1, topfloor, 0, 0);
+
+    for(tick = 0; tick < ticks; ++tick) {
+        update_shafts(shafts, shaftcount);
+        destinations_tick(building);
+
+        arriving = rate / 1000 + (traffic_random(&arrivals, 1000) < rate % 1000);
+        while(arriving-- > 0 && next_call(&arrivals, &floor, &direction)) {
+            if(direction == DIR_UP) {
+                destination = floor + 1 + traffic_random(&destinations, topfloor - floor);
+            } else {
+                destination = traffic_random(&destinations, floor);
+            }
+            destination_call(building, floor, destination);
+            ++spawned;
+        }
+    }
+
+    printf("Destination control\n");
+    printf("Passengers:     %ld arrived, %ld delivered, %d still in the building\n",
+           spawned, building -> served, building -> live);
+    if(building -> served) {
+        printf("Average wait:   %.1f updates (longest %ld)\n",
+               (double)building -> total_wait / building -> served, building -> longest_wait);
+        printf("Average ride:   %.1f updates\n", (double)building -> total_ride / building -> served);
+        printf("Average trip:   %.1f updates (longest %ld)\n",
+               (double)(building -> total_wait + building -> total_ride) / building -> served, building -> longest_trip);
+    }
+    printf("Grouping:       %.2f passengers in or out each time a lift opened\n",
+           building -> openings ? (double)building -> moved / building -> openings : 0.0);
+    printf("Dispatch:       %.2f microseconds of CPU per call, %ld calls moved to another lift\n",
+           building -> calls ? building -> dispatch_nanos / 1000.0 / building -> calls : 0.0, building -> reassigned);
+    printf("Left behind:    %ld times, by lifts holding %d passengers\n", building -> left_behind, capacity);
+
+    free_destinations(building);
+
+    // The same arrivals with ordinary hall calls, for comparison
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        others[shaftnum] = create_shaft(topfloor, get_speed(shafts[shaftnum] -> car));
+    }
+    sim = create_passengers(others, shaftcount, topfloor, seed + 1);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        set_capacity(sim, shaftnum, capacity);
+    }
+
+    spawned = simulate_passengers(sim, ticks, rate, seed);
+
+    printf("\nHall calls, with the same arrivals\n");
+    printf("Passengers:     %ld arrived, %ld delivered, %d still in the building\n", spawned, sim -> served, sim -> live);
+    if(sim -> served) {
+        printf("Average wait:   %.1f updates (longest %ld)\n", (double)sim -> total_wait / sim -> served, sim -> max_wait);
+        printf("Average ride:   %.1f updates\n", (double)sim -> total_ride / sim -> served);
+        printf("Average trip:   %.1f updates\n", (double)(sim -> total_wait + sim -> total_ride) / sim -> served);
+    }
+
+    free_passengers(sim);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        free_shaft(others[shaftnum]);
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Determine whether a lift is at a floor with its doors opening, open or closing,
+ *  or waiting to move off.
+ *
+ *  \param car   The lift to inspect.
+ *  \param floor The floor to check.
+ *  \return true if the lift is stopped at the floor, false otherwise.
+ */
+static int doors_busy(Lift *car, int floor)
+{
+    State state = get_state(car);
+
+    return at_floor(car) == floor && state != STATE_MOVING && state != STATE_IDLE;
+}
+
+
+/** Determine whether a floor lies strictly between two others.
+ *
+ *  \param from  One end.
+ *  \param floor The floor to check.
+ *  \param to    The other end.
+ *  \return true if the floor is between them, false otherwise.
+ */
+static int between(int from, int floor, int to)
+{
+    return (from < floor && floor < to) || (to < floor && floor < from);
+}
+
+
+/** Take a call from the free list, growing the pool if there are none free.
+ *
+ *  \param building The building.
+ *  \return The number of the new call in the pool.
+ */
+static int new_call(Destinations *building)
+{
+    int id;
+
+    if(building -> freelist == NO_PASSENGER) {
+        int newsize = building -> poolsize ? building -> poolsize * 2 : POOL_SIZE;
+        DestinationCall *bigger = (DestinationCall *)realloc(building -> pool, newsize * sizeof(DestinationCall));
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to allocate space for %d destination calls.\n", newsize);
+            exit(1);
+        }
+
+        // Put all the new calls on the free list, lowest first
+        for(id = newsize - 1; id >= building -> poolsize; --id) {
+            bigger[id].next = building -> freelist;
+            building -> freelist = id;
+        }
+
+        building -> pool = bigger;
+        building -> poolsize = newsize;
+    }
+
+    id = building -> freelist;
+    building -> freelist = building -> pool[id].next;
+    ++building -> live;
+
+    return id;
+}
+
+
+/** Put a finished call back on the free list.
+ *
+ *  \param building The building.
+ *  \param id       The call.
+ */
+static void release_call(Destinations *building, int id)
+{
+    building -> pool[id].next = building -> freelist;
+    building -> freelist = id;
+    --building -> live;
+}
+
+
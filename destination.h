@@ -0,0 +1,69 @@
+/** \file destination.h
+ *  Declarations for destination dispatch, where passengers give the floor they
+ *  are going to when they call a lift, and are told which lift to wait for.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef DESTINATION_H
+#define DESTINATION_H
+
+#include <stdint.h>
+#include "shaft.h"
+
+/** One passenger's destination call. Until they board it is on the waiting list
+ *  of the lift they were given, and from then on it is on that lift's riding list.
+ */
+typedef struct {
+    int floor;          //!< The floor the call was made on.
+    int destination;    //!< The floor the passenger is going to.
+    Moving direction;   //!< The direction they are going in.
+    int shaft;          //!< The shaft of the lift they were given.
+    long called;        //!< The update the call was made on.
+    long boarded;       //!< The update the passenger got into a lift on.
+    int next;           //!< The next call on the same list, or NO_PASSENGER.
+} DestinationCall;
+
+/** A building run under destination control. Each lift keeps count of the calls
+ *  given to it by floor and direction, so that it stops for them with hall call
+ *  bits, and of the destinations of the passengers it has still to pick up, so
+ *  that new calls can be matched to lifts already going their way.
+ */
+typedef struct {
+    Shaft **shafts;         //!< The shafts in the building.
+    int shaftcount;         //!< The number of shafts.
+    int topfloor;           //!< The top floor of the building.
+    int capacity;           //!< The most passengers a lift can hold.
+    long now;               //!< The current update.
+
+    DestinationCall *pool;  //!< All calls, live and free.
+    int poolsize;           //!< The size of the pool.
+    int freelist;           //!< The first unused call in the pool.
+    int live;               //!< Passengers waiting or riding.
+    int *waiting;           //!< The first call waiting for each shaft's lift.
+    int *riding;            //!< The first passenger riding in each shaft's lift.
+    int *load;              //!< Passengers riding in each shaft's lift.
+    int *booked;            //!< Calls waiting for each shaft's lift.
+    int *pickups;           //!< Calls waiting for each lift, by shaft, floor and direction.
+    int *dropoffs;          //!< Destinations of calls waiting for each lift, by shaft and floor.
+
+    long calls;             //!< Destination calls made.
+    long served;            //!< Passengers who have reached their destination.
+    long total_wait;        //!< Sum of their waiting times.
+    long total_ride;        //!< Sum of their riding times.
+    long longest_wait;      //!< The longest any of them waited.
+    long longest_trip;      //!< The longest any of them took from calling to arriving.
+    long openings;          //!< Times a lift opened its doors.
+    long moved;             //!< Passengers getting in or out.
+    long reassigned;        //!< Times a waiting call was moved to another lift.
+    long left_behind;       //!< Times a passenger could not get into their lift because it was full.
+    long dispatch_nanos;    //!< CPU time spent choosing lifts.
+} Destinations;
+
+Destinations *create_destinations(Shaft **shafts, int shaftcount, int topfloor, int capacity);
+void free_destinations(Destinations *building);
+int destination_call(Destinations *building, int floor, int destination);
+void destinations_tick(Destinations *building);
+void run_destinations(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity, uint64_t seed);
+
+#endif
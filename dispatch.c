@@ -0,0 +1,543 @@
+/** \file dispatch.c
+ *  This file contains the dispatchers, and the tournament that compares them. A
+ *  dispatcher is a table of functions (see dispatch.h) that the simulation calls
+ *  as hall calls are made and the lifts move, so strategies can be swapped without
+ *  touching the simulation. The dispatchers provided are:
+ *
+ *  - nearest:    call_lift(), which gives each call to one lift for good.
+ *  - zoning:     call_lift() within a group of shafts that serves the call's band
+ *                of floors; the ground floor is served by every shaft.
+ *  - collective: hall calls are answered by the first lift to pass the floor going
+ *                the caller's way; a call no lift is heading for is given to the
+ *                nearest idle lift when there is one.
+ *  - eta:        the hall call registry, which gives each call to the lift that
+ *                can answer it soonest, and moves it as the lifts move.
+ *  - lookahead:  each call is given in turn to every lift in a fork of the
+ *                building, which is run forward, and goes to the lift that left
+ *                the stops waiting least (see lookahead.c).
+ *
+ *  The tournament runs the same passengers through each of them in turn, and
+ *  reports the spread of waiting times and the CPU time each spends per call.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "dispatch.h"
+#include "hallcall.h"
+#include "lookahead.h"
+#include "passenger.h"
+
+// The number of shafts in each zone of the zoning dispatcher
+#define ZONE_SHAFTS 2
+
+
+/** State shared by the dispatchers that only need to know the building. */
+typedef struct {
+    Shaft **shafts;     //!< The shafts in the building.
+    int shaftcount;     //!< The number of shafts.
+    int topfloor;       //!< The top floor of the building.
+} Building;
+
+/** State for the eta dispatcher. */
+typedef struct {
+    Shaft **shafts;     //!< The shafts in the building.
+    HallCalls *halls;   //!< The hall call registry.
+} EtaState;
+
+/** State for the collective dispatcher. Calls are stored as in the hall call
+ *  registry, at [floor * 2] for up and [floor * 2 + 1] for down.
+ */
+typedef struct {
+    Shaft **shafts;     //!< The shafts in the building.
+    int shaftcount;     //!< The number of shafts.
+    int topfloor;       //!< The top floor of the building.
+    char *made;         //!< true for each call waiting to be answered.
+    int *claimed;       //!< The lift carrying each call in its stops, or NO_CAR.
+    char *unavailable;  //!< Lifts that must not be given calls.
+} Collective;
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void *building_init(Shaft **shafts, int shaftcount, int topfloor);
+static void nearest_call(void *state, int floor, Moving direction);
+static void zoning_call(void *state, int floor, Moving direction);
+static void *eta_init(Shaft **shafts, int shaftcount, int topfloor);
+static void eta_release(void *state);
+static void eta_call(void *state, int floor, Moving direction);
+static void eta_tick(void *state);
+static int eta_pending(void *state, int floor, Moving direction);
+static void eta_available(void *state, int shaftnum, int available);
+static void *collective_init(Shaft **shafts, int shaftcount, int topfloor);
+static void collective_release(void *state);
+static void collective_call(void *state, int floor, Moving direction);
+static void collective_tick(void *state);
+static void collective_event(void *state, int shaftnum, State from, State to);
+static int collective_pending(void *state, int floor, Moving direction);
+static void collective_available(void *state, int shaftnum, int available);
+static void claim_call(Collective *group, int call, int shaftnum);
+static void send_idle_car(Collective *group, int call);
+static void *lookahead_init(Shaft **shafts, int shaftcount, int topfloor);
+static void lookahead_release(void *state);
+static void lookahead_place(void *state, int floor, Moving direction);
+static int lookahead_waiting(void *state, int floor, Moving direction);
+
+
+/** All the dispatchers, in the order the tournament runs them. */
+static const Dispatcher dispatchers[] = {
+    { "nearest",    "call_lift(): each call goes to one lift for good",
+      building_init, free, nearest_call, NULL, NULL, NULL, NULL },
+    { "zoning",     "call_lift() within the group of shafts serving the call's floors",
+      building_init, free, zoning_call, NULL, NULL, NULL, NULL },
+    { "collective", "the first lift passing the floor the caller's way answers",
+      collective_init, collective_release, collective_call, collective_tick, collective_event,
+      collective_pending, collective_available },
+    { "eta",        "the lift that can answer soonest, re-dispatched every update",
+      eta_init, eta_release, eta_call, eta_tick, NULL, eta_pending, eta_available },
+    { "lookahead",  "the lift that does best when the building is run forward with the call",
+      lookahead_init, lookahead_release, lookahead_place, NULL, NULL, lookahead_waiting, NULL },
+};
+
+#define DISPATCHER_COUNT ((int)(sizeof(dispatchers) / sizeof(dispatchers[0])))
+
+
+/* ============================================================================ *
+ * Finding dispatchers                                                          *
+ * ============================================================================ */
+
+/** Look up a dispatcher by name.
+ *
+ *  \param name The name of the dispatcher.
+ *  \return A pointer to the dispatcher, or NULL if there is none with that name.
+ */
+const Dispatcher *find_dispatcher(const char *name)
+{
+    int i;
+
+    for(i = 0; i < DISPATCHER_COUNT; ++i) {
+        if(!strcmp(dispatchers[i].name, name)) {
+            return &dispatchers[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/** Print out the names and descriptions of the dispatchers.
+ *
+ *  \param out The stream to print to.
+ */
+void list_dispatchers(FILE *out)
+{
+    int i;
+
+    for(i = 0; i < DISPATCHER_COUNT; ++i) {
+        fprintf(out, "    %-10s %s\n", dispatchers[i].name, dispatchers[i].description);
+    }
+}
+
+
+/* ============================================================================ *
+ * nearest and zoning                                                           *
+ * ============================================================================ */
+
+/** Remember the building, for dispatchers that need nothing else.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \return A pointer to the new Building, to be released with free().
+ */
+static void *building_init(Shaft **shafts, int shaftcount, int topfloor)
+{
+    Building *building = (Building *)malloc(sizeof(Building));
+
+    if(!building) {
+        fprintf(stderr, "Unable to allocate space for the dispatcher.\n");
+        exit(1);
+    }
+
+    building -> shafts     = shafts;
+    building -> shaftcount = shaftcount;
+    building -> topfloor   = topfloor;
+
+    return building;
+}
+
+
+/** Give a call to a lift with call_lift(). */
+static void nearest_call(void *state, int floor, Moving direction)
+{
+    Building *building = (Building *)state;
+
+    call_lift(building -> shafts, building -> shaftcount, floor, direction);
+}
+
+
+/** Give a call to a lift in the zone serving its floor. The shafts are split into
+ *  groups of ZONE_SHAFTS, and the floors above the ground floor into as many bands;
+ *  calls on the ground floor can go to any lift.
+ */
+static void zoning_call(void *state, int floor, Moving direction)
+{
+    Building *building = (Building *)state;
+    int zones = building -> shaftcount / ZONE_SHAFTS;
+    int zone, first, last;
+
+    if(zones < 2 || floor == 0 || building -> topfloor < zones) {
+        call_lift(building -> shafts, building -> shaftcount, floor, direction);
+        return;
+    }
+
+    zone  = ((floor - 1) * zones) / building -> topfloor;
+    first = (zone * building -> shaftcount) / zones;
+    last  = ((zone + 1) * building -> shaftcount) / zones;
+
+    call_lift(building -> shafts + first, last - first, floor, direction);
+}
+
+
+/* ============================================================================ *
+ * eta                                                                          *
+ * ============================================================================ */
+
+/** Set up a hall call registry for the building. */
+static void *eta_init(Shaft **shafts, int shaftcount, int topfloor)
+{
+    EtaState *eta = (EtaState *)malloc(sizeof(EtaState));
+
+    if(!eta) {
+        fprintf(stderr, "Unable to allocate space for the dispatcher.\n");
+        exit(1);
+    }
+
+    eta -> shafts = shafts;
+    eta -> halls  = create_hall_calls(topfloor, shaftcount);
+
+    return eta;
+}
+
+
+/** Release the hall call registry. */
+static void eta_release(void *state)
+{
+    EtaState *eta = (EtaState *)state;
+
+    free_hall_calls(eta -> halls);
+    free(eta);
+}
+
+
+/** Register a call with the hall call registry. */
+static void eta_call(void *state, int floor, Moving direction)
+{
+    EtaState *eta = (EtaState *)state;
+
+    hall_call(eta -> halls, eta -> shafts, floor, direction);
+}
+
+
+/** Re-dispatch every waiting call. */
+static void eta_tick(void *state)
+{
+    EtaState *eta = (EtaState *)state;
+
+    dispatch_hall_calls(eta -> halls, eta -> shafts);
+}
+
+
+/** Ask the registry whether a call is waiting. */
+static int eta_pending(void *state, int floor, Moving direction)
+{
+    return hall_call_pending(((EtaState *)state) -> halls, floor, direction);
+}
+
+
+/** Tell the registry whether a lift may be given calls. */
+static void eta_available(void *state, int shaftnum, int available)
+{
+    set_car_available(((EtaState *)state) -> halls, shaftnum, available);
+}
+
+
+/* ============================================================================ *
+ * collective                                                                   *
+ * ============================================================================ */
+
+/** Set up an empty set of collective calls for the building. */
+static void *collective_init(Shaft **shafts, int shaftcount, int topfloor)
+{
+    Collective *group = (Collective *)calloc(1, sizeof(Collective));
+    int call;
+
+    if(group) {
+        group -> made        = (char *)calloc((topfloor + 1) * 2, sizeof(char));
+        group -> claimed     = (int *)malloc((topfloor + 1) * 2 * sizeof(int));
+        group -> unavailable = (char *)calloc(shaftcount, sizeof(char));
+    }
+    if(!group || !group -> made || !group -> claimed || !group -> unavailable) {
+        fprintf(stderr, "Unable to allocate space for the dispatcher.\n");
+        exit(1);
+    }
+
+    group -> shafts     = shafts;
+    group -> shaftcount = shaftcount;
+    group -> topfloor   = topfloor;
+    for(call = 0; call < (topfloor + 1) * 2; ++call) {
+        group -> claimed[call] = NO_CAR;
+    }
+
+    return group;
+}
+
+
+/** Release the collective calls. */
+static void collective_release(void *state)
+{
+    Collective *group = (Collective *)state;
+
+    free(group -> made);
+    free(group -> claimed);
+    free(group -> unavailable);
+    free(group);
+}
+
+
+/** Record a call, and send an idle lift to it if there is one. Otherwise it waits
+ *  for a lift to pass, or to go idle.
+ */
+static void collective_call(void *state, int floor, Moving direction)
+{
+    Collective *group = (Collective *)state;
+    int call = (floor * 2) + (direction == DIR_DOWN);
+
+    if(!group -> made[call]) {
+        group -> made[call] = 1;
+        send_idle_car(group, call);
+    }
+}
+
+
+/** Clear calls that have been answered, and give calls to lifts passing their
+ *  floors in the right direction. A moving lift at a floor stops there on its next
+ *  update if it has a stop, so setting the call's bit now is in time.
+ */
+static void collective_tick(void *state)
+{
+    Collective *group = (Collective *)state;
+    int call, shaftnum, floor, bit, holder;
+    Lift *car;
+
+    for(call = 0; call < (group -> topfloor + 1) * 2; ++call) {
+        holder = group -> claimed[call];
+        bit = (call & 1) ? STOP_HALL_DOWN : STOP_HALL_UP;
+
+        if(holder != NO_CAR && !(group -> shafts[holder] -> car -> stops[call / 2] & bit)) {
+            group -> made[call] = 0;
+            group -> claimed[call] = NO_CAR;
+        } else if(holder != NO_CAR && group -> unavailable[holder]) {
+            group -> shafts[holder] -> car -> stops[call / 2] &= ~bit;
+            group -> claimed[call] = NO_CAR;
+        }
+    }
+
+    for(shaftnum = 0; shaftnum < group -> shaftcount; ++shaftnum) {
+        car = group -> shafts[shaftnum] -> car;
+        floor = at_floor(car);
+
+        if(get_state(car) != STATE_MOVING || floor == NOT_AT_FLOOR || group -> unavailable[shaftnum] ||
+           get_direction(car) == DIR_NONE) {
+            continue;
+        }
+
+        call = (floor * 2) + (get_direction(car) == DIR_DOWN);
+        if(group -> made[call] && group -> claimed[call] != shaftnum) {
+            claim_call(group, call, shaftnum);
+        }
+    }
+}
+
+
+/** When a lift goes idle, give it the nearest call nobody is answering. Only the
+ *  state the lift has gone into matters, not the one it came from.
+ */
+static void collective_event(void *state, int shaftnum, State from, State to)
+{
+    Collective *group = (Collective *)state;
+    int call, best = -1;
+    int here = get_position(group -> shafts[shaftnum] -> car);
+
+    (void)from;
+
+    if(to != STATE_IDLE || group -> unavailable[shaftnum]) {
+        return;
+    }
+
+    for(call = 0; call < (group -> topfloor + 1) * 2; ++call) {
+        if(group -> made[call] && group -> claimed[call] == NO_CAR &&
+           (best < 0 || abs((call / 2) * FLOOR_HEIGHT - here) < abs((best / 2) * FLOOR_HEIGHT - here))) {
+            best = call;
+        }
+    }
+
+    if(best >= 0) {
+        claim_call(group, best, shaftnum);
+    }
+}
+
+
+/** Determine whether a call is waiting to be answered. */
+static int collective_pending(void *state, int floor, Moving direction)
+{
+    return ((Collective *)state) -> made[(floor * 2) + (direction == DIR_DOWN)];
+}
+
+
+/** Record whether a lift may be given calls; calls it holds are freed on the next tick. */
+static void collective_available(void *state, int shaftnum, int available)
+{
+    ((Collective *)state) -> unavailable[shaftnum] = !available;
+}
+
+
+/** Move a call to a lift, taking it away from the lift that had it.
+ *
+ *  \param group    The collective calls.
+ *  \param call     The call to move.
+ *  \param shaftnum The shaft of the lift to give it to.
+ */
+static void claim_call(Collective *group, int call, int shaftnum)
+{
+    int bit = (call & 1) ? STOP_HALL_DOWN : STOP_HALL_UP;
+
+    if(group -> claimed[call] != NO_CAR) {
+        group -> shafts[group -> claimed[call]] -> car -> stops[call / 2] &= ~bit;
+    }
+
+    group -> shafts[shaftnum] -> car -> stops[call / 2] |= bit;
+    group -> claimed[call] = shaftnum;
+}
+
+
+/** Give a call to the nearest idle lift, if there is one.
+ *
+ *  \param group The collective calls.
+ *  \param call  The call to give out.
+ */
+static void send_idle_car(Collective *group, int call)
+{
+    int shaftnum, best = NO_CAR;
+    int target = (call / 2) * FLOOR_HEIGHT;
+    Lift *car;
+
+    for(shaftnum = 0; shaftnum < group -> shaftcount; ++shaftnum) {
+        car = group -> shafts[shaftnum] -> car;
+
+        if(get_state(car) == STATE_IDLE && !group -> unavailable[shaftnum] &&
+           (best == NO_CAR || abs(get_position(car) - target) < abs(get_position(group -> shafts[best] -> car) - target))) {
+            best = shaftnum;
+        }
+    }
+
+    if(best != NO_CAR) {
+        claim_call(group, call, best);
+    }
+}
+
+
+/* ============================================================================ *
+ * lookahead                                                                    *
+ * ============================================================================ */
+
+/** Set up look-ahead dispatching for the building, running forks on every core.
+ *  The forks take each shaft's top floor from the shaft itself.
+ */
+static void *lookahead_init(Shaft **shafts, int shaftcount, int topfloor)
+{
+    (void)topfloor;
+
+    return create_lookahead(shafts, shaftcount, LOOKAHEAD_HORIZON, (int)sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+
+/** Release the look-ahead dispatching. */
+static void lookahead_release(void *state)
+{
+    free_lookahead((Lookahead *)state);
+}
+
+
+/** Give a call to the lift that does best with it in a fork of the building. */
+static void lookahead_place(void *state, int floor, Moving direction)
+{
+    lookahead_call((Lookahead *)state, floor, direction);
+}
+
+
+/** Determine whether a lift has the call in its stops. */
+static int lookahead_waiting(void *state, int floor, Moving direction)
+{
+    return lookahead_pending((Lookahead *)state, floor, direction);
+}
+
+
+/* ============================================================================ *
+ * The tournament                                                               *
+ * ============================================================================ */
+
+/** Run the same passengers through a fresh building with each dispatcher in turn,
+ *  and print out a table comparing how long passengers waited and how much CPU
+ *  time the dispatcher used per hall call.
+ *
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of the lifts.
+ *  \param ticks      The number of updates to run each dispatcher for.
+ *  \param rate       Passengers arriving per 1000 updates.
+ *  \param capacity   The most passengers each lift can hold.
+ *  \param seed       The seed for the arrivals and destinations.
+ */
+void run_tournament(int shaftcount, int topfloor, int speed, long ticks, int rate, int capacity, uint64_t seed)
+{
+    Shaft *shafts[shaftcount];
+    Passengers *sim;
+    long spawned;
+    int i, shaftnum;
+
+    printf("%d shafts, top floor %d, %ld updates, %d passengers per 1000 updates, %d per lift, seed %lu\n\n",
+           shaftcount, topfloor, ticks, rate, capacity, (unsigned long)seed);
+    printf("%-10s %9s %9s %7s %6s %6s %6s %7s %7s %9s\n", "dispatcher", "arrived", "delivered",
+           "mean", "50%", "90%", "99%", "longest", "ride", "us/call");
+
+    for(i = 0; i < DISPATCHER_COUNT; ++i) {
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            shafts[shaftnum] = create_shaft(topfloor, speed);
+        }
+
+        sim = create_passengers(shafts, shaftcount, topfloor, seed + 1);
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            set_capacity(sim, shaftnum, capacity);
+        }
+        use_dispatcher(sim, &dispatchers[i]);
+
+        spawned = simulate_passengers(sim, ticks, rate, seed);
+
+        printf("%-10s %9ld %9ld %7.1f %6ld %6ld %6ld %7ld %7.1f %9.3f\n", dispatchers[i].name, spawned, sim -> served,
+               sim -> served ? (double)sim -> total_wait / sim -> served : 0.0,
+               wait_percentile(sim, 50), wait_percentile(sim, 90), wait_percentile(sim, 99), sim -> max_wait,
+               sim -> served ? (double)sim -> total_ride / sim -> served : 0.0,
+               sim -> calls ? sim -> dispatch_nanos / 1000.0 / sim -> calls : 0.0);
+
+        free_passengers(sim);
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            free_shaft(shafts[shaftnum]);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+/** \file dispatch.h
+ *  Declarations for pluggable dispatchers. A dispatcher decides which lift answers
+ *  each hall call; several strategies are provided, and can be compared on the
+ *  same traffic with run_tournament().
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "shaft.h"
+
+/** A dispatching strategy. The simulation calls on_call() for each hall call,
+ *  on_tick() after every update of the lifts, and on_car_event() whenever a lift
+ *  changes state. pending() and set_available() may be NULL: without pending(), a
+ *  call counts as pending while any lift has a stop on its floor, and without
+ *  set_available() full lifts have their hall calls taken away and made again.
+ */
+typedef struct {
+    const char *name;                                                       //!< Name used to select the dispatcher.
+    const char *description;                                                //!< One line saying what it does.
+    void *(*init)(Shaft **shafts, int shaftcount, int topfloor);            //!< Set up for a building.
+    void (*release)(void *state);                                           //!< Free what init() set up.
+    void (*on_call)(void *state, int floor, Moving direction);              //!< A hall call has been made.
+    void (*on_tick)(void *state);                                           //!< The lifts have been updated.
+    void (*on_car_event)(void *state, int shaftnum, State from, State to);  //!< A lift has changed state.
+    int (*pending)(void *state, int floor, Moving direction);               //!< Is a call waiting to be answered?
+    void (*set_available)(void *state, int shaftnum, int available);        //!< May a lift be given calls?
+} Dispatcher;
+
+const Dispatcher *find_dispatcher(const char *name);
+void list_dispatchers(FILE *out);
+void run_tournament(int shaftcount, int topfloor, int speed, long ticks, int rate, int capacity, uint64_t seed);
+
+#endif
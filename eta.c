@@ -0,0 +1,439 @@
+/** \file eta.c
+ *  This file contains the ETA table: for every floor and direction, how many
+ *  updates until a lift could open its doors there for a caller going that way,
+ *  and which lift it would be. Hall displays want that for every floor on every
+ *  update, and so do dispatchers trying out assignments. Working it out afresh
+ *  each time means asking every lift about every floor.
+ *
+ *  The table is kept up to date instead. Each lift's time to each entry is found
+ *  by running a copy of the lift forward through update_lift(), with a hall call
+ *  added for that floor and direction, until it opens for the call - jumping from
+ *  one state change to the next as advance_building() does. So the times are
+ *  exactly what the finite state machine will do, not an estimate.
+ *
+ *  A lift's times only need working out again when it does something the copy
+ *  didn't: it changes state or direction, or its stops change. While it carries on
+ *  as planned the update each entry will happen on stays the same, so those are
+ *  what is stored, apart from when the lift passes a floor - a caller there has
+ *  just missed it - when that floor's two entries are worked out again. A lift
+ *  standing idle with nowhere to go takes the same number of updates to get
+ *  anywhere however long it stands there, so its times are stored relative to now.
+ *  Looking up a floor and direction then takes two reads, whatever the size of the
+ *  building.
+ *
+ *  Nothing here prints or exits, as the table is also used by libliftsim; running
+ *  out of memory is reported by create_eta_table() returning NULL.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "eta.h"
+#include "advance.h"
+#include "liftfsm.h"
+#include "stops.h"
+
+// The index of one lift's time for a floor and direction
+#define SLOT(floor, direction) (((floor) * 2) + ((direction) == DIR_DOWN))
+#define ENTRY(table, shaftnum, slot) ((shaftnum) * ((table) -> topfloor + 1) * 2 + (slot))
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void work_out_lift(EtaTable *table, int shaftnum);
+static void work_out_floor(EtaTable *table, int shaftnum, int floor);
+static void work_out_entry(EtaTable *table, int shaftnum, int slot);
+static void pick_best(EtaTable *table, int slot);
+static int time_to_open(EtaTable *table, Lift *car, int floor, Moving direction);
+static int open_for(Lift *car, int floor, Moving direction);
+static int standing_still(Lift *car);
+
+
+/* ============================================================================ *
+ * Creating and releasing the table                                             *
+ * ============================================================================ */
+
+/** Create an ETA table for a building. The times are worked out on the first call
+ *  to refresh_etas().
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \return A pointer to the new table, or NULL if there is not enough memory.
+ */
+EtaTable *create_eta_table(Shaft **shafts, int shaftcount, int topfloor)
+{
+    size_t slots = (size_t)(topfloor + 1) * 2;
+    EtaTable *table = (EtaTable *)calloc(1, sizeof(EtaTable));
+    size_t num;
+
+    if(!table) {
+        return NULL;
+    }
+
+    table -> shafts       = shafts;
+    table -> shaftcount   = shaftcount;
+    table -> topfloor     = topfloor;
+    table -> arrival      = (long *)malloc(shaftcount * slots * sizeof(long));
+    table -> still        = (char *)calloc(shaftcount, sizeof(char));
+    table -> busybest     = (long *)malloc(slots * sizeof(long));
+    table -> busycar      = (int *)malloc(slots * sizeof(int));
+    table -> stillbest    = (long *)malloc(slots * sizeof(long));
+    table -> stillcar     = (int *)malloc(slots * sizeof(int));
+    table -> laststate    = (State *)calloc(shaftcount, sizeof(State));
+    table -> lastdir      = (Moving *)calloc(shaftcount, sizeof(Moving));
+    table -> lastposition = (int *)calloc(shaftcount, sizeof(int));
+    table -> laststops    = (char *)calloc(shaftcount * (size_t)(topfloor + 1), sizeof(char));
+    table -> seen         = (char *)calloc(shaftcount, sizeof(char));
+    table -> scratchstops = (char *)calloc(topfloor + 1, sizeof(char));
+
+    if(!table -> arrival || !table -> still || !table -> busybest || !table -> busycar ||
+       !table -> stillbest || !table -> stillcar || !table -> laststate || !table -> lastdir ||
+       !table -> lastposition || !table -> laststops || !table -> seen || !table -> scratchstops) {
+        free_eta_table(table);
+        return NULL;
+    }
+
+    for(num = 0; num < shaftcount * slots; ++num) {
+        table -> arrival[num] = ETA_NEVER;
+    }
+    for(num = 0; num < slots; ++num) {
+        table -> busybest[num]  = ETA_NEVER;
+        table -> busycar[num]   = -1;
+        table -> stillbest[num] = ETA_NEVER;
+        table -> stillcar[num]  = -1;
+    }
+
+    return table;
+}
+
+
+/** Release the memory used by an ETA table. The shafts are left alone.
+ *
+ *  \param table The table to free. May be NULL.
+ */
+void free_eta_table(EtaTable *table)
+{
+    if(!table) {
+        return;
+    }
+
+    free(table -> arrival);
+    free(table -> still);
+    free(table -> busybest);
+    free(table -> busycar);
+    free(table -> stillbest);
+    free(table -> stillcar);
+    free(table -> laststate);
+    free(table -> lastdir);
+    free(table -> lastposition);
+    free(table -> laststops);
+    free(table -> seen);
+    free(table -> scratchstops);
+    free(table);
+}
+
+
+/* ============================================================================ *
+ * Keeping the table up to date and reading it                                  *
+ * ============================================================================ */
+
+/** Bring the table up to date with the lifts. This should be called after every
+ *  update of the lifts, and after stops or calls are set, before the table is read.
+ *  If the lifts have been moved on by more than one update since it was last called,
+ *  every lift that isn't standing idle has its times worked out again.
+ *
+ *  \param table The table.
+ *  \param now   The number of updates the lifts have been run for.
+ */
+void refresh_etas(EtaTable *table, long now)
+{
+    int floors = table -> topfloor + 1;
+    long elapsed = now - table -> now;
+    int shaftnum, floor, low, high;
+    Lift *car;
+
+    table -> now = now;
+
+    for(shaftnum = 0; shaftnum < table -> shaftcount; ++shaftnum) {
+        car = table -> shafts[shaftnum] -> car;
+
+        if(!table -> seen[shaftnum] || get_state(car) != table -> laststate[shaftnum] ||
+           get_direction(car) != table -> lastdir[shaftnum] || (elapsed > 1 && !table -> still[shaftnum]) ||
+           memcmp(car -> stops, &table -> laststops[shaftnum * floors], floors)) {
+            work_out_lift(table, shaftnum);
+
+        // Carrying on as planned; only the floors it has reached or left have changed
+        } else if(get_position(car) != table -> lastposition[shaftnum]) {
+            low  = get_position(car) < table -> lastposition[shaftnum] ? get_position(car) : table -> lastposition[shaftnum];
+            high = get_position(car) < table -> lastposition[shaftnum] ? table -> lastposition[shaftnum] : get_position(car);
+
+            for(floor = (low + FLOOR_HEIGHT - 1) / FLOOR_HEIGHT; floor * FLOOR_HEIGHT <= high; ++floor) {
+                work_out_floor(table, shaftnum, floor);
+            }
+        }
+
+        table -> seen[shaftnum]         = 1;
+        table -> laststate[shaftnum]    = get_state(car);
+        table -> lastdir[shaftnum]      = get_direction(car);
+        table -> lastposition[shaftnum] = get_position(car);
+        memcpy(&table -> laststops[shaftnum * floors], car -> stops, floors);
+    }
+}
+
+
+/** Find out how soon any lift could open its doors on a floor for a caller going
+ *  one way, as of the last refresh_etas().
+ *
+ *  \param table     The table.
+ *  \param floor     The floor.
+ *  \param direction The direction the caller wants to go in, DIR_UP or DIR_DOWN.
+ *  \param shaftnum  If not NULL, where to store the shaft of the first lift there.
+ *  \return The number of updates until a lift opens there going that way (0 if one
+ *          is already open there), or ETA_NEVER if no lift can.
+ */
+int eta_lookup(const EtaTable *table, int floor, Moving direction, int *shaftnum)
+{
+    int slot = SLOT(floor, direction);
+    long busy = table -> busybest[slot];
+    long still = table -> stillbest[slot];
+    int best = -1;
+    long eta = ETA_NEVER;
+
+    if(busy != ETA_NEVER) {
+        eta  = busy > table -> now ? busy - table -> now : 0;
+        best = table -> busycar[slot];
+    }
+    if(still != ETA_NEVER && (eta == ETA_NEVER || still < eta || (still == eta && table -> stillcar[slot] < best))) {
+        eta  = still;
+        best = table -> stillcar[slot];
+    }
+
+    if(shaftnum) {
+        *shaftnum = best;
+    }
+    return (int)eta;
+}
+
+
+/** Find out how soon one lift could open its doors on a floor for a caller going
+ *  one way, as of the last refresh_etas().
+ *
+ *  \param table     The table.
+ *  \param shaftnum  The shaft of the lift.
+ *  \param floor     The floor.
+ *  \param direction The direction the caller wants to go in, DIR_UP or DIR_DOWN.
+ *  \return The number of updates until the lift opens there going that way, or
+ *          ETA_NEVER if it can't.
+ */
+int car_eta(const EtaTable *table, int shaftnum, int floor, Moving direction)
+{
+    long arrival = table -> arrival[ENTRY(table, shaftnum, SLOT(floor, direction))];
+
+    if(arrival == ETA_NEVER || table -> still[shaftnum]) {
+        return (int)arrival;
+    }
+
+    return arrival > table -> now ? (int)(arrival - table -> now) : 0;
+}
+
+
+/* ============================================================================ *
+ * Working out times                                                            *
+ * ============================================================================ */
+
+/** Work out all of one lift's times again.
+ *
+ *  \param table    The table.
+ *  \param shaftnum The shaft of the lift.
+ */
+static void work_out_lift(EtaTable *table, int shaftnum)
+{
+    int slot;
+
+    table -> still[shaftnum] = standing_still(table -> shafts[shaftnum] -> car);
+
+    for(slot = 0; slot < (table -> topfloor + 1) * 2; ++slot) {
+        work_out_entry(table, shaftnum, slot);
+    }
+}
+
+
+/** Work out one lift's times for both directions on one floor again.
+ *
+ *  \param table    The table.
+ *  \param shaftnum The shaft of the lift.
+ *  \param floor    The floor.
+ */
+static void work_out_floor(EtaTable *table, int shaftnum, int floor)
+{
+    if(floor >= 0 && floor <= table -> topfloor) {
+        work_out_entry(table, shaftnum, SLOT(floor, DIR_UP));
+        work_out_entry(table, shaftnum, SLOT(floor, DIR_DOWN));
+    }
+}
+
+
+/** Work out one lift's time for one entry, and which lift is now first there.
+ *  Nobody calls down from the ground floor or up from the top floor, so those
+ *  entries are always ETA_NEVER.
+ *
+ *  \param table    The table.
+ *  \param shaftnum The shaft of the lift.
+ *  \param slot     The entry, floor * 2 for up or floor * 2 + 1 for down.
+ */
+static void work_out_entry(EtaTable *table, int shaftnum, int slot)
+{
+    int floor = slot / 2;
+    Moving direction = (slot & 1) ? DIR_DOWN : DIR_UP;
+    long *arrival = &table -> arrival[ENTRY(table, shaftnum, slot)];
+    int updates = ETA_NEVER;
+
+    if(!((direction == DIR_DOWN && floor == 0) || (direction == DIR_UP && floor == table -> topfloor))) {
+        updates = time_to_open(table, table -> shafts[shaftnum] -> car, floor, direction);
+        ++table -> worked;
+    }
+
+    if(updates == ETA_NEVER || table -> still[shaftnum]) {
+        *arrival = updates;
+    } else {
+        *arrival = table -> now + updates;
+    }
+
+    pick_best(table, slot);
+}
+
+
+/** Find the first moving lift and the first idle lift for an entry. Ties go to the
+ *  lower shaft number.
+ *
+ *  \param table The table.
+ *  \param slot  The entry.
+ */
+static void pick_best(EtaTable *table, int slot)
+{
+    int shaftnum;
+    long arrival;
+
+    table -> busybest[slot]  = ETA_NEVER;
+    table -> busycar[slot]   = -1;
+    table -> stillbest[slot] = ETA_NEVER;
+    table -> stillcar[slot]  = -1;
+
+    for(shaftnum = 0; shaftnum < table -> shaftcount; ++shaftnum) {
+        arrival = table -> arrival[ENTRY(table, shaftnum, slot)];
+        if(arrival == ETA_NEVER) {
+            continue;
+        }
+
+        if(table -> still[shaftnum]) {
+            if(table -> stillbest[slot] == ETA_NEVER || arrival < table -> stillbest[slot]) {
+                table -> stillbest[slot] = arrival;
+                table -> stillcar[slot]  = shaftnum;
+            }
+        } else if(table -> busybest[slot] == ETA_NEVER || arrival < table -> busybest[slot]) {
+            table -> busybest[slot] = arrival;
+            table -> busycar[slot]  = shaftnum;
+        }
+    }
+}
+
+
+/** Work out how many updates a lift would take to open its doors on a floor for a
+ *  caller going one way, if the call were made now. A copy of the lift is given
+ *  the call and run forward until it stops for it, a state change at a time.
+ *
+ *  \param table     The table, for its scratch lift.
+ *  \param car       The lift.
+ *  \param floor     The floor of the call.
+ *  \param direction The direction the caller wants to go in.
+ *  \return The number of updates until the lift starts opening for the call, 0 if
+ *          it is already opening or open there going that way, or ETA_NEVER if
+ *          it never would.
+ */
+static int time_to_open(EtaTable *table, Lift *car, int floor, Moving direction)
+{
+    Lift *copy = &table -> scratch;
+    int bit = (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+    int elapsed, step, changes;
+
+    if(open_for(car, floor, direction)) {
+        return 0;
+    }
+
+    *copy = *car;
+    copy -> stops = table -> scratchstops;
+    memcpy(copy -> stops, car -> stops, table -> topfloor + 1);
+    copy -> stops[floor] |= bit;
+
+    // The copy has no hold on its doors, so it closes them as soon as it may, and
+    // whatever is left of the real lift's hold is added on
+    elapsed = door_hold(car);
+
+    // Each stop costs a handful of state changes, and there are two sweeps at most
+    for(changes = 0; changes < 16 * (table -> topfloor + 2); ++changes) {
+        if((step = updates_to_change(copy)) == NEVER_CHANGES) {
+            break;
+        }
+
+        skip_updates(copy, step - 1);
+        update_lift(copy);
+        elapsed += step;
+
+        if(get_state(copy) == STATE_OPENING && get_time(copy) == 0 &&
+           at_floor(copy) == floor && !(copy -> stops[floor] & bit)) {
+            return elapsed;
+        }
+    }
+
+    return ETA_NEVER;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Determine whether a lift already has its doors opening or open on a floor, and
+ *  will take a caller going one way (see going_my_way()).
+ *
+ *  \param car       The lift to inspect.
+ *  \param floor     The floor.
+ *  \param direction The direction the caller wants to go in.
+ *  \return true if the caller can get straight in, false otherwise.
+ */
+static int open_for(Lift *car, int floor, Moving direction)
+{
+    if((get_state(car) != STATE_OPENING && get_state(car) != STATE_OPEN) || at_floor(car) != floor) {
+        return 0;
+    }
+
+    return going_my_way(car, direction);
+}
+
+
+/** Determine whether a lift is standing idle with nowhere to go, so that it takes
+ *  the same time to get anywhere however long it stands there.
+ *
+ *  \param car The lift to inspect.
+ *  \return true if the lift is idle with no stops, false otherwise.
+ */
+static int standing_still(Lift *car)
+{
+    int floor;
+
+    if(get_state(car) != STATE_IDLE) {
+        return 0;
+    }
+
+    for(floor = 0; floor <= get_topfloor(car); ++floor) {
+        if(car -> stops[floor]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,57 @@
+/** \file eta.h
+ *  Declarations for the table of how soon a lift could open on each floor, for
+ *  each direction, kept up to date as the lifts move.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef ETA_H
+#define ETA_H
+
+#include "shaft.h"
+
+// The estimate for a floor and direction no lift can answer
+#define ETA_NEVER -1
+
+/** The table. Each floor has an up and a down entry, at [floor * 2] and
+ *  [floor * 2 + 1]. For every lift and entry it holds when the lift would open its
+ *  doors there for a caller going that way, and for every entry the lift that
+ *  would be first.
+ *
+ *  Times for a lift that is standing idle with nowhere to go are kept relative to
+ *  now, as they stay the same for as long as it stands there. Times for any other
+ *  lift are kept as the update they will happen on, as they stay the same while
+ *  the lift carries on as planned. So the table only has to change when a lift does
+ *  something it hadn't planned to, or passes a floor.
+ */
+typedef struct {
+    Shaft **shafts;     //!< The shafts in the building.
+    int shaftcount;     //!< The number of shafts.
+    int topfloor;       //!< The top floor of the building.
+    long now;           //!< The update the table was last brought up to date on.
+
+    long *arrival;      //!< For each lift and entry, when it would open, or ETA_NEVER.
+    char *still;        //!< For each lift, true if its times are relative to now.
+    long *busybest;     //!< For each entry, the earliest update a moving lift would open.
+    int *busycar;       //!< The shaft of that lift, or -1.
+    long *stillbest;    //!< For each entry, the fewest updates an idle lift would take.
+    int *stillcar;      //!< The shaft of that lift, or -1.
+
+    State *laststate;   //!< Each lift's state when the table was last brought up to date.
+    Moving *lastdir;    //!< Each lift's direction then.
+    int *lastposition;  //!< Each lift's position then.
+    char *laststops;    //!< Each lift's stop markers then, topfloor + 1 per lift.
+    char *seen;         //!< For each lift, true once its times have been worked out.
+
+    Lift scratch;       //!< A copy of a lift, run forward to time one entry.
+    char *scratchstops; //!< The copy's stop markers.
+    long worked;        //!< Entries worked out since the table was created.
+} EtaTable;
+
+EtaTable *create_eta_table(Shaft **shafts, int shaftcount, int topfloor);
+void free_eta_table(EtaTable *table);
+void refresh_etas(EtaTable *table, long now);
+int eta_lookup(const EtaTable *table, int floor, Moving direction, int *shaftnum);
+int car_eta(const EtaTable *table, int shaftnum, int floor, Moving direction);
+
+#endif
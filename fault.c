@@ -0,0 +1,482 @@
+/** \file fault.c
+ *  This file contains fault injection. Lifts can be taken out of service at
+ *  scripted updates - with jammed doors, for maintenance, or by losing power - and
+ *  put back once the fault has been dealt with, so that the rest of the building
+ *  can be seen coping without them.
+ *
+ *  A lift taken out of service is left in STATE_OUT_OF_SERVICE, which update_lift()
+ *  leaves alone and call_lift() never gives a call to. Its hall
+ *  calls are handed on straight away by set_in_service(), through the dispatcher,
+ *  looking only at the failed lift's own stops.
+ *
+ *  A lift whose state has been corrupted is the same kind of fault: update_lift()
+ *  takes it out of service itself and reports it through notify_fault(), and it is
+ *  dealt with here like any other failure. A corrupted state can be scripted too,
+ *  to check that the run carries on.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fault.h"
+#include "liftfsm.h"
+#include "notify.h"
+#include "profile.h"
+
+// Initial room for scripted faults; it doubles whenever it fills up
+#define SCRIPT_SIZE 16
+
+// A state no lift should ever be in, used to corrupt one
+#define CORRUPT_STATE ((State)(STATE_OUT_OF_SERVICE + 1))
+
+/** The names of the kinds of fault, as used in scripts. */
+static const char *fault_names[FAULT_KINDS] = { "doors", "maintenance", "power", "state" };
+
+/** How long a lift is out of service for each kind of fault, unless the script says. */
+static const long fault_durations[FAULT_KINDS] = { 300, 2000, 600, 50 };
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void fsm_fault(void *data, Lift *car);
+static void corrupt_lift(Faults *faults, int shaftnum, long duration);
+static void print_results(Passengers *sim, long spawned);
+
+
+/* ============================================================================ *
+ * Creating and releasing fault injection                                       *
+ * ============================================================================ */
+
+/** Set up fault injection for a passenger simulation, with no faults scripted.
+ *  Lifts that update_lift() finds in an illegal state are dealt with from now on,
+ *  until free_faults() is called.
+ *
+ *  \param sim The passenger simulation whose lifts may fail.
+ *  \return A pointer to the new fault injection state.
+ */
+Faults *create_faults(Passengers *sim)
+{
+    Faults *faults = (Faults *)calloc(1, sizeof(Faults));
+    int shaftnum;
+
+    if(faults) {
+        faults -> script    = (Fault *)malloc(SCRIPT_SIZE * sizeof(Fault));
+        faults -> failed    = (long *)malloc(sim -> shaftcount * sizeof(long));
+        faults -> repair    = (long *)malloc(sim -> shaftcount * sizeof(long));
+        faults -> corrupted = (long *)malloc(sim -> shaftcount * sizeof(long));
+        faults -> kind      = (FaultKind *)calloc(sim -> shaftcount, sizeof(FaultKind));
+    }
+    if(!faults || !faults -> script || !faults -> failed || !faults -> repair || !faults -> corrupted ||
+       !faults -> kind || !add_fault_hook(fsm_fault, faults)) {
+        fprintf(stderr, "Unable to allocate space for fault injection.\n");
+        exit(1);
+    }
+
+    faults -> sim = sim;
+    faults -> scriptsize = SCRIPT_SIZE;
+    for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+        faults -> failed[shaftnum]    = IN_SERVICE;
+        faults -> repair[shaftnum]    = NO_REPAIR;
+        faults -> corrupted[shaftnum] = fault_durations[FAULT_STATE];
+    }
+
+    return faults;
+}
+
+
+/** Release the memory used by fault injection. Lifts out of service stay out.
+ *
+ *  \param faults The fault injection state to free.
+ */
+void free_faults(Faults *faults)
+{
+    remove_fault_hook(fsm_fault, faults);
+    free(faults -> script);
+    free(faults -> failed);
+    free(faults -> repair);
+    free(faults -> corrupted);
+    free(faults -> kind);
+    free(faults);
+}
+
+
+/* ============================================================================ *
+ * Scripting faults                                                             *
+ * ============================================================================ */
+
+/** Add a fault to the script. Faults on the same update happen in the order they
+ *  were added.
+ *
+ *  \param faults   The fault injection state.
+ *  \param tick     The update the fault happens on.
+ *  \param shaftnum The shaft of the lift that fails.
+ *  \param kind     What goes wrong.
+ *  \param duration How many updates the lift is out of service for, or NO_REPAIR
+ *                  to leave it out for the rest of the run.
+ *  \return true if the fault was added, false if the shaft or kind is not valid.
+ */
+int add_fault(Faults *faults, long tick, int shaftnum, FaultKind kind, long duration)
+{
+    int slot;
+
+    if(shaftnum < 0 || shaftnum >= faults -> sim -> shaftcount || kind < 0 || kind >= FAULT_KINDS || tick < 0) {
+        return 0;
+    }
+
+    if(faults -> faultcount == faults -> scriptsize) {
+        faults -> scriptsize *= 2;
+        faults -> script = (Fault *)realloc(faults -> script, faults -> scriptsize * sizeof(Fault));
+        if(!faults -> script) {
+            fprintf(stderr, "Unable to allocate space for the fault script.\n");
+            exit(1);
+        }
+    }
+
+    // Scripts are short and usually written in order, so this rarely moves anything
+    for(slot = faults -> faultcount; slot > faults -> nextfault && faults -> script[slot - 1].tick > tick; --slot) {
+        faults -> script[slot] = faults -> script[slot - 1];
+    }
+
+    faults -> script[slot].tick     = tick;
+    faults -> script[slot].shaft    = shaftnum;
+    faults -> script[slot].kind     = kind;
+    faults -> script[slot].duration = duration;
+    ++faults -> faultcount;
+
+    return 1;
+}
+
+
+/** Add the faults described by a script. A script is a comma separated list of
+ *  faults, each written update:shaft:kind, optionally followed by :updates to say
+ *  how long the lift is out of service for (0 for the rest of the run). The kinds
+ *  are doors, maintenance, power, and state. For example, "5000:0:doors,8000:2:power:0".
+ *
+ *  \param faults The fault injection state.
+ *  \param script The script.
+ *  \return true if the whole script was understood, false if not. Faults before the
+ *          first one that was not understood are added anyway.
+ */
+int parse_faults(Faults *faults, const char *script)
+{
+    char name[16];
+    long tick, duration;
+    int shaftnum, kind, used, more;
+
+    while(*script) {
+        if(sscanf(script, "%ld:%d:%15[a-z]%n", &tick, &shaftnum, name, &used) != 3) {
+            fprintf(stderr, "Faults must be written update:shaft:kind[:updates], not '%s'.\n", script);
+            return 0;
+        }
+        script += used;
+
+        for(kind = 0; kind < FAULT_KINDS && strcmp(name, fault_names[kind]); ++kind) {
+        }
+        if(kind == FAULT_KINDS) {
+            fprintf(stderr, "Unknown kind of fault '%s': use doors, maintenance, power, or state.\n", name);
+            return 0;
+        }
+
+        duration = fault_durations[kind];
+        if(*script == ':') {
+            if(sscanf(script, ":%ld%n", &duration, &more) != 1 || duration < 0) {
+                fprintf(stderr, "The time a lift is out of service must be a number of updates, not '%s'.\n", script + 1);
+                return 0;
+            }
+            script += more;
+            if(!duration) {
+                duration = NO_REPAIR;
+            }
+        }
+
+        if(!add_fault(faults, tick, shaftnum, (FaultKind)kind, duration)) {
+            fprintf(stderr, "There is no shaft %d for a fault on update %ld.\n", shaftnum, tick);
+            return 0;
+        }
+
+        if(*script == ',') {
+            ++script;
+        } else if(*script) {
+            fprintf(stderr, "Faults must be separated by commas, not '%s'.\n", script);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/* ============================================================================ *
+ * Failing and repairing lifts                                                  *
+ * ============================================================================ */
+
+/** Take a lift out of service. Its hall calls are handed on to other lifts at once,
+ *  and its riders stay inside until it is repaired. A lift that is already out of
+ *  service is left as it is.
+ *
+ *  \param faults   The fault injection state.
+ *  \param shaftnum The shaft of the lift.
+ *  \param kind     What has gone wrong.
+ *  \param duration How many updates until the lift is put back into service, or
+ *                  NO_REPAIR to leave it out.
+ */
+void fail_lift(Faults *faults, int shaftnum, FaultKind kind, long duration)
+{
+    Passengers *sim = faults -> sim;
+    long start;
+    int handed;
+
+    if(faults -> failed[shaftnum] != IN_SERVICE) {
+        return;
+    }
+
+    start = cpu_nanos();
+    handed = set_in_service(sim, shaftnum, 0);
+    faults -> fault_nanos += cpu_nanos() - start;
+
+    faults -> failed[shaftnum] = sim -> now;
+    faults -> repair[shaftnum] = duration == NO_REPAIR ? NO_REPAIR : sim -> now + duration;
+    faults -> kind[shaftnum]   = kind;
+    ++faults -> out;
+
+    ++faults -> failures[kind];
+    faults -> handed_on += handed;
+    faults -> trapped += sim -> load[shaftnum];
+
+    if(faults -> log) {
+        fprintf(faults -> log, "Update %ld: lift %d out of service (%s), %d riders inside, %d floors' calls handed on\n",
+                sim -> now, shaftnum, fault_names[kind], sim -> load[shaftnum], handed);
+    }
+}
+
+
+/** Put a lift back into service. It starts off idle where it is, and carries on to
+ *  the floors its riders want.
+ *
+ *  \param faults   The fault injection state.
+ *  \param shaftnum The shaft of the lift.
+ */
+void repair_lift(Faults *faults, int shaftnum)
+{
+    Passengers *sim = faults -> sim;
+
+    if(faults -> failed[shaftnum] == IN_SERVICE) {
+        return;
+    }
+
+    set_in_service(sim, shaftnum, 1);
+
+    faults -> outage += sim -> now - faults -> failed[shaftnum];
+    faults -> failed[shaftnum] = IN_SERVICE;
+    faults -> repair[shaftnum] = NO_REPAIR;
+    faults -> corrupted[shaftnum] = fault_durations[FAULT_STATE];
+    --faults -> out;
+    ++faults -> repairs;
+
+    if(faults -> log) {
+        fprintf(faults -> log, "Update %ld: lift %d back in service\n", sim -> now, shaftnum);
+    }
+}
+
+
+/** Make the faults due on this update happen, and repair the lifts due back. This
+ *  should be called once before every update_shafts().
+ *
+ *  \param faults The fault injection state.
+ */
+void faults_tick(Faults *faults)
+{
+    Passengers *sim = faults -> sim;
+    Fault *fault;
+    int shaftnum;
+
+    // Repairs first, so a lift can be failed again on the update it comes back
+    for(shaftnum = 0; faults -> out && shaftnum < sim -> shaftcount; ++shaftnum) {
+        if(faults -> repair[shaftnum] != NO_REPAIR && faults -> repair[shaftnum] <= sim -> now) {
+            repair_lift(faults, shaftnum);
+        }
+    }
+
+    while(faults -> nextfault < faults -> faultcount && faults -> script[faults -> nextfault].tick <= sim -> now) {
+        fault = &faults -> script[faults -> nextfault++];
+
+        if(fault -> kind == FAULT_STATE) {
+            corrupt_lift(faults, fault -> shaft, fault -> duration);
+        } else {
+            fail_lift(faults, fault -> shaft, fault -> kind, fault -> duration);
+        }
+    }
+}
+
+
+/** Corrupt a lift's state, for update_lift() to find on its next update. The lift
+ *  is only taken out of service once it has been found.
+ *
+ *  \param faults   The fault injection state.
+ *  \param shaftnum The shaft of the lift.
+ *  \param duration How long the lift will be out of service once it has been found.
+ */
+static void corrupt_lift(Faults *faults, int shaftnum, long duration)
+{
+    if(faults -> failed[shaftnum] != IN_SERVICE) {
+        return;
+    }
+
+    faults -> corrupted[shaftnum] = duration;
+    set_state(faults -> sim -> shafts[shaftnum] -> car, CORRUPT_STATE);
+}
+
+
+/** Deal with a lift that update_lift() has taken out of service because it was in
+ *  an illegal state. Lifts that are not in this building are left to whoever owns
+ *  them.
+ *
+ *  \param data The fault injection state.
+ *  \param car  The lift.
+ */
+static void fsm_fault(void *data, Lift *car)
+{
+    Faults *faults = (Faults *)data;
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < faults -> sim -> shaftcount; ++shaftnum) {
+        if(faults -> sim -> shafts[shaftnum] -> car == car) {
+            fail_lift(faults, shaftnum, FAULT_STATE, faults -> corrupted[shaftnum]);
+            return;
+        }
+    }
+}
+
+
+/* ============================================================================ *
+ * Resilience drills                                                            *
+ * ============================================================================ */
+
+/** Run a building full of passengers while lifts fail as a script says, reporting
+ *  each fault and repair as it happens, then run the same arrivals with no faults
+ *  and compare how the passengers got on.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param ticks      The number of updates to run for.
+ *  \param rate       Passengers arriving per 1000 updates.
+ *  \param capacity   The most passengers each lift can hold.
+ *  \param dispatcher The dispatcher to make calls through, or NULL for call_loaded().
+ *  \param script     The faults, as parse_faults() reads them.
+ *  \param seed       The seed for the random arrivals and destinations.
+ *  \return true if the drill was run, false if the script was not understood.
+ */
+int run_faults(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity,
+               const Dispatcher *dispatcher, const char *script, uint64_t seed)
+{
+    Passengers *sim = create_passengers(shafts, shaftcount, topfloor, seed + 1);
+    Faults *faults = create_faults(sim);
+    Shaft *others[shaftcount];
+    Traffic arrivals;
+    long tick, spawned = 0, total = 0;
+    int arriving, floor, shaftnum, kind;
+    Moving direction;
+
+    if(!parse_faults(faults, script)) {
+        free_faults(faults);
+        free_passengers(sim);
+        return 0;
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        set_capacity(sim, shaftnum, capacity);
+    }
+    if(dispatcher) {
+        use_dispatcher(sim, dispatcher);
+    }
+    faults -> log = stdout;
+
+    // Arrivals are drawn as simulate_passengers() draws them, so both runs see the same ones
+    init_traffic(&arrivals, seed, topfloor, 1000, 0);
+
+    for(tick = 0; tick < ticks; ++tick) {
+        faults_tick(faults);
+        update_shafts(shafts, shaftcount);
+        passengers_tick(sim);
+
+        arriving = rate / 1000 + (traffic_random(&arrivals, 1000) < rate % 1000);
+        while(arriving-- > 0 && next_call(&arrivals, &floor, &direction)) {
+            spawn_passenger(sim, floor, direction);
+            ++spawned;
+        }
+    }
+
+    // Lifts still out of service count up to the end of the run
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        if(faults -> failed[shaftnum] != IN_SERVICE) {
+            faults -> outage += sim -> now - faults -> failed[shaftnum];
+        }
+    }
+    for(kind = 0; kind < FAULT_KINDS; ++kind) {
+        total += faults -> failures[kind];
+    }
+
+    printf("\nWith faults\n");
+    printf("Faults:         %ld (%ld doors, %ld maintenance, %ld power, %ld state), %ld repaired\n",
+           total, faults -> failures[FAULT_DOORS], faults -> failures[FAULT_MAINTENANCE],
+           faults -> failures[FAULT_POWER], faults -> failures[FAULT_STATE], faults -> repairs);
+    printf("Out of service: %ld lift-updates, with %ld riders trapped inside\n", faults -> outage, faults -> trapped);
+    printf("Handed on:      %ld floors' calls, %.2f microseconds of CPU per fault\n", faults -> handed_on,
+           total ? faults -> fault_nanos / 1000.0 / total : 0.0);
+    print_results(sim, spawned);
+
+    free_faults(faults);
+    free_passengers(sim);
+
+    // The same arrivals with every lift in service, for comparison
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        others[shaftnum] = create_shaft(topfloor, get_speed(shafts[shaftnum] -> car));
+    }
+    sim = create_passengers(others, shaftcount, topfloor, seed + 1);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        set_capacity(sim, shaftnum, capacity);
+    }
+    if(dispatcher) {
+        use_dispatcher(sim, dispatcher);
+    }
+
+    spawned = simulate_passengers(sim, ticks, rate, seed);
+
+    printf("\nWithout faults, with the same arrivals\n");
+    print_results(sim, spawned);
+
+    free_passengers(sim);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        free_shaft(others[shaftnum]);
+    }
+
+    return 1;
+}
+
+
+/** Print out how the passengers in a drill got on.
+ *
+ *  \param sim     The passenger simulation.
+ *  \param spawned The number of passengers who arrived.
+ */
+static void print_results(Passengers *sim, long spawned)
+{
+    printf("Passengers:     %ld arrived, %ld delivered, %d still in the building\n", spawned, sim -> served, sim -> live);
+    if(sim -> served) {
+        printf("Average wait:   %.1f updates (longest %ld)\n", (double)sim -> total_wait / sim -> served, sim -> max_wait);
+        printf("Wait centiles:  50%% %ld, 90%% %ld, 99%% %ld updates\n",
+               wait_percentile(sim, 50), wait_percentile(sim, 90), wait_percentile(sim, 99));
+        printf("Average ride:   %.1f updates\n", (double)sim -> total_ride / sim -> served);
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
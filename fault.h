@@ -0,0 +1,77 @@
+/** \file fault.h
+ *  Declarations for fault injection: lifts taken out of service at scripted
+ *  updates, and put back after a while, to see how the rest of the building copes.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "passenger.h"
+
+// Marks a lift that is in service
+#define IN_SERVICE -1
+
+// Marks a fault that lasts for the rest of the run
+#define NO_REPAIR -1
+
+/** The kinds of fault. Each one stops the lift where it is, with any riders still
+ *  inside; they differ in how long the lift is out of service for, unless the
+ *  script says otherwise.
+ */
+typedef enum {
+    FAULT_DOORS,        //!< The doors have jammed.
+    FAULT_MAINTENANCE,  //!< The lift has been switched to maintenance mode.
+    FAULT_POWER,        //!< The lift has lost power.
+    FAULT_STATE,        //!< The controller has been corrupted, leaving the lift in an illegal state.
+    FAULT_KINDS         //!< The number of kinds of fault.
+} FaultKind;
+
+/** One scripted fault. */
+typedef struct {
+    long tick;          //!< The update the fault happens on.
+    int shaft;          //!< The shaft of the lift that fails.
+    FaultKind kind;     //!< What goes wrong.
+    long duration;      //!< Updates until the lift is back in service, or NO_REPAIR.
+} Fault;
+
+/** Fault injection for a passenger simulation. Scripted faults are kept in the
+ *  order they happen, so each update only has to look at the next one.
+ */
+typedef struct {
+    Passengers *sim;    //!< The passenger simulation the lifts belong to.
+    FILE *log;          //!< Where to report faults and repairs as they happen, or NULL.
+
+    Fault *script;      //!< The scripted faults, in the order they happen.
+    int faultcount;     //!< The number of scripted faults.
+    int scriptsize;     //!< The room there is in 'script'.
+    int nextfault;      //!< The next scripted fault to happen.
+
+    long *failed;       //!< The update each shaft's lift failed on, or IN_SERVICE.
+    long *repair;       //!< The update each shaft's lift will be back on, or NO_REPAIR.
+    long *corrupted;    //!< The outage for a lift whose state has been corrupted, until update_lift() notices.
+    FaultKind *kind;    //!< What has gone wrong with each shaft's lift.
+    int out;            //!< The number of lifts out of service.
+
+    long failures[FAULT_KINDS]; //!< Faults of each kind that have happened.
+    long repairs;       //!< Lifts put back into service.
+    long handed_on;     //!< Hall calls handed on from lifts that failed.
+    long trapped;       //!< Riders in lifts when they failed.
+    long outage;        //!< Updates spent out of service, summed over the lifts.
+    long fault_nanos;   //!< CPU time spent taking lifts out of service.
+} Faults;
+
+Faults *create_faults(Passengers *sim);
+void free_faults(Faults *faults);
+int add_fault(Faults *faults, long tick, int shaftnum, FaultKind kind, long duration);
+int parse_faults(Faults *faults, const char *script);
+void fail_lift(Faults *faults, int shaftnum, FaultKind kind, long duration);
+void repair_lift(Faults *faults, int shaftnum);
+void faults_tick(Faults *faults);
+int run_faults(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity,
+               const Dispatcher *dispatcher, const char *script, uint64_t seed);
+
+#endif
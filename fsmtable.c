@@ -0,0 +1,279 @@
+/** \file fsmtable.c
+ *  This file contains a table driven version of update_lift(). The finite state
+ *  machine is written out once, in build_table(), as a table giving the next state
+ *  and the actions to take for every state and every combination of a few facts
+ *  about the lift: whether its timer has run out, whether it has any stops, whether
+ *  it has stops ahead, whether it is at a floor, and whether it should stop there.
+ *
+ *  An update then works those facts out with a single pass over the stop markers
+ *  that doesn't stop early, looks up the transition, and applies the actions with
+ *  masks rather than if statements. The only branch that depends on the lift is the
+ *  loop over its floors, so a batch of lifts can be updated without the branch
+ *  predictor having to guess what each one is doing, which is where update_lift()
+ *  spends most of its time with many lifts in different states.
+ *
+ *  The result is exactly what update_lift() does; the 'table' engine in verify.c
+ *  checks one against the other. The packed lifts in packed.c work their facts out
+ *  from their stop bitmaps and use the same table, so there is one copy of the
+ *  transitions for both.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fsmtable.h"
+#include "liftfsm.h"
+#include "stops.h"
+#include "notify.h"
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void build_table(void);
+static Transition transition(State state, unsigned predicates);
+static void set_transition(State state, int limit);
+
+
+/* ============================================================================ *
+ * The transition table                                                         *
+ * ============================================================================ */
+
+static Transition table[FSM_STATE_SLOTS * FSM_PREDICATES];
+static int limits[FSM_STATE_SLOTS];
+static pthread_once_t table_built = PTHREAD_ONCE_INIT;
+
+
+/** Obtain the transition table, building it the first time it is needed. Entry
+ *  (state * FSM_PREDICATES) + predicates says what an update does to a lift in that
+ *  state with that combination of FSM_ predicate bits.
+ *
+ *  \return A pointer to the table.
+ */
+const Transition *fsm_table(void)
+{
+    pthread_once(&table_built, build_table);
+    return table;
+}
+
+
+/** Obtain the value of the timer at which a state runs out.
+ *
+ *  \param state The state.
+ *  \return The time limit, or -1 if the state doesn't have one or is not a State.
+ */
+int fsm_time_limit(State state)
+{
+    pthread_once(&table_built, build_table);
+    return ((unsigned)state < FSM_STATE_SLOTS) ? limits[state] : -1;
+}
+
+
+/** Fill in the transition table and the time limit for each state.
+ */
+static void build_table(void)
+{
+    int slot;
+
+    // Anything not filled in below is not a State at all
+    for(slot = 0; slot < FSM_STATE_SLOTS * FSM_PREDICATES; ++slot) {
+        table[slot].state = FSM_ILLEGAL;
+    }
+    for(slot = 0; slot < FSM_STATE_SLOTS; ++slot) {
+        limits[slot] = -1;
+    }
+
+    set_transition(STATE_IDLE, -1);
+    set_transition(STATE_MOVING, -1);
+    set_transition(STATE_OPENING, OPENING_TIME);
+    set_transition(STATE_OPEN, OPEN_TIME);
+    set_transition(STATE_CLOSING, CLOSING_TIME);
+    set_transition(STATE_WAIT, WAIT_TIME);
+    set_transition(STATE_OUT_OF_SERVICE, -1);
+}
+
+
+/** Fill in the table entries for one state.
+ *
+ *  \param state The state to fill in.
+ *  \param limit The value of the timer at which the state runs out, or -1 if it
+ *               doesn't have a time limit.
+ */
+static void set_transition(State state, int limit)
+{
+    unsigned predicates;
+
+    if((unsigned)state >= FSM_STATE_SLOTS) {
+        fprintf(stderr, "State %d does not fit in the transition table.\n", (int)state);
+        exit(1);
+    }
+
+    limits[state] = limit;
+    for(predicates = 0; predicates < FSM_PREDICATES; ++predicates) {
+        table[(state * FSM_PREDICATES) + predicates] = transition(state, predicates);
+    }
+}
+
+
+/** Work out what update_lift() does to a lift in a state, given the facts about it.
+ *  This is the finite state machine described in lift.c.
+ *
+ *  \param state      The state the lift is in.
+ *  \param predicates The FSM_ predicate bits that are true for the lift.
+ *  \return The transition the lift makes.
+ */
+static Transition transition(State state, unsigned predicates)
+{
+    Transition stay = { state, 0 };
+
+    // Out of service is not one of the finite state machine's states, but it is legal
+    if(state == STATE_OUT_OF_SERVICE) {
+        return stay;
+    }
+
+    switch(state) {
+        case STATE_IDLE:
+            if(predicates & FSM_STOPS) {
+                return (Transition){ STATE_MOVING, FSM_HEAD };
+            }
+            return stay;
+
+        case STATE_MOVING:
+            if(predicates & FSM_AT_STOP) {
+                return (Transition){ STATE_OPENING, FSM_CLEAR_SERVED };
+            }
+
+            // Nothing left ahead at this floor: turn round, or stop altogether
+            if((predicates & FSM_AT_FLOOR) && !(predicates & FSM_AHEAD)) {
+                if(predicates & FSM_STOPS) {
+                    return (Transition){ STATE_MOVING, FSM_HEAD | FSM_MOVE };
+                }
+                return (Transition){ STATE_IDLE, FSM_CLEAR_DIR };
+            }
+            return (Transition){ STATE_MOVING, FSM_MOVE };
+
+        case STATE_OPENING:
+            return (predicates & FSM_EXPIRED) ? (Transition){ STATE_OPEN, 0 } : stay;
+
+        case STATE_OPEN:
+            return (predicates & FSM_EXPIRED) ? (Transition){ STATE_CLOSING, 0 } : stay;
+
+        case STATE_CLOSING:
+            return (predicates & FSM_EXPIRED) ? (Transition){ STATE_WAIT, 0 } : stay;
+
+        case STATE_WAIT:
+            if(!(predicates & FSM_EXPIRED)) {
+                return stay;
+            }
+            if(!(predicates & FSM_STOPS)) {
+                return (Transition){ STATE_IDLE, FSM_CLEAR_DIR };
+            }
+
+            // Turn round if there is nothing left the way the lift was going
+            if(!(predicates & FSM_DIRECTED) || !(predicates & FSM_AHEAD)) {
+                return (Transition){ STATE_MOVING, FSM_HEAD };
+            }
+            return (Transition){ STATE_MOVING, 0 };
+
+        default:
+            return (Transition){ FSM_ILLEGAL, 0 };
+    }
+}
+
+
+/* ============================================================================ *
+ * Updating lifts                                                               *
+ * ============================================================================ */
+
+/** Update the finite state machine for a lift, exactly as update_lift() does.
+ *
+ *  \param car A pointer to the lift to update.
+ */
+void update_lift_table(Lift *car)
+{
+    const Transition *transitions = fsm_table();
+    int position = car -> position;
+    int here = position / FLOOR_HEIGHT;
+    int up   = car -> direction == DIR_UP;
+    int down = car -> direction == DIR_DOWN;
+    int above = 0, below = 0, beyond_above = 0, beyond_below = 0;
+    int floor, level, marked, atfloor, marks, served, ahead, legal;
+    unsigned predicates, slot;
+    Moving heading;
+    Transition next;
+
+    ++car -> time;
+
+    // One pass over every floor, rather than searching outwards and stopping early
+    for(floor = 0, level = 0; floor <= car -> topfloor; ++floor, level += FLOOR_HEIGHT) {
+        marked = car -> stops[floor] != 0;
+
+        above        |= marked & (level >= position);
+        below        |= marked & (level <= position);
+        beyond_above |= marked & (level > position);
+        beyond_below |= marked & (level < position);
+    }
+
+    // Which markers on this floor does the lift stop for? (see stops_served() in lift.c)
+    atfloor = (position % FLOOR_HEIGHT) == 0;
+    marks   = car -> stops[here] & -atfloor;
+    served  = (marks & STOP_CAR) |
+              (marks & STOP_HALL_UP   & -(!down | !beyond_below)) |
+              (marks & STOP_HALL_DOWN & -(!up   | !beyond_above));
+
+    // A lift with no direction looks both ways, as nearest_stop() does
+    ahead = (up & above) | (down & below) | (!up & !down & (above | below));
+
+    // A state with no room in the table is as illegal as one marked FSM_ILLEGAL
+    legal = (unsigned)car -> state < FSM_STATE_SLOTS;
+    slot  = legal ? (unsigned)car -> state : 0;
+
+    predicates = ((car -> time == limits[slot]) * FSM_EXPIRED) |
+                 ((above | below) * FSM_STOPS) |
+                 (ahead * FSM_AHEAD) |
+                 ((served != 0) * FSM_AT_STOP) |
+                 (atfloor * FSM_AT_FLOOR) |
+                 ((up | down) * FSM_DIRECTED);
+
+    next = transitions[(slot * FSM_PREDICATES) + predicates];
+
+    // As update_lift() does: out of service where it is, with the fault reported
+    if(!legal || next.state == FSM_ILLEGAL) {
+        car -> time = 0;
+        car -> state = STATE_OUT_OF_SERVICE;
+        car -> direction = DIR_NONE;
+        notify_fault(car);
+        return;
+    }
+
+    // Stops below win over stops above, as in head_for_nearest_stop()
+    heading = below ? DIR_DOWN : (above ? DIR_UP : car -> direction);
+
+    car -> stops[here] &= ~(served & -((next.actions & FSM_CLEAR_SERVED) != 0));
+    car -> direction = (Moving)(car -> direction + ((heading - car -> direction) & -((next.actions & FSM_HEAD) != 0)));
+    car -> direction = (Moving)(car -> direction + ((DIR_NONE - car -> direction) & -((next.actions & FSM_CLEAR_DIR) != 0)));
+    car -> position += car -> speed * ((car -> direction == DIR_UP) - (car -> direction == DIR_DOWN)) *
+                       ((next.actions & FSM_MOVE) != 0);
+
+    // Changing state restarts the timer
+    car -> time &= -(next.state == car -> state);
+    car -> state = (State)next.state;
+}
+
+
+/** Update every lift in a building with update_lift_table().
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ */
+void update_shafts_table(Shaft **shafts, int shaftcount)
+{
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        update_lift_table(shafts[shaftnum] -> car);
+    }
+}
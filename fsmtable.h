@@ -0,0 +1,44 @@
+/** \file fsmtable.h
+ *  Declarations for the table driven version of the lift finite state machine.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef FSMTABLE_H
+#define FSMTABLE_H
+
+#include "shaft.h"
+
+// The number of State values the table has room for; every State must be below this
+#define FSM_STATE_SLOTS 8
+
+/* The facts about a lift that decide what its next update does */
+#define FSM_EXPIRED  0x01   //!< The timer has reached the current state's time limit.
+#define FSM_STOPS    0x02   //!< The lift has a stop anywhere.
+#define FSM_AHEAD    0x04   //!< The lift has a stop at or beyond its position in its direction.
+#define FSM_AT_STOP  0x08   //!< The lift is at a floor it should stop at.
+#define FSM_AT_FLOOR 0x10   //!< The lift is level with a floor.
+#define FSM_DIRECTED 0x20   //!< The lift has a direction.
+#define FSM_PREDICATES 64   //!< The number of combinations of the bits above.
+
+// The next state in the table entries for values that are not valid States
+#define FSM_ILLEGAL 0xff
+
+/* The things an update can do besides changing state, in the order they are done */
+#define FSM_CLEAR_SERVED 0x01   //!< Clear the stop markers the lift is stopping for.
+#define FSM_HEAD         0x02   //!< Point the lift towards its nearest stops.
+#define FSM_CLEAR_DIR    0x04   //!< Take away the lift's direction.
+#define FSM_MOVE         0x08   //!< Move the lift one step in its direction.
+
+/** What one update does to a lift in a given state with a given set of predicates. */
+typedef struct {
+    unsigned char state;    //!< The state the lift is in afterwards.
+    unsigned char actions;  //!< The FSM_ actions to carry out.
+} Transition;
+
+const Transition *fsm_table(void);
+int fsm_time_limit(State state);
+void update_lift_table(Lift *car);
+void update_shafts_table(Shaft **shafts, int shaftcount);
+
+#endif
@@ -0,0 +1,341 @@
+/** \file hallcall.c
+ *  This file contains the hall call registry. call_lift() turns a hall call into a
+ *  plain stop in one lift, chosen when the call is made and kept forever; the lift
+ *  then stops there whichever way it is going, and if another lift becomes free
+ *  to answer the call sooner it is too late to change.
+ *
+ *  Here the calls are kept in a registry of their own, one up and one down call
+ *  for each floor. Every update, dispatch_hall_calls() works out which lift could
+ *  now answer each call soonest, and moves the call to it if that is better by
+ *  more than REASSIGN_MARGIN updates (so calls do not flap between lifts that are
+ *  about as good as each other). The lift a call is given carries it as a
+ *  direction bit in its stops (see stops.h), so it only stops for the call when
+ *  it is going the caller's way.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hallcall.h"
+#include "liftfsm.h"
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int best_car(HallCalls *halls, Shaft **shafts, int floor, Moving direction, int *eta);
+static int stops_between(Lift *car, int from, int to);
+static int last_stop_ahead(Lift *car);
+static int doors_remaining(Lift *car);
+
+
+/* ============================================================================ *
+ * Creating and releasing the registry                                          *
+ * ============================================================================ */
+
+/** Create an empty hall call registry for a building.
+ *
+ *  \param topfloor   The top floor of the building.
+ *  \param shaftcount The number of shafts in the building.
+ *  \return A pointer to the new registry.
+ */
+HallCalls *create_hall_calls(int topfloor, int shaftcount)
+{
+    int call;
+    HallCalls *halls = (HallCalls *)calloc(1, sizeof(HallCalls));
+
+    if(halls) {
+        halls -> assigned    = (int *)malloc((topfloor + 1) * 2 * sizeof(int));
+        halls -> made        = (long *)malloc((topfloor + 1) * 2 * sizeof(long));
+        halls -> unavailable = (char *)calloc(shaftcount, sizeof(char));
+    }
+    if(!halls || !halls -> assigned || !halls -> made || !halls -> unavailable) {
+        fprintf(stderr, "Unable to allocate space for the hall call registry.\n");
+        exit(1);
+    }
+
+    halls -> topfloor   = topfloor;
+    halls -> shaftcount = shaftcount;
+
+    for(call = 0; call < (topfloor + 1) * 2; ++call) {
+        halls -> assigned[call] = NO_CAR;
+        halls -> made[call] = NO_CALL;
+    }
+
+    return halls;
+}
+
+
+/** Release the memory used by a hall call registry. Any calls still assigned to
+ *  lifts stay in their stops.
+ *
+ *  \param halls The registry to free.
+ */
+void free_hall_calls(HallCalls *halls)
+{
+    free(halls -> assigned);
+    free(halls -> made);
+    free(halls -> unavailable);
+    free(halls);
+}
+
+
+/* ============================================================================ *
+ * Making and assigning calls                                                   *
+ * ============================================================================ */
+
+/** Make a hall call. If the same call has already been made and not yet answered
+ *  this does nothing, otherwise the call is registered and given to the lift that
+ *  can answer it soonest.
+ *
+ *  \param halls     The registry.
+ *  \param shafts    A pointer to a block of memory containing pointers to Shafts.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in, DIR_UP or DIR_DOWN.
+ */
+void hall_call(HallCalls *halls, Shaft **shafts, int floor, Moving direction)
+{
+    int call = (floor * 2) + (direction == DIR_DOWN);
+    int bit = (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+    int shaftnum, eta;
+
+    if(halls -> made[call] != NO_CALL) {
+        return;
+    }
+
+    halls -> made[call] = halls -> now;
+    ++halls -> calls;
+
+    shaftnum = best_car(halls, shafts, floor, direction, &eta);
+    halls -> assigned[call] = shaftnum;
+    if(shaftnum != NO_CAR) {
+        shafts[shaftnum] -> car -> stops[floor] |= bit;
+    }
+}
+
+
+/** Determine whether a hall call has been made and not yet answered.
+ *
+ *  \param halls     The registry.
+ *  \param floor     The floor to check.
+ *  \param direction The direction to check, DIR_UP or DIR_DOWN.
+ *  \return true if the call is waiting to be answered, false otherwise.
+ */
+int hall_call_pending(HallCalls *halls, int floor, Moving direction)
+{
+    return halls -> made[(floor * 2) + (direction == DIR_DOWN)] != NO_CALL;
+}
+
+
+/** Say whether a lift may be given hall calls. Calls already given to a lift that
+ *  becomes unavailable are moved to other lifts by the next dispatch_hall_calls().
+ *
+ *  \param halls     The registry.
+ *  \param shaftnum  The shaft of the lift.
+ *  \param available true if the lift may be given calls, false if not.
+ */
+void set_car_available(HallCalls *halls, int shaftnum, int available)
+{
+    halls -> unavailable[shaftnum] = !available;
+}
+
+
+/** Update the registry after the lifts have been updated. Calls whose lift has
+ *  cleared the call's bit from its stops have been answered and are removed, and
+ *  every other call is moved to a better lift if there is one. This should be
+ *  called once after every update_shafts().
+ *
+ *  \param halls  The registry.
+ *  \param shafts A pointer to a block of memory containing pointers to Shafts.
+ */
+void dispatch_hall_calls(HallCalls *halls, Shaft **shafts)
+{
+    int call, floor, bit, current, best, besteta;
+    Moving direction;
+
+    ++halls -> now;
+
+    for(call = 0; call < (halls -> topfloor + 1) * 2; ++call) {
+        if(halls -> made[call] == NO_CALL) {
+            continue;
+        }
+
+        floor     = call / 2;
+        direction = (call & 1) ? DIR_DOWN : DIR_UP;
+        bit       = (call & 1) ? STOP_HALL_DOWN : STOP_HALL_UP;
+        current   = halls -> assigned[call];
+
+        // The lift clears the bit when it stops for the call
+        if(current != NO_CAR && !(shafts[current] -> car -> stops[floor] & bit)) {
+            ++halls -> answered;
+            halls -> total_wait += halls -> now - halls -> made[call];
+            halls -> made[call] = NO_CALL;
+            halls -> assigned[call] = NO_CAR;
+            continue;
+        }
+
+        best = best_car(halls, shafts, floor, direction, &besteta);
+        if(best == current) {
+            continue;
+        }
+
+        // Only move a call from an available lift if the new one is clearly better
+        if(current != NO_CAR && !halls -> unavailable[current] &&
+           (best == NO_CAR || besteta + REASSIGN_MARGIN >= hall_eta(shafts[current] -> car, floor, direction))) {
+            continue;
+        }
+
+        if(current != NO_CAR) {
+            shafts[current] -> car -> stops[floor] &= ~bit;
+            ++halls -> reassigned;
+        }
+        if(best != NO_CAR) {
+            shafts[best] -> car -> stops[floor] |= bit;
+        }
+        halls -> assigned[call] = best;
+    }
+}
+
+
+/* ============================================================================ *
+ * Estimating                                                                   *
+ * ============================================================================ */
+
+/** Estimate how many updates it will take a lift to answer a hall call, going the
+ *  caller's way. A lift already heading for the floor in the caller's direction
+ *  only has to travel there; any other lift has to carry on to its last stop in
+ *  the direction it is going, then come back. Each stop on the way adds
+ *  STOP_OVERHEAD, and a lift with its doors open has to finish with them first.
+ *
+ *  Unlike service_call(), the result is a plain estimate in updates, and it takes
+ *  the caller's direction into account: a lift passing the floor going the other
+ *  way will not stop for the call.
+ *
+ *  \param car       The lift to inspect.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in.
+ *  \return The estimated number of updates before the lift opens for the call.
+ */
+int hall_eta(Lift *car, int floor, Moving direction)
+{
+    int position = get_position(car);
+    int target = floor * FLOOR_HEIGHT;
+    Moving heading = get_direction(car);
+    int turn, travel, stops;
+
+    if(get_state(car) == STATE_IDLE || heading == DIR_NONE ||
+       (heading == direction && (heading == DIR_UP ? target >= position : target <= position))) {
+        travel = abs(target - position);
+        stops  = stops_between(car, position, target);
+    } else {
+        turn   = last_stop_ahead(car);
+        travel = abs(turn - position) + abs(target - turn);
+        stops  = stops_between(car, position, turn) + stops_between(car, turn, target) + (turn != position);
+    }
+
+    return (travel / get_speed(car)) + (stops * STOP_OVERHEAD) + doors_remaining(car);
+}
+
+
+/** Find the available lift that could answer a hall call soonest.
+ *
+ *  \param halls     The registry.
+ *  \param shafts    A pointer to a block of memory containing pointers to Shafts.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in.
+ *  \param eta       A pointer to an int to store the best lift's estimate in.
+ *  \return The shaft of the best lift, or NO_CAR if no lift is available.
+ */
+static int best_car(HallCalls *halls, Shaft **shafts, int floor, Moving direction, int *eta)
+{
+    int shaftnum, estimate;
+    int best = NO_CAR;
+
+    for(shaftnum = 0; shaftnum < halls -> shaftcount; ++shaftnum) {
+        if(halls -> unavailable[shaftnum]) {
+            continue;
+        }
+
+        estimate = hall_eta(shafts[shaftnum] -> car, floor, direction);
+        if(best == NO_CAR || estimate < *eta) {
+            best = shaftnum;
+            *eta = estimate;
+        }
+    }
+
+    return best;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Count the floors with stops strictly between two shaft positions.
+ *
+ *  \param car  The lift to inspect.
+ *  \param from One shaft position.
+ *  \param to   The other shaft position.
+ *  \return The number of floors with stops between them.
+ */
+static int stops_between(Lift *car, int from, int to)
+{
+    int low  = (from < to ? from : to) / FLOOR_HEIGHT + 1;
+    int high = ((from < to ? to : from) - 1) / FLOOR_HEIGHT;
+    int floor, count = 0;
+
+    for(floor = low; floor <= high; ++floor) {
+        count += (car -> stops[floor] != 0);
+    }
+
+    return count;
+}
+
+
+/** Find the shaft position of the furthest stop in the lift's direction of travel.
+ *
+ *  \param car The lift to inspect.
+ *  \return The position of the last stop ahead, or the lift's position if there is none.
+ */
+static int last_stop_ahead(Lift *car)
+{
+    int floor;
+
+    if(get_direction(car) == DIR_UP) {
+        for(floor = get_topfloor(car); floor * FLOOR_HEIGHT > get_position(car); --floor) {
+            if(car -> stops[floor]) {
+                return floor * FLOOR_HEIGHT;
+            }
+        }
+    } else if(get_direction(car) == DIR_DOWN) {
+        for(floor = 0; floor * FLOOR_HEIGHT < get_position(car); ++floor) {
+            if(car -> stops[floor]) {
+                return floor * FLOOR_HEIGHT;
+            }
+        }
+    }
+
+    return get_position(car);
+}
+
+
+/** Work out how long a lift that has stopped at a floor has left before it can
+ *  move again.
+ *
+ *  \param car The lift to inspect.
+ *  \return The number of updates until the lift finishes its stop, 0 if it is not stopped.
+ */
+static int doors_remaining(Lift *car)
+{
+    int time = get_time(car);
+
+    switch(get_state(car)) {
+        case STATE_OPENING: return (OPENING_TIME - time) + OPEN_TIME + CLOSING_TIME + WAIT_TIME;
+        case STATE_OPEN   : return (time < OPEN_TIME ? OPEN_TIME - time : 1) + door_hold(car) + CLOSING_TIME + WAIT_TIME;
+        case STATE_CLOSING: return (CLOSING_TIME - time) + WAIT_TIME;
+        case STATE_WAIT   : return WAIT_TIME - time;
+        default: return 0;
+    }
+}
@@ -0,0 +1,57 @@
+/** \file hallcall.h
+ *  Declarations for the hall call registry. Hall calls are kept by floor and
+ *  direction, separately from the lifts, and are handed to whichever lift can
+ *  answer them soonest - again every update, as the lifts move.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef HALLCALL_H
+#define HALLCALL_H
+
+#include "shaft.h"
+#include "stops.h"
+
+// Marks a hall call with no lift assigned
+#define NO_CAR -1
+
+// Marks a hall call that has not been made
+#define NO_CALL -1
+
+// Updates a lift spends at each stop on the way: opening, open, closing, and waiting
+#define STOP_OVERHEAD (OPENING_TIME + OPEN_TIME + CLOSING_TIME + WAIT_TIME)
+
+// How many updates sooner another lift has to be before a call is moved to it. The
+// estimates jump by a whole STOP_OVERHEAD whenever a lift gains a stop, so anything
+// much smaller than this moves calls back and forth on every new stop.
+#define REASSIGN_MARGIN (2 * STOP_OVERHEAD)
+
+/** The registry. Each floor has an up and a down call, stored at [floor * 2] and
+ *  [floor * 2 + 1], which is either not made (NO_CALL in 'made') or assigned to the
+ *  lift in one shaft (or to none, if no lift is available). The assigned lift
+ *  carries the call as a STOP_HALL_UP or STOP_HALL_DOWN bit in its stops, and when
+ *  the lift clears that bit on arriving the call has been answered.
+ */
+typedef struct {
+    int topfloor;       //!< The top floor of the building.
+    int shaftcount;     //!< The number of shafts.
+    long now;           //!< The current update.
+    int *assigned;      //!< The shaft each call is assigned to, or NO_CAR.
+    long *made;         //!< The update each call was made on, or NO_CALL if it has not been.
+    char *unavailable;  //!< Lifts that must not be given calls, for example because they are full.
+
+    long calls;         //!< Calls made.
+    long answered;      //!< Calls answered.
+    long total_wait;    //!< Sum of the time answered calls waited.
+    long reassigned;    //!< Times a call was moved to a different lift.
+} HallCalls;
+
+HallCalls *create_hall_calls(int topfloor, int shaftcount);
+void free_hall_calls(HallCalls *halls);
+void hall_call(HallCalls *halls, Shaft **shafts, int floor, Moving direction);
+int hall_call_pending(HallCalls *halls, int floor, Moving direction);
+void set_car_available(HallCalls *halls, int shaftnum, int available);
+void dispatch_hall_calls(HallCalls *halls, Shaft **shafts);
+int hall_eta(Lift *car, int floor, Moving direction);
+
+#endif
@@ -0,0 +1,528 @@
+/** \file journal.c
+ *  This file contains the input journal. An interactive session can't be run
+ *  again by hand: the user would have to make every call and stop on exactly the
+ *  same update as before. With --journal, every input the prompts accept is
+ *  written to a file with the update it was made on, and --replay feeds them back
+ *  to a fresh building at full speed, with nothing drawn and nothing asked, so
+ *  a session that found a problem can be run as often as it takes to fix it.
+ *
+ *  A journal is a text file, so it can be read and edited by hand:
+ *
+ *      liftsim journal 1
+ *      building <shafts> <top floor> <speed> <zones> <park halflife>
+ *      <update> call <floor> up|down
+ *      <update> stop <shaft> <floor>
+ *      end <update> <hash>
+ *
+ *  The building line holds everything that changes how the lifts respond to the
+ *  inputs. Lines are only ever added, and each is flushed as it is written, so a
+ *  session that crashes still leaves a journal of everything up to the crash.
+ *  The end line is written when the session finishes cleanly, and holds a hash of
+ *  the lifts' final state (see building_hash()), so the replay can check that it
+ *  finished in the same state. Blank lines and lines starting with '#' are ignored.
+ *
+ *  --check-journal writes a journal of generated traffic and replays it straight
+ *  away. Zoned buildings are updated on a thread per zone, and this is how to
+ *  find out that their replays don't depend on how the threads were scheduled.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "journal.h"
+#include "advance.h"
+#include "notify.h"
+#include "parking.h"
+#include "traffic.h"
+#include "zone.h"
+
+// The longest line expected in a journal
+#define JOURNAL_LINE 128
+
+// FNV-1a, which is quick and spreads small differences in the lifts' state widely
+#define HASH_OFFSET 0xcbf29ce484222325ULL
+#define HASH_PRIME  0x100000001b3ULL
+
+// The traffic check_journal() writes: calls per 1000 updates, and the chance in
+// percent that a lift with its doors open is given a stop
+#define CHECK_CALL_RATE 150
+#define CHECK_STOP_RATE 60
+
+/** A building being replayed, set up the same way as the main loop sets it up. */
+typedef struct {
+    Shaft **shafts;         //!< The shafts in the building.
+    int shaftcount;         //!< The number of shafts.
+    int topfloor;           //!< The top floor of the building.
+    ZonedBuilding *zones;   //!< The zones, or NULL if the shafts are not zoned.
+    Parking *parking;       //!< Parking for idle lifts, or NULL if they are not parked.
+    long tick;              //!< Updates run so far.
+} Replay;
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void journal_call(void *data, int floor, Moving direction);
+static void journal_stop(void *data, int shaftnum, int floor);
+static void build_replay(Replay *replay, int shaftcount, int topfloor, int speed, int zonecount, int halflife);
+static void free_replay(Replay *replay);
+static void replay_call(Replay *replay, int floor, Moving direction);
+static void replay_stop(Replay *replay, int shaftnum, int floor);
+static void replay_until(Replay *replay, long tick);
+static void print_building(Shaft **shafts, int shaftcount);
+static uint64_t hash_int(uint64_t hash, int value);
+
+
+/* ============================================================================ *
+ * Writing journals                                                             *
+ * ============================================================================ */
+
+/** Start a journal, and add the hooks that write the inputs to it. Any file with
+ *  the same name is replaced.
+ *
+ *  \param filename      The name of the journal file.
+ *  \param tick          A pointer to the main loop's count of updates.
+ *  \param shaftcount    The number of shafts in the building.
+ *  \param topfloor      The top floor of the building.
+ *  \param speed         The speed of the lifts.
+ *  \param zonecount     The number of zones the shafts are split into, 1 for none.
+ *  \param park_halflife The halflife given to --park, or 0 if idle lifts are not parked.
+ *  \return A pointer to the new journal, or NULL if it could not be started.
+ */
+Journal *open_journal(const char *filename, const long *tick, int shaftcount, int topfloor, int speed,
+                      int zonecount, int park_halflife)
+{
+    Journal *journal = (Journal *)calloc(1, sizeof(Journal));
+
+    if(!journal) {
+        fprintf(stderr, "Unable to allocate space for the journal.\n");
+        exit(1);
+    }
+
+    if(!(journal -> file = fopen(filename, "w"))) {
+        fprintf(stderr, "Unable to open journal '%s'.\n", filename);
+        free(journal);
+        return NULL;
+    }
+
+    if(!add_input_hook(journal_call, journal_stop, journal)) {
+        fprintf(stderr, "Unable to add the journal's input hook.\n");
+        fclose(journal -> file);
+        free(journal);
+        return NULL;
+    }
+
+    journal -> tick = tick;
+    fprintf(journal -> file, "liftsim journal %d\n", JOURNAL_VERSION);
+    fprintf(journal -> file, "building %d %d %d %d %d\n", shaftcount, topfloor, speed, zonecount, park_halflife);
+    fflush(journal -> file);
+
+    return journal;
+}
+
+
+/** Finish a journal, recording the update the session ended on and the state the
+ *  lifts were left in.
+ *
+ *  \param journal    The journal to close.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ */
+void close_journal(Journal *journal, Shaft **shafts, int shaftcount)
+{
+    remove_input_hook(journal_call, journal_stop, journal);
+
+    fprintf(journal -> file, "end %ld %016" PRIx64 "\n", *journal -> tick, building_hash(shafts, shaftcount));
+    fclose(journal -> file);
+    free(journal);
+}
+
+
+/** Work out a hash of everything about the lifts that decides what they do next:
+ *  where they are, their state, timer and direction, and their stops.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \return The hash.
+ */
+uint64_t building_hash(Shaft **shafts, int shaftcount)
+{
+    uint64_t hash = HASH_OFFSET;
+    int shaftnum, floor;
+    Lift *car;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+
+        hash = hash_int(hash, get_position(car));
+        hash = hash_int(hash, get_time(car));
+        hash = hash_int(hash, get_state(car));
+        hash = hash_int(hash, get_direction(car));
+        for(floor = 0; floor <= get_topfloor(car); ++floor) {
+            hash = (hash ^ (unsigned char)car -> stops[floor]) * HASH_PRIME;
+        }
+    }
+
+    return hash;
+}
+
+
+/** Write a hall call to the journal. */
+static void journal_call(void *data, int floor, Moving direction)
+{
+    Journal *journal = (Journal *)data;
+
+    fprintf(journal -> file, "%ld call %d %s\n", *journal -> tick, floor, (direction == DIR_DOWN) ? "down" : "up");
+    fflush(journal -> file);
+    ++journal -> inputs;
+}
+
+
+/** Write a stop to the journal. */
+static void journal_stop(void *data, int shaftnum, int floor)
+{
+    Journal *journal = (Journal *)data;
+
+    fprintf(journal -> file, "%ld stop %d %d\n", *journal -> tick, shaftnum, floor);
+    fflush(journal -> file);
+    ++journal -> inputs;
+}
+
+
+/* ============================================================================ *
+ * Replaying journals                                                           *
+ * ============================================================================ */
+
+/** Replay a journal on a fresh building, then print out the lifts' final state and
+ *  check it against the state recorded at the end of the journal.
+ *
+ *  \param filename   The name of the journal file.
+ *  \param shaftcount The number of shafts given on the command line.
+ *  \param topfloor   The top floor given on the command line.
+ *  \return true if the journal was replayed and finished in the state recorded,
+ *          or has no end to check against; false otherwise.
+ */
+int replay_journal(const char *filename, int shaftcount, int topfloor)
+{
+    FILE *file = fopen(filename, "r");
+    char line[JOURNAL_LINE], word[8];
+    Replay replay;
+    struct timespec start, finish;
+    int version = 0, speed, zonecount, halflife, first, second, linenum = 0, ok = 1, ended = 0;
+    long tick, inputs = 0;
+    uint64_t expected = 0, hash;
+
+    if(!file) {
+        fprintf(stderr, "Unable to open journal '%s'.\n", filename);
+        return 0;
+    }
+
+    if(!fgets(line, sizeof(line), file) || sscanf(line, "liftsim journal %d", &version) != 1 ||
+       version != JOURNAL_VERSION) {
+        fprintf(stderr, "'%s' is not a version %d journal.\n", filename, JOURNAL_VERSION);
+        fclose(file);
+        return 0;
+    }
+    if(!fgets(line, sizeof(line), file) ||
+       sscanf(line, "building %d %d %d %d %d", &first, &second, &speed, &zonecount, &halflife) != 5) {
+        fprintf(stderr, "'%s' doesn't say what building it is for.\n", filename);
+        fclose(file);
+        return 0;
+    }
+    if(first != shaftcount || second != topfloor) {
+        fprintf(stderr, "'%s' is for %d shafts and top floor %d, not %d and %d.\n", filename,
+                first, second, shaftcount, topfloor);
+        fclose(file);
+        return 0;
+    }
+    linenum = 2;
+
+    build_replay(&replay, shaftcount, topfloor, speed, zonecount, halflife);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(ok && !ended && fgets(line, sizeof(line), file)) {
+        ++linenum;
+
+        if(line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+
+        if(sscanf(line, "end %ld %" SCNx64, &tick, &expected) == 2 && tick >= replay.tick) {
+            replay_until(&replay, tick);
+            ended = 1;
+        } else if(sscanf(line, "%ld call %d %7s", &tick, &first, word) == 3 && tick >= replay.tick &&
+                  first >= 0 && first <= topfloor && (!strcmp(word, "up") || !strcmp(word, "down"))) {
+            replay_until(&replay, tick);
+            replay_call(&replay, first, strcmp(word, "up") ? DIR_DOWN : DIR_UP);
+            ++inputs;
+        } else if(sscanf(line, "%ld stop %d %d", &tick, &first, &second) == 3 && tick >= replay.tick &&
+                  first >= 0 && first < shaftcount && second >= 0 && second <= topfloor) {
+            replay_until(&replay, tick);
+            replay_stop(&replay, first, second);
+            ++inputs;
+        } else {
+            fprintf(stderr, "%s:%d: can't replay '%.*s'.\n", filename, linenum, (int)strcspn(line, "\r\n"), line);
+            ok = 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    fclose(file);
+
+    if(ok) {
+        hash = building_hash(replay.shafts, shaftcount);
+
+        printf("Replayed %ld inputs over %ld updates in %.3f ms\n", inputs, replay.tick,
+               ((finish.tv_sec - start.tv_sec) * 1e9 + (finish.tv_nsec - start.tv_nsec)) / 1e6);
+        print_building(replay.shafts, shaftcount);
+
+        if(!ended) {
+            printf("Final state:    %016" PRIx64 ", but the journal has no end to check it against\n", hash);
+        } else if(hash == expected) {
+            printf("Final state:    %016" PRIx64 ", the same as when the journal was written\n", hash);
+        } else {
+            printf("Final state:    %016" PRIx64 ", but it was %016" PRIx64 " when the journal was written\n",
+                   hash, expected);
+            ok = 0;
+        }
+    }
+
+    free_replay(&replay);
+
+    return ok;
+}
+
+
+/** Check that a journal replays to the state it was written in. A building set up
+ *  as the main loop sets it up is given generated calls and stops, made the way
+ *  --commands makes them so that they are written to the journal by its hooks,
+ *  and then the journal is replayed on a fresh building.
+ *
+ *  \param filename      The name of the journal file to write and replay.
+ *  \param shaftcount    The number of shafts in the building.
+ *  \param topfloor      The top floor of the building.
+ *  \param speed         The speed of the lifts.
+ *  \param zonecount     The number of zones to split the shafts into, 1 for none.
+ *  \param park_halflife The halflife given to --park, or 0 if idle lifts are not parked.
+ *  \param ticks         The number of updates to run for.
+ *  \param seed          The seed for the generated traffic.
+ *  \return true if the replay finished in the state the journal was written in,
+ *          false otherwise.
+ */
+int check_journal(const char *filename, int shaftcount, int topfloor, int speed, int zonecount,
+                  int park_halflife, long ticks, uint64_t seed)
+{
+    Replay run;
+    Journal *journal;
+    Traffic traffic;
+    int shaftnum, floor;
+    Moving direction;
+
+    build_replay(&run, shaftcount, topfloor, speed, zonecount, park_halflife);
+    if(!(journal = open_journal(filename, &run.tick, shaftcount, topfloor, speed, zonecount, park_halflife))) {
+        free_replay(&run);
+        return 0;
+    }
+    init_traffic(&traffic, seed, topfloor, CHECK_CALL_RATE, CHECK_STOP_RATE);
+
+    while(run.tick < ticks) {
+        replay_until(&run, run.tick + 1);
+
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            if(get_state(run.shafts[shaftnum] -> car) == STATE_OPEN &&
+               next_stop(&traffic, run.shafts[shaftnum] -> car, &floor)) {
+                replay_stop(&run, shaftnum, floor);
+                notify_stop(shaftnum, floor);
+            }
+        }
+        if(next_call(&traffic, &floor, &direction)) {
+            replay_call(&run, floor, direction);
+            notify_call(floor, direction);
+        }
+    }
+
+    printf("Wrote %ld inputs over %ld updates to '%s'\n", journal -> inputs, run.tick, filename);
+    close_journal(journal, run.shafts, shaftcount);
+    free_replay(&run);
+
+    return replay_journal(filename, shaftcount, topfloor);
+}
+
+
+/** Set a building up to be replayed, as the main loop sets it up.
+ *
+ *  \param replay     The building to set up.
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of the lifts.
+ *  \param zonecount  The number of zones to split the shafts into, 1 for none.
+ *  \param halflife   The halflife of the parking demand, or 0 if idle lifts are not parked.
+ */
+static void build_replay(Replay *replay, int shaftcount, int topfloor, int speed, int zonecount, int halflife)
+{
+    int shaftnum;
+
+    memset(replay, 0, sizeof(Replay));
+    replay -> shaftcount = shaftcount;
+    replay -> topfloor   = topfloor;
+    replay -> shafts     = (Shaft **)malloc(shaftcount * sizeof(Shaft *));
+    if(!replay -> shafts) {
+        fprintf(stderr, "Unable to allocate space for the replay.\n");
+        exit(1);
+    }
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        replay -> shafts[shaftnum] = create_shaft(topfloor, speed);
+    }
+    if(zonecount > 1) {
+        replay -> zones = create_zones(replay -> shafts, shaftcount, topfloor, zonecount);
+    }
+    if(halflife > 0) {
+        replay -> parking = create_parking(topfloor, halflife);
+    }
+}
+
+
+/** Release a building set up by build_replay().
+ *
+ *  \param replay The building to free.
+ */
+static void free_replay(Replay *replay)
+{
+    int shaftnum;
+
+    if(replay -> zones) {
+        free_zones(replay -> zones);
+    }
+    if(replay -> parking) {
+        free_parking(replay -> parking);
+    }
+    for(shaftnum = 0; shaftnum < replay -> shaftcount; ++shaftnum) {
+        free_shaft(replay -> shafts[shaftnum]);
+    }
+    free(replay -> shafts);
+}
+
+
+/** Make a hall call in a building being replayed, as the main loop would have.
+ *
+ *  \param replay    The building being replayed.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+static void replay_call(Replay *replay, int floor, Moving direction)
+{
+    if(replay -> zones) {
+        zone_call(replay -> zones, floor, direction);
+    } else {
+        call_lift(replay -> shafts, replay -> shaftcount, floor, direction);
+    }
+    if(replay -> parking) {
+        record_call(replay -> parking, floor, direction);
+    }
+}
+
+
+/** Set a stop in a building being replayed, as the main loop would have.
+ *
+ *  \param replay   The building being replayed.
+ *  \param shaftnum The number of the shaft the stop is for.
+ *  \param floor    The floor to stop at.
+ */
+static void replay_stop(Replay *replay, int shaftnum, int floor)
+{
+    if(replay -> zones) {
+        zone_stop(replay -> zones, shaftnum, floor);
+    } else {
+        set_stop(replay -> shafts[shaftnum] -> car, floor);
+    }
+}
+
+
+/** Run a building being replayed up to an update, exactly as the main loop would
+ *  have run it. When nothing needs to see each update, they are skipped straight
+ *  through with advance_building(), and zones run through them together with
+ *  update_zones().
+ *
+ *  \param replay The building being replayed.
+ *  \param tick   The update to run up to.
+ */
+static void replay_until(Replay *replay, long tick)
+{
+    int shaftnum;
+
+    if(replay -> zones) {
+        if(replay -> tick < tick) {
+            update_zones(replay -> zones, tick - replay -> tick);
+            replay -> tick = tick;
+        }
+        return;
+    }
+
+    if(!replay -> parking) {
+        while(replay -> tick < tick) {
+            replay -> tick += advance_building(replay -> shafts, replay -> shaftcount,
+                                               (tick - replay -> tick > NEVER_CHANGES) ? NEVER_CHANGES
+                                                                                       : (int)(tick - replay -> tick));
+        }
+        return;
+    }
+
+    for(; replay -> tick < tick; ++replay -> tick) {
+        for(shaftnum = 0; shaftnum < replay -> shaftcount; ++shaftnum) {
+            update_lift(replay -> shafts[shaftnum] -> car);
+        }
+        park_idle_cars(replay -> parking, replay -> shafts, replay -> shaftcount, replay -> tick);
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Print out where each lift is, what it is doing, and its stops, one character
+ *  per floor from the ground up with '!' where there is a stop.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ */
+static void print_building(Shaft **shafts, int shaftcount)
+{
+    int shaftnum, floor;
+    Lift *car;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+
+        printf("Shaft %-3d       %-4s position %4d, time %2d, stops ", shaftnum, lift_to_string(car),
+               get_position(car), get_time(car));
+        for(floor = 0; floor <= get_topfloor(car); ++floor) {
+            putchar(car -> stops[floor] ? '!' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+
+/** Add an int to a hash, a byte at a time.
+ *
+ *  \param hash  The hash so far.
+ *  \param value The value to add.
+ *  \return The new hash.
+ */
+static uint64_t hash_int(uint64_t hash, int value)
+{
+    unsigned int bits = (unsigned int)value;
+    int byte;
+
+    for(byte = 0; byte < 4; ++byte) {
+        hash = (hash ^ ((bits >> (byte * 8)) & 0xff)) * HASH_PRIME;
+    }
+
+    return hash;
+}
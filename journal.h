@@ -0,0 +1,36 @@
+/** \file journal.h
+ *  Declarations for the input journal, which records every call and stop made in
+ *  an interactive session with the update it was made on, so that the session can
+ *  be replayed later without anybody at the keyboard.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "shaft.h"
+
+// Changes whenever the journal format does, so old journals are not misread
+#define JOURNAL_VERSION 1
+
+/** An open journal. The building it was opened for is written at the top, and the
+ *  inputs are written as they are made; nothing written is ever changed.
+ */
+typedef struct {
+    FILE *file;         //!< The journal file.
+    const long *tick;   //!< The main loop's update counter, read when an input is made.
+    long inputs;        //!< Inputs written so far.
+} Journal;
+
+Journal *open_journal(const char *filename, const long *tick, int shaftcount, int topfloor, int speed,
+                      int zonecount, int park_halflife);
+void close_journal(Journal *journal, Shaft **shafts, int shaftcount);
+uint64_t building_hash(Shaft **shafts, int shaftcount);
+int replay_journal(const char *filename, int shaftcount, int topfloor);
+int check_journal(const char *filename, int shaftcount, int topfloor, int speed, int zonecount,
+                  int park_halflife, long ticks, uint64_t seed);
+
+#endif
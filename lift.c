@@ -38,12 +38,16 @@
  *       if the lift is at a stop floor
  *           clear the stop marker on the floor
  *           'state' changes to STATE_OPENING
+ *       otherwise, if the lift is at a floor and has no stops left in its direction
+ *           if it has stops the other way, turn towards them and move the lift
+ *           otherwise 'state' changes to STATE_IDLE and 'direction' to DIR_NONE
  *       otherwise
  *           move the lift
  *  else if 'state' is STATE_OPENING
  *       if 'time' is OPENING_TIME then 'state' changes to STATE_OPEN
  *  else if 'state' is STATE_OPEN
- *       if 'time' is OPEN_TIME then 'state' changes to STATE_CLOSING
+ *       if 'time' is OPEN_TIME then 'state' changes to STATE_CLOSING, unless the doors
+ *       are held (see hold_doors()), when an update of the hold is used up instead
  *  else if 'state' is STATE_CLOSING
  *       if 'time' is CLOSING_TIME then 'state' changes to STATE_WAIT
  *  else if 'state' is STATE_WAIT
@@ -56,8 +60,12 @@
  *           otherwise
  *               'state' changes to STATE_IDLE
  *               'direction' changes to DIR_NONE
+ *  else if 'state' is STATE_OUT_OF_SERVICE
+ *       nothing happens until the lift is put back into service
  *  else
- *       the finite state machine has entered an illegal state, print an error and exit</pre>
+ *       the finite state machine has entered an illegal state: 'state' changes to
+ *       STATE_OUT_OF_SERVICE, 'direction' to DIR_NONE, and the fault is reported
+ *       to the fault hooks (see notify.h)</pre>
  *
  * IMPORTANT: Note that 'direction' should NOT be changed when changing to STATE_OPENING
  *            The only points at which direction should be changed are immediately following
@@ -76,6 +84,23 @@
 #include <string.h>
 #include <math.h>
 #include "lift.h"
+#include "liftfsm.h"
+#include "stops.h"
+#include "notify.h"
+
+/** A lift whose doors are being held open, and how many more updates the OPEN
+ *  state has to use up before it may close them.
+ */
+typedef struct {
+    const Lift *car;
+    int updates;
+} DoorHold;
+
+// The lifts with their doors held. lift.h has no room for a hold count, so they are
+// kept here, and there are only ever as many as there are lifts with open doors.
+static DoorHold *holds = NULL;
+static int holdcount = 0;
+static int holdcapacity = 0;
 
 /* ============================================================================ *
  * Prototypes for functions only visible within this file                       *
@@ -85,6 +110,12 @@ static void time_tick(Lift *car);
 static void move_lift(Lift *car);
 static int nearest_stop(Lift *car, Moving constrain);
 static int distance_to_last_stop(Lift *car);
+static void head_for_nearest_stop(Lift *car);
+static int stops_beyond(Lift *car, int floor, Moving direction);
+static int stops_served(Lift *car);
+static DoorHold *find_hold(const Lift *car);
+static int use_hold(Lift *car);
+static void drop_hold(const Lift *car);
 
 
 /* ============================================================================ *
@@ -147,6 +178,7 @@ Lift *create_lift(int topfloor, int speed)
  */
 void free_lift(Lift *car)
 {
+    drop_hold(car);
     free(car -> stops);
     free(car);
 }
@@ -179,14 +211,16 @@ Moving get_direction(Lift *car)
 
 
 /** Set the current state of the specified lift's finite state machine, resetting its
- *  time to zero in the process.
+ *  time to zero in the process. Any hold on the lift's doors goes with the old state.
  *
  *  \param car The lift to modify.
  *  \param state The new state the FSM should be set to.
  */
 void set_state(Lift *car, State state)
 {
+    drop_hold(car);
     car -> state = state;
+    car -> time = 0;
 }
 
 
@@ -294,7 +328,7 @@ int get_topfloor(Lift *car)
  */
 void set_stop(Lift *car, int floor)
 {
-    car -> stops[floor] = 1;
+    car -> stops[floor] |= STOP_CAR;
 }
 
 
@@ -310,23 +344,108 @@ void clear_stop(Lift *car, int floor)
 }
 
 
+/** Keep a lift's doors open for longer than OPEN_TIME, for example while people
+ *  get in and out. The doors close 'updates' updates later than they would have
+ *  done: the lift keeps a hold count that the OPEN state uses up, one update at a
+ *  time, before it closes them. The lift's timer carries on counting as normal.
+ *  Holding the doors again replaces the hold that is left. This does nothing
+ *  unless the lift is open.
+ *
+ *  \param car     A pointer to the lift to hold.
+ *  \param updates The number of updates to hold the doors open for.
+ *  \return true if the doors are held as asked (or there was nothing to do),
+ *          false if there was not enough memory to hold them.
+ */
+int hold_doors(Lift *car, int updates)
+{
+    DoorHold *hold, *grown;
+    int capacity;
+
+    if (get_state(car) != STATE_OPEN) {
+        return 1;
+    }
+
+    if (updates <= 0) {
+        drop_hold(car);
+        return 1;
+    }
+
+    if (!(hold = find_hold(car))) {
+        if (holdcount == holdcapacity) {
+            capacity = holdcapacity ? holdcapacity * 2 : 8;
+            grown = (DoorHold *)realloc(holds, capacity * sizeof(DoorHold));
+            if (!grown) {
+                return 0;
+            }
+            holds = grown;
+            holdcapacity = capacity;
+        }
+        hold = &holds[holdcount++];
+        hold -> car = car;
+    }
+
+    hold -> updates = updates;
+    return 1;
+}
+
+
+/** Find out how many more updates a lift's doors are being held open for, on top
+ *  of the time the FSM would leave them open anyway.
+ *
+ *  \param car A pointer to the lift to check.
+ *  \return The number of updates left on the hold, 0 if the doors are not held.
+ */
+int door_hold(Lift *car)
+{
+    DoorHold *hold;
+
+    if (get_state(car) != STATE_OPEN || !(hold = find_hold(car))) {
+        return 0;
+    }
+
+    return hold -> updates;
+}
+
+
+/** Determine whether a lift will take a passenger in a given direction. It will
+ *  if it is going that way already, or is idle, or has no stops left ahead of it
+ *  in the direction it is going, as it will turn round (or go idle) next.
+ *
+ *  \param car       A pointer to the lift to check.
+ *  \param direction The direction the passenger wants to go in.
+ *  \return true if the lift is going the passenger's way, false otherwise.
+ */
+int going_my_way(Lift *car, Moving direction)
+{
+    int move, check;
+
+    if (get_direction(car) == direction || get_direction(car) == DIR_NONE) {
+        return 1;
+    }
+
+    // Going the other way: only if there are no more stops that way
+    move = (get_direction(car) == DIR_UP) ? 1 : -1;
+    for (check = at_floor(car) + move; check >= 0 && check <= get_topfloor(car); check += move) {
+        if (car -> stops[check]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
 /** Determine whether the lift is at a stop floor. This returns true
  *  if the lift is at a floor, and that floor is the nearest stop,
- *  and false otherwise.
+ *  and false otherwise. Hall calls only count if the lift is going the
+ *  caller's way, see stops_served().
  *
  *  \param car The lift to inspect.
  *  \return true if the lift is at a stop floor, false if it is not.
  */
 int at_stop(Lift *car)
 {
-    int current_floor = at_floor(car);
-
-    if(current_floor!=NOT_AT_FLOOR){
-        if (car->stops[current_floor] == 1){  //1 = stopmarker
-            return 1;
-            }
-    }
-    return 0;
+    return stops_served(car) != 0;
 }
 
 
@@ -349,6 +468,7 @@ int service_call(Lift *car, int call_floor, Moving direction)
     // First calculate the distance between the car and call floor
     int distance = (call_floor * FLOOR_HEIGHT) - get_position(car);
     int time_to_service = (distance/get_speed(car));
+
     // Idle cars can always service calls, regardless of direction or
     // floor. Determine how far the car is from the call floor and return the time
     // to service * -1. Note that the time to service is the distance between the
@@ -394,33 +514,36 @@ void update_lift(Lift *car)
     if (get_state(car) == STATE_IDLE) {
         //if the lift has been called to a floor (one or more entries in 'stops' is set)
         for(i=0; i<=get_topfloor(car); i++) {
-            if(car->stops[i] == 1){
+            if(car->stops[i]){
                 lift_called = 1;
             }
         }
 
         if (lift_called){
             set_state(car, STATE_MOVING);
-
-            //if the nearest stop is above the lift, 'direction' is set to DIR_UP
-            if (nearest_stop (car, DIR_UP)) {
-                set_direction(car, DIR_UP);
-            }
-            //if the nearest stop is below the lift, 'direction' is set to DIR_DOWN
-            if (nearest_stop (car, DIR_DOWN)) {
-                set_direction(car, DIR_DOWN);
-            }
+            head_for_nearest_stop(car);
         }
     }
     // else if the lift is in STATE_MOVING
     else if (get_state(car) == STATE_MOVING) {
         //if the lift is at a stop floor
         if (at_stop(car)) {
-            //clear the stop marker on the floor
-            clear_stop(car, (get_position(car)/FLOOR_HEIGHT));
+            //clear the stop marker on the floor - only the hall calls going our way
+            car -> stops[get_position(car)/FLOOR_HEIGHT] &= ~stops_served(car);
             //'state' changes to STATE_OPENING
             set_state(car, STATE_OPENING);
         }
+        //if a stop was taken away, and there is nothing left ahead of the lift at
+        //this floor, turn round - or stop altogether - rather than run off the shaft
+        else if (at_floor(car) != NOT_AT_FLOOR && nearest_stop(car, get_direction(car)) == NO_STOPS) {
+            if (nearest_stop(car, DIR_NONE) != NO_STOPS) {
+                head_for_nearest_stop(car);
+                move_lift(car);
+            } else {
+                set_state(car, STATE_IDLE);
+                set_direction(car, DIR_NONE);
+            }
+        }
         else {
             //move the lift
             move_lift(car);
@@ -435,8 +558,9 @@ void update_lift(Lift *car)
     }
     //else if 'state' is STATE_OPEN
     else if (get_state(car) == STATE_OPEN) {
-        //if 'time' is OPEN_TIME then 'state' changes to STATE_CLOSING
-        if (get_time(car) == OPEN_TIME) {
+        //if 'time' is OPEN_TIME then 'state' changes to STATE_CLOSING - once any hold
+        //on the doors has been used up, so a held lift's timer runs on past OPEN_TIME
+        if (get_time(car) >= OPEN_TIME && !use_hold(car)) {
             set_state(car, STATE_CLOSING);
         }
     }
@@ -456,16 +580,11 @@ void update_lift(Lift *car)
                 //'state' changes to STATE_MOVING
                 set_state(car, STATE_MOVING);
                     //if there are no more stops left in the current direction (above the lift for DIR_UP, below it for DIR_DOWN)
-                    if (nearest_stop(car, get_direction(car))== NO_STOPS)
+                    if (get_direction(car) == DIR_NONE || nearest_stop(car, get_direction(car)) == NO_STOPS)
                     {
-                       //If the nearest stop is above the lift, 'direction' is set to DIR_UP
-                        if (get_direction(car) == DIR_UP) {
-                            set_direction(car, DIR_DOWN);
-                        }
-                       //If the nearest stop is below the lift, 'direction' is set to DIR_DOWN
-                        if (get_direction(car) == DIR_DOWN) {
-                            set_direction(car, DIR_UP);
-                        }
+                        //If the nearest stop is above the lift, 'direction' is set to DIR_UP
+                        //If the nearest stop is below the lift, 'direction' is set to DIR_DOWN
+                        head_for_nearest_stop(car);
                     }
             }
             else {
@@ -476,11 +595,17 @@ void update_lift(Lift *car)
             }
         }
     }
+    //else if 'state' is STATE_OUT_OF_SERVICE
+    else if (get_state(car) == STATE_OUT_OF_SERVICE) {
+        //the lift stays where it is, doors and all, until it is put back into service
+    }
     else{
-        //the finite state machine has entered an illegal state, print an error and exit</pre>
-        fprintf(stderr, "the finite state machine has entered an illegal state.\n");
-        getchar;
-        exit(1);
+        //the finite state machine has entered an illegal state. Take the lift out of
+        //service where it is and report the fault to the fault hooks, so the rest of
+        //the building carries on without it
+        set_state(car, STATE_OUT_OF_SERVICE);
+        set_direction(car, DIR_NONE);
+        notify_fault(car);
     }
 }
 
@@ -518,8 +643,11 @@ int request_stop(Lift *car, int shaftnum)
 
         printf("Enter a floor number and press return, or just press return to skip floor selection: ");
 
-        // Wait for input from the user
-        fgets(promptbuff, 10, stdin);
+        // Wait for input from the user; nothing was entered if the input has ended,
+        // or a signal interrupted the wait
+        if(!fgets(promptbuff, 10, stdin)) {
+            return NO_STOPS;
+        }
 
         // Does the string contain a number?
         if(string_to_int(promptbuff, &request)) {
@@ -672,6 +800,138 @@ static int nearest_stop(Lift *car, Moving constrain)
 }
 
 
+/** Point the lift towards its stops. If there are stops above the lift the direction
+ *  is set to DIR_UP, and if there are stops below it the direction is set to DIR_DOWN
+ *  (stops below win if there are both, as they do in nearest_stop()). If the only
+ *  stop is at the lift's current position, DIR_DOWN is used, as the stop is found
+ *  looking in either direction.
+ *
+ *  \param car The lift to point towards its stops.
+ */
+static void head_for_nearest_stop(Lift *car)
+{
+    if(nearest_stop(car, DIR_UP) != NO_STOPS) {
+        set_direction(car, DIR_UP);
+    }
+
+    if(nearest_stop(car, DIR_DOWN) != NO_STOPS) {
+        set_direction(car, DIR_DOWN);
+    }
+}
+
+
+/** Determine whether a lift has any stops strictly beyond a floor.
+ *
+ *  \param car       The lift to inspect.
+ *  \param floor     The floor to look beyond.
+ *  \param direction DIR_UP to look above the floor, DIR_DOWN to look below it.
+ *  \return true if there are stops beyond the floor, false otherwise.
+ */
+static int stops_beyond(Lift *car, int floor, Moving direction)
+{
+    int move = (direction == DIR_UP) ? 1 : -1;
+
+    for(floor += move; floor >= 0 && floor <= car -> topfloor; floor += move) {
+        if(car -> stops[floor]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** Work out which of the stop markers on the lift's current floor it should stop
+ *  for. A car stop always counts. A hall call counts if the lift is going the way
+ *  the caller wants to, if it has no direction, or if it has nothing left to do
+ *  further in the direction it is going, as it is about to turn round.
+ *
+ *  \param car The lift to inspect.
+ *  \return The STOP_ bits on the current floor the lift stops for, 0 if none or
+ *          if the lift is not at a floor.
+ */
+static int stops_served(Lift *car)
+{
+    int floor = at_floor(car);
+    int marks, served;
+
+    if(floor == NOT_AT_FLOOR) {
+        return 0;
+    }
+
+    marks = car -> stops[floor];
+    served = marks & STOP_CAR;
+
+    if((marks & STOP_HALL_UP) &&
+       (get_direction(car) != DIR_DOWN || !stops_beyond(car, floor, DIR_DOWN))) {
+        served |= STOP_HALL_UP;
+    }
+    if((marks & STOP_HALL_DOWN) &&
+       (get_direction(car) != DIR_UP || !stops_beyond(car, floor, DIR_UP))) {
+        served |= STOP_HALL_DOWN;
+    }
+
+    return served;
+}
+
+
+/** Find the hold on a lift's doors, if there is one.
+ *
+ *  \param car The lift to look for.
+ *  \return A pointer to the lift's hold, or NULL if its doors are not held.
+ */
+static DoorHold *find_hold(const Lift *car)
+{
+    int num;
+
+    for(num = 0; num < holdcount; ++num) {
+        if(holds[num].car == car) {
+            return &holds[num];
+        }
+    }
+
+    return NULL;
+}
+
+
+/** Use up one update of the hold on an open lift's doors. The hold goes once the
+ *  last of it is used.
+ *
+ *  \param car The lift whose doors are due to close.
+ *  \return true if the doors were held for this update, false if they may close.
+ */
+static int use_hold(Lift *car)
+{
+    DoorHold *hold = find_hold(car);
+
+    if(!hold) {
+        return 0;
+    }
+
+    if(--hold -> updates == 0) {
+        drop_hold(car);
+    }
+
+    return 1;
+}
+
+
+/** Let go of any hold on a lift's doors.
+ *
+ *  \param car The lift to let go of.
+ */
+static void drop_hold(const Lift *car)
+{
+    DoorHold *hold;
+
+    if(!holdcount || !(hold = find_hold(car))) {
+        return;
+    }
+
+    *hold = holds[--holdcount];
+}
+
+
 /** Determine the distance to the last stop this car has to service.
  *  If the lift is idle, or no stops remain in its direction of travel
  *  then this should return 0.
@@ -739,10 +999,12 @@ const char *lift_to_string(Lift *car)
     static const char *open       = "] [";
     static const char *closing    = "> <";
     static const char *waiting    = "[|]";
+    static const char *outofservice = "[x]";
     static const char *badstate   = "BAD";
 
-    // Use the car state to determine which string to return.
-    switch(get_state(car)) {
+    // Use the car state to determine which string to return. STATE_OUT_OF_SERVICE
+    // follows the State enum rather than being part of it, hence the int.
+    switch((int)get_state(car)) {
         case STATE_MOVING: if(get_direction(car) == DIR_DOWN) {
                                return going_down;
                            } else if(get_direction(car) == DIR_UP) {
@@ -754,6 +1016,7 @@ const char *lift_to_string(Lift *car)
         case STATE_OPEN   : return open;    break;
         case STATE_CLOSING: return closing; break;
         case STATE_WAIT   : return waiting; break;
+        case STATE_OUT_OF_SERVICE: return outofservice; break;
         default: return badstate;
     }
 }
\ No newline at end of file
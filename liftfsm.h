@@ -0,0 +1,21 @@
+/** \file liftfsm.h
+ *  Declarations for the parts of the lift finite state machine in lift.c that
+ *  go beyond the interface in lift.h.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef LIFTFSM_H
+#define LIFTFSM_H
+
+#include "lift.h"
+
+// The state of a lift taken out of service, following the states of the State enum
+// in lift.h. update_lift() leaves a lift in it exactly where it is, doors and all.
+#define STATE_OUT_OF_SERVICE ((State)(STATE_WAIT + 1))
+
+int hold_doors(Lift *car, int updates);
+int door_hold(Lift *car);
+int going_my_way(Lift *car, Moving direction);
+
+#endif
@@ -0,0 +1,441 @@
+/** \file liftsim.c
+ *  This file contains libliftsim, which lets other programs run the lift simulation
+ *  in their own process: build a building, make calls and stops in batches, move it
+ *  on any number of updates, and copy out the state of every lift in bulk. It uses
+ *  the same lifts and the same call_lift() as the interactive program, and moves
+ *  them on with advance_building(), so a long step costs time in proportion to the
+ *  number of things that happen rather than the number of updates.
+ *
+ *  The library must not print or exit, as the program it is loaded into owns the
+ *  terminal. So the lifts are allocated here, with every failure reported back to
+ *  the caller, rather than with create_shaft(), and nothing here uses stdio. Calls
+ *  are given to the lift choose_lift() picks, which is the lift call_lift() would
+ *  pick, without call_lift()'s message for a call it has to drop; the caller is
+ *  told instead. update_lift() takes a lift that faults out of service without
+ *  printing anything, and the fault shows in the lift's state. So none of the
+ *  interactive parts of lift.c and shaft.c are called, and the build leaves them
+ *  out (see liftsim.h).
+ *
+ *  An ETA table is kept alongside the lifts, brought up to date after every step,
+ *  call and stop, so that hall displays can read how soon a lift will reach every
+ *  floor without the library working it out on each read.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include "liftsim.h"
+#include "shaft.h"
+#include "shaftcall.h"
+#include "lift.h"
+#include "liftfsm.h"
+#include "stops.h"
+#include "advance.h"
+#include "eta.h"
+
+
+/** A building, with all of its lifts allocated in a handful of blocks. */
+struct LiftSim {
+    Shaft **shafts;     //!< Pointers to the shafts, as the simulation expects them.
+    Shaft *shaftstore;  //!< The shafts themselves.
+    Lift *cars;         //!< One lift per shaft.
+    char *stops;        //!< The lifts' stop markers, topfloor + 1 per lift.
+    EtaTable *etas;     //!< How soon a lift could open on each floor, going each way.
+    int shaftcount;     //!< The number of shafts.
+    int topfloor;       //!< The top floor of the building.
+    int64_t tick;       //!< Updates run since the building was created.
+};
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int32_t export_state(State state);
+static int32_t export_direction(Moving direction);
+static uint8_t export_stops(char marks);
+
+
+/* ============================================================================ *
+ * Creating and destroying buildings                                            *
+ * ============================================================================ */
+
+/** Find out which version of the interface the library provides.
+ *
+ *  \return LIFTSIM_API_VERSION as the library was built.
+ */
+int liftsim_api_version(void)
+{
+    return LIFTSIM_API_VERSION;
+}
+
+
+/** Find out how many sections of shaft there are between floors, which is the unit
+ *  lift positions and speeds are given in.
+ *
+ *  \return The number of sections per floor.
+ */
+int liftsim_floor_height(void)
+{
+    return FLOOR_HEIGHT;
+}
+
+
+/** Build a building of idle lifts, all on the ground floor.
+ *
+ *  \param shaftcount The number of shafts, each with one lift.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      How far the lifts move per update, in sections. This must divide
+ *                    liftsim_floor_height() exactly.
+ *  \return A new building, or NULL if the arguments are not valid or there is not
+ *          enough memory.
+ */
+LiftSim *liftsim_create(int32_t shaftcount, int32_t topfloor, int32_t speed)
+{
+    LiftSim *sim;
+    int shaftnum;
+
+    if(shaftcount < 1 || topfloor < 1 || topfloor > INT_MAX / FLOOR_HEIGHT ||
+       speed < 1 || FLOOR_HEIGHT % speed) {
+        return NULL;
+    }
+
+    if(!(sim = (LiftSim *)calloc(1, sizeof(LiftSim)))) {
+        return NULL;
+    }
+
+    sim -> shaftcount = shaftcount;
+    sim -> topfloor   = topfloor;
+    sim -> shafts     = (Shaft **)calloc(shaftcount, sizeof(Shaft *));
+    sim -> shaftstore = (Shaft *)calloc(shaftcount, sizeof(Shaft));
+    sim -> cars       = (Lift *)calloc(shaftcount, sizeof(Lift));
+    sim -> stops      = (char *)calloc((size_t)shaftcount * (topfloor + 1), sizeof(char));
+
+    if(!sim -> shafts || !sim -> shaftstore || !sim -> cars || !sim -> stops) {
+        liftsim_destroy(sim);
+        return NULL;
+    }
+
+    // The same starting state as create_lift() gives
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        Lift *car = &sim -> cars[shaftnum];
+
+        car -> topfloor  = topfloor;
+        car -> direction = DIR_NONE;
+        car -> state     = STATE_IDLE;
+        car -> time      = 0;
+        car -> position  = 0;
+        car -> speed     = speed;
+        car -> stops     = &sim -> stops[(size_t)shaftnum * (topfloor + 1)];
+
+        sim -> shaftstore[shaftnum].car = car;
+        sim -> shaftstore[shaftnum].topfloor = topfloor;
+        sim -> shafts[shaftnum] = &sim -> shaftstore[shaftnum];
+    }
+
+    if(!(sim -> etas = create_eta_table(sim -> shafts, shaftcount, topfloor))) {
+        liftsim_destroy(sim);
+        return NULL;
+    }
+    refresh_etas(sim -> etas, 0);
+
+    return sim;
+}
+
+
+/** Release a building and all of its lifts.
+ *
+ *  \param sim The building to release. May be NULL.
+ */
+void liftsim_destroy(LiftSim *sim)
+{
+    if(!sim) {
+        return;
+    }
+
+    free_eta_table(sim -> etas);
+    free(sim -> stops);
+    free(sim -> cars);
+    free(sim -> shaftstore);
+    free(sim -> shafts);
+    free(sim);
+}
+
+
+/* ============================================================================ *
+ * Running the simulation                                                       *
+ * ============================================================================ */
+
+/** Move every lift in the building on by a number of updates. This gives the same
+ *  result as updating every lift that many times, one update at a time.
+ *
+ *  \param sim     The building to move on.
+ *  \param updates The number of updates to run; 0 does nothing.
+ *  \return LIFTSIM_OK, or LIFTSIM_EINVAL if 'updates' is negative.
+ */
+int liftsim_step(LiftSim *sim, int64_t updates)
+{
+    int chunk, done;
+
+    if(!sim || updates < 0) {
+        return LIFTSIM_EINVAL;
+    }
+
+    // advance_building() stops early whenever a lift opens its doors
+    while(updates > 0) {
+        chunk = updates > INT_MAX ? INT_MAX : (int)updates;
+        done = advance_building(sim -> shafts, sim -> shaftcount, chunk);
+
+        updates -= done;
+        sim -> tick += done;
+    }
+    refresh_etas(sim -> etas, sim -> tick);
+
+    return LIFTSIM_OK;
+}
+
+
+/** Find out how many updates the building has been moved on by since it was created.
+ *
+ *  \param sim The building to inspect.
+ *  \return The number of updates run.
+ */
+int64_t liftsim_tick(const LiftSim *sim)
+{
+    return sim ? sim -> tick : 0;
+}
+
+
+/** Make a number of hall calls, in order, giving each to the lift call_lift() would
+ *  choose. Every call is checked before any are made, so if one is not valid none
+ *  are. A call that no lift can take is dropped, and the rest are still made.
+ *
+ *  \param sim        The building to make the calls in.
+ *  \param floors     The floor of each call.
+ *  \param directions The direction of each call, LIFTSIM_UP or LIFTSIM_DOWN. Nobody
+ *                    can call down from the ground floor or up from the top floor.
+ *  \param count      The number of calls.
+ *  \return LIFTSIM_OK, LIFTSIM_ERANGE if a floor is not in the building,
+ *          LIFTSIM_EINVAL if a direction is not possible, or LIFTSIM_ENOLIFT if
+ *          any call was dropped.
+ */
+int liftsim_calls(LiftSim *sim, const int32_t *floors, const int32_t *directions, size_t count)
+{
+    size_t num;
+    int shaftnum, status = LIFTSIM_OK;
+
+    if(!sim || (count && (!floors || !directions))) {
+        return LIFTSIM_EINVAL;
+    }
+
+    for(num = 0; num < count; ++num) {
+        if(floors[num] < 0 || floors[num] > sim -> topfloor) {
+            return LIFTSIM_ERANGE;
+        }
+        if((directions[num] == LIFTSIM_UP && floors[num] == sim -> topfloor) ||
+           (directions[num] == LIFTSIM_DOWN && floors[num] == 0) ||
+           (directions[num] != LIFTSIM_UP && directions[num] != LIFTSIM_DOWN)) {
+            return LIFTSIM_EINVAL;
+        }
+    }
+
+    for(num = 0; num < count; ++num) {
+        shaftnum = choose_lift(sim -> shafts, sim -> shaftcount, floors[num],
+                               directions[num] == LIFTSIM_UP ? DIR_UP : DIR_DOWN);
+        if(shaftnum == -1) {
+            status = LIFTSIM_ENOLIFT;
+        } else {
+            set_stop(sim -> shafts[shaftnum] -> car, floors[num]);
+        }
+    }
+    refresh_etas(sim -> etas, sim -> tick);
+
+    return status;
+}
+
+
+/** Set a number of stops, as if passengers in the lifts had pressed floor buttons.
+ *  Every stop is checked before any are set, so if one is not valid none are.
+ *
+ *  \param sim    The building to set the stops in.
+ *  \param shafts The shaft whose lift each stop is for.
+ *  \param floors The floor of each stop.
+ *  \param count  The number of stops.
+ *  \return LIFTSIM_OK, or LIFTSIM_ERANGE if a shaft or floor is not in the building.
+ */
+int liftsim_stops(LiftSim *sim, const int32_t *shafts, const int32_t *floors, size_t count)
+{
+    size_t num;
+
+    if(!sim || (count && (!shafts || !floors))) {
+        return LIFTSIM_EINVAL;
+    }
+
+    for(num = 0; num < count; ++num) {
+        if(shafts[num] < 0 || shafts[num] >= sim -> shaftcount ||
+           floors[num] < 0 || floors[num] > sim -> topfloor) {
+            return LIFTSIM_ERANGE;
+        }
+    }
+
+    for(num = 0; num < count; ++num) {
+        set_stop(sim -> shafts[shafts[num]] -> car, floors[num]);
+    }
+    refresh_etas(sim -> etas, sim -> tick);
+
+    return LIFTSIM_OK;
+}
+
+
+/* ============================================================================ *
+ * Reading the state of the building                                            *
+ * ============================================================================ */
+
+/** Copy out the state of the lifts, one LiftSimCar per shaft in shaft order. If
+ *  there is not room for every lift, as many as fit are copied; call this with a
+ *  count of 0 to find out how many there are.
+ *
+ *  \param sim   The building to read.
+ *  \param cars  Where to copy the lifts to.
+ *  \param count The number of LiftSimCars there is room for in 'cars'.
+ *  \return The number of lifts in the building, or LIFTSIM_EINVAL.
+ */
+int liftsim_read_cars(const LiftSim *sim, LiftSimCar *cars, size_t count)
+{
+    size_t num;
+    Lift *car;
+
+    if(!sim || (count && !cars)) {
+        return LIFTSIM_EINVAL;
+    }
+
+    for(num = 0; num < count && num < (size_t)sim -> shaftcount; ++num) {
+        car = sim -> shafts[num] -> car;
+
+        cars[num].position  = get_position(car);
+        cars[num].floor     = at_floor(car);
+        cars[num].state     = export_state(get_state(car));
+        cars[num].direction = export_direction(get_direction(car));
+        cars[num].time      = get_time(car);
+    }
+
+    return sim -> shaftcount;
+}
+
+
+/** Copy out every lift's stop markers: topfloor + 1 bytes per shaft, in shaft order,
+ *  each 0 or a combination of the LIFTSIM_STOP_* bits. If there is not room for all
+ *  of them, as many as fit are copied.
+ *
+ *  \param sim   The building to read.
+ *  \param stops Where to copy the markers to.
+ *  \param size  The number of bytes there is room for in 'stops'.
+ *  \return The number of bytes needed for every marker, or LIFTSIM_EINVAL.
+ */
+int liftsim_read_stops(const LiftSim *sim, uint8_t *stops, size_t size)
+{
+    size_t needed, num;
+
+    if(!sim || (size && !stops)) {
+        return LIFTSIM_EINVAL;
+    }
+
+    needed = (size_t)sim -> shaftcount * (sim -> topfloor + 1);
+    for(num = 0; num < size && num < needed; ++num) {
+        stops[num] = export_stops(sim -> stops[num]);
+    }
+
+    return needed > INT_MAX ? INT_MAX : (int)needed;
+}
+
+
+/** Copy out how soon a lift could open its doors on each floor for a caller going
+ *  each way: two entries per floor from the ground floor up, the first for going up
+ *  and the second for going down. Each is a number of updates, 0 if a lift is open
+ *  there going that way already, or LIFTSIM_NO_ETA if no lift can answer it (as for
+ *  down from the ground floor). If there is not room for every entry, as many as
+ *  fit are copied.
+ *
+ *  These are exactly what the lifts will do if given the call now, and they are
+ *  kept up to date as the lifts move, so reading them costs no more than copying.
+ *
+ *  \param sim    The building to read.
+ *  \param etas   Where to copy the entries to.
+ *  \param shafts If not NULL, where to copy the shaft of the lift that would be
+ *                first for each entry, or -1.
+ *  \param count  The number of entries there is room for in 'etas' (and 'shafts').
+ *  \return The number of entries for the building, or LIFTSIM_EINVAL.
+ */
+int liftsim_read_etas(const LiftSim *sim, int32_t *etas, int32_t *shafts, size_t count)
+{
+    size_t needed, num;
+    int shaftnum;
+
+    if(!sim || (count && !etas)) {
+        return LIFTSIM_EINVAL;
+    }
+
+    needed = (size_t)(sim -> topfloor + 1) * 2;
+    for(num = 0; num < count && num < needed; ++num) {
+        etas[num] = eta_lookup(sim -> etas, (int)(num / 2), (num & 1) ? DIR_DOWN : DIR_UP, &shaftnum);
+        if(shafts) {
+            shafts[num] = shaftnum;
+        }
+    }
+
+    return needed > INT_MAX ? INT_MAX : (int)needed;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Convert a lift state to the value the interface uses for it, so that the
+ *  interface does not change if the simulation's State does.
+ *
+ *  \param state The state to convert.
+ *  \return The matching LIFTSIM_* state.
+ */
+static int32_t export_state(State state)
+{
+    switch((int)state) {
+        case STATE_MOVING : return LIFTSIM_MOVING;
+        case STATE_OPENING: return LIFTSIM_OPENING;
+        case STATE_OPEN   : return LIFTSIM_OPEN;
+        case STATE_CLOSING: return LIFTSIM_CLOSING;
+        case STATE_WAIT   : return LIFTSIM_WAIT;
+        case STATE_OUT_OF_SERVICE: return LIFTSIM_OUT_OF_SERVICE;
+        default           : return LIFTSIM_IDLE;
+    }
+}
+
+
+/** Convert a direction to the value the interface uses for it.
+ *
+ *  \param direction The direction to convert.
+ *  \return LIFTSIM_UP, LIFTSIM_DOWN or LIFTSIM_NONE.
+ */
+static int32_t export_direction(Moving direction)
+{
+    switch(direction) {
+        case DIR_UP  : return LIFTSIM_UP;
+        case DIR_DOWN: return LIFTSIM_DOWN;
+        default      : return LIFTSIM_NONE;
+    }
+}
+
+
+/** Convert a lift's stop markers to the LIFTSIM_STOP_* bits the interface uses, so
+ *  that the interface does not change if the markers in stops.h do.
+ *
+ *  \param marks The stop markers for one floor.
+ *  \return The matching combination of LIFTSIM_STOP_* bits.
+ */
+static uint8_t export_stops(char marks)
+{
+    return ((marks & STOP_CAR)       ? LIFTSIM_STOP_CAR       : 0) |
+           ((marks & STOP_HALL_UP)   ? LIFTSIM_STOP_HALL_UP   : 0) |
+           ((marks & STOP_HALL_DOWN) ? LIFTSIM_STOP_HALL_DOWN : 0);
+}
@@ -0,0 +1,106 @@
+/** \file liftsim.h
+ *  The C interface to libliftsim, the lift simulation as a shared library. This is
+ *  the only header a program using the library needs; it does not depend on any of
+ *  the simulation's own headers, and everything passed across it is a plain integer
+ *  type of fixed size, so it can be used from other languages through their C
+ *  foreign function interfaces.
+ *
+ *  The library is built from liftsim.c, advance.c, eta.c, lift.c, shaft.c, viewport.c,
+ *  notify.c and profile.c, compiled with -fPIC -fvisibility=hidden -ffunction-sections
+ *  and linked with -shared -Wl,--gc-sections into libliftsim.so. Only the functions
+ *  declared here are exported, and the interactive parts of the simulation, which
+ *  nothing here calls, are left out.
+ *
+ *  Functions that can fail return one of the LIFTSIM_E* codes, which are all
+ *  negative. Nothing in the library prints or exits the program. A lift that
+ *  develops a fault is reported through its state, LIFTSIM_OUT_OF_SERVICE. A hall
+ *  call no lift can take, because every lift is out of service or more than 32767
+ *  updates away, is dropped and reported as LIFTSIM_ENOLIFT. In buildings of up to
+ *  2700 floors no lift in service can ever be that far away.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef LIFTSIM_H
+#define LIFTSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+    #define LIFTSIM_EXPORT __declspec(dllexport)
+#else
+    #define LIFTSIM_EXPORT __attribute__((visibility("default")))
+#endif
+
+/** The version of this interface. It only changes if existing functions or
+ *  structures change; new functions may be added without changing it.
+ */
+#define LIFTSIM_API_VERSION 1
+
+/* Error codes */
+#define LIFTSIM_OK        0  //!< Success.
+#define LIFTSIM_EINVAL   -1  //!< An argument was not valid; nothing was changed.
+#define LIFTSIM_ENOMEM   -2  //!< Memory could not be allocated.
+#define LIFTSIM_ERANGE   -3  //!< A floor or shaft number was out of range; nothing was changed.
+#define LIFTSIM_ENOLIFT  -4  //!< No lift could take a hall call, so it was dropped.
+
+/* Call directions */
+#define LIFTSIM_DOWN     -1  //!< The caller wants to go down.
+#define LIFTSIM_NONE      0  //!< A lift that is not going anywhere.
+#define LIFTSIM_UP        1  //!< The caller wants to go up.
+
+/* Lift states */
+#define LIFTSIM_IDLE      0  //!< Waiting at a floor with nowhere to go.
+#define LIFTSIM_MOVING    1  //!< Travelling, or about to set off.
+#define LIFTSIM_OPENING   2  //!< Opening its doors.
+#define LIFTSIM_OPEN      3  //!< Doors open.
+#define LIFTSIM_CLOSING   4  //!< Closing its doors.
+#define LIFTSIM_WAIT      5  //!< Doors closed, about to move on.
+#define LIFTSIM_OUT_OF_SERVICE 6  //!< Taken out of service by a fault, and going nowhere.
+
+/* Read out by liftsim_read_etas() for a floor and direction no lift can answer */
+#define LIFTSIM_NO_ETA   -1
+
+/* Stop markers, as read out by liftsim_read_stops() */
+#define LIFTSIM_STOP_CAR       1  //!< Somebody in the lift wants this floor.
+#define LIFTSIM_STOP_HALL_UP   2  //!< Somebody on this floor wants to go up.
+#define LIFTSIM_STOP_HALL_DOWN 4  //!< Somebody on this floor wants to go down.
+
+/** A building full of lifts. The contents are private to the library. */
+typedef struct LiftSim LiftSim;
+
+/** The state of one lift, as read out by liftsim_read_cars(). */
+typedef struct {
+    int32_t position;   //!< Height in the shaft, in sections; each floor is 'floor_height' sections.
+    int32_t floor;      //!< The floor the lift is at, or -1 if it is between floors.
+    int32_t state;      //!< One of the LIFTSIM_* lift states.
+    int32_t direction;  //!< LIFTSIM_UP, LIFTSIM_DOWN or LIFTSIM_NONE.
+    int32_t time;       //!< Updates spent in the current state.
+} LiftSimCar;
+
+LIFTSIM_EXPORT int liftsim_api_version(void);
+LIFTSIM_EXPORT int liftsim_floor_height(void);
+
+LIFTSIM_EXPORT LiftSim *liftsim_create(int32_t shaftcount, int32_t topfloor, int32_t speed);
+LIFTSIM_EXPORT void liftsim_destroy(LiftSim *sim);
+
+LIFTSIM_EXPORT int liftsim_step(LiftSim *sim, int64_t updates);
+LIFTSIM_EXPORT int64_t liftsim_tick(const LiftSim *sim);
+
+LIFTSIM_EXPORT int liftsim_calls(LiftSim *sim, const int32_t *floors, const int32_t *directions, size_t count);
+LIFTSIM_EXPORT int liftsim_stops(LiftSim *sim, const int32_t *shafts, const int32_t *floors, size_t count);
+
+LIFTSIM_EXPORT int liftsim_read_cars(const LiftSim *sim, LiftSimCar *cars, size_t count);
+LIFTSIM_EXPORT int liftsim_read_stops(const LiftSim *sim, uint8_t *stops, size_t size);
+LIFTSIM_EXPORT int liftsim_read_etas(const LiftSim *sim, int32_t *etas, int32_t *shafts, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,297 @@
+/** \file lookahead.c
+ *  This file contains look-ahead dispatching. call_lift() and the hall call
+ *  registry both decide where a call goes from an estimate of how long each lift
+ *  would take to get there, and the estimate knows nothing of the calls the lift
+ *  would be held up by, or would hold up in turn.
+ *
+ *  Here each lift that could take the call is tried for real: the building is
+ *  forked (see snapshot.c), the call is given to that lift in the fork, and the
+ *  fork is run forward for up to 'horizon' updates. Every update, each stop still
+ *  outstanding in the fork adds one to the cost, so the cost is the total time the
+ *  stops - the new call and every stop already made - take to be reached, with
+ *  any left at the end counted as taking the whole horizon. The call goes to the
+ *  lift with the lowest cost, or the lowest numbered lift of those that tie.
+ *
+ *  The forks don't know about the passengers, so nobody gets in or presses a
+ *  button in them; the riders' destinations already in the stops are all they
+ *  run to. The candidates are tried on up to 'threads' threads at once, each with
+ *  its own fork that it copies the snapshot into again for each candidate, and
+ *  the lift chosen does not depend on how many threads there are.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "lookahead.h"
+#include "liftfsm.h"
+
+/** One thread running forks. */
+typedef struct {
+    Lookahead *ahead;       //!< The look-ahead the forks are for.
+    Snapshot *fork;         //!< The thread's own fork.
+    long forked;            //!< Forks it has run for this call.
+    long updates;           //!< Updates it has run for this call.
+    pthread_t thread;       //!< The thread.
+} Forker;
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void *fork_thread(void *arg);
+static long try_candidate(Forker *forker, int shaftnum);
+static int outstanding_stops(Snapshot *snap);
+
+
+/* ============================================================================ *
+ * Creating and releasing look-ahead dispatching                                *
+ * ============================================================================ */
+
+/** Set up look-ahead dispatching for a building.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param horizon    Updates to run each fork forward for.
+ *  \param threads    The most threads to run forks on; this is limited to
+ *                    LOOKAHEAD_MAX_THREADS, and to the number of shafts.
+ *  \return A pointer to the new Lookahead.
+ */
+Lookahead *create_lookahead(Shaft **shafts, int shaftcount, long horizon, int threads)
+{
+    Lookahead *ahead = (Lookahead *)calloc(1, sizeof(Lookahead));
+    int i;
+
+    if(threads > LOOKAHEAD_MAX_THREADS) {
+        threads = LOOKAHEAD_MAX_THREADS;
+    }
+    if(threads > shaftcount) {
+        threads = shaftcount;
+    }
+    if(threads < 1) {
+        threads = 1;
+    }
+
+    if(ahead) {
+        ahead -> now        = take_snapshot(shafts, shaftcount);
+        ahead -> forks      = (Snapshot **)calloc(threads, sizeof(Snapshot *));
+        ahead -> candidates = (int *)malloc(shaftcount * sizeof(int));
+        ahead -> cost       = (long *)malloc(shaftcount * sizeof(long));
+    }
+    if(!ahead || !ahead -> now || !ahead -> forks || !ahead -> candidates || !ahead -> cost) {
+        fprintf(stderr, "Unable to allocate space for look-ahead dispatching.\n");
+        exit(1);
+    }
+
+    for(i = 0; i < threads; ++i) {
+        ahead -> forks[i] = fork_snapshot(ahead -> now);
+        if(!ahead -> forks[i]) {
+            fprintf(stderr, "Unable to allocate space for look-ahead dispatching.\n");
+            exit(1);
+        }
+    }
+
+    ahead -> shafts     = shafts;
+    ahead -> shaftcount = shaftcount;
+    ahead -> horizon    = horizon;
+    ahead -> threads    = threads;
+
+    return ahead;
+}
+
+
+/** Release the memory used by look-ahead dispatching. Calls already given to lifts
+ *  stay in their stops.
+ *
+ *  \param ahead The look-ahead to free.
+ */
+void free_lookahead(Lookahead *ahead)
+{
+    int i;
+
+    for(i = 0; i < ahead -> threads; ++i) {
+        free_snapshot(ahead -> forks[i]);
+    }
+    free_snapshot(ahead -> now);
+    free(ahead -> forks);
+    free(ahead -> candidates);
+    free(ahead -> cost);
+    free(ahead);
+}
+
+
+/* ============================================================================ *
+ * Placing calls                                                                *
+ * ============================================================================ */
+
+/** Give a hall call to the lift that does best with it when the building is run
+ *  forward. If a lift already has the call this does nothing, and lifts out of
+ *  service are not tried.
+ *
+ *  \param ahead     The look-ahead.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in, DIR_UP or DIR_DOWN.
+ *  \return The shaft of the lift given the call, or -1 if no lift was.
+ */
+int lookahead_call(Lookahead *ahead, int floor, Moving direction)
+{
+    Forker forkers[ahead -> threads];
+    int shaftnum, threads, i, best = -1;
+
+    if(lookahead_pending(ahead, floor, direction)) {
+        return -1;
+    }
+
+    ahead -> candidatecount = 0;
+    for(shaftnum = 0; shaftnum < ahead -> shaftcount; ++shaftnum) {
+        if(get_state(ahead -> shafts[shaftnum] -> car) != STATE_OUT_OF_SERVICE) {
+            ahead -> candidates[ahead -> candidatecount++] = shaftnum;
+        }
+    }
+    if(!ahead -> candidatecount) {
+        return -1;
+    }
+
+    ++ahead -> calls;
+    ahead -> floor = floor;
+    ahead -> bit = (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+    atomic_store(&ahead -> next, 0);
+
+    // The building can't have changed shape since the snapshot was taken
+    capture_snapshot(ahead -> now, ahead -> shafts, ahead -> shaftcount);
+
+    // This thread runs forks too, so only the others are started
+    threads = (ahead -> candidatecount < ahead -> threads) ? ahead -> candidatecount : ahead -> threads;
+    for(i = 0; i < threads; ++i) {
+        forkers[i].ahead   = ahead;
+        forkers[i].fork    = ahead -> forks[i];
+        forkers[i].forked  = 0;
+        forkers[i].updates = 0;
+        if(i > 0 && pthread_create(&forkers[i].thread, NULL, fork_thread, &forkers[i])) {
+            fprintf(stderr, "Unable to start look-ahead thread %d.\n", i);
+            exit(1);
+        }
+    }
+    fork_thread(&forkers[0]);
+
+    for(i = 0; i < threads; ++i) {
+        if(i > 0) {
+            pthread_join(forkers[i].thread, NULL);
+        }
+        ahead -> forked  += forkers[i].forked;
+        ahead -> updates += forkers[i].updates;
+    }
+
+    for(i = 0; i < ahead -> candidatecount; ++i) {
+        if(best < 0 || ahead -> cost[i] < ahead -> cost[best]) {
+            best = i;
+        }
+    }
+
+    shaftnum = ahead -> candidates[best];
+    ahead -> shafts[shaftnum] -> car -> stops[floor] |= ahead -> bit;
+
+    return shaftnum;
+}
+
+
+/** Determine whether a hall call has been given to a lift, and not yet answered.
+ *
+ *  \param ahead     The look-ahead.
+ *  \param floor     The floor to check.
+ *  \param direction The direction the caller wants to go in.
+ *  \return true if a lift has the call in its stops, false otherwise.
+ */
+int lookahead_pending(Lookahead *ahead, int floor, Moving direction)
+{
+    int bit = (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < ahead -> shaftcount; ++shaftnum) {
+        if(ahead -> shafts[shaftnum] -> car -> stops[floor] & bit) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* ============================================================================ *
+ * Running forks                                                                *
+ * ============================================================================ */
+
+/** The body of a thread running forks: take candidates until there are none left,
+ *  and work out the cost of each.
+ *
+ *  \param arg A pointer to the thread's Forker.
+ *  \return Always NULL.
+ */
+static void *fork_thread(void *arg)
+{
+    Forker *forker = (Forker *)arg;
+    Lookahead *ahead = forker -> ahead;
+    int candidate;
+
+    while((candidate = atomic_fetch_add(&ahead -> next, 1)) < ahead -> candidatecount) {
+        ahead -> cost[candidate] = try_candidate(forker, ahead -> candidates[candidate]);
+    }
+
+    return NULL;
+}
+
+
+/** Fork the building, give the call to a lift in the fork, and run it forward.
+ *
+ *  \param forker   The thread running the fork.
+ *  \param shaftnum The shaft of the lift to give the call to.
+ *  \return The sum over the updates run of the stops outstanding in each.
+ */
+static long try_candidate(Forker *forker, int shaftnum)
+{
+    Lookahead *ahead = forker -> ahead;
+    Snapshot *fork = forker -> fork;
+    long tick, cost = 0;
+    int outstanding;
+
+    copy_snapshot(fork, ahead -> now);
+    fork -> shafts[shaftnum] -> car -> stops[ahead -> floor] |= ahead -> bit;
+    ++forker -> forked;
+
+    for(tick = 0; tick < ahead -> horizon; ++tick) {
+        outstanding = outstanding_stops(fork);
+        if(!outstanding) {
+            break;
+        }
+
+        cost += outstanding;
+        run_snapshot(fork, 1);
+    }
+    forker -> updates += tick;
+
+    return cost;
+}
+
+
+/** Count the stops still to be made in a snapshot. A floor with a hall call and a
+ *  rider's stop counts twice, as both are somebody waiting.
+ *
+ *  \param snap The snapshot to inspect.
+ *  \return The number of stop bits set in all the lifts.
+ */
+static int outstanding_stops(Snapshot *snap)
+{
+    int shaftnum, floor, stops, count = 0;
+    Lift *car;
+
+    for(shaftnum = 0; shaftnum < snap -> shaftcount; ++shaftnum) {
+        car = snap -> shafts[shaftnum] -> car;
+        for(floor = 0; floor <= get_topfloor(car); ++floor) {
+            stops = car -> stops[floor];
+            count += ((stops & STOP_CAR) != 0) + ((stops & STOP_HALL_UP) != 0) + ((stops & STOP_HALL_DOWN) != 0);
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,51 @@
+/** \file lookahead.h
+ *  Declarations for look-ahead dispatching, which gives each hall call to the lift
+ *  that does best when the building is actually run forward with the call given
+ *  to it, rather than to the one service_call() guesses is best.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef LOOKAHEAD_H
+#define LOOKAHEAD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "snapshot.h"
+#include "stops.h"
+
+// Updates each fork of the building is run forward for
+#define LOOKAHEAD_HORIZON 120
+
+// The most threads the forks are run on
+#define LOOKAHEAD_MAX_THREADS 8
+
+/** Look-ahead dispatching for a building. The snapshot and forks are made once,
+ *  when it is created, and only copied into for each call.
+ */
+typedef struct {
+    Shaft **shafts;         //!< The shafts in the building.
+    int shaftcount;         //!< The number of shafts.
+    long horizon;           //!< Updates each fork is run forward for.
+    int threads;            //!< The most threads to run forks on.
+
+    Snapshot *now;          //!< The building as it was when the call being placed was made.
+    Snapshot **forks;       //!< One fork for each thread, run forward for each candidate in turn.
+    int *candidates;        //!< The lifts that could be given the call.
+    long *cost;             //!< The cost of giving the call to each candidate.
+    int candidatecount;     //!< The number of candidates.
+    int floor;              //!< The floor of the call being placed.
+    int bit;                //!< Its direction, as a hall call bit in the lifts' stops.
+    atomic_int next;        //!< The next candidate for a thread to try.
+
+    long calls;             //!< Calls placed.
+    long forked;            //!< Forks run.
+    long updates;           //!< Updates run in forks.
+} Lookahead;
+
+Lookahead *create_lookahead(Shaft **shafts, int shaftcount, long horizon, int threads);
+void free_lookahead(Lookahead *ahead);
+int lookahead_call(Lookahead *ahead, int floor, Moving direction);
+int lookahead_pending(Lookahead *ahead, int floor, Moving direction);
+
+#endif
@@ -17,33 +17,590 @@
 #include <math.h>
 #include "shaft.h"
 #include "lift.h"
+#include "viewport.h"
+#include "verify.h"
+#include "zone.h"
+#include "notify.h"
+#include "parking.h"
+#include "passenger.h"
+#include "publish.h"
+#include "profile.h"
+#include "render.h"
+#include "optimal.h"
+#include "dispatch.h"
+#include "pacing.h"
+#include "command.h"
+#include "advance.h"
+#include "twin.h"
+#include "destination.h"
+#include "fault.h"
+#include "benchmark.h"
+#include "journal.h"
+
+
+/** What the program has been asked to do. Each mode but the interactive one is
+ *  chosen by an option of the same name.
+ */
+typedef enum {
+    MODE_INTERACTIVE,
+    MODE_VERIFY,
+    MODE_PASSENGERS,
+    MODE_DESTINATION,
+    MODE_FAULTS,
+    MODE_RENDER_THREAD,
+    MODE_RATE,
+    MODE_TWIN,
+    MODE_OPTIMAL,
+    MODE_MAKE_TRACE,
+    MODE_TOURNAMENT,
+    MODE_BENCHMARK,
+    MODE_WATCH,
+    MODE_REPLAY,
+    MODE_CHECK_JOURNAL
+} Mode;
+
+/** Everything read from the command line. The numbers after a mode's option are
+ *  stored in the fields they share with other modes, defaulting per mode.
+ */
+typedef struct {
+    Mode mode;                      //!< The mode to run in.
+    int shaft_count;                //!< The number of shafts in the building.
+    int shaft_height;               //!< The top floor of the building.
+    int car_speed;                  //!< Shaft sections each lift moves per update.
+
+    int ticks;                      //!< Updates to run for.
+    int rate;                       //!< Arrivals (or calls) per 1000 updates.
+    int seed;                       //!< Seed for generated traffic.
+    int capacity;                   //!< Passengers each car can hold.
+    int interval;                   //!< Updates between --verify comparisons.
+    int fps;                        //!< Frames drawn per second.
+    int hz;                         //!< Updates per second for --rate.
+    int multiplier;                 //!< How much faster than real time --rate runs.
+    int cars;                       //!< Cars in each shaft for --twin.
+    int calls;                      //!< Calls to write with --make-trace.
+    int population;                 //!< People on each floor above the lobby for --benchmark.
+    const char *filename;           //!< The script, trace, journal or shared memory name the mode uses.
+    const Engine *engine;           //!< The engine to check with --verify.
+    Objective objective;            //!< What --optimal minimises.
+
+    const Dispatcher *dispatcher;   //!< Chooses lifts for hall calls, or NULL for call_lift().
+    int zone_count;                 //!< Zones to split the shafts into.
+    int park_halflife;              //!< Half life of parking demand, or 0 not to park.
+    int commands;                   //!< true to read command lines rather than prompting.
+    int profile;                    //!< true to time each phase of the loop.
+    const char *publish_name;       //!< Shared memory to publish the lifts in, or NULL.
+    const char *journal_name;       //!< The file to journal the session in, or NULL.
+} Options;
+
+
+static int parse_options(int argc, char **argv, Options *options);
+static int set_mode(Options *options, Mode mode);
+static int run_session(Shaft **shafts, const Options *options, Publisher *publisher);
+static int option_int(int argc, char **argv, int *argnum, int *value);
+static void print_fault(void *data, Lift *car);
+static void usage(const char *progname);
 
 
  int main(int argc, char **argv){
 
     int i;
-    int car_speed = 2;
-    int shaft_count;
-    int shaft_height;
-    string_to_int(argv[1], &shaft_count);
-    string_to_int(argv[2], &shaft_height);
+    int status = 0;
+    Options options;
+    Publisher *publisher = NULL;
+
+    //The number of shafts and their height must be provided on the command line, and any options after that.
+    if(!parse_options(argc, argv, &options)) {
+        return 1;
+    }
+
+    //A lift found in an illegal state is taken out of service and reported to the fault hooks,
+    //so say so - unless this is a faults run, which reports the faults it causes itself.
+    if(options.mode != MODE_FAULTS) {
+        add_fault_hook(print_fault, NULL);
+    }
+
+    //Some modes make their own lifts, or need none, so they are run before the building is made.
+    switch(options.mode) {
+    case MODE_VERIFY:
+        return run_verify(options.engine, options.shaft_count, options.shaft_height, options.car_speed,
+                          options.ticks, options.interval, options.seed);
+    case MODE_TWIN:
+        run_twins(options.shaft_count, options.cars, options.shaft_height, options.car_speed,
+                  options.ticks, options.fps, options.seed);
+        return 0;
+    case MODE_OPTIMAL:
+        return run_optimal(options.filename, options.shaft_count, options.shaft_height, options.car_speed,
+                           options.objective);
+    case MODE_MAKE_TRACE:
+        return !write_trace(options.filename, options.calls, options.shaft_height, options.rate, options.seed);
+    case MODE_TOURNAMENT:
+        run_tournament(options.shaft_count, options.shaft_height, options.car_speed, options.ticks,
+                       options.rate, options.capacity, options.seed);
+        return 0;
+    case MODE_BENCHMARK:
+        run_benchmark(options.shaft_count, options.shaft_height, options.car_speed, options.ticks,
+                      options.capacity, options.population, options.dispatcher, options.seed, stdout);
+        return 0;
+    case MODE_WATCH:
+        run_watch(options.filename);
+        return 1;
+    case MODE_REPLAY:
+        return !replay_journal(options.filename, options.shaft_count, options.shaft_height);
+    case MODE_CHECK_JOURNAL:
+        return !check_journal(options.filename, options.shaft_count, options.shaft_height, options.car_speed,
+                              options.zone_count, options.park_halflife, options.ticks, options.seed);
+    default:
+        break;
+    }
+
+    //Publish the state of the lifts in shared memory for other programs to watch if asked to.
+    if(options.publish_name && (options.mode == MODE_RATE || options.mode == MODE_INTERACTIVE) &&
+       !(publisher = open_publisher(options.publish_name, options.shaft_count, options.shaft_height))) {
+        return 1;
+    }
 
     //Allocate space for a number of lift shaft pointers, the number of which should be provided on the command line.
-    Shaft *shafts[shaft_count];
+    Shaft *shafts[options.shaft_count];
 
     //Create enough shafts for each pointer, the height of the shafts should be the same, and the height should be provided on the command line.
-    for(i = 0; i < shaft_count; ++i) {
-        shafts[i] = create_shaft(shaft_height, car_speed);
+    for(i = 0; i < options.shaft_count; ++i) {
+        shafts[i] = create_shaft(options.shaft_height, options.car_speed);
+    }
+
+    switch(options.mode) {
+    case MODE_PASSENGERS:
+        run_passengers(shafts, options.shaft_count, options.shaft_height, options.ticks, options.rate,
+                       options.capacity, options.dispatcher, options.seed);
+        break;
+    case MODE_DESTINATION:
+        run_destinations(shafts, options.shaft_count, options.shaft_height, options.ticks, options.rate,
+                         options.capacity, options.seed);
+        break;
+    case MODE_FAULTS:
+        status = !run_faults(shafts, options.shaft_count, options.shaft_height, options.ticks, options.rate,
+                             options.capacity, options.dispatcher, options.filename, options.seed);
+        break;
+    case MODE_RENDER_THREAD:
+        run_rendered(shafts, options.shaft_count, options.shaft_height, options.ticks, options.fps, options.seed);
+        break;
+    case MODE_RATE:
+        run_paced(shafts, options.shaft_count, options.shaft_height, options.hz, options.multiplier,
+                  options.ticks, options.seed, publisher);
+        break;
+    default:
+        status = run_session(shafts, &options, publisher);
+        break;
+    }
+
+    if(publisher) {
+        close_publisher(publisher);
+    }
+    for(i = 0; i < options.shaft_count; ++i) {
+        free_shaft(shafts[i]);
+    }
+    return status;
+}
+
+
+/** Read the command line. The options can be given in any order, but only one of
+ *  them can choose a mode. Anything that isn't understood prints the usage.
+ *
+ *  \param argc    The number of command line arguments.
+ *  \param argv    The command line arguments.
+ *  \param options A pointer to the Options to fill in.
+ *  \return true if the command line was understood, false if the program should exit.
+ */
+static int parse_options(int argc, char **argv, Options *options)
+{
+    int i;
+
+    memset(options, 0, sizeof(Options));
+    options -> mode = MODE_INTERACTIVE;
+    options -> car_speed = 2;
+    options -> zone_count = 1;
+
+    if(argc < 3 || !string_to_int(argv[1], &options -> shaft_count) ||
+       !string_to_int(argv[2], &options -> shaft_height) ||
+       options -> shaft_count < 1 || options -> shaft_height < 1) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    for(i = 3; i < argc; ++i) {
+        if(!strcmp(argv[i], "--verify") && i + 1 < argc && set_mode(options, MODE_VERIFY)) {
+            if(!(options -> engine = find_engine(argv[++i]))) {
+                fprintf(stderr, "Unknown engine '%s'. Engines that can be verified are:\n", argv[i]);
+                list_engines(stderr);
+                return 0;
+            }
+            options -> ticks = 100000;
+            options -> interval = 1;
+            options -> seed = 1;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> interval);
+            option_int(argc, argv, &i, &options -> seed);
+            if(options -> interval < 1) {
+                options -> interval = 1;
+            }
+        } else if((!strcmp(argv[i], "--passengers") && set_mode(options, MODE_PASSENGERS)) ||
+                  (!strcmp(argv[i], "--destination") && set_mode(options, MODE_DESTINATION)) ||
+                  (!strcmp(argv[i], "--faults") && i + 1 < argc && set_mode(options, MODE_FAULTS))) {
+            if(options -> mode == MODE_FAULTS) {
+                options -> filename = argv[++i];
+            }
+            options -> ticks = 100000;
+            options -> rate = 100;
+            options -> seed = 1;
+            options -> capacity = DEFAULT_CAPACITY;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> rate);
+            option_int(argc, argv, &i, &options -> seed);
+            option_int(argc, argv, &i, &options -> capacity);
+        } else if(!strcmp(argv[i], "--render-thread") && set_mode(options, MODE_RENDER_THREAD)) {
+            options -> fps = 30;
+            options -> ticks = 1000000;
+            options -> seed = 1;
+            option_int(argc, argv, &i, &options -> fps);
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> seed);
+        } else if(!strcmp(argv[i], "--rate") && set_mode(options, MODE_RATE) &&
+                  option_int(argc, argv, &i, &options -> hz)) {
+            options -> multiplier = 1;
+            options -> ticks = 1000;
+            options -> seed = 1;
+            option_int(argc, argv, &i, &options -> multiplier);
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> seed);
+        } else if(!strcmp(argv[i], "--twin") && set_mode(options, MODE_TWIN) &&
+                  option_int(argc, argv, &i, &options -> cars)) {
+            options -> ticks = 100000;
+            options -> seed = 1;
+            options -> fps = 0;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> seed);
+            option_int(argc, argv, &i, &options -> fps);
+        } else if(!strcmp(argv[i], "--optimal") && i + 1 < argc && set_mode(options, MODE_OPTIMAL)) {
+            options -> filename = argv[++i];
+            options -> objective = OBJECTIVE_TOTAL;
+
+            if(i + 1 < argc && !strcmp(argv[i + 1], "max")) {
+                options -> objective = OBJECTIVE_MAX;
+                ++i;
+            } else if(i + 1 < argc && !strcmp(argv[i + 1], "total")) {
+                ++i;
+            }
+        } else if(!strcmp(argv[i], "--make-trace") && i + 1 < argc && set_mode(options, MODE_MAKE_TRACE)) {
+            options -> filename = argv[++i];
+            options -> calls = 20;
+            options -> rate = 50;
+            options -> seed = 1;
+            option_int(argc, argv, &i, &options -> calls);
+            option_int(argc, argv, &i, &options -> rate);
+            option_int(argc, argv, &i, &options -> seed);
+        } else if(!strcmp(argv[i], "--tournament") && set_mode(options, MODE_TOURNAMENT)) {
+            options -> ticks = 100000;
+            options -> rate = 100;
+            options -> seed = 1;
+            options -> capacity = DEFAULT_CAPACITY;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> rate);
+            option_int(argc, argv, &i, &options -> seed);
+            option_int(argc, argv, &i, &options -> capacity);
+        } else if(!strcmp(argv[i], "--benchmark") && set_mode(options, MODE_BENCHMARK)) {
+            options -> ticks = 3600;
+            options -> seed = 1;
+            options -> capacity = DEFAULT_CAPACITY;
+            options -> population = DEFAULT_FLOOR_POPULATION;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> seed);
+            option_int(argc, argv, &i, &options -> capacity);
+            option_int(argc, argv, &i, &options -> population);
+        } else if(!strcmp(argv[i], "--watch") && i + 1 < argc && set_mode(options, MODE_WATCH)) {
+            options -> filename = argv[++i];
+        } else if(!strcmp(argv[i], "--replay") && i + 1 < argc && set_mode(options, MODE_REPLAY)) {
+            options -> filename = argv[++i];
+        } else if(!strcmp(argv[i], "--check-journal") && i + 1 < argc && set_mode(options, MODE_CHECK_JOURNAL)) {
+            options -> filename = argv[++i];
+            options -> ticks = 20000;
+            options -> seed = 1;
+            option_int(argc, argv, &i, &options -> ticks);
+            option_int(argc, argv, &i, &options -> seed);
+        } else if(!strcmp(argv[i], "--dispatcher") && i + 1 < argc) {
+            if(!(options -> dispatcher = find_dispatcher(argv[++i]))) {
+                fprintf(stderr, "Unknown dispatcher '%s'. Dispatchers are:\n", argv[i]);
+                list_dispatchers(stderr);
+                return 0;
+            }
+        } else if(!strcmp(argv[i], "--hall-calls")) {
+            options -> dispatcher = find_dispatcher("eta");
+        } else if(!strcmp(argv[i], "--zones") && option_int(argc, argv, &i, &options -> zone_count)) {
+            continue;
+        } else if(!strcmp(argv[i], "--publish") && i + 1 < argc) {
+            options -> publish_name = argv[++i];
+        } else if(!strcmp(argv[i], "--journal") && i + 1 < argc) {
+            options -> journal_name = argv[++i];
+        } else if(!strcmp(argv[i], "--commands")) {
+            options -> commands = 1;
+        } else if(!strcmp(argv[i], "--profile")) {
+            options -> profile = 1;
+        } else if(!strcmp(argv[i], "--park")) {
+            options -> park_halflife = 3 * DEMAND_DAY_TICKS;
+            option_int(argc, argv, &i, &options -> park_halflife);
+        } else {
+            usage(argv[0]);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/** Choose the mode to run in, unless another option has already chosen one.
+ *
+ *  \param options A pointer to the Options being filled in.
+ *  \param mode    The mode to choose.
+ *  \return true if the mode was chosen, false if one already had been.
+ */
+static int set_mode(Options *options, Mode mode)
+{
+    if(options -> mode != MODE_INTERACTIVE) {
+        return 0;
+    }
+
+    options -> mode = mode;
+    return 1;
+}
+
+
+/** Run the interactive simulation: update the lifts, draw them, and prompt for
+ *  calls and stops, until the user quits or the program is interrupted.
+ *
+ *  \param shafts    A pointer to a block of memory containing pointers to Shafts.
+ *  \param options   The options read from the command line.
+ *  \param publisher The shared memory to publish the lifts in, or NULL.
+ *  \return The program's exit status.
+ */
+static int run_session(Shaft **shafts, const Options *options, Publisher *publisher)
+{
+    int i;
+    int shaft_count = options -> shaft_count;
+    int shaft_height = options -> shaft_height;
+    int updates = 1;
+    int done;
+    uint64_t begin;
+    long tick = 0;
+    ZonedBuilding *zones = NULL;
+    Parking *parking = NULL;
+    Journal *journal = NULL;
+    Viewport view;
+
+    //Write every input to a journal with the update it was made on if asked to, so the session can be replayed.
+    if(options -> journal_name &&
+       !(journal = open_journal(options -> journal_name, &tick, shaft_count, shaft_height, options -> car_speed,
+                                options -> zone_count, options -> park_halflife))) {
+        return 1;
+    }
+
+    //Split the shafts into zones if asked to; each zone is updated on its own thread.
+    if(options -> zone_count > 1) {
+        zones = create_zones(shafts, shaft_count, shaft_height, options -> zone_count);
+    }
+
+    //Park idle lifts where calls are expected if asked to, learning from the calls the user makes.
+    if(options -> park_halflife > 0) {
+        parking = create_parking(shaft_height, options -> park_halflife);
+        add_input_hook(parking_hook, NULL, parking);
+    }
+
+    //Show as much of the building as fits in the terminal, starting from the ground floor.
+    full_viewport(&view, shafts, shaft_count);
+
+    //Time each phase of the loop if asked to; an interrupt then ends the loop instead of the program.
+    //A journal also needs the loop to end cleanly, so that the final state gets written to it.
+    if(options -> profile) {
+        start_profile();
+    } else if(journal) {
+        catch_interrupt();
     }
 
     //Enter an infinite loop.
-    while(1) {
+    while(!profile_stopped()) {
     //Each time through the loop, update the shafts, print the shafts, and prompt the user for input.
-        for(i = 0; i < shaft_count; ++i){
-            update_lift(shafts[i]->car);
+        begin = profile_begin();
+        //When several updates are asked for and nothing needs to see each one, skip straight through them.
+        //Zones run through them together, only meeting after each one while passengers change zones.
+        if(zones && !publisher) {
+            update_zones(zones, updates);
+            tick += updates;
+            updates = 0;
+        } else if(!zones && !parking && !publisher) {
+            while(updates > 1) {
+                done = advance_building(shafts, shaft_count, updates - 1);
+                updates -= done;
+                tick += done;
+            }
         }
-        print_shafts(shafts, shaft_count);
-        prompt_user(shafts, shaft_count, shaft_height);
+        for(; updates > 0; --updates) {
+            if(zones) {
+                update_zones(zones, 1);
+            } else {
+                for(i = 0; i < shaft_count; ++i){
+                    update_lift(shafts[i]->car);
+                }
+                if(parking) {
+                    park_idle_cars(parking, shafts, shaft_count, tick);
+                }
+            }
+            ++tick;
+            if(publisher) {
+                publish_state(publisher, shafts, tick);
+            }
+        }
+        profile_end(PHASE_UPDATE, begin);
+        begin = profile_begin();
+        fit_viewport(&view, shafts, shaft_count);
+        print_viewport(shafts, shaft_count, &view);
+        profile_end(PHASE_RENDER, begin);
+        begin = profile_begin();
+        if(options -> commands) {
+            updates = prompt_commands(shafts, shaft_count, shaft_height, zones, &view);
+            profile_end(PHASE_INPUT, begin);
+            if(updates == COMMANDS_QUIT) {
+                break;
+            }
+        } else {
+            if(zones) {
+                prompt_zones(zones, shaft_height);
+            } else {
+                prompt_user(shafts, shaft_count, shaft_height);
+            }
+            profile_end(PHASE_INPUT, begin);
+            //Once the input has run out nothing more can be asked for, so the session ends, as 'q' ends it with --commands.
+            if(feof(stdin)) {
+                break;
+            }
+            updates = 1;
+        }
+    }
+
+    if(profiling()) {
+        print_profile(stderr);
     }
+
+    if(journal) {
+        close_journal(journal, shafts, shaft_count);
+    }
+
+    if(parking) {
+        remove_input_hook(parking_hook, NULL, parking);
+        free_parking(parking);
+    }
+    if(zones) {
+        free_zones(zones);
+    }
+    return 0;
+}
+
+
+/** Read an optional number following a command line option. If the next argument
+ *  is a number it is stored in 'value' and skipped over, otherwise 'value' is left
+ *  alone so the default is used.
+ *
+ *  \param argc   The number of command line arguments.
+ *  \param argv   The command line arguments.
+ *  \param argnum A pointer to the index of the last argument used.
+ *  \param value  A pointer to the variable to store the number in.
+ *  \return true if a number was read, false otherwise.
+ */
+static int option_int(int argc, char **argv, int *argnum, int *value)
+{
+    if(*argnum + 1 < argc && isdigit((unsigned char)argv[*argnum + 1][0]) &&
+       string_to_int(argv[*argnum + 1], value)) {
+        ++*argnum;
+        return 1;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
+
+
+/** A fault hook that prints a message for each lift taken out of service by a fault.
+ *
+ *  \param data Not used.
+ *  \param car  The lift that has been taken out of service.
+ */
+static void print_fault(void *data, Lift *car)
+{
+    (void)data;
+    (void)car;
+
+    fprintf(stderr, "the finite state machine has entered an illegal state; the lift has been taken out of service.\n");
+}
+
+
+/** Print out a summary of the command line arguments.
+ *
+ *  \param progname The name the program was run as.
+ */
+static void usage(const char *progname)
+{
+    fprintf(stderr, "Usage: %s <shafts> <floors> [options]\n", progname);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "    --verify <engine> [updates] [interval] [seed]\n");
+    fprintf(stderr, "        check an engine against the reference lifts, comparing every interval updates\n");
+    fprintf(stderr, "    --passengers [updates] [rate] [seed] [capacity]\n");
+    fprintf(stderr, "        run without prompting, with rate passengers arriving per 1000 updates\n");
+    fprintf(stderr, "    --destination [updates] [rate] [seed] [capacity]\n");
+    fprintf(stderr, "        the same, with passengers giving their destination when they call and grouped into\n");
+    fprintf(stderr, "        lifts by it, then compared with ordinary hall calls on the same arrivals\n");
+    fprintf(stderr, "    --faults <script> [updates] [rate] [seed] [capacity]\n");
+    fprintf(stderr, "        the same as --passengers while lifts fail as the script says, then compared with no\n");
+    fprintf(stderr, "        faults; the script is update:shaft:kind[:updates out],... where kind is doors,\n");
+    fprintf(stderr, "        maintenance, power or state\n");
+    fprintf(stderr, "    --optimal <trace> [total|max]\n");
+    fprintf(stderr, "        search a model for the best assignment of a trace of hall calls to lifts, and compare\n");
+    fprintf(stderr, "        call_lift with it on the model and in the simulation\n");
+    fprintf(stderr, "    --make-trace <trace> [calls] [rate] [seed]\n");
+    fprintf(stderr, "        write a trace of random hall calls, with rate calls per 1000 updates\n");
+    fprintf(stderr, "    --dispatcher <name>\n");
+    fprintf(stderr, "        with --passengers, --faults or --benchmark, choose lifts for hall calls with this dispatcher\n");
+    fprintf(stderr, "    --hall-calls\n");
+    fprintf(stderr, "        the same as --dispatcher eta\n");
+    fprintf(stderr, "    --tournament [updates] [rate] [seed] [capacity]\n");
+    fprintf(stderr, "        run the same passengers with every dispatcher, and compare their waiting times\n");
+    fprintf(stderr, "    --benchmark [updates] [seed] [capacity] [population]\n");
+    fprintf(stderr, "        measure five-minute handling capacity, interval, round trip, waiting and destination\n");
+    fprintf(stderr, "        times under up-peak and mixed traffic, with population people on each floor above the\n");
+    fprintf(stderr, "        lobby, and write them out as JSON (uses --dispatcher if given)\n");
+    fprintf(stderr, "    --render-thread [fps] [updates] [seed]\n");
+    fprintf(stderr, "        run at full speed with generated traffic, drawing on a separate thread\n");
+    fprintf(stderr, "    --rate <hz> [multiplier] [updates] [seed]\n");
+    fprintf(stderr, "        run with generated traffic at hz updates per second, multiplier times faster than\n");
+    fprintf(stderr, "        real time, and report how late updates started (publishing too if --publish is given)\n");
+    fprintf(stderr, "    --twin <cars> [updates] [seed] [fps]\n");
+    fprintf(stderr, "        run with generated traffic and several cars in each shaft, drawing fps frames a second if given\n");
+    fprintf(stderr, "    --publish <name>\n");
+    fprintf(stderr, "        publish the state of the lifts every update in POSIX shared memory\n");
+    fprintf(stderr, "    --watch <name>\n");
+    fprintf(stderr, "        print the lift state published by another simulation\n");
+    fprintf(stderr, "    --commands\n");
+    fprintf(stderr, "        read whole lines of commands, such as 'c3u c7d s2:5 t+50', instead of prompting for each;\n");
+    fprintf(stderr, "        v+<floors>, v-<floors>, h+<shafts> and h-<shafts> scroll buildings bigger than the terminal\n");
+    fprintf(stderr, "    --zones <count>\n");
+    fprintf(stderr, "        split the shafts into zones serving separate floor ranges, updated in parallel\n");
+    fprintf(stderr, "    --park [halflife]\n");
+    fprintf(stderr, "        send idle lifts to the floors where calls are expected (not used with --zones)\n");
+    fprintf(stderr, "    --journal <file>\n");
+    fprintf(stderr, "        write every call and stop made to file, with the update it was made on; control-C\n");
+    fprintf(stderr, "        ends the session cleanly, recording the final state\n");
+    fprintf(stderr, "    --replay <file>\n");
+    fprintf(stderr, "        run a journalled session again at full speed, without drawing or prompting, and check\n");
+    fprintf(stderr, "        that it finishes in the same state\n");
+    fprintf(stderr, "    --check-journal <file> [updates] [seed]\n");
+    fprintf(stderr, "        journal a session of generated calls and stops to file, using --zones and --park if\n");
+    fprintf(stderr, "        given, then replay it and check that it finishes in the same state\n");
+    fprintf(stderr, "    --profile\n");
+    fprintf(stderr, "        time updating, drawing, waiting for input and dispatching, and print a breakdown\n");
+    fprintf(stderr, "        when the program ends (control-C ends it cleanly)\n");
+}
@@ -0,0 +1,165 @@
+/** \file notify.c
+ *  This file contains the input notification hooks. prompt_user() and the other
+ *  prompting functions call notify_call() and notify_stop() for every call and stop
+ *  they accept, and those pass the input on to every hook that has been added.
+ *  update_lift() calls notify_fault() when it finds a lift in a state the finite
+ *  state machine doesn't know, having taken the lift out of service.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "notify.h"
+
+// The most hooks that may be added at once
+#define MAX_HOOKS 8
+
+/** A registered set of hook functions, and the data to pass them. */
+typedef struct {
+    CallHook on_call;
+    StopHook on_stop;
+    void *data;
+} Hook;
+
+/** A registered fault hook, and the data to pass it. */
+typedef struct {
+    FaultHook on_fault;
+    void *data;
+} FaultHandler;
+
+static Hook hooks[MAX_HOOKS];
+static int hookcount = 0;
+static FaultHandler faulthooks[MAX_HOOKS];
+static int faulthookcount = 0;
+
+
+/** Add a hook to be told about calls and stops. Either function may be NULL if
+ *  the hook is not interested in that kind of input.
+ *
+ *  \param on_call The function to call for each hall call.
+ *  \param on_stop The function to call for each stop.
+ *  \param data    A pointer passed to the hook functions.
+ *  \return true if the hook was added, false if there is no room for more hooks.
+ */
+int add_input_hook(CallHook on_call, StopHook on_stop, void *data)
+{
+    if(hookcount == MAX_HOOKS) {
+        return 0;
+    }
+
+    hooks[hookcount].on_call = on_call;
+    hooks[hookcount].on_stop = on_stop;
+    hooks[hookcount].data = data;
+    ++hookcount;
+
+    return 1;
+}
+
+
+/** Remove a hook added by add_input_hook(), so that its data can be freed.
+ *
+ *  \param on_call The call function the hook was added with.
+ *  \param on_stop The stop function the hook was added with.
+ *  \param data    The data the hook was added with.
+ */
+void remove_input_hook(CallHook on_call, StopHook on_stop, void *data)
+{
+    int i;
+
+    for(i = 0; i < hookcount; ++i) {
+        if(hooks[i].on_call == on_call && hooks[i].on_stop == on_stop && hooks[i].data == data) {
+            hooks[i] = hooks[--hookcount];
+            return;
+        }
+    }
+}
+
+
+/** Tell the hooks that a hall call has been made.
+ *
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+void notify_call(int floor, Moving direction)
+{
+    int i;
+
+    for(i = 0; i < hookcount; ++i) {
+        if(hooks[i].on_call) {
+            hooks[i].on_call(hooks[i].data, floor, direction);
+        }
+    }
+}
+
+
+/** Tell the hooks that a stop has been set for a lift.
+ *
+ *  \param shaftnum The number of the shaft containing the lift.
+ *  \param floor    The floor the lift will stop at.
+ */
+void notify_stop(int shaftnum, int floor)
+{
+    int i;
+
+    for(i = 0; i < hookcount; ++i) {
+        if(hooks[i].on_stop) {
+            hooks[i].on_stop(hooks[i].data, shaftnum, floor);
+        }
+    }
+}
+
+
+/** Add a hook to be told about lifts taken out of service by a fault.
+ *
+ *  \param on_fault The function to call for each fault.
+ *  \param data     A pointer passed to the hook function.
+ *  \return true if the hook was added, false if there is no room for more hooks.
+ */
+int add_fault_hook(FaultHook on_fault, void *data)
+{
+    if(faulthookcount == MAX_HOOKS) {
+        return 0;
+    }
+
+    faulthooks[faulthookcount].on_fault = on_fault;
+    faulthooks[faulthookcount].data = data;
+    ++faulthookcount;
+
+    return 1;
+}
+
+
+/** Remove a fault hook added by add_fault_hook(), so that its data can be freed.
+ *
+ *  \param on_fault The function the hook was added with.
+ *  \param data     The data the hook was added with.
+ */
+void remove_fault_hook(FaultHook on_fault, void *data)
+{
+    int i;
+
+    for(i = 0; i < faulthookcount; ++i) {
+        if(faulthooks[i].on_fault == on_fault && faulthooks[i].data == data) {
+            faulthooks[i] = faulthooks[--faulthookcount];
+            return;
+        }
+    }
+}
+
+
+/** Tell the hooks that a lift has been taken out of service because of a fault.
+ *
+ *  \param car The lift, already in STATE_OUT_OF_SERVICE.
+ *  \return The number of hooks told.
+ */
+int notify_fault(Lift *car)
+{
+    int i;
+
+    for(i = 0; i < faulthookcount; ++i) {
+        faulthooks[i].on_fault(faulthooks[i].data, car);
+    }
+
+    return faulthookcount;
+}
@@ -0,0 +1,32 @@
+/** \file notify.h
+ *  Declarations for input notification. Code that needs to know about the calls
+ *  and stops the user makes - without getting in the way of them - registers a
+ *  hook here, and the prompting functions report each accepted input to it.
+ *  Lifts that develop a fault are reported to fault hooks in the same way.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include "lift.h"
+
+/** Called when a hall call has been made. */
+typedef void (*CallHook)(void *data, int floor, Moving direction);
+
+/** Called when a stop has been set for the lift in a shaft. */
+typedef void (*StopHook)(void *data, int shaftnum, int floor);
+
+/** Called when a lift has been taken out of service because of a fault. */
+typedef void (*FaultHook)(void *data, Lift *car);
+
+int add_input_hook(CallHook on_call, StopHook on_stop, void *data);
+void remove_input_hook(CallHook on_call, StopHook on_stop, void *data);
+void notify_call(int floor, Moving direction);
+void notify_stop(int shaftnum, int floor);
+int add_fault_hook(FaultHook on_fault, void *data);
+void remove_fault_hook(FaultHook on_fault, void *data);
+int notify_fault(Lift *car);
+
+#endif
@@ -0,0 +1,1009 @@
+/** \file optimal.c
+ *  This file contains the offline dispatch solver. Given a recorded trace of hall
+ *  calls, it searches a model of the building for the assignment of calls to lifts
+ *  with the smallest total (or longest) wait, and reports how far the call_lift()
+ *  rule and some other simple rules fall short of it on the model. Every rule, and
+ *  the assignment the search found, is then replayed through the simulation itself.
+ *
+ *  In the model every lift starts idle on the ground floor and answers the calls it
+ *  is given in the order they were made. It takes an update to set off, travels at
+ *  its speed, takes an update to notice it has arrived, and spends OPENING_TIME,
+ *  OPEN_TIME, CLOSING_TIME and WAIT_TIME at each call, just as update_lift() does for
+ *  a lift with one stop at a time. A call's wait runs from the update it was made on
+ *  to the update the doors are open after, counting both. The search's result is
+ *  the best for the model, and the gaps are measured on the model; neither is a
+ *  bound on the simulation, which answers calls out of order and picks them up on
+ *  the way past, and so can do better or worse than the model with the same lifts.
+ *
+ *  The search is a branch and bound over the lift given to each call in turn. A
+ *  partial assignment is abandoned as soon as its wait so far, plus the least each
+ *  remaining call could possibly wait, is no better than the best complete
+ *  assignment found. Lifts in the same state are interchangeable, so only one of
+ *  them is tried at each step, and the lift that would open soonest is tried
+ *  first. The first few levels of the tree are split into separate prefixes,
+ *  which are searched in parallel, sharing the best result found so far.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "optimal.h"
+#include "shaft.h"
+#include "shaftcall.h"
+#include "traffic.h"
+
+// Nodes a search thread visits between checks of the shared node count
+#define NODE_BATCH 65536
+
+// Initial space for calls when reading a trace; it doubles whenever it fills up
+#define TRACE_SIZE 256
+
+// Prefixes to split the search into for each thread, so the threads stay busy
+#define PREFIXES_PER_THREAD 16
+
+// Most updates a replay runs on after the last call while calls are still unanswered
+#define REPLAY_LIMIT 1000000L
+
+
+/** A lift in the model: when it is next free to move, and where it is then. */
+typedef struct {
+    long free;          //!< The update the lift has finished its last call by.
+    int floor;          //!< The floor the lift is at once it is free.
+} ModelCar;
+
+/** Picks a lift for a call, given the state of the model lifts when the call is made. */
+typedef int (*Rule)(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed);
+
+/** Picks a lift for a call, given the state of the simulated lifts when the call is made. */
+typedef int (*SimRule)(Shaft **shafts, int shaftcount, const TraceCall *call);
+
+/** The search shared between all the threads. */
+typedef struct {
+    const Trace *trace;     //!< The calls being assigned.
+    int shaftcount;         //!< The number of lifts.
+    int speed;              //!< The speed of the lifts.
+    Objective objective;    //!< What is being minimised.
+
+    int depth;              //!< The number of calls assigned in each prefix.
+    int *prefixes;          //!< 'prefixcount' prefixes of 'depth' lifts each.
+    int prefixcount;        //!< The number of prefixes.
+    int nextprefix;         //!< The next prefix for a thread to search.
+
+    atomic_long best;       //!< The objective of the best assignment found.
+    int *bestassignment;    //!< The best assignment found.
+    atomic_long nodes;      //!< Nodes visited, added to in batches.
+    atomic_int stopped;     //!< Set when the node limit has been reached.
+    pthread_mutex_t lock;   //!< Protects nextprefix and bestassignment.
+} Search;
+
+/** One search thread's own state. */
+typedef struct {
+    Search *search;         //!< The shared search.
+    ModelCar *cars;         //!< The model lifts, after the calls assigned so far.
+    int *assignment;        //!< The lift given each call so far.
+    long nodes;             //!< Nodes visited since the last batch was added to the total.
+    pthread_t thread;       //!< The thread.
+} Worker;
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static long travel_time(int from, int to, int speed);
+static long serve_call(ModelCar *car, const TraceCall *call, int speed);
+static long combine(Objective objective, long cost, long wait);
+static long lower_bound(Search *search, const ModelCar *cars, int from, long cost);
+static int same_state(const ModelCar *a, const ModelCar *b, long tick);
+static void search_from(Worker *worker, int index, long cost);
+static void record_best(Worker *worker, long cost);
+static int make_prefixes(Search *search, int *prefix, ModelCar *cars, int index, int *stored);
+static void *search_thread(void *arg);
+static void apply_rule(const Trace *trace, int shaftcount, int speed, Rule rule, int *assignment);
+static int rule_call_lift(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed);
+static int rule_nearest(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed);
+static int rule_earliest(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed);
+static void replay_waits(const Trace *trace, int shaftcount, int topfloor, int speed, SimRule rule,
+                         const int *assignment, long *total, long *longest);
+static int sim_call_lift(Shaft **shafts, int shaftcount, const TraceCall *call);
+static int sim_nearest(Shaft **shafts, int shaftcount, const TraceCall *call);
+static int sim_earliest(Shaft **shafts, int shaftcount, const TraceCall *call);
+static long updates_to_open(Lift *car, int floor);
+
+
+/** The rules the search is compared against, on the model and in the simulation. */
+static const struct {
+    const char *name;
+    Rule rule;
+    SimRule simrule;
+} rules[] = {
+    { "call_lift", rule_call_lift, sim_call_lift },
+    { "nearest",   rule_nearest,   sim_nearest   },
+    { "earliest",  rule_earliest,  sim_earliest  },
+};
+
+#define RULE_COUNT ((int)(sizeof(rules) / sizeof(rules[0])))
+
+
+/* ============================================================================ *
+ * Traces                                                                       *
+ * ============================================================================ */
+
+/** Read a trace of hall calls from a file. Each line holds the update a call was
+ *  made on, the floor, and 'u' or 'd' for the direction, for example "120 7 d".
+ *  Blank lines and lines starting with '#' are ignored. Calls must be in the
+ *  order they were made.
+ *
+ *  \param filename The name of the file to read.
+ *  \return A pointer to the trace, or NULL if the file could not be read.
+ */
+Trace *read_trace(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    Trace *trace;
+    char line[128], dir;
+    int lineno = 0, size = TRACE_SIZE;
+    TraceCall call;
+
+    if(!file) {
+        fprintf(stderr, "Unable to open trace '%s'.\n", filename);
+        return NULL;
+    }
+
+    trace = (Trace *)calloc(1, sizeof(Trace));
+    if(trace) {
+        trace -> calls = (TraceCall *)malloc(size * sizeof(TraceCall));
+    }
+    if(!trace || !trace -> calls) {
+        fprintf(stderr, "Unable to allocate space for the trace.\n");
+        exit(1);
+    }
+
+    while(fgets(line, sizeof(line), file)) {
+        ++lineno;
+        if(line[strspn(line, " \t\r\n")] == '\0' || line[strspn(line, " \t")] == '#') {
+            continue;
+        }
+
+        if(sscanf(line, "%ld %d %c", &call.tick, &call.floor, &dir) != 3 || (dir != 'u' && dir != 'd') ||
+           call.floor < 0 || (trace -> count && call.tick < trace -> calls[trace -> count - 1].tick)) {
+            fprintf(stderr, "%s:%d: expected '<update> <floor> u|d', in update order.\n", filename, lineno);
+            fclose(file);
+            free_trace(trace);
+            return NULL;
+        }
+        call.direction = (dir == 'u') ? DIR_UP : DIR_DOWN;
+
+        if(trace -> count == size) {
+            TraceCall *bigger = (TraceCall *)realloc(trace -> calls, size * 2 * sizeof(TraceCall));
+
+            if(!bigger) {
+                fprintf(stderr, "Unable to allocate space for %d calls.\n", size * 2);
+                exit(1);
+            }
+            trace -> calls = bigger;
+            size *= 2;
+        }
+        trace -> calls[trace -> count++] = call;
+    }
+
+    fclose(file);
+    return trace;
+}
+
+
+/** Write a trace of randomly generated hall calls, in the format read_trace() reads.
+ *
+ *  \param filename The name of the file to write.
+ *  \param calls    The number of calls to write.
+ *  \param topfloor The top floor of the building.
+ *  \param rate     The chance of a call each update, per 1000.
+ *  \param seed     The seed for the calls.
+ *  \return true if the trace was written, false otherwise.
+ */
+int write_trace(const char *filename, int calls, int topfloor, int rate, uint64_t seed)
+{
+    FILE *file = fopen(filename, "w");
+    Traffic traffic;
+    long tick;
+    int floor;
+    Moving direction;
+
+    if(!file) {
+        fprintf(stderr, "Unable to create trace '%s'.\n", filename);
+        return 0;
+    }
+
+    init_traffic(&traffic, seed, topfloor, rate, 0);
+
+    fprintf(file, "# %d calls, top floor %d, %d per 1000 updates, seed %lu\n",
+            calls, topfloor, rate, (unsigned long)seed);
+    for(tick = 1; calls > 0; ++tick) {
+        if(next_call(&traffic, &floor, &direction)) {
+            fprintf(file, "%ld %d %c\n", tick, floor, direction == DIR_UP ? 'u' : 'd');
+            --calls;
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+
+/** Release the memory used by a trace.
+ *
+ *  \param trace The trace to free.
+ */
+void free_trace(Trace *trace)
+{
+    free(trace -> calls);
+    free(trace);
+}
+
+
+/* ============================================================================ *
+ * The model                                                                    *
+ * ============================================================================ */
+
+/** Work out the waits of every call in a trace, when each is given to the lift
+ *  named in an assignment.
+ *
+ *  \param trace      The calls.
+ *  \param shaftcount The number of lifts.
+ *  \param speed      The speed of the lifts.
+ *  \param assignment The shaft given each call.
+ *  \param total      A pointer to a long to store the sum of the waits in.
+ *  \param longest    A pointer to a long to store the longest wait in.
+ */
+void trace_waits(const Trace *trace, int shaftcount, int speed, const int *assignment, long *total, long *longest)
+{
+    ModelCar cars[shaftcount];
+    long wait;
+    int call;
+
+    memset(cars, 0, sizeof(cars));
+    *total = *longest = 0;
+
+    for(call = 0; call < trace -> count; ++call) {
+        wait = serve_call(&cars[assignment[call]], &trace -> calls[call], speed);
+        *total += wait;
+        if(wait > *longest) {
+            *longest = wait;
+        }
+    }
+}
+
+
+/** Work out how long a lift takes to travel between floors.
+ *
+ *  \param from  The floor the lift starts at.
+ *  \param to    The floor it travels to.
+ *  \param speed The speed of the lift.
+ *  \return The number of updates the journey takes.
+ */
+static long travel_time(int from, int to, int speed)
+{
+    return (((long)abs(to - from) * FLOOR_HEIGHT) + speed - 1) / speed;
+}
+
+
+/** Send a model lift to answer a call. The lift sets off on the update it is free,
+ *  or the update of the call if it is idle by then, as update_lift() turns an idle
+ *  or waiting lift with a stop into a moving one. It then travels, and takes one
+ *  more update to notice it is at the stop before it starts opening.
+ *
+ *  \param car   The lift, which is moved on to the state it is in after the call.
+ *  \param call  The call to answer.
+ *  \param speed The speed of the lift.
+ *  \return The call's wait.
+ */
+static long serve_call(ModelCar *car, const TraceCall *call, int speed)
+{
+    long start = (car -> free > call -> tick) ? car -> free : call -> tick;
+    long opened = start + travel_time(car -> floor, call -> floor, speed) + 1 + OPENING_TIME;
+
+    car -> free = opened + OPEN_TIME + CLOSING_TIME + WAIT_TIME;
+    car -> floor = call -> floor;
+
+    return opened - call -> tick + 1;
+}
+
+
+/** Add one call's wait to the objective so far.
+ *
+ *  \param objective What is being minimised.
+ *  \param cost      The objective for the calls before this one.
+ *  \param wait      This call's wait.
+ *  \return The objective including this call.
+ */
+static long combine(Objective objective, long cost, long wait)
+{
+    if(objective == OBJECTIVE_MAX) {
+        return (wait > cost) ? wait : cost;
+    }
+
+    return cost + wait;
+}
+
+
+/* ============================================================================ *
+ * The search                                                                   *
+ * ============================================================================ */
+
+/** Find the assignment of the calls in a trace to lifts with the smallest total or
+ *  longest wait on the model. If the search visits OPTIMAL_NODE_LIMIT nodes without finishing,
+ *  the best assignment found so far is returned and 'nodes' shows the limit was
+ *  reached.
+ *
+ *  \param trace      The calls.
+ *  \param shaftcount The number of lifts.
+ *  \param speed      The speed of the lifts.
+ *  \param objective  What to minimise.
+ *  \param threads    The number of threads to search with.
+ *  \param assignment Space for trace -> count ints, to store the shaft given each call in.
+ *  \param nodes      A pointer to a long to store the number of nodes visited in.
+ *  \return The objective of the assignment.
+ */
+long solve_optimal(const Trace *trace, int shaftcount, int speed, Objective objective, int threads,
+                   int *assignment, long *nodes)
+{
+    Search search;
+    Worker *workers;
+    ModelCar cars[shaftcount];
+    int prefix[trace -> count + 1];
+    long total, longest, value;
+    int rulenum, i, stored;
+
+    memset(&search, 0, sizeof(search));
+    search.trace      = trace;
+    search.shaftcount = shaftcount;
+    search.speed      = speed;
+    search.objective  = objective;
+    search.bestassignment = assignment;
+    atomic_init(&search.nodes, 0);
+    atomic_init(&search.stopped, 0);
+    pthread_mutex_init(&search.lock, NULL);
+
+    // Start from the best of the simple rules, which gives the search a bound to beat
+    atomic_init(&search.best, -1);
+    for(rulenum = 0; rulenum < RULE_COUNT; ++rulenum) {
+        apply_rule(trace, shaftcount, speed, rules[rulenum].rule, prefix);
+        trace_waits(trace, shaftcount, speed, prefix, &total, &longest);
+        value = (objective == OBJECTIVE_MAX) ? longest : total;
+
+        if(atomic_load(&search.best) < 0 || value < atomic_load(&search.best)) {
+            atomic_store(&search.best, value);
+            memcpy(assignment, prefix, trace -> count * sizeof(int));
+        }
+    }
+
+    if(threads < 1) {
+        threads = 1;
+    }
+    if(threads > OPTIMAL_MAX_THREADS) {
+        threads = OPTIMAL_MAX_THREADS;
+    }
+
+    // Split the tree into enough prefixes to keep every thread busy
+    do {
+        ++search.depth;
+        memset(cars, 0, sizeof(cars));
+        stored = 0;
+        search.prefixcount = make_prefixes(&search, prefix, cars, 0, &stored);
+    } while(search.depth < trace -> count && search.prefixcount < threads * PREFIXES_PER_THREAD);
+
+    search.prefixes = (int *)malloc(((size_t)search.prefixcount * search.depth + 1) * sizeof(int));
+    workers = (Worker *)calloc(threads, sizeof(Worker));
+    if(!search.prefixes || !workers) {
+        fprintf(stderr, "Unable to allocate space for the search.\n");
+        exit(1);
+    }
+    memset(cars, 0, sizeof(cars));
+    stored = 0;
+    make_prefixes(&search, prefix, cars, 0, &stored);
+
+    for(i = 0; i < threads; ++i) {
+        workers[i].search     = &search;
+        workers[i].cars       = (ModelCar *)malloc(shaftcount * sizeof(ModelCar));
+        workers[i].assignment = (int *)malloc((trace -> count + 1) * sizeof(int));
+        if(!workers[i].cars || !workers[i].assignment) {
+            fprintf(stderr, "Unable to allocate space for search thread %d.\n", i);
+            exit(1);
+        }
+        if(pthread_create(&workers[i].thread, NULL, search_thread, &workers[i])) {
+            fprintf(stderr, "Unable to start search thread %d.\n", i);
+            exit(1);
+        }
+    }
+
+    for(i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].cars);
+        free(workers[i].assignment);
+    }
+
+    *nodes = atomic_load(&search.nodes);
+    if(atomic_load(&search.stopped) && *nodes < OPTIMAL_NODE_LIMIT) {
+        *nodes = OPTIMAL_NODE_LIMIT;
+    }
+
+    free(workers);
+    free(search.prefixes);
+    pthread_mutex_destroy(&search.lock);
+
+    return atomic_load(&search.best);
+}
+
+
+/** Enumerate the prefixes of the search tree: every way of assigning the first
+ *  'depth' calls, leaving out assignments that differ only by swapping lifts that
+ *  are in the same state. Called once with search -> prefixes NULL to count them,
+ *  and again to store them.
+ *
+ *  \param search The search.
+ *  \param prefix Space for the prefix being built.
+ *  \param cars   The model lifts after the calls assigned so far.
+ *  \param index  The number of calls assigned so far.
+ *  \param stored A pointer to the number of prefixes found so far.
+ *  \return The number of prefixes found below this point.
+ */
+static int make_prefixes(Search *search, int *prefix, ModelCar *cars, int index, int *stored)
+{
+    const TraceCall *call = &search -> trace -> calls[index];
+    ModelCar saved;
+    int shaftnum, other, count = 0;
+
+    if(index == search -> depth || index == search -> trace -> count) {
+        if(search -> prefixes) {
+            memcpy(&search -> prefixes[*stored * search -> depth], prefix, index * sizeof(int));
+        }
+        ++*stored;
+        return 1;
+    }
+
+    for(shaftnum = 0; shaftnum < search -> shaftcount; ++shaftnum) {
+        for(other = 0; other < shaftnum && !same_state(&cars[other], &cars[shaftnum], call -> tick); ++other);
+        if(other < shaftnum) {
+            continue;
+        }
+
+        saved = cars[shaftnum];
+        serve_call(&cars[shaftnum], call, search -> speed);
+        prefix[index] = shaftnum;
+        count += make_prefixes(search, prefix, cars, index + 1, stored);
+        cars[shaftnum] = saved;
+    }
+
+    return count;
+}
+
+
+/** The body of a search thread: take prefixes until there are none left, and
+ *  search below each one.
+ *
+ *  \param arg A pointer to the thread's Worker.
+ *  \return Always NULL.
+ */
+static void *search_thread(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    Search *search = worker -> search;
+    int prefixnum, index, depth;
+    long cost;
+
+    while(!atomic_load_explicit(&search -> stopped, memory_order_relaxed)) {
+        pthread_mutex_lock(&search -> lock);
+        prefixnum = search -> nextprefix++;
+        pthread_mutex_unlock(&search -> lock);
+
+        if(prefixnum >= search -> prefixcount) {
+            break;
+        }
+
+        // Replay the prefix from the start
+        depth = (search -> depth < search -> trace -> count) ? search -> depth : search -> trace -> count;
+        memset(worker -> cars, 0, search -> shaftcount * sizeof(ModelCar));
+        cost = 0;
+        for(index = 0; index < depth; ++index) {
+            worker -> assignment[index] = search -> prefixes[(prefixnum * search -> depth) + index];
+            cost = combine(search -> objective, cost,
+                           serve_call(&worker -> cars[worker -> assignment[index]],
+                                      &search -> trace -> calls[index], search -> speed));
+        }
+
+        search_from(worker, depth, cost);
+    }
+
+    atomic_fetch_add(&search -> nodes, worker -> nodes);
+    return NULL;
+}
+
+
+/** Search every assignment of the calls from 'index' on, given the lifts' state
+ *  after the calls before it.
+ *
+ *  \param worker The search thread.
+ *  \param index  The next call to assign.
+ *  \param cost   The objective for the calls assigned so far.
+ */
+static void search_from(Worker *worker, int index, long cost)
+{
+    Search *search = worker -> search;
+    const TraceCall *call = &search -> trace -> calls[index];
+    int shaftcount = search -> shaftcount;
+    int order[shaftcount];
+    long wait[shaftcount];
+    ModelCar after[shaftcount], saved;
+    int shaftnum, i, tried;
+
+    if(index == search -> trace -> count) {
+        if(cost < atomic_load_explicit(&search -> best, memory_order_relaxed)) {
+            record_best(worker, cost);
+        }
+        return;
+    }
+
+    if(++worker -> nodes == NODE_BATCH) {
+        if(atomic_fetch_add(&search -> nodes, worker -> nodes) + worker -> nodes >= OPTIMAL_NODE_LIMIT) {
+            atomic_store(&search -> stopped, 1);
+        }
+        worker -> nodes = 0;
+    }
+    if(atomic_load_explicit(&search -> stopped, memory_order_relaxed) ||
+       lower_bound(search, worker -> cars, index, cost) >= atomic_load_explicit(&search -> best, memory_order_relaxed)) {
+        return;
+    }
+
+    // Try the lifts in order of how soon they would open for this call
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        after[shaftnum] = worker -> cars[shaftnum];
+        wait[shaftnum] = serve_call(&after[shaftnum], call, search -> speed);
+
+        for(i = shaftnum; i > 0 && wait[order[i - 1]] > wait[shaftnum]; --i) {
+            order[i] = order[i - 1];
+        }
+        order[i] = shaftnum;
+    }
+
+    for(i = 0; i < shaftcount; ++i) {
+        shaftnum = order[i];
+
+        // Lifts in the same state as one already tried give the same results
+        for(tried = 0; tried < i && !same_state(&worker -> cars[order[tried]], &worker -> cars[shaftnum], call -> tick); ++tried);
+        if(tried < i) {
+            continue;
+        }
+
+        saved = worker -> cars[shaftnum];
+        worker -> cars[shaftnum] = after[shaftnum];
+        worker -> assignment[index] = shaftnum;
+        search_from(worker, index + 1, combine(search -> objective, cost, wait[shaftnum]));
+        worker -> cars[shaftnum] = saved;
+    }
+}
+
+
+/** Work out the least the objective could be once every call from 'from' on has
+ *  been assigned. Giving a lift another call can only make it later for the calls
+ *  after, so no call can wait less than it would if the best lift for it went
+ *  straight there now.
+ *
+ *  \param search The search.
+ *  \param cars   The model lifts after the calls assigned so far.
+ *  \param from   The first call not yet assigned.
+ *  \param cost   The objective for the calls assigned so far.
+ *  \return A lower bound on the objective of any complete assignment from here, on
+ *          the model.
+ */
+static long lower_bound(Search *search, const ModelCar *cars, int from, long cost)
+{
+    const TraceCall *call;
+    ModelCar car;
+    long wait, least;
+    int index, shaftnum;
+
+    for(index = from; index < search -> trace -> count; ++index) {
+        call = &search -> trace -> calls[index];
+        least = -1;
+
+        for(shaftnum = 0; shaftnum < search -> shaftcount; ++shaftnum) {
+            car = cars[shaftnum];
+            wait = serve_call(&car, call, search -> speed);
+            if(least < 0 || wait < least) {
+                least = wait;
+            }
+        }
+
+        cost = combine(search -> objective, cost, least);
+    }
+
+    return cost;
+}
+
+
+/** Record a complete assignment as the best found, if it still is.
+ *
+ *  \param worker The search thread that found it.
+ *  \param cost   Its objective.
+ */
+static void record_best(Worker *worker, long cost)
+{
+    Search *search = worker -> search;
+
+    pthread_mutex_lock(&search -> lock);
+    if(cost < atomic_load(&search -> best)) {
+        memcpy(search -> bestassignment, worker -> assignment, search -> trace -> count * sizeof(int));
+        atomic_store(&search -> best, cost);
+    }
+    pthread_mutex_unlock(&search -> lock);
+}
+
+
+/** Determine whether two model lifts will behave the same for every call from a
+ *  given update on. Lifts that were free before the update are the same if they
+ *  are on the same floor, however long ago they became free.
+ *
+ *  \param a    One lift.
+ *  \param b    The other lift.
+ *  \param tick The update of the next call.
+ *  \return true if the lifts are interchangeable, false otherwise.
+ */
+static int same_state(const ModelCar *a, const ModelCar *b, long tick)
+{
+    long afree = (a -> free > tick) ? a -> free : tick;
+    long bfree = (b -> free > tick) ? b -> free : tick;
+
+    return a -> floor == b -> floor && afree == bfree;
+}
+
+
+/* ============================================================================ *
+ * Rules to compare against                                                     *
+ * ============================================================================ */
+
+/** Assign every call in a trace using a rule.
+ *
+ *  \param trace      The calls.
+ *  \param shaftcount The number of lifts.
+ *  \param speed      The speed of the lifts.
+ *  \param rule       The rule to use.
+ *  \param assignment Space for trace -> count ints, to store the shaft given each call in.
+ */
+static void apply_rule(const Trace *trace, int shaftcount, int speed, Rule rule, int *assignment)
+{
+    ModelCar cars[shaftcount];
+    int call;
+
+    memset(cars, 0, sizeof(cars));
+    for(call = 0; call < trace -> count; ++call) {
+        assignment[call] = rule(cars, shaftcount, &trace -> calls[call], speed);
+        serve_call(&cars[assignment[call]], &trace -> calls[call], speed);
+    }
+}
+
+
+/** The call_lift() rule, as near as the model can give it. A lift that is free when the call is made
+ *  can service it easily, and scores minus its travel time; a busy lift scores
+ *  twice the time to finish what it is doing, plus the travel time, as
+ *  service_call() does. The easy lift closest to zero wins, then the lowest score.
+ */
+static int rule_call_lift(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed)
+{
+    int bestpos_time = 32768;
+    int bestneg_time = -32767;
+    int bestpos_shaftnum = -1;
+    int bestneg_shaftnum = -1;
+    int shaftnum, service_time;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        if(cars[shaftnum].free <= call -> tick) {
+            service_time = (int)travel_time(cars[shaftnum].floor, call -> floor, speed) * CAN_SERVICE;
+        } else {
+            service_time = (int)(((cars[shaftnum].free - call -> tick) * 2) +
+                                 travel_time(cars[shaftnum].floor, call -> floor, speed));
+        }
+
+        if(service_time < 0 && service_time > bestneg_time) {
+            bestneg_time = service_time;
+            bestneg_shaftnum = shaftnum;
+        } else if(service_time >= 0 && service_time < bestpos_time) {
+            bestpos_time = service_time;
+            bestpos_shaftnum = shaftnum;
+        }
+    }
+
+    return (bestneg_shaftnum != -1) ? bestneg_shaftnum : (bestpos_shaftnum != -1) ? bestpos_shaftnum : 0;
+}
+
+
+/** Give the call to the lift whose floor is nearest, whether it is busy or not.
+ *  Only distance counts, so the speed every rule is given is not needed.
+ */
+static int rule_nearest(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed)
+{
+    int shaftnum, best = 0;
+
+    (void)speed;
+
+    for(shaftnum = 1; shaftnum < shaftcount; ++shaftnum) {
+        if(abs(cars[shaftnum].floor - call -> floor) < abs(cars[best].floor - call -> floor)) {
+            best = shaftnum;
+        }
+    }
+
+    return best;
+}
+
+
+/** Give the call to the lift that would open for it soonest. */
+static int rule_earliest(const ModelCar *cars, int shaftcount, const TraceCall *call, int speed)
+{
+    ModelCar car;
+    long wait, bestwait = -1;
+    int shaftnum, best = 0;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = cars[shaftnum];
+        wait = serve_call(&car, call, speed);
+        if(bestwait < 0 || wait < bestwait) {
+            bestwait = wait;
+            best = shaftnum;
+        }
+    }
+
+    return best;
+}
+
+
+/* ============================================================================ *
+ * Replaying through the simulation                                             *
+ * ============================================================================ */
+
+/** Work out the waits of every call in a trace when it is made on lifts run by
+ *  update_lift(), starting idle on the ground floor. Each call is made just before
+ *  the update it was recorded on, by setting a stop in the lift a rule chooses or
+ *  the lift an assignment gives it, and is answered once that lift has its doors
+ *  open on the call's floor.
+ *
+ *  \param trace      The calls.
+ *  \param shaftcount The number of lifts.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of the lifts.
+ *  \param rule       The rule to choose lifts with, or NULL to follow 'assignment'.
+ *  \param assignment The shaft given each call, if 'rule' is NULL.
+ *  \param total      A pointer to a long to store the sum of the waits in.
+ *  \param longest    A pointer to a long to store the longest wait in.
+ */
+static void replay_waits(const Trace *trace, int shaftcount, int topfloor, int speed, SimRule rule,
+                         const int *assignment, long *total, long *longest)
+{
+    Shaft *shafts[shaftcount];
+    const TraceCall *made;
+    Lift *car;
+    int floors = topfloor + 1;
+    int *pending, *next;
+    int call = 0, answered = 0, shaftnum, slot, id;
+    long tick, wait, last;
+
+    // The calls waiting for each lift at each floor, linked through 'next'
+    pending = (int *)malloc((size_t)shaftcount * floors * sizeof(int));
+    next = (int *)malloc((trace -> count + 1) * sizeof(int));
+    if(!pending || !next) {
+        fprintf(stderr, "Unable to allocate space to replay the trace.\n");
+        exit(1);
+    }
+    for(slot = 0; slot < shaftcount * floors; ++slot) {
+        pending[slot] = -1;
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        shafts[shaftnum] = create_shaft(topfloor, speed);
+    }
+
+    *total = *longest = 0;
+    tick = trace -> count ? trace -> calls[0].tick : 0;
+    last = trace -> count ? trace -> calls[trace -> count - 1].tick : 0;
+
+    for(; answered < trace -> count; ++tick) {
+        if(tick > last + REPLAY_LIMIT) {
+            fprintf(stderr, "%d calls were still unanswered %ld updates after the last call.\n",
+                    trace -> count - answered, REPLAY_LIMIT);
+            break;
+        }
+
+        for(; call < trace -> count && trace -> calls[call].tick <= tick; ++call) {
+            made = &trace -> calls[call];
+            shaftnum = rule ? rule(shafts, shaftcount, made) : assignment[call];
+            set_stop(shafts[shaftnum] -> car, made -> floor);
+
+            slot = (shaftnum * floors) + made -> floor;
+            next[call] = pending[slot];
+            pending[slot] = call;
+        }
+
+        update_shafts(shafts, shaftcount);
+
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            car = shafts[shaftnum] -> car;
+            if(get_state(car) != STATE_OPEN || get_time(car) != 0) {
+                continue;
+            }
+
+            slot = (shaftnum * floors) + at_floor(car);
+            for(id = pending[slot]; id != -1; id = next[id]) {
+                wait = tick - trace -> calls[id].tick + 1;
+                *total += wait;
+                if(wait > *longest) {
+                    *longest = wait;
+                }
+                ++answered;
+            }
+            pending[slot] = -1;
+        }
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        free_shaft(shafts[shaftnum]);
+    }
+    free(pending);
+    free(next);
+}
+
+
+/** The call_lift() rule itself: the lift choose_lift() picks. */
+static int sim_call_lift(Shaft **shafts, int shaftcount, const TraceCall *call)
+{
+    int shaftnum = choose_lift(shafts, shaftcount, call -> floor, call -> direction);
+
+    return (shaftnum != -1) ? shaftnum : 0;
+}
+
+
+/** Give the call to the lift nearest its floor, whether it is busy or not. */
+static int sim_nearest(Shaft **shafts, int shaftcount, const TraceCall *call)
+{
+    int target = call -> floor * FLOOR_HEIGHT;
+    int shaftnum, best = 0;
+
+    for(shaftnum = 1; shaftnum < shaftcount; ++shaftnum) {
+        if(abs(get_position(shafts[shaftnum] -> car) - target) < abs(get_position(shafts[best] -> car) - target)) {
+            best = shaftnum;
+        }
+    }
+
+    return best;
+}
+
+
+/** Give the call to the lift that would open for it soonest, running a copy of
+ *  each lift forward with the call added.
+ */
+static int sim_earliest(Shaft **shafts, int shaftcount, const TraceCall *call)
+{
+    long updates, bestupdates = -1;
+    int shaftnum, best = 0;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        updates = updates_to_open(shafts[shaftnum] -> car, call -> floor);
+        if(updates >= 0 && (bestupdates < 0 || updates < bestupdates)) {
+            bestupdates = updates;
+            best = shaftnum;
+        }
+    }
+
+    return best;
+}
+
+
+/** Work out how many updates a lift would take to have its doors open on a floor,
+ *  if it were given a stop there now.
+ *
+ *  \param car   The lift.
+ *  \param floor The floor.
+ *  \return The number of updates, or -1 if the lift would not open there within
+ *          REPLAY_LIMIT updates.
+ */
+static long updates_to_open(Lift *car, int floor)
+{
+    char stops[get_topfloor(car) + 1];
+    Lift copy = *car;
+    long updates;
+
+    memcpy(stops, car -> stops, sizeof(stops));
+    copy.stops = stops;
+    set_stop(&copy, floor);
+
+    for(updates = 1; updates <= REPLAY_LIMIT; ++updates) {
+        update_lift(&copy);
+        if(get_state(&copy) == STATE_OPEN && get_time(&copy) == 0 && at_floor(&copy) == floor) {
+            return updates;
+        }
+    }
+
+    return -1;
+}
+
+
+/* ============================================================================ *
+ * Reporting                                                                    *
+ * ============================================================================ */
+
+/** Solve a trace on the model, and print out how the assignment the search found
+ *  compares with each of the simple rules, on the model and in the simulation.
+ *
+ *  \param filename   The trace to read.
+ *  \param shaftcount The number of lifts.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of the lifts.
+ *  \param objective  What to minimise.
+ *  \return 0 on success, 1 if the trace could not be used.
+ */
+int run_optimal(const char *filename, int shaftcount, int topfloor, int speed, Objective objective)
+{
+    Trace *trace = read_trace(filename);
+    struct timespec start, end;
+    long total, longest, best, value, simtotal, simlongest, nodes;
+    int *assignment;
+    int call, rulenum, threads;
+
+    if(!trace) {
+        return 1;
+    }
+    for(call = 0; call < trace -> count; ++call) {
+        if(trace -> calls[call].floor > topfloor) {
+            fprintf(stderr, "Call %d is on floor %d, above the top floor %d.\n", call + 1,
+                    trace -> calls[call].floor, topfloor);
+            free_trace(trace);
+            return 1;
+        }
+    }
+
+    assignment = (int *)malloc((trace -> count + 1) * sizeof(int));
+    if(!assignment) {
+        fprintf(stderr, "Unable to allocate space for the assignment.\n");
+        exit(1);
+    }
+
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    best = solve_optimal(trace, shaftcount, speed, objective, threads, assignment, &nodes);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%d calls, %d shafts, top floor %d, speed %d, minimising the %s wait\n", trace -> count, shaftcount,
+           topfloor, speed, objective == OBJECTIVE_MAX ? "longest" : "total");
+    printf("Searched %ld nodes of the model on %d threads in %.3f seconds\n", nodes, threads < 1 ? 1 : threads,
+           (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9));
+    if(nodes >= OPTIMAL_NODE_LIMIT) {
+        printf("The node limit was reached: 'search' is the best assignment found, not the best for the model\n");
+    }
+    printf("Gaps are to 'search' on the model, which answers each lift's calls in order; the simulation\n"
+           "picks calls up on the way past, so its waits can be shorter or longer than the model's\n");
+
+    printf("\n%-10s %12s %10s %8s %12s %10s %10s\n", "rule", "model total", "longest", "gap",
+           "sim total", "mean", "longest");
+    trace_waits(trace, shaftcount, speed, assignment, &total, &longest);
+    replay_waits(trace, shaftcount, topfloor, speed, NULL, assignment, &simtotal, &simlongest);
+    printf("%-10s %12ld %10ld %8s %12ld %10.1f %10ld\n", "search", total, longest, "-", simtotal,
+           trace -> count ? (double)simtotal / trace -> count : 0.0, simlongest);
+
+    for(rulenum = 0; rulenum < RULE_COUNT; ++rulenum) {
+        apply_rule(trace, shaftcount, speed, rules[rulenum].rule, assignment);
+        trace_waits(trace, shaftcount, speed, assignment, &total, &longest);
+        value = (objective == OBJECTIVE_MAX) ? longest : total;
+        replay_waits(trace, shaftcount, topfloor, speed, rules[rulenum].simrule, NULL, &simtotal, &simlongest);
+
+        printf("%-10s %12ld %10ld %7.1f%% %12ld %10.1f %10ld\n", rules[rulenum].name, total, longest,
+               best ? 100.0 * (value - best) / best : 0.0, simtotal,
+               trace -> count ? (double)simtotal / trace -> count : 0.0, simlongest);
+    }
+
+    free(assignment);
+    free_trace(trace);
+    return 0;
+}
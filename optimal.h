@@ -0,0 +1,48 @@
+/** \file optimal.h
+ *  Declarations for the offline dispatch solver, which searches a model of the
+ *  building for the best assignment of a recorded trace of hall calls to lifts, so
+ *  that dispatching rules can be measured against it.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef OPTIMAL_H
+#define OPTIMAL_H
+
+#include <stdint.h>
+#include "lift.h"
+
+// Most nodes the search visits before it gives up on proving the answer best for the model
+#define OPTIMAL_NODE_LIMIT 500000000L
+
+// Most threads the search runs on
+#define OPTIMAL_MAX_THREADS 64
+
+/** One hall call in a trace. */
+typedef struct {
+    long tick;          //!< The update the call was made on.
+    int floor;          //!< The floor the call was made on.
+    Moving direction;   //!< The direction the caller wants to go in.
+} TraceCall;
+
+/** A recorded trace of hall calls, in the order they were made. */
+typedef struct {
+    TraceCall *calls;   //!< The calls.
+    int count;          //!< The number of calls.
+} Trace;
+
+/** What the solver minimises. */
+typedef enum {
+    OBJECTIVE_TOTAL,    //!< The sum of every call's wait.
+    OBJECTIVE_MAX       //!< The longest wait of any call.
+} Objective;
+
+Trace *read_trace(const char *filename);
+int write_trace(const char *filename, int calls, int topfloor, int rate, uint64_t seed);
+void free_trace(Trace *trace);
+void trace_waits(const Trace *trace, int shaftcount, int speed, const int *assignment, long *total, long *longest);
+long solve_optimal(const Trace *trace, int shaftcount, int speed, Objective objective, int threads,
+                   int *assignment, long *nodes);
+int run_optimal(const char *filename, int shaftcount, int topfloor, int speed, Objective objective);
+
+#endif
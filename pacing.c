@@ -0,0 +1,291 @@
+/** \file pacing.c
+ *  This file contains a pacer that runs the simulation at a fixed number of updates
+ *  per wall-clock second, for testing against real hardware that expects the lifts
+ *  to move in real time, and a headless mode that drives the lifts with generated
+ *  traffic at that rate.
+ *
+ *  Each update is given an absolute deadline on the monotonic clock, and the pacer
+ *  sleeps until it with clock_nanosleep(TIMER_ABSTIME). Sleeping for a relative
+ *  interval instead would add the time spent working, and any lateness in waking, to
+ *  every period, so the simulation would slowly drift behind the clock. With absolute
+ *  deadlines an update that starts late or runs long only shortens the next sleep.
+ *
+ *  The pacer records how late every update started (jitter) and, for updates whose
+ *  work was not finished by the time the next was due, by how much (overrun), in
+ *  histograms with power of two buckets. An update that starts a whole period or
+ *  more late means the simulation has fallen behind.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pacing.h"
+#include "profile.h"
+#include "traffic.h"
+
+// Generated traffic for the headless paced mode, as for the render thread
+#define PACED_CALL_RATE 100
+#define PACED_STOP_RATE 60
+
+#define NANOS_PER_SECOND 1000000000L
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static long nanos_between(struct timespec *from, struct timespec *to);
+static void add_nanos(struct timespec *when, long nanos);
+static void record_time(long *histogram, long nanos);
+static void print_histogram(FILE *out, const char *title, long *histogram);
+
+
+/* ============================================================================ *
+ * Pacing                                                                       *
+ * ============================================================================ */
+
+/** Set up a pacer. The first update starts as soon as pace_tick() is first called.
+ *
+ *  \param pacer      The pacer to set up.
+ *  \param hz         The number of updates per simulated second.
+ *  \param multiplier How many times faster than real time to run; 1 for real time.
+ *  \return true if the pacer was set up, false if the rate is not possible.
+ */
+int init_pacer(Pacer *pacer, int hz, int multiplier)
+{
+    if(hz < 1 || multiplier < 1 || (long)hz * multiplier > NANOS_PER_SECOND) {
+        return 0;
+    }
+
+    *pacer = (Pacer){ .hz = hz, .multiplier = multiplier };
+    pacer -> period = NANOS_PER_SECOND / ((long)hz * multiplier);
+
+    return 1;
+}
+
+
+/** Wait until the next update is due. Call this at the start of every update; it
+ *  also finishes the timing of the update before.
+ *
+ *  \param pacer The pacer to wait on.
+ */
+void pace_tick(Pacer *pacer)
+{
+    struct timespec now;
+    long late;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if(pacer -> ticks) {
+        // The previous update's work has just finished; was it done in time?
+        late = nanos_between(&pacer -> deadline, &now);
+        if(late > 0) {
+            ++pacer -> overruns;
+            record_time(pacer -> overrun, late);
+            if(late > pacer -> worst_overrun) {
+                pacer -> worst_overrun = late;
+            }
+        } else {
+            // Retry if a signal wakes us early, the deadline doesn't move
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &pacer -> deadline, NULL) == EINTR) {
+                continue;
+            }
+        }
+    } else {
+        // The first update starts now and sets the schedule for the rest
+        pacer -> deadline = now;
+        pacer -> first = now;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &pacer -> started);
+
+    late = nanos_between(&pacer -> deadline, &pacer -> started);
+    if(late < 0) {
+        late = 0;
+    }
+    record_time(pacer -> jitter, late);
+    if(late > pacer -> worst_jitter) {
+        pacer -> worst_jitter = late;
+    }
+    if(late >= pacer -> period) {
+        ++pacer -> behind;
+    }
+
+    ++pacer -> ticks;
+    add_nanos(&pacer -> deadline, pacer -> period);
+}
+
+
+/** Finish the timing of the last update, once its work is done.
+ *
+ *  \param pacer The pacer to finish.
+ */
+void finish_pacer(Pacer *pacer)
+{
+    struct timespec now;
+    long late;
+
+    if(!pacer -> ticks) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    late = nanos_between(&pacer -> deadline, &now);
+    if(late > 0) {
+        ++pacer -> overruns;
+        record_time(pacer -> overrun, late);
+        if(late > pacer -> worst_overrun) {
+            pacer -> worst_overrun = late;
+        }
+    }
+}
+
+
+/** Print a summary of how well a pacer kept to time, with the jitter and overrun
+ *  histograms.
+ *
+ *  \param pacer The pacer to report on.
+ *  \param out   The stream to print to.
+ */
+void print_pacing(Pacer *pacer, FILE *out)
+{
+    double seconds = nanos_between(&pacer -> first, &pacer -> started) / 1e9;
+
+    fprintf(out, "%ld updates at %d Hz x%d (period %ld us) in %.3f seconds\n",
+            pacer -> ticks, pacer -> hz, pacer -> multiplier, pacer -> period / 1000, seconds);
+    fprintf(out, "Worst start jitter %ld us, worst overrun %ld us\n",
+            pacer -> worst_jitter / 1000, pacer -> worst_overrun / 1000);
+    fprintf(out, "%ld updates overran, %ld started a whole period or more late\n",
+            pacer -> overruns, pacer -> behind);
+
+    print_histogram(out, "Start jitter", pacer -> jitter);
+    if(pacer -> overruns) {
+        print_histogram(out, "Overrun", pacer -> overrun);
+    }
+}
+
+
+/** Run the lifts at a fixed wall-clock rate without prompting, giving them generated
+ *  traffic, then print how well the rate was kept to.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param hz         The number of updates per simulated second.
+ *  \param multiplier How many times faster than real time to run.
+ *  \param ticks      The number of updates to run for.
+ *  \param seed       The seed for the traffic generator.
+ *  \param publisher  Where to publish the state of the lifts every update, or NULL.
+ */
+void run_paced(Shaft **shafts, int shaftcount, int topfloor, int hz, int multiplier, long ticks,
+               uint64_t seed, Publisher *publisher)
+{
+    Pacer pacer;
+    Traffic traffic;
+    long tick;
+    int shaftnum, floor;
+    Moving direction;
+
+    if(!init_pacer(&pacer, hz, multiplier)) {
+        fprintf(stderr, "Can't run at %d updates per second, %d times real time\n", hz, multiplier);
+        return;
+    }
+
+    init_traffic(&traffic, seed, topfloor, PACED_CALL_RATE, PACED_STOP_RATE);
+
+    for(tick = 1; tick <= ticks; ++tick) {
+        pace_tick(&pacer);
+
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            update_lift(shafts[shaftnum] -> car);
+
+            if(get_state(shafts[shaftnum] -> car) == STATE_OPEN &&
+               next_stop(&traffic, shafts[shaftnum] -> car, &floor)) {
+                set_stop(shafts[shaftnum] -> car, floor);
+            }
+        }
+        if(next_call(&traffic, &floor, &direction)) {
+            call_lift(shafts, shaftcount, floor, direction);
+        }
+
+        if(publisher) {
+            publish_state(publisher, shafts, tick);
+        }
+    }
+
+    finish_pacer(&pacer);
+    print_pacing(&pacer, stdout);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Work out the time from one point to another.
+ *
+ *  \param from The earlier time.
+ *  \param to   The later time.
+ *  \return The number of nanoseconds from 'from' to 'to', negative if 'to' is earlier.
+ */
+static long nanos_between(struct timespec *from, struct timespec *to)
+{
+    return ((to -> tv_sec - from -> tv_sec) * NANOS_PER_SECOND) + (to -> tv_nsec - from -> tv_nsec);
+}
+
+
+/** Move a time on by a number of nanoseconds.
+ *
+ *  \param when  The time to move on.
+ *  \param nanos The number of nanoseconds to add, less than a second.
+ */
+static void add_nanos(struct timespec *when, long nanos)
+{
+    when -> tv_nsec += nanos;
+    if(when -> tv_nsec >= NANOS_PER_SECOND) {
+        when -> tv_nsec -= NANOS_PER_SECOND;
+        ++when -> tv_sec;
+    }
+}
+
+
+/** Count a time in a histogram with power of two buckets in microseconds.
+ *
+ *  \param histogram The histogram, with PACE_BUCKETS buckets.
+ *  \param nanos     The time to count, in nanoseconds.
+ */
+static void record_time(long *histogram, long nanos)
+{
+    ++histogram[time_bucket((uint64_t)nanos / 1000, PACE_BUCKETS)];
+}
+
+
+/** Print the non-empty buckets of a timing histogram.
+ *
+ *  \param out       The stream to print to.
+ *  \param title     What the histogram measures.
+ *  \param histogram The histogram, with PACE_BUCKETS buckets.
+ */
+static void print_histogram(FILE *out, const char *title, long *histogram)
+{
+    char range[32];
+    int bucket;
+
+    fprintf(out, "%s:\n", title);
+    for(bucket = 0; bucket < PACE_BUCKETS; ++bucket) {
+        if(!histogram[bucket]) {
+            continue;
+        }
+
+        if(bucket == 0) {
+            snprintf(range, sizeof(range), "under 1 us");
+        } else if(bucket == PACE_BUCKETS - 1) {
+            snprintf(range, sizeof(range), "%ld us or more", 1L << (bucket - 1));
+        } else {
+            snprintf(range, sizeof(range), "%ld - %ld us", 1L << (bucket - 1), 1L << bucket);
+        }
+        fprintf(out, "    %20s  %ld\n", range, histogram[bucket]);
+    }
+}
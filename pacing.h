@@ -0,0 +1,50 @@
+/** \file pacing.h
+ *  Declarations for running the simulation at a fixed wall-clock rate.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "shaft.h"
+#include "publish.h"
+
+/** The number of buckets in the timing histograms. Bucket 0 counts times under a
+ *  microsecond, bucket b counts times from 2^(b-1) up to 2^b microseconds, and the
+ *  last bucket counts everything longer.
+ */
+#define PACE_BUCKETS 24
+
+/** Keeps the updates of a simulation in step with the wall clock. Every update is
+ *  given an absolute deadline one period after the last, so time spent sleeping
+ *  late or working long is never added to the schedule; a late update just leaves
+ *  less sleep before the next one.
+ */
+typedef struct {
+    struct timespec deadline;   //!< When the next update is due to start.
+    struct timespec started;    //!< When the current update actually started.
+    struct timespec first;      //!< When the first update started.
+    long period;                //!< Time between updates, in nanoseconds.
+    int hz;                     //!< Updates per simulated second.
+    int multiplier;             //!< How many times faster than real time to run.
+    long ticks;                 //!< Updates started.
+    long behind;                //!< Updates that started a whole period or more late.
+    long overruns;              //!< Updates whose work ran past the next deadline.
+    long worst_jitter;          //!< The latest an update has started, in nanoseconds.
+    long worst_overrun;         //!< The furthest an update has run past its deadline, in nanoseconds.
+    long jitter[PACE_BUCKETS];  //!< How late each update started.
+    long overrun[PACE_BUCKETS]; //!< How far each overrunning update ran past the next deadline.
+} Pacer;
+
+int init_pacer(Pacer *pacer, int hz, int multiplier);
+void pace_tick(Pacer *pacer);
+void finish_pacer(Pacer *pacer);
+void print_pacing(Pacer *pacer, FILE *out);
+void run_paced(Shaft **shafts, int shaftcount, int topfloor, int hz, int multiplier, long ticks,
+               uint64_t seed, Publisher *publisher);
+
+#endif
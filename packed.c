@@ -0,0 +1,608 @@
+/** \file packed.c
+ *  This file contains fleets of packed lifts. A Lift from create_lift() takes two
+ *  heap allocations and, with its stop array, somewhere around 40 bytes plus one
+ *  byte per floor. A city full of lifts made that way is tens of millions of small
+ *  objects scattered over memory. A Fleet instead stores each lift in a 16 byte
+ *  PackedCar, all in one block, with the stop markers kept as a bitmap inside the
+ *  PackedCar for lifts serving fewer than INLINE_FLOORS floors. Taller lifts spill
+ *  their bitmaps into a second block shared by the whole fleet.
+ *
+ *  The packed lifts behave exactly as Lifts do: update_packed() is update_lift(),
+ *  carrying out the same transition table as update_lift_table(), and call_packed()
+ *  is call_lift() over the whole fleet, so the 'packed' engine in verify.c can
+ *  check one against the other. The bitmaps also make searching for
+ *  stops cheap, as a whole word of floors can be checked at once.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "packed.h"
+#include "liftfsm.h"
+#include "fsmtable.h"
+#include "notify.h"
+
+// This will fail to compile if a PackedCar is not 16 bytes
+typedef char packed_car_is_16_bytes[(sizeof(PackedCar) == 16) ? 1 : -1];
+
+// State and direction each get 4 bits of statedir. The direction is stored as a
+// 4 bit two's complement number, so it is sign-extended when read back.
+#define STATE_MASK 0x0f
+#define DIRECTION_MASK 0x0f
+#define DIRECTION_SIGN 0x08
+#define DIRECTION_SHIFT 4
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static uint8_t pack_statedir(State state, Moving direction);
+static uint64_t *stop_words(Fleet *fleet, PackedCar *car);
+static int stop_at_or_above(Fleet *fleet, PackedCar *car, int floor);
+static int stop_at_or_below(Fleet *fleet, PackedCar *car, int floor);
+static void report_fault(Fleet *fleet, size_t car);
+static int lowest_bit(uint64_t bits);
+static int highest_bit(uint64_t bits);
+
+
+/* ============================================================================ *
+ * Creating and releasing fleets                                                *
+ * ============================================================================ */
+
+/** Allocate a fleet of idle lifts, all on the ground floor with no stops.
+ *
+ *  \param count    The number of lifts in the fleet.
+ *  \param topfloor The top floor every lift can stop at. topfloor * FLOOR_HEIGHT must fit in 16 bits.
+ *  \param speed    The speed at which the lifts move. Must fit in 8 bits.
+ *  \return A pointer to the new fleet.
+ */
+Fleet *create_fleet(size_t count, int topfloor, int speed)
+{
+    size_t i, words = 0;
+    Fleet *fleet;
+
+    if(topfloor < 0 || (long)topfloor * FLOOR_HEIGHT > 0xffff || speed < 1 || speed > 0xff) {
+        fprintf(stderr, "Lifts with top floor %d and speed %d can not be packed.\n", topfloor, speed);
+        exit(1);
+    }
+
+    fleet = (Fleet *)malloc(sizeof(Fleet));
+    if(fleet) {
+        fleet -> cars = (PackedCar *)calloc(count ? count : 1, sizeof(PackedCar));
+    }
+    if(!fleet || !fleet -> cars) {
+        fprintf(stderr, "Unable to allocate space for a fleet of %lu lifts.\n", (unsigned long)count);
+        exit(1);
+    }
+
+    // Tall lifts need a share of the spill area for their stops
+    fleet -> spill = NULL;
+    if(topfloor >= INLINE_FLOORS) {
+        words = (topfloor / 64) + 1;
+
+        fleet -> spill = (uint64_t *)calloc(count * words, sizeof(uint64_t));
+        if(!fleet -> spill) {
+            fprintf(stderr, "Unable to allocate space for packed stop markers.\n");
+            exit(1);
+        }
+    }
+
+    fleet -> count = count;
+    for(i = 0; i < count; ++i) {
+        fleet -> cars[i].topfloor = topfloor;
+        fleet -> cars[i].speed    = speed;
+        fleet -> cars[i].statedir = pack_statedir(STATE_IDLE, DIR_NONE);
+        fleet -> cars[i].stops    = words ? i * words : 0;
+    }
+
+    return fleet;
+}
+
+
+/** Release the memory used by a fleet.
+ *
+ *  \param fleet The fleet to free.
+ */
+void free_fleet(Fleet *fleet)
+{
+    free(fleet -> spill);
+    free(fleet -> cars);
+    free(fleet);
+}
+
+
+/* ============================================================================ *
+ * Accessors, matching the get_ and set_ functions for Lifts                    *
+ * ============================================================================ */
+
+/** Obtain a lift's position in the lift shaft.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The position of the lift in the shaft.
+ */
+int packed_get_position(Fleet *fleet, size_t car)
+{
+    return fleet -> cars[car].position;
+}
+
+
+/** Set the location of a lift in the shaft.
+ *
+ *  \param fleet    The fleet containing the lift.
+ *  \param car      The number of the lift in the fleet.
+ *  \param position The position of the lift in the shaft.
+ */
+void packed_set_position(Fleet *fleet, size_t car, int position)
+{
+    fleet -> cars[car].position = position;
+}
+
+
+/** Obtain the current value of a lift's timer.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The current value of the lift's timer.
+ */
+int packed_get_time(Fleet *fleet, size_t car)
+{
+    return fleet -> cars[car].time;
+}
+
+
+/** Obtain the current state of a lift's finite state machine.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The state the lift is currently in.
+ */
+State packed_get_state(Fleet *fleet, size_t car)
+{
+    return (State)(fleet -> cars[car].statedir & STATE_MASK);
+}
+
+
+/** Set the current state of a lift's finite state machine, resetting its timer.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \param state The new state.
+ */
+void packed_set_state(Fleet *fleet, size_t car, State state)
+{
+    fleet -> cars[car].statedir = pack_statedir(state, packed_get_direction(fleet, car));
+    fleet -> cars[car].time = 0;
+}
+
+
+/** Obtain the direction a lift is moving in.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The direction that the lift is moving in.
+ */
+Moving packed_get_direction(Fleet *fleet, size_t car)
+{
+    int direction = (fleet -> cars[car].statedir >> DIRECTION_SHIFT) & DIRECTION_MASK;
+
+    return (Moving)((direction ^ DIRECTION_SIGN) - DIRECTION_SIGN);
+}
+
+
+/** Set the direction a lift is moving in.
+ *
+ *  \param fleet     The fleet containing the lift.
+ *  \param car       The number of the lift in the fleet.
+ *  \param direction The direction in which the lift should be moving.
+ */
+void packed_set_direction(Fleet *fleet, size_t car, Moving direction)
+{
+    fleet -> cars[car].statedir = pack_statedir(packed_get_state(fleet, car), direction);
+}
+
+
+/** Obtain the speed at which a lift moves per update.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The speed at which the lift moves.
+ */
+int packed_get_speed(Fleet *fleet, size_t car)
+{
+    return fleet -> cars[car].speed;
+}
+
+
+/** Obtain the top floor number that a lift serves.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \return The top floor the lift goes to.
+ */
+int packed_get_topfloor(Fleet *fleet, size_t car)
+{
+    return fleet -> cars[car].topfloor;
+}
+
+
+/** Determine whether a lift has a stop marker set on a floor.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \param floor The floor number to check.
+ *  \return true if the lift will stop at the floor, false otherwise.
+ */
+int packed_get_stop(Fleet *fleet, size_t car, int floor)
+{
+    return (stop_words(fleet, &fleet -> cars[car])[floor >> 6] >> (floor & 63)) & 1;
+}
+
+
+/** Mark a floor as one at which a lift should stop.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \param floor The floor the lift should stop at.
+ */
+void packed_set_stop(Fleet *fleet, size_t car, int floor)
+{
+    stop_words(fleet, &fleet -> cars[car])[floor >> 6] |= (uint64_t)1 << (floor & 63);
+}
+
+
+/** Remove a stop marker from a lift.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ *  \param floor The floor to remove from the stop list.
+ */
+void packed_clear_stop(Fleet *fleet, size_t car, int floor)
+{
+    stop_words(fleet, &fleet -> cars[car])[floor >> 6] &= ~((uint64_t)1 << (floor & 63));
+}
+
+
+/* ============================================================================ *
+ * The finite state machine and call handling                                   *
+ * ============================================================================ */
+
+/** Update the finite state machine for a packed lift. The facts the transition table
+ *  in fsmtable.c needs are worked out from the stop bitmap, and the transition is
+ *  looked up and carried out as update_lift_table() does, so a packed lift follows
+ *  update_lift() exactly. Packed lifts only have car stops, so a lift at a floor
+ *  with a stop always stops there.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ */
+void update_packed(Fleet *fleet, size_t car)
+{
+    const Transition *transitions = fsm_table();
+    PackedCar *packed = &fleet -> cars[car];
+    int position = packed -> position;
+    int here = position / FLOOR_HEIGHT;
+    State state = packed_get_state(fleet, car);
+    Moving direction = packed_get_direction(fleet, car);
+    int up = direction == DIR_UP;
+    int down = direction == DIR_DOWN;
+    int above, below, atfloor, served, ahead;
+    unsigned predicates;
+    Transition next;
+
+    if(packed -> time < PACKED_TIME_MAX) {
+        ++packed -> time;
+    }
+
+    // Stops at or beyond the lift's position each way, and one where it is
+    above   = stop_at_or_above(fleet, packed, (position + FLOOR_HEIGHT - 1) / FLOOR_HEIGHT) != NO_STOPS;
+    below   = stop_at_or_below(fleet, packed, here) != NO_STOPS;
+    atfloor = (position % FLOOR_HEIGHT) == 0;
+    served  = atfloor && packed_get_stop(fleet, car, here);
+    ahead   = (up && above) || (down && below) || (!up && !down && (above || below));
+
+    predicates = ((packed -> time == fsm_time_limit(state)) * FSM_EXPIRED) |
+                 ((above || below) * FSM_STOPS) |
+                 (ahead * FSM_AHEAD) |
+                 (served * FSM_AT_STOP) |
+                 (atfloor * FSM_AT_FLOOR) |
+                 ((up || down) * FSM_DIRECTED);
+
+    // As update_lift() does: out of service where it is, with the fault reported
+    if((unsigned)state >= FSM_STATE_SLOTS ||
+       (next = transitions[(state * FSM_PREDICATES) + predicates]).state == FSM_ILLEGAL) {
+        packed -> statedir = pack_statedir(STATE_OUT_OF_SERVICE, DIR_NONE);
+        packed -> time = 0;
+        report_fault(fleet, car);
+        return;
+    }
+
+    if((next.actions & FSM_CLEAR_SERVED) && served) {
+        packed_clear_stop(fleet, car, here);
+    }
+
+    // Stops below win over stops above, as in head_for_nearest_stop()
+    if((next.actions & FSM_HEAD) && (above || below)) {
+        direction = below ? DIR_DOWN : DIR_UP;
+    }
+    if(next.actions & FSM_CLEAR_DIR) {
+        direction = DIR_NONE;
+    }
+    if(next.actions & FSM_MOVE) {
+        packed -> position += packed -> speed * ((direction == DIR_UP) - (direction == DIR_DOWN));
+    }
+
+    // Changing state restarts the timer
+    if(next.state != state) {
+        packed -> time = 0;
+    }
+    packed -> statedir = pack_statedir((State)next.state, direction);
+}
+
+
+/** Update the finite state machine for every lift in a fleet.
+ *
+ *  \param fleet The fleet to update.
+ */
+void update_fleet(Fleet *fleet)
+{
+    size_t car;
+
+    for(car = 0; car < fleet -> count; ++car) {
+        update_packed(fleet, car);
+    }
+}
+
+
+/** Work out how long a packed lift would take to service a call. This follows
+ *  service_call() exactly, including its sign convention: negative values are
+ *  lifts that can easily service the call.
+ *
+ *  \param fleet      The fleet containing the lift.
+ *  \param car        The number of the lift in the fleet.
+ *  \param call_floor The floor a call has been made on.
+ *  \param direction  The direction the caller wants to go in.
+ *  \return The time to service the call, negated if the lift can easily service it.
+ */
+int packed_service_call(Fleet *fleet, size_t car, int call_floor, Moving direction)
+{
+    PackedCar *packed = &fleet -> cars[car];
+    int distance = (call_floor * FLOOR_HEIGHT) - packed -> position;
+    int time_to_service = distance / packed -> speed;
+    int last, remaining = 0;
+
+    if(packed_get_state(fleet, car) == STATE_IDLE) {
+        return time_to_service * CAN_SERVICE;
+    }
+
+    direction = packed_get_direction(fleet, car);
+    if((distance > 0 && direction == DIR_UP) || (distance < 0 && direction == DIR_DOWN)) {
+        return time_to_service * CAN_SERVICE;
+    }
+
+    // The distance to the furthest stop in the direction of travel
+    if(direction == DIR_DOWN) {
+        last = stop_at_or_above(fleet, packed, 0);
+        if(last != NO_STOPS && last * FLOOR_HEIGHT < packed -> position) {
+            remaining = packed -> position - (last * FLOOR_HEIGHT);
+        }
+    } else if(direction == DIR_UP) {
+        last = stop_at_or_below(fleet, packed, packed -> topfloor);
+        if(last != NO_STOPS && last * FLOOR_HEIGHT > packed -> position) {
+            remaining = (last * FLOOR_HEIGHT) - packed -> position;
+        }
+    }
+
+    return ((remaining / packed -> speed) * 2) + time_to_service;
+}
+
+
+/** Call a lift in a fleet to a floor. This picks the same lift call_lift() would if
+ *  the fleet were an array of shafts, and sets a stop for the call in it. Lifts out
+ *  of service are passed over.
+ *
+ *  \param fleet     The fleet to call a lift from.
+ *  \param tofloor   The floor the call was received on.
+ *  \param direction The direction the caller wants to go in.
+ */
+void call_packed(Fleet *fleet, int tofloor, Moving direction)
+{
+    int bestpos_time = 32768;
+    int bestneg_time = -32767;
+    long bestpos_car = -1;
+    long bestneg_car = -1;
+    int service_time;
+    size_t car;
+
+    for(car = 0; car < fleet -> count; ++car) {
+        if(packed_get_state(fleet, car) == STATE_OUT_OF_SERVICE) {
+            continue;
+        }
+
+        service_time = packed_service_call(fleet, car, tofloor, direction);
+        if(service_time < 0 && service_time > bestneg_time) {
+            bestneg_time = service_time;
+            bestneg_car = car;
+        } else if(service_time >= 0 && service_time < bestpos_time) {
+            bestpos_time = service_time;
+            bestpos_car = car;
+        }
+    }
+
+    if(bestneg_car != -1) {
+        packed_set_stop(fleet, bestneg_car, tofloor);
+    } else if(bestpos_car != -1) {
+        packed_set_stop(fleet, bestpos_car, tofloor);
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Pack a state and a direction into a statedir byte. Both are masked to their
+ *  4 bits, so a negative direction can't spill into the state.
+ *
+ *  \param state     The state of the lift's finite state machine.
+ *  \param direction The direction the lift is moving in.
+ *  \return The packed byte.
+ */
+static uint8_t pack_statedir(State state, Moving direction)
+{
+    return (uint8_t)(((unsigned)state & STATE_MASK) | (((unsigned)direction & DIRECTION_MASK) << DIRECTION_SHIFT));
+}
+
+
+/** Locate the stop bitmap for a lift.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The packed lift.
+ *  \return A pointer to the first word of the lift's stop bitmap.
+ */
+static uint64_t *stop_words(Fleet *fleet, PackedCar *car)
+{
+    if(car -> topfloor < INLINE_FLOORS) {
+        return &car -> stops;
+    }
+
+    return fleet -> spill + car -> stops;
+}
+
+
+/** Find the lowest floor at or above 'floor' with a stop marker.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The packed lift.
+ *  \param floor The floor to start looking from.
+ *  \return The floor number of the stop, or NO_STOPS if there are none.
+ */
+static int stop_at_or_above(Fleet *fleet, PackedCar *car, int floor)
+{
+    uint64_t *words = stop_words(fleet, car);
+    int lastword = car -> topfloor >> 6;
+    int word = floor >> 6;
+    uint64_t bits;
+
+    if(floor > car -> topfloor) {
+        return NO_STOPS;
+    }
+
+    bits = words[word] & (~(uint64_t)0 << (floor & 63));
+    while(!bits) {
+        if(++word > lastword) {
+            return NO_STOPS;
+        }
+        bits = words[word];
+    }
+
+    return (word << 6) + lowest_bit(bits);
+}
+
+
+/** Find the highest floor at or below 'floor' with a stop marker.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The packed lift.
+ *  \param floor The floor to start looking from.
+ *  \return The floor number of the stop, or NO_STOPS if there are none.
+ */
+static int stop_at_or_below(Fleet *fleet, PackedCar *car, int floor)
+{
+    uint64_t *words = stop_words(fleet, car);
+    int word;
+    uint64_t bits;
+
+    if(floor < 0) {
+        return NO_STOPS;
+    }
+    if(floor > car -> topfloor) {
+        floor = car -> topfloor;
+    }
+
+    word = floor >> 6;
+    bits = words[word] & (~(uint64_t)0 >> (63 - (floor & 63)));
+    while(!bits) {
+        if(--word < 0) {
+            return NO_STOPS;
+        }
+        bits = words[word];
+    }
+
+    return (word << 6) + highest_bit(bits);
+}
+
+
+/** Report a packed lift that has been taken out of service because of a fault.
+ *  Fault hooks are given a Lift, so they are shown an unpacked copy of this one;
+ *  no building contains the copy, so hooks that look for their own lifts leave it
+ *  alone.
+ *
+ *  \param fleet The fleet containing the lift.
+ *  \param car   The number of the lift in the fleet.
+ */
+static void report_fault(Fleet *fleet, size_t car)
+{
+    int topfloor = packed_get_topfloor(fleet, car);
+    char stops[topfloor + 1];
+    Lift copy;
+    int floor;
+
+    for(floor = 0; floor <= topfloor; ++floor) {
+        stops[floor] = packed_get_stop(fleet, car, floor);
+    }
+
+    copy.topfloor  = topfloor;
+    copy.direction = packed_get_direction(fleet, car);
+    copy.state     = packed_get_state(fleet, car);
+    copy.time      = packed_get_time(fleet, car);
+    copy.position  = packed_get_position(fleet, car);
+    copy.speed     = packed_get_speed(fleet, car);
+    copy.stops     = stops;
+
+    notify_fault(&copy);
+}
+
+
+/** Find the index of the lowest set bit in a word. The word must not be zero.
+ *
+ *  \param bits The word to inspect.
+ *  \return The index of the lowest set bit.
+ */
+static int lowest_bit(uint64_t bits)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+
+    while(!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+
+/** Find the index of the highest set bit in a word. The word must not be zero.
+ *
+ *  \param bits The word to inspect.
+ *  \return The index of the highest set bit.
+ */
+static int highest_bit(uint64_t bits)
+{
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(bits);
+#else
+    int index = 63;
+
+    while(!(bits >> 63)) {
+        bits <<= 1;
+        --index;
+    }
+    return index;
+#endif
+}
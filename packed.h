@@ -0,0 +1,63 @@
+/** \file packed.h
+ *  Declarations for fleets of lifts stored in a compact, packed form.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lift.h"
+
+// Lifts whose top floor is below this keep their stop markers inside the PackedCar
+#define INLINE_FLOORS 64
+
+// The largest value the packed timer can hold; it stops counting here
+#define PACKED_TIME_MAX 0xffff
+
+/** One lift, packed into 16 bytes. The fields have the same meanings as in Lift,
+ *  but are narrowed: positions and top floors must fit in 16 bits, speeds in 8, and
+ *  the timer saturates at PACKED_TIME_MAX (far beyond any FSM time limit). State and
+ *  direction share a byte. The stop markers are a bitmap, one bit per floor, held in
+ *  'stops' for short shafts and in the fleet's spill area for tall ones.
+ */
+typedef struct {
+    uint16_t position;  //!< Position in the shaft, 0 to topfloor * FLOOR_HEIGHT.
+    uint16_t time;      //!< The FSM timer.
+    uint16_t topfloor;  //!< The top floor the lift serves.
+    uint8_t speed;      //!< Shaft sections moved per update.
+    uint8_t statedir;   //!< State in the low 4 bits, direction in the high 4 bits.
+    uint64_t stops;     //!< The stop bitmap, or the index of its first word in the spill area.
+} PackedCar;
+
+/** A contiguous block of packed lifts, and the spill area for tall lifts' stops. */
+typedef struct {
+    PackedCar *cars;    //!< The lifts.
+    size_t count;       //!< The number of lifts.
+    uint64_t *spill;    //!< Stop bitmaps for lifts with topfloor >= INLINE_FLOORS.
+} Fleet;
+
+Fleet *create_fleet(size_t count, int topfloor, int speed);
+void free_fleet(Fleet *fleet);
+
+int packed_get_position(Fleet *fleet, size_t car);
+void packed_set_position(Fleet *fleet, size_t car, int position);
+int packed_get_time(Fleet *fleet, size_t car);
+State packed_get_state(Fleet *fleet, size_t car);
+void packed_set_state(Fleet *fleet, size_t car, State state);
+Moving packed_get_direction(Fleet *fleet, size_t car);
+void packed_set_direction(Fleet *fleet, size_t car, Moving direction);
+int packed_get_speed(Fleet *fleet, size_t car);
+int packed_get_topfloor(Fleet *fleet, size_t car);
+int packed_get_stop(Fleet *fleet, size_t car, int floor);
+void packed_set_stop(Fleet *fleet, size_t car, int floor);
+void packed_clear_stop(Fleet *fleet, size_t car, int floor);
+
+void update_packed(Fleet *fleet, size_t car);
+void update_fleet(Fleet *fleet);
+int packed_service_call(Fleet *fleet, size_t car, int call_floor, Moving direction);
+void call_packed(Fleet *fleet, int tofloor, Moving direction);
+
+#endif
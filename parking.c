@@ -0,0 +1,290 @@
+/** \file parking.c
+ *  This file contains the idle lift parking policy. When a lift runs out of stops
+ *  the finite state machine leaves it wherever it last stopped, so the first call
+ *  after a quiet spell has to wait for the lift to come all the way from there.
+ *  Instead, lifts that have been idle for PARK_DELAY updates are sent to the floors
+ *  where calls are most likely to come from next.
+ *
+ *  Those floors are predicted from the calls seen so far. The day is divided into
+ *  DEMAND_BUCKETS time-of-day buckets, and each bucket keeps an exponentially
+ *  decayed count of the calls made on each floor in each direction. Recording a
+ *  call only touches two counts (its bucket, and the whole-day count used when a
+ *  bucket has not seen any calls yet), and the decay is applied lazily when a count
+ *  is next used, so recording a call costs the same however big the building is.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "parking.h"
+
+// The whole-day counts are kept after the time-of-day buckets
+#define WHOLE_DAY DEMAND_BUCKETS
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int demand_index(Parking *parking, int bucket, int floor, Moving direction);
+static double decayed(Parking *parking, int index);
+static int current_bucket(Parking *parking);
+static double bucket_demand(Parking *parking, int bucket, int floor, Moving direction);
+
+
+/* ============================================================================ *
+ * Creating and releasing the demand model                                      *
+ * ============================================================================ */
+
+/** Allocate a new, empty, demand model for a building.
+ *
+ *  \param topfloor The top floor of the building.
+ *  \param halflife The number of updates after which a call counts half as much.
+ *  \return A pointer to the new parking policy.
+ */
+Parking *create_parking(int topfloor, double halflife)
+{
+    int entries = (DEMAND_BUCKETS + 1) * (topfloor + 1) * 2;
+    Parking *parking = (Parking *)malloc(sizeof(Parking));
+
+    if(parking) {
+        parking -> rate    = (double *)calloc(entries, sizeof(double));
+        parking -> stamp   = (long *)calloc(entries, sizeof(long));
+        parking -> score   = (double *)calloc(topfloor + 1, sizeof(double));
+        parking -> covered = (char *)calloc(topfloor + 1, sizeof(char));
+    }
+    if(!parking || !parking -> rate || !parking -> stamp || !parking -> score || !parking -> covered) {
+        fprintf(stderr, "Unable to allocate space for the parking demand model.\n");
+        exit(1);
+    }
+
+    parking -> topfloor = topfloor;
+    parking -> halflife = halflife;
+    parking -> now = 0;
+
+    return parking;
+}
+
+
+/** Release the memory used by a parking policy.
+ *
+ *  \param parking The parking policy to free.
+ */
+void free_parking(Parking *parking)
+{
+    free(parking -> rate);
+    free(parking -> stamp);
+    free(parking -> score);
+    free(parking -> covered);
+    free(parking);
+}
+
+
+/* ============================================================================ *
+ * Demand estimates                                                             *
+ * ============================================================================ */
+
+/** Add a call to the demand estimates. The call is counted in the current time of
+ *  day bucket and in the whole-day counts.
+ *
+ *  \param parking   The parking policy to update.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+void record_call(Parking *parking, int floor, Moving direction)
+{
+    int index;
+
+    index = demand_index(parking, current_bucket(parking), floor, direction);
+    parking -> rate[index] = decayed(parking, index) + 1.0;
+
+    index = demand_index(parking, WHOLE_DAY, floor, direction);
+    parking -> rate[index] = decayed(parking, index) + 1.0;
+}
+
+
+/** The input hook used to feed calls made at the prompt into the demand estimates.
+ *
+ *  \param data      A pointer to the Parking policy.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+void parking_hook(void *data, int floor, Moving direction)
+{
+    record_call((Parking *)data, floor, direction);
+}
+
+
+/** Obtain the expected demand for calls on a floor at this time of day. If nothing
+ *  has been seen at this time of day yet, the whole-day estimate is used instead.
+ *
+ *  \param parking   The parking policy to inspect.
+ *  \param floor     The floor to look at.
+ *  \param direction The direction of the calls, or DIR_NONE to include both directions.
+ *  \return The decayed number of calls expected, relative to other floors.
+ */
+double predicted_demand(Parking *parking, int floor, Moving direction)
+{
+    int bucket = current_bucket(parking);
+    double demand;
+
+    if(direction == DIR_NONE) {
+        return predicted_demand(parking, floor, DIR_UP) + predicted_demand(parking, floor, DIR_DOWN);
+    }
+
+    demand = bucket_demand(parking, bucket, floor, direction);
+    if(demand > 0.0) {
+        return demand;
+    }
+
+    return bucket_demand(parking, WHOLE_DAY, floor, direction);
+}
+
+
+/* ============================================================================ *
+ * Parking                                                                      *
+ * ============================================================================ */
+
+/** Send lifts that have been idle for PARK_DELAY updates to the floors with the most
+ *  expected demand. Floors that already have a lift idling at them, or a lift on its
+ *  way to them, are skipped so the idle lifts spread out over the busiest floors. A
+ *  lift is left where it is if it is already at the best floor it could be sent to,
+ *  or if no calls have been seen yet. This should be called once per update, after
+ *  the lifts have been updated.
+ *
+ *  \param parking    The parking policy.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param tick       The number of the current update.
+ */
+void park_idle_cars(Parking *parking, Shaft **shafts, int shaftcount, long tick)
+{
+    int shaftnum, floor, best;
+    int candidates = 0;
+    Lift *car;
+
+    parking -> now = tick;
+
+    // Lifts only become candidates once, on the update their idle time reaches PARK_DELAY
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+        if(get_state(car) == STATE_IDLE && get_time(car) == PARK_DELAY) {
+            ++candidates;
+        }
+    }
+    if(!candidates) {
+        return;
+    }
+
+    // Work out which floors are already looked after by other lifts, and the demand on each floor
+    memset(parking -> covered, 0, parking -> topfloor + 1);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+
+        if(get_state(car) == STATE_IDLE && get_time(car) == PARK_DELAY) {
+            continue;
+        }
+        if(get_state(car) == STATE_IDLE && at_floor(car) != NOT_AT_FLOOR) {
+            parking -> covered[at_floor(car)] = 1;
+        }
+        for(floor = 0; floor <= parking -> topfloor && floor <= get_topfloor(car); ++floor) {
+            if(car -> stops[floor]) {
+                parking -> covered[floor] = 1;
+            }
+        }
+    }
+
+    for(floor = 0; floor <= parking -> topfloor; ++floor) {
+        parking -> score[floor] = predicted_demand(parking, floor, DIR_NONE);
+    }
+
+    // Now give each candidate the busiest floor nobody is looking after yet
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+        if(get_state(car) != STATE_IDLE || get_time(car) != PARK_DELAY) {
+            continue;
+        }
+
+        best = NO_STOPS;
+        for(floor = 0; floor <= parking -> topfloor && floor <= get_topfloor(car); ++floor) {
+            if(!parking -> covered[floor] && parking -> score[floor] > 0.0 &&
+               (best == NO_STOPS || parking -> score[floor] > parking -> score[best])) {
+                best = floor;
+            }
+        }
+
+        if(best == NO_STOPS) {
+            break; // no demand left to cover
+        }
+
+        parking -> covered[best] = 1;
+        if(best != at_floor(car)) {
+            set_stop(car, best);
+        }
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Work out where a count is stored in the rate and stamp arrays.
+ *
+ *  \param parking   The parking policy.
+ *  \param bucket    The time-of-day bucket, or WHOLE_DAY.
+ *  \param floor     The floor.
+ *  \param direction DIR_UP or DIR_DOWN.
+ *  \return The index of the count.
+ */
+static int demand_index(Parking *parking, int bucket, int floor, Moving direction)
+{
+    return (((bucket * (parking -> topfloor + 1)) + floor) * 2) + (direction == DIR_DOWN);
+}
+
+
+/** Bring a count up to date, applying the decay since it was last touched.
+ *
+ *  \param parking The parking policy.
+ *  \param index   The index of the count.
+ *  \return The decayed count.
+ */
+static double decayed(Parking *parking, int index)
+{
+    long age = parking -> now - parking -> stamp[index];
+
+    if(age > 0 && parking -> rate[index] > 0.0) {
+        parking -> rate[index] *= pow(0.5, (double)age / parking -> halflife);
+    }
+    parking -> stamp[index] = parking -> now;
+
+    return parking -> rate[index];
+}
+
+
+/** Obtain the decayed count for a bucket, floor and direction.
+ *
+ *  \param parking   The parking policy.
+ *  \param bucket    The time-of-day bucket, or WHOLE_DAY.
+ *  \param floor     The floor.
+ *  \param direction DIR_UP or DIR_DOWN.
+ *  \return The decayed count.
+ */
+static double bucket_demand(Parking *parking, int bucket, int floor, Moving direction)
+{
+    return decayed(parking, demand_index(parking, bucket, floor, direction));
+}
+
+
+/** Work out which time-of-day bucket the current update falls in.
+ *
+ *  \param parking The parking policy.
+ *  \return The bucket number, 0 to DEMAND_BUCKETS - 1.
+ */
+static int current_bucket(Parking *parking)
+{
+    return (int)(((parking -> now % DEMAND_DAY_TICKS) * DEMAND_BUCKETS) / DEMAND_DAY_TICKS);
+}
@@ -0,0 +1,42 @@
+/** \file parking.h
+ *  Declarations for parking idle lifts at the floors where calls are expected.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PARKING_H
+#define PARKING_H
+
+#include "shaft.h"
+
+// The day is split into this many time-of-day buckets, each with its own demand estimates
+#define DEMAND_BUCKETS 24
+
+// The number of updates in a simulated day
+#define DEMAND_DAY_TICKS 86400L
+
+// How many updates a lift has to sit idle before it is sent to park
+#define PARK_DELAY 10
+
+/** Call rate estimates for every floor and direction, and the scratch space used
+ *  when choosing parking floors. Each estimate is an exponentially decayed count
+ *  of calls, decayed lazily when it is next touched.
+ */
+typedef struct {
+    int topfloor;       //!< The top floor of the building.
+    double halflife;    //!< Updates for an old call to count half as much as a new one.
+    long now;           //!< The current update.
+    double *rate;       //!< Decayed call counts, by bucket, floor and direction.
+    long *stamp;        //!< The update each count was last decayed to.
+    double *score;      //!< Scratch: predicted demand for each floor.
+    char *covered;      //!< Scratch: floors that already have a lift at or heading to them.
+} Parking;
+
+Parking *create_parking(int topfloor, double halflife);
+void free_parking(Parking *parking);
+void record_call(Parking *parking, int floor, Moving direction);
+double predicted_demand(Parking *parking, int floor, Moving direction);
+void park_idle_cars(Parking *parking, Shaft **shafts, int shaftcount, long tick);
+void parking_hook(void *data, int floor, Moving direction);
+
+#endif
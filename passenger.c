@@ -0,0 +1,811 @@
+/** \file passenger.c
+ *  This file contains the passenger simulation. Without passengers a hall call is
+ *  just a stop marker in some lift; here each passenger calls a lift, waits for
+ *  one going their way to open on their floor, gets in, chooses a floor, rides to
+ *  it and gets out.
+ *
+ *  Passengers are written as stackless coroutines: run_passenger() reads like the
+ *  passenger's whole journey from start to finish, but it returns to the scheduler
+ *  every time the passenger has to wait, and carries on from the same point the
+ *  next time it is resumed. This is done with the CO_ macros below, which turn
+ *  the function into a switch() on the passenger's 'resume' field (the same trick
+ *  as Duff's device). A passenger costs one small Passenger structure and no
+ *  thread or stack, so millions of them can be in the building at once.
+ *
+ *  The scheduler only resumes passengers when something has happened that they
+ *  are waiting for. When a lift opens its doors, the passengers riding in it who
+ *  want that floor are resumed so they can get out, then the passengers waiting on
+ *  that floor are resumed so they can get in.
+ *
+ *  Lifts have a limited capacity. Passengers will not get into a full lift, and a
+ *  lift that fills up hands its remaining hall calls on to other lifts rather than
+ *  stopping at floors where nobody can get in. Calls are placed by call_loaded(),
+ *  which works like call_lift() but leaves full lifts out and counts the time a
+ *  lift's current load will spend getting out along the way - or, if the scheduler
+ *  has been told to use_dispatcher(), by the dispatcher, which is told about full
+ *  lifts if it can deal with them itself. Lifts taken out of service are dealt with
+ *  in the same way as full ones, by set_in_service().
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "passenger.h"
+#include "liftfsm.h"
+#include "notify.h"
+#include "profile.h"
+#include "stops.h"
+
+// Initial size of the passenger pool; it doubles whenever it fills up
+#define POOL_SIZE 1024
+
+// What a passenger's coroutine returns: the list the passenger should be kept on
+#define PASSENGER_WAITING 0
+#define PASSENGER_RIDING  1
+#define PASSENGER_DONE    2
+
+// Stackless coroutine macros. Locals do not survive a CO_AWAIT, so anything that
+// needs to be remembered has to be kept in the Passenger structure.
+#define CO_BEGIN(p)        switch((p) -> resume) { case 0:
+#define CO_AWAIT(p, list)  do { (p) -> resume = __LINE__; return (list); case __LINE__:; } while(0)
+#define CO_END(p)          } (p) -> resume = 0; return PASSENGER_DONE
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int run_passenger(Passengers *sim, Passenger *p, int shaftnum);
+static int call_pending(Passengers *sim, int floor, Moving direction);
+static void call_loaded(Passengers *sim, int floor, Moving direction);
+static int shed_hall_calls(Passengers *sim, int shaftnum);
+static void call_again(Passengers *sim);
+static int choose_destination(Passengers *sim, Passenger *p);
+static int new_passenger(Passengers *sim);
+static void lift_opened(Passengers *sim, int shaftnum);
+
+
+/* ============================================================================ *
+ * Creating and releasing the scheduler                                         *
+ * ============================================================================ */
+
+/** Create an empty passenger scheduler for a building.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param seed       The seed used when passengers choose their destinations.
+ *  \return A pointer to the new scheduler.
+ */
+Passengers *create_passengers(Shaft **shafts, int shaftcount, int topfloor, uint64_t seed)
+{
+    int i;
+    Passengers *sim = (Passengers *)calloc(1, sizeof(Passengers));
+
+    if(sim) {
+        sim -> waiting     = (int *)malloc((topfloor + 1) * sizeof(int));
+        sim -> lastwaiting = (int *)malloc((topfloor + 1) * sizeof(int));
+        sim -> wanted      = (char *)calloc(topfloor + 1, sizeof(char));
+        sim -> riding      = (int *)malloc(shaftcount * sizeof(int));
+        sim -> carcapacity = (int *)malloc(shaftcount * sizeof(int));
+        sim -> load        = (int *)calloc(shaftcount, sizeof(int));
+        sim -> opened      = (char *)calloc(shaftcount, sizeof(char));
+        sim -> waits       = (long *)calloc(WAIT_BUCKETS, sizeof(long));
+    }
+    if(!sim || !sim -> waiting || !sim -> lastwaiting || !sim -> wanted || !sim -> riding ||
+       !sim -> carcapacity || !sim -> load || !sim -> opened || !sim -> waits) {
+        fprintf(stderr, "Unable to allocate space for the passenger scheduler.\n");
+        exit(1);
+    }
+
+    sim -> shafts     = shafts;
+    sim -> shaftcount = shaftcount;
+    sim -> topfloor   = topfloor;
+    sim -> freelist   = NO_PASSENGER;
+    init_traffic(&sim -> traffic, seed, topfloor, 0, 0);
+
+    for(i = 0; i <= topfloor; ++i) {
+        sim -> waiting[i] = NO_PASSENGER;
+        sim -> lastwaiting[i] = NO_PASSENGER;
+    }
+    for(i = 0; i < shaftcount; ++i) {
+        sim -> riding[i] = NO_PASSENGER;
+        sim -> carcapacity[i] = DEFAULT_CAPACITY;
+    }
+
+    return sim;
+}
+
+
+/** Release the memory used by a passenger scheduler and all its passengers.
+ *
+ *  \param sim The scheduler to free.
+ */
+void free_passengers(Passengers *sim)
+{
+    free(sim -> pool);
+    free(sim -> waiting);
+    free(sim -> lastwaiting);
+    free(sim -> wanted);
+    free(sim -> riding);
+    free(sim -> carcapacity);
+    free(sim -> load);
+    free(sim -> opened);
+    free(sim -> waits);
+    if(sim -> dispatcher) {
+        sim -> dispatcher -> release(sim -> dispatch);
+        free(sim -> laststate);
+    }
+    free(sim);
+}
+
+
+/** Set the number of passengers one lift can hold.
+ *
+ *  \param sim      The passenger scheduler.
+ *  \param shaftnum The shaft of the lift.
+ *  \param capacity The most passengers the lift can hold, at least 1.
+ */
+void set_capacity(Passengers *sim, int shaftnum, int capacity)
+{
+    sim -> carcapacity[shaftnum] = capacity > 0 ? capacity : 1;
+}
+
+
+/** Make passengers' calls through a dispatcher. Must be called, at most once,
+ *  before any passengers are spawned.
+ *
+ *  \param sim        The passenger scheduler.
+ *  \param dispatcher The dispatcher to use.
+ */
+void use_dispatcher(Passengers *sim, const Dispatcher *dispatcher)
+{
+    int shaftnum;
+
+    sim -> laststate = (State *)malloc(sim -> shaftcount * sizeof(State));
+    if(!sim -> laststate) {
+        fprintf(stderr, "Unable to allocate space for the dispatcher's lift states.\n");
+        exit(1);
+    }
+    for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+        sim -> laststate[shaftnum] = get_state(sim -> shafts[shaftnum] -> car);
+    }
+
+    sim -> dispatcher = dispatcher;
+    sim -> dispatch = dispatcher -> init(sim -> shafts, sim -> shaftcount, sim -> topfloor);
+}
+
+
+/** Take a lift out of service, or put it back. A lift taken out of service stops
+ *  where it is, and its riders stay in it; the stops they want are kept for when
+ *  it comes back. Any other stop it had was a hall call, and is handed on at once,
+ *  as a full lift's are: the dispatcher is told the lift is unavailable if it can
+ *  move the lift's calls itself, and otherwise the calls are cleared and made again
+ *  for the passengers waiting on those floors. Only the lift's own stops and those
+ *  passengers are looked at, never the rest of the building.
+ *
+ *  A lift put back into service starts off idle where it is. If it is the only lift
+ *  in service, calls made while every lift was out went nowhere, so they are made
+ *  again.
+ *
+ *  \param sim        The passenger scheduler.
+ *  \param shaftnum   The shaft of the lift.
+ *  \param in_service true to put the lift back into service, false to take it out.
+ *  \return The number of floors whose hall calls were handed on.
+ */
+int set_in_service(Passengers *sim, int shaftnum, int in_service)
+{
+    Lift *car = sim -> shafts[shaftnum] -> car;
+    int floor, handed = 0, other;
+
+    if(!in_service) {
+        // The lift may already have taken itself out, with an illegal state
+        if(get_state(car) != STATE_OUT_OF_SERVICE) {
+            set_state(car, STATE_OUT_OF_SERVICE);
+            set_direction(car, DIR_NONE);
+        }
+
+        if(sim -> dispatcher && sim -> dispatcher -> set_available) {
+            sim -> dispatcher -> set_available(sim -> dispatch, shaftnum, 0);
+            for(floor = 0; floor <= sim -> topfloor; ++floor) {
+                handed += (car -> stops[floor] & (STOP_HALL_UP | STOP_HALL_DOWN)) != 0;
+            }
+        } else {
+            handed = shed_hall_calls(sim, shaftnum);
+        }
+
+        return handed;
+    }
+
+    if(get_state(car) != STATE_OUT_OF_SERVICE) {
+        return 0;
+    }
+
+    set_state(car, STATE_IDLE);
+    set_direction(car, DIR_NONE);
+
+    if(sim -> dispatcher && sim -> dispatcher -> set_available) {
+        sim -> dispatcher -> set_available(sim -> dispatch, shaftnum, sim -> load[shaftnum] < sim -> carcapacity[shaftnum]);
+        return 0;
+    }
+
+    for(other = 0; other < sim -> shaftcount; ++other) {
+        if(other != shaftnum && get_state(sim -> shafts[other] -> car) != STATE_OUT_OF_SERVICE) {
+            return 0;
+        }
+    }
+    call_again(sim);
+
+    return 0;
+}
+
+
+/* ============================================================================ *
+ * The passenger coroutine                                                      *
+ * ============================================================================ */
+
+/** Run a passenger until they next have to wait. The first time this is called the
+ *  passenger makes their call; after that it is called with the shaft of a lift that
+ *  has opened its doors on the floor they are waiting on (or, once they are in a
+ *  lift, at the floor they are going to).
+ *
+ *  \param sim      The passenger scheduler.
+ *  \param p        The passenger to run.
+ *  \param shaftnum The shaft of the lift that has just opened, unused on the first call.
+ *  \return PASSENGER_WAITING if the passenger is waiting on a floor, PASSENGER_RIDING
+ *          if they are in a lift, or PASSENGER_DONE if they have left the building.
+ */
+static int run_passenger(Passengers *sim, Passenger *p, int shaftnum)
+{
+    Lift *car;
+
+    CO_BEGIN(p);
+
+    p -> called = sim -> now;
+    call_loaded(sim, p -> floor, p -> direction);
+
+    // Wait for a lift going our way, with room for us, to open on this floor
+    while(1) {
+        CO_AWAIT(p, PASSENGER_WAITING);
+
+        car = sim -> shafts[shaftnum] -> car;
+        if(going_my_way(car, p -> direction)) {
+            if(sim -> load[shaftnum] < sim -> carcapacity[shaftnum]) {
+                break;
+            }
+            ++sim -> left_behind;
+        }
+
+        // It opened its doors, so our call has been cleared. Call again if nobody else has.
+        if(!call_pending(sim, p -> floor, p -> direction)) {
+            call_loaded(sim, p -> floor, p -> direction);
+        }
+    }
+
+    // Get in and choose a floor
+    ++sim -> load[shaftnum];
+    p -> shaft = shaftnum;
+    p -> boarded = sim -> now;
+    p -> destination = choose_destination(sim, p);
+    set_stop(car, p -> destination);
+
+    // Ride until the doors open at our floor
+    do {
+        CO_AWAIT(p, PASSENGER_RIDING);
+    } while(at_floor(sim -> shafts[p -> shaft] -> car) != p -> destination);
+
+    // Get out, and record how the journey went
+    --sim -> load[p -> shaft];
+    ++sim -> served;
+    sim -> total_wait += p -> boarded - p -> called;
+    sim -> total_ride += sim -> now - p -> boarded;
+    if(p -> boarded - p -> called > sim -> max_wait) {
+        sim -> max_wait = p -> boarded - p -> called;
+    }
+    ++sim -> waits[(p -> boarded - p -> called < WAIT_BUCKETS) ? p -> boarded - p -> called : WAIT_BUCKETS - 1];
+
+    CO_END(p);
+}
+
+
+/* ============================================================================ *
+ * The scheduler                                                                *
+ * ============================================================================ */
+
+/** Add a passenger to the building. They will call a lift straight away.
+ *
+ *  \param sim       The passenger scheduler.
+ *  \param floor     The floor the passenger appears on.
+ *  \param direction The direction they want to go in.
+ *  \return The passenger's number in the pool.
+ */
+int spawn_passenger(Passengers *sim, int floor, Moving direction)
+{
+    int id = new_passenger(sim);
+    Passenger *p = &sim -> pool[id];
+
+    p -> resume = 0;
+    p -> floor = floor;
+    p -> destination = NO_STOPS;
+    p -> direction = direction;
+    p -> shaft = -1;
+
+    run_passenger(sim, p, 0);
+
+    // Now they join the back of the queue on their floor
+    p -> next = NO_PASSENGER;
+    if(sim -> waiting[floor] == NO_PASSENGER) {
+        sim -> waiting[floor] = id;
+    } else {
+        sim -> pool[sim -> lastwaiting[floor]].next = id;
+    }
+    sim -> lastwaiting[floor] = id;
+
+    return id;
+}
+
+
+/** Add a passenger to the building who already knows which floor they are going
+ *  to, as when traffic follows a pattern such as everybody arriving at the lobby.
+ *  They call a lift straight away, in the direction of their destination.
+ *
+ *  \param sim         The passenger scheduler.
+ *  \param floor       The floor the passenger appears on.
+ *  \param destination The floor they are going to; must not be 'floor'.
+ *  \return The passenger's number in the pool.
+ */
+int spawn_passenger_to(Passengers *sim, int floor, int destination)
+{
+    int id = spawn_passenger(sim, floor, destination > floor ? DIR_UP : DIR_DOWN);
+
+    // They only choose once they are in a lift, so this is in time
+    sim -> pool[id].destination = destination;
+
+    return id;
+}
+
+
+/** Let passengers react to the latest update of the lifts. This should be called
+ *  once after every update_shafts(); any lift that has just opened its doors has its
+ *  riders and the passengers waiting on its floor resumed. Lifts whose passengers
+ *  need longer than OPEN_TIME to get in and out have their doors held with hold_doors().
+ *
+ *  \param sim The passenger scheduler.
+ */
+void passengers_tick(Passengers *sim)
+{
+    int shaftnum;
+    long start;
+    Lift *car;
+
+    ++sim -> now;
+
+    if(sim -> dispatcher) {
+        start = cpu_nanos();
+        if(sim -> dispatcher -> on_car_event) {
+            for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+                car = sim -> shafts[shaftnum] -> car;
+                if(get_state(car) != sim -> laststate[shaftnum]) {
+                    sim -> dispatcher -> on_car_event(sim -> dispatch, shaftnum, sim -> laststate[shaftnum], get_state(car));
+                    sim -> laststate[shaftnum] = get_state(car);
+                }
+            }
+        }
+        if(sim -> dispatcher -> on_tick) {
+            sim -> dispatcher -> on_tick(sim -> dispatch);
+        }
+        sim -> dispatch_nanos += cpu_nanos() - start;
+    }
+
+    for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+        car = sim -> shafts[shaftnum] -> car;
+
+        // The doors opened during this update if the lift is open and hasn't been seen
+        // open before.
+        if(get_state(car) != STATE_OPEN) {
+            sim -> opened[shaftnum] = 0;
+        } else if(!sim -> opened[shaftnum]) {
+            sim -> opened[shaftnum] = 1;
+            lift_opened(sim, shaftnum);
+        }
+    }
+}
+
+
+/** Resume the passengers affected by a lift opening its doors: first the riders
+ *  getting out on this floor, then the passengers waiting to get in, in the order
+ *  they arrived. The doors are then held open long enough for all of them.
+ *
+ *  \param sim      The passenger scheduler.
+ *  \param shaftnum The shaft of the lift that opened.
+ */
+static void lift_opened(Passengers *sim, int shaftnum)
+{
+    int floor = at_floor(sim -> shafts[shaftnum] -> car);
+    int *link, id, last = NO_PASSENGER;
+    int alighted = 0, boarded = 0, dwell;
+    Passenger *p;
+
+    // Riders for this floor get out, and go back on the free list
+    link = &sim -> riding[shaftnum];
+    while(*link != NO_PASSENGER) {
+        id = *link;
+        p = &sim -> pool[id];
+
+        if(p -> destination == floor && run_passenger(sim, p, shaftnum) == PASSENGER_DONE) {
+            *link = p -> next;
+            p -> next = sim -> freelist;
+            sim -> freelist = id;
+            --sim -> live;
+            ++alighted;
+        } else {
+            link = &p -> next;
+        }
+    }
+
+    // Waiting passengers who get in move to the lift's riding list
+    link = &sim -> waiting[floor];
+    while(*link != NO_PASSENGER) {
+        id = *link;
+        p = &sim -> pool[id];
+
+        if(run_passenger(sim, p, shaftnum) == PASSENGER_RIDING) {
+            *link = p -> next;
+            p -> next = sim -> riding[shaftnum];
+            sim -> riding[shaftnum] = id;
+            ++boarded;
+        } else {
+            last = id;
+            link = &p -> next;
+        }
+    }
+    sim -> lastwaiting[floor] = last;
+
+    dwell = alighted * ALIGHT_TIME + boarded * BOARD_TIME;
+    if(!hold_doors(sim -> shafts[shaftnum] -> car, dwell - OPEN_TIME)) {
+        fprintf(stderr, "Unable to allocate space to hold the lift doors.\n");
+        exit(1);
+    }
+
+    if(sim -> dispatcher && sim -> dispatcher -> set_available) {
+        sim -> dispatcher -> set_available(sim -> dispatch, shaftnum, sim -> load[shaftnum] < sim -> carcapacity[shaftnum]);
+    } else if(sim -> load[shaftnum] >= sim -> carcapacity[shaftnum]) {
+        shed_hall_calls(sim, shaftnum);
+    }
+}
+
+
+/** Work out the wait that a given percentage of served passengers waited no
+ *  longer than. Waits of WAIT_BUCKETS - 1 updates or more are all counted as
+ *  WAIT_BUCKETS - 1.
+ *
+ *  \param sim     The passenger scheduler.
+ *  \param percent The percentage of passengers, 0 to 100.
+ *  \return The wait, in updates, or 0 if nobody has been served.
+ */
+long wait_percentile(Passengers *sim, int percent)
+{
+    long wanted = (sim -> served * percent + 99) / 100;
+    long counted = 0, wait;
+
+    for(wait = 0; wait < WAIT_BUCKETS - 1; ++wait) {
+        counted += sim -> waits[wait];
+        if(counted >= wanted && counted > 0) {
+            return wait;
+        }
+    }
+
+    return sim -> served ? WAIT_BUCKETS - 1 : 0;
+}
+
+
+/** Run a building full of passengers without any user input. Passengers appear
+ *  at random, at 'rate' passengers per 1000 updates (which may be more than 1000);
+ *  the same seed always gives the same arrivals.
+ *
+ *  \param sim   The passenger scheduler.
+ *  \param ticks The number of updates to run for.
+ *  \param rate  Passengers arriving per 1000 updates.
+ *  \param seed  The seed for the random arrivals.
+ *  \return The number of passengers who arrived.
+ */
+long simulate_passengers(Passengers *sim, long ticks, int rate, uint64_t seed)
+{
+    Traffic arrivals;
+    long tick, spawned = 0;
+    int arriving, floor;
+    Moving direction;
+
+    // Arrivals are drawn one per 1000th of the rate, so call_rate is left at 1000
+    init_traffic(&arrivals, seed, sim -> topfloor, 1000, 0);
+
+    for(tick = 0; tick < ticks; ++tick) {
+        update_shafts(sim -> shafts, sim -> shaftcount);
+        passengers_tick(sim);
+
+        arriving = rate / 1000 + (traffic_random(&arrivals, 1000) < rate % 1000);
+        while(arriving-- > 0 && next_call(&arrivals, &floor, &direction)) {
+            spawn_passenger(sim, floor, direction);
+            ++spawned;
+        }
+    }
+
+    return spawned;
+}
+
+
+/** Run a building full of passengers without any user input, and print out how
+ *  long they waited and rode for.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param ticks      The number of updates to run for.
+ *  \param rate       Passengers arriving per 1000 updates.
+ *  \param capacity   The most passengers each lift can hold.
+ *  \param dispatcher The dispatcher to make calls through, or NULL for call_loaded().
+ *  \param seed       The seed for the random arrivals and destinations.
+ */
+void run_passengers(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity,
+                    const Dispatcher *dispatcher, uint64_t seed)
+{
+    Passengers *sim = create_passengers(shafts, shaftcount, topfloor, seed + 1);
+    long spawned;
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        set_capacity(sim, shaftnum, capacity);
+    }
+    if(dispatcher) {
+        use_dispatcher(sim, dispatcher);
+    }
+
+    spawned = simulate_passengers(sim, ticks, rate, seed);
+
+    printf("Passengers:     %ld arrived, %ld delivered, %d still in the building (peak %d)\n",
+           spawned, sim -> served, sim -> live, sim -> peak);
+    if(sim -> served) {
+        printf("Average wait:   %.1f updates (longest %ld)\n", (double)sim -> total_wait / sim -> served, sim -> max_wait);
+        printf("Wait centiles:  50%% %ld, 90%% %ld, 99%% %ld updates\n",
+               wait_percentile(sim, 50), wait_percentile(sim, 90), wait_percentile(sim, 99));
+        printf("Average ride:   %.1f updates\n", (double)sim -> total_ride / sim -> served);
+    }
+    if(sim -> dispatcher) {
+        printf("Dispatcher:     %s, %.2f microseconds of CPU per call\n", sim -> dispatcher -> name,
+               sim -> calls ? sim -> dispatch_nanos / 1000.0 / sim -> calls : 0.0);
+    }
+    printf("Left behind:    %ld times, by lifts holding %d passengers\n", sim -> left_behind, capacity);
+    printf("Passenger pool: %d passengers, %lu bytes\n", sim -> capacity,
+           (unsigned long)(sim -> capacity * sizeof(Passenger)));
+
+    free_passengers(sim);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Determine whether any lift is already due to stop at a floor. If the dispatcher
+ *  keeps track of its calls itself, it is asked instead.
+ *
+ *  \param sim       The passenger scheduler.
+ *  \param floor     The floor to check.
+ *  \param direction The direction the passenger wants to go in.
+ *  \return true if the call is still waiting to be answered, false otherwise.
+ */
+static int call_pending(Passengers *sim, int floor, Moving direction)
+{
+    int shaftnum;
+
+    if(sim -> dispatcher && sim -> dispatcher -> pending) {
+        return sim -> dispatcher -> pending(sim -> dispatch, floor, direction);
+    }
+
+    for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+        if(sim -> shafts[shaftnum] -> car -> stops[floor]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** Call a lift to a floor, taking the lifts' loads into account. This picks a lift
+ *  the same way as call_lift(), except that full lifts are not considered, and each
+ *  passenger already in a lift adds ALIGHT_TIME to its service time for the stop
+ *  they will make on the way. If every lift is full the call goes to call_lift(),
+ *  so that it is at least placed somewhere. With a dispatcher, the dispatcher
+ *  chooses the lift instead.
+ *
+ *  \param sim       The passenger scheduler.
+ *  \param floor     The floor the call is made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+static void call_loaded(Passengers *sim, int floor, Moving direction)
+{
+    int bestpos_time = 32768;
+    int bestneg_time = -32767;
+    int bestpos_shaftnum = -1;
+    int bestneg_shaftnum = -1;
+    int shaftnum, service_time, delay;
+    long start;
+
+    ++sim -> calls;
+
+    if(sim -> dispatcher) {
+        start = cpu_nanos();
+        sim -> dispatcher -> on_call(sim -> dispatch, floor, direction);
+        sim -> dispatch_nanos += cpu_nanos() - start;
+        return;
+    }
+
+    for(shaftnum = 0; shaftnum < sim -> shaftcount; ++shaftnum) {
+        if(sim -> load[shaftnum] >= sim -> carcapacity[shaftnum] ||
+           get_state(sim -> shafts[shaftnum] -> car) == STATE_OUT_OF_SERVICE) {
+            continue;
+        }
+
+        // Negative times mean the lift can service the call easily, so the delay
+        // has to push them further from zero too
+        service_time = service_call(sim -> shafts[shaftnum] -> car, floor, direction);
+        delay = sim -> load[shaftnum] * ALIGHT_TIME;
+
+        if(service_time < 0 && service_time - delay > bestneg_time) {
+            bestneg_time = service_time - delay;
+            bestneg_shaftnum = shaftnum;
+        } else if(service_time >= 0 && service_time + delay < bestpos_time) {
+            bestpos_time = service_time + delay;
+            bestpos_shaftnum = shaftnum;
+        }
+    }
+
+    if(bestneg_shaftnum != -1) {
+        set_stop(sim -> shafts[bestneg_shaftnum] -> car, floor);
+    } else if(bestpos_shaftnum != -1) {
+        set_stop(sim -> shafts[bestpos_shaftnum] -> car, floor);
+    } else {
+        call_lift(sim -> shafts, sim -> shaftcount, floor, direction);
+    }
+}
+
+
+/** Hand the hall calls of a full lift on to other lifts. Any stop the lift has that
+ *  none of its riders are going to must be a hall call, and nobody there could get
+ *  in, so the stop is cleared and the call placed again for each direction that
+ *  passengers are waiting to go in on that floor.
+ *
+ *  \param sim      The passenger scheduler.
+ *  \param shaftnum The shaft of the full lift.
+ *  \return The number of stops cleared.
+ */
+static int shed_hall_calls(Passengers *sim, int shaftnum)
+{
+    Lift *car = sim -> shafts[shaftnum] -> car;
+    int id, floor, up, down, shed = 0;
+
+    for(id = sim -> riding[shaftnum]; id != NO_PASSENGER; id = sim -> pool[id].next) {
+        sim -> wanted[sim -> pool[id].destination] = 1;
+    }
+
+    for(floor = 0; floor <= sim -> topfloor; ++floor) {
+        if(car -> stops[floor] && !sim -> wanted[floor]) {
+            clear_stop(car, floor);
+            ++shed;
+
+            up = down = 0;
+            for(id = sim -> waiting[floor]; id != NO_PASSENGER; id = sim -> pool[id].next) {
+                if(sim -> pool[id].direction == DIR_UP) {
+                    up = 1;
+                } else {
+                    down = 1;
+                }
+            }
+            if(up) {
+                call_loaded(sim, floor, DIR_UP);
+            }
+            if(down) {
+                call_loaded(sim, floor, DIR_DOWN);
+            }
+        }
+        sim -> wanted[floor] = 0;
+    }
+
+    return shed;
+}
+
+
+/** Make a call for every floor and direction that passengers are waiting for. Used
+ *  when a lift comes back into service after every lift has been out, as the calls
+ *  made in the meantime were not placed. Stops left in the other lifts by their
+ *  riders don't count as calls, so every floor is called for again.
+ *
+ *  \param sim The passenger scheduler.
+ */
+static void call_again(Passengers *sim)
+{
+    int id, floor, up, down;
+
+    for(floor = 0; floor <= sim -> topfloor; ++floor) {
+        up = down = 0;
+        for(id = sim -> waiting[floor]; id != NO_PASSENGER; id = sim -> pool[id].next) {
+            if(sim -> pool[id].direction == DIR_UP) {
+                up = 1;
+            } else {
+                down = 1;
+            }
+        }
+        if(up) {
+            call_loaded(sim, floor, DIR_UP);
+        }
+        if(down) {
+            call_loaded(sim, floor, DIR_DOWN);
+        }
+    }
+}
+
+
+/** Choose a destination floor for a passenger who has just got into a lift. The
+ *  floor is picked at random from the floors in the direction they called for,
+ *  unless they were spawned knowing where they were going.
+ *
+ *  \param sim The passenger scheduler.
+ *  \param p   The passenger.
+ *  \return The floor the passenger wants to go to.
+ */
+static int choose_destination(Passengers *sim, Passenger *p)
+{
+    if(p -> destination != NO_STOPS) {
+        return p -> destination;
+    }
+
+    if(p -> direction == DIR_UP) {
+        return p -> floor + 1 + traffic_random(&sim -> traffic, sim -> topfloor - p -> floor);
+    }
+
+    return traffic_random(&sim -> traffic, p -> floor);
+}
+
+
+/** Take a passenger from the free list, growing the pool if there are none free.
+ *
+ *  \param sim The passenger scheduler.
+ *  \return The number of the new passenger in the pool.
+ */
+static int new_passenger(Passengers *sim)
+{
+    int id;
+
+    if(sim -> freelist == NO_PASSENGER) {
+        int newcapacity = sim -> capacity ? sim -> capacity * 2 : POOL_SIZE;
+        Passenger *bigger = (Passenger *)realloc(sim -> pool, newcapacity * sizeof(Passenger));
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to allocate space for %d passengers.\n", newcapacity);
+            exit(1);
+        }
+
+        // Put all the new passengers on the free list, lowest first
+        for(id = newcapacity - 1; id >= sim -> capacity; --id) {
+            bigger[id].next = sim -> freelist;
+            sim -> freelist = id;
+        }
+
+        sim -> pool = bigger;
+        sim -> capacity = newcapacity;
+    }
+
+    id = sim -> freelist;
+    sim -> freelist = sim -> pool[id].next;
+
+    if(++sim -> live > sim -> peak) {
+        sim -> peak = sim -> live;
+    }
+
+    return id;
+}
+
+
@@ -0,0 +1,99 @@
+/** \file passenger.h
+ *  Declarations for simulated passengers. Each passenger is a small stackless
+ *  coroutine, resumed by the scheduler when a lift opens its doors.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PASSENGER_H
+#define PASSENGER_H
+
+#include "shaft.h"
+#include "traffic.h"
+#include "dispatch.h"
+
+// Marks the end of a passenger list
+#define NO_PASSENGER -1
+
+// The number of passengers a lift holds unless set_capacity() says otherwise
+#define DEFAULT_CAPACITY 8
+
+// Updates each passenger adds to the time a lift's doors stay open
+#define BOARD_TIME  1
+#define ALIGHT_TIME 1
+
+// Waits are counted in a histogram with one bucket per update; longer waits share the last bucket
+#define WAIT_BUCKETS 8192
+
+/** One passenger. 'resume' records where the passenger's coroutine should carry
+ *  on from; everything else the coroutine needs to remember lives here too, as
+ *  a stackless coroutine has no stack of its own to keep local variables on.
+ */
+typedef struct {
+    int resume;         //!< Where the coroutine carries on from, 0 for the start.
+    int floor;          //!< The floor the passenger called a lift from.
+    int destination;    //!< The floor they are going to, once chosen.
+    Moving direction;   //!< The direction they want to go in.
+    int shaft;          //!< The shaft of the lift they are in, once boarded.
+    long called;        //!< The update the passenger called a lift on.
+    long boarded;       //!< The update the passenger got into a lift on.
+    int next;           //!< The next passenger on the same list, or NO_PASSENGER.
+} Passenger;
+
+/** The passenger scheduler. Passengers live in one pool, and are linked into a
+ *  waiting list for the floor they are on, or a riding list for the lift they are
+ *  in. Only the passengers on the right list are resumed when a lift opens.
+ *
+ *  Waiting lists are queues: passengers get in in the order they arrived, so when
+ *  a lift fills up it is the latest arrivals who are left behind. Lifts hold at
+ *  most 'carcapacity' passengers, and their doors stay open for long enough for
+ *  everybody getting in and out, which may be longer than OPEN_TIME.
+ */
+typedef struct {
+    Shaft **shafts;     //!< The shafts in the building.
+    int shaftcount;     //!< The number of shafts.
+    int topfloor;       //!< The top floor of the building.
+    long now;           //!< The current update.
+    Traffic traffic;    //!< Used by passengers to choose their destinations.
+
+    Passenger *pool;    //!< All passengers, live and free.
+    int capacity;       //!< The size of the pool.
+    int freelist;       //!< The first unused passenger in the pool.
+    int live;           //!< The number of passengers in the building.
+    int peak;           //!< The most passengers there have been in the building at once.
+    int *waiting;       //!< The first passenger waiting on each floor.
+    int *lastwaiting;   //!< The last passenger waiting on each floor.
+    int *riding;        //!< The first passenger riding in each shaft's lift.
+
+    int *carcapacity;   //!< The most passengers each shaft's lift can hold.
+    int *load;          //!< The number of passengers in each shaft's lift.
+    char *opened;       //!< Set while each shaft's lift is open and has let its passengers on and off.
+    char *wanted;       //!< Scratch space marking the floors a lift's riders are going to.
+    const Dispatcher *dispatcher;   //!< The dispatcher used for calls, or NULL for call_loaded()'s own rule.
+    void *dispatch;                 //!< The dispatcher's state.
+    State *laststate;               //!< Each lift's state after the previous update, for on_car_event().
+    long dispatch_nanos;            //!< CPU time spent deciding where calls go.
+
+    long served;        //!< Passengers who have reached their destination.
+    long total_wait;    //!< Sum of their waiting times.
+    long total_ride;    //!< Sum of their riding times.
+    long max_wait;      //!< The longest any of them waited.
+    long left_behind;   //!< Times a passenger was left waiting because a lift was full.
+    long calls;         //!< Hall calls made.
+    long *waits;        //!< How many served passengers waited for each number of updates.
+} Passengers;
+
+Passengers *create_passengers(Shaft **shafts, int shaftcount, int topfloor, uint64_t seed);
+void free_passengers(Passengers *sim);
+void set_capacity(Passengers *sim, int shaftnum, int capacity);
+void use_dispatcher(Passengers *sim, const Dispatcher *dispatcher);
+int set_in_service(Passengers *sim, int shaftnum, int in_service);
+int spawn_passenger(Passengers *sim, int floor, Moving direction);
+int spawn_passenger_to(Passengers *sim, int floor, int destination);
+void passengers_tick(Passengers *sim);
+long wait_percentile(Passengers *sim, int percent);
+long simulate_passengers(Passengers *sim, long ticks, int rate, uint64_t seed);
+void run_passengers(Shaft **shafts, int shaftcount, int topfloor, long ticks, int rate, int capacity,
+                    const Dispatcher *dispatcher, uint64_t seed);
+
+#endif
@@ -0,0 +1,307 @@
+/** \file profile.c
+ *  This file contains a simple profiler for the main loop. Each phase of the loop
+ *  - updating the lifts, drawing them, waiting for input, and dispatching calls -
+ *  is timed with the monotonic clock, and the times are added to a histogram per
+ *  phase. When the loop ends a table shows where the time went, so a slow run can
+ *  be pinned on print_viewport(), call_lift() or update_lift() without reaching
+ *  for an external profiler.
+ *
+ *  clock_gettime() is used rather than reading the CPU's cycle counter, as it is
+ *  portable, needs no calibration against the wall clock, and on Linux is answered
+ *  without entering the kernel. Timing one phase costs two clock reads and a few
+ *  additions, a few tens of nanoseconds. That is measured when profiling starts
+ *  and reported with the results; against a loop that redraws the terminal every
+ *  update it comes to far less than 1% of the run.
+ *
+ *  While profiling, the first interrupt (control-C) asks the main loop to finish
+ *  and print the results rather than killing the program; a second one kills it.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+
+// The number of timings made to work out how much a timing costs
+#define CALIBRATION_SAMPLES 10000
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static uint64_t now_nanos(void);
+static void record_time(PhaseTimes *phase, uint64_t nanos);
+static double percentile(PhaseTimes *phase, int percent);
+static void interrupted(int signum);
+
+
+/* ============================================================================ *
+ * Profiler state                                                               *
+ * ============================================================================ */
+
+static PhaseTimes phases[PHASE_COUNT];
+static const char *phase_names[PHASE_COUNT] = { "update", "render", "input wait", "dispatch" };
+
+static int enabled = 0;                 // Whether phases are being timed
+static volatile sig_atomic_t stopped;   // Set when the user interrupts the program
+static uint64_t started;                // When profiling started
+static uint64_t nested;                 // Dispatch time since the last input phase ended
+static uint64_t sample_cost;            // Nanoseconds taken by one profile_begin()/profile_end()
+
+
+/* ============================================================================ *
+ * Timing phases                                                                *
+ * ============================================================================ */
+
+/** Start timing the phases of the main loop. This works out how long a timing
+ *  takes, and catches the first interrupt so the results can be printed.
+ */
+void start_profile(void)
+{
+    uint64_t begin, sample;
+    int i;
+
+    enabled = 1;
+
+    // Time a batch of empty phases, then throw them away
+    begin = now_nanos();
+    for(i = 0; i < CALIBRATION_SAMPLES; ++i) {
+        sample = profile_begin();
+        profile_end(PHASE_UPDATE, sample);
+    }
+    sample_cost = (now_nanos() - begin) / CALIBRATION_SAMPLES;
+    memset(phases, 0, sizeof(phases));
+
+    catch_interrupt();
+    started = now_nanos();
+}
+
+
+/** Catch the first interrupt, so that the main loop can finish cleanly rather
+ *  than the program being killed; profile_stopped() then returns true. A second
+ *  interrupt kills the program as usual.
+ */
+void catch_interrupt(void)
+{
+    struct sigaction action;
+
+    // No SA_RESTART, so a blocked read returns and the loop can see 'stopped'
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupted;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+}
+
+
+/** Find out whether the main loop is being profiled.
+ *
+ *  \return true if start_profile() has been called, false otherwise.
+ */
+int profiling(void)
+{
+    return enabled;
+}
+
+
+/** Find out whether the user has asked for the main loop to finish.
+ *
+ *  \return true if the program has been interrupted, false otherwise.
+ */
+int profile_stopped(void)
+{
+    return stopped;
+}
+
+
+/** Mark the start of a phase.
+ *
+ *  \return The time to pass to profile_end() when the phase is over.
+ */
+uint64_t profile_begin(void)
+{
+    return enabled ? now_nanos() : 0;
+}
+
+
+/** Mark the end of a phase, and record how long it took. Time spent dispatching
+ *  during an input phase is taken out of the input phase.
+ *
+ *  \param phase   The phase that has ended.
+ *  \param begin   The time profile_begin() returned at the start of the phase.
+ */
+void profile_end(Phase phase, uint64_t begin)
+{
+    uint64_t nanos;
+
+    if(!enabled) {
+        return;
+    }
+
+    nanos = now_nanos() - begin;
+
+    if(phase == PHASE_DISPATCH) {
+        nested += nanos;
+    } else if(phase == PHASE_INPUT) {
+        nanos  = (nested < nanos) ? nanos - nested : 0;
+        nested = 0;
+    }
+
+    record_time(&phases[phase], nanos);
+}
+
+
+/** Print a table showing how long each phase took, and how much time was spent
+ *  outside all of them.
+ *
+ *  \param out The stream to print to.
+ */
+void print_profile(FILE *out)
+{
+    uint64_t wall = now_nanos() - started;
+    uint64_t timed = 0, samples = 0;
+    int phase;
+
+    if(!wall) {
+        wall = 1;
+    }
+
+    fprintf(out, "%-12s %10s %12s %7s %10s %10s %10s %10s\n",
+            "Phase", "Count", "Total ms", "Share", "Mean us", "p50 us", "p99 us", "Max us");
+
+    for(phase = 0; phase < PHASE_COUNT; ++phase) {
+        PhaseTimes *times = &phases[phase];
+
+        fprintf(out, "%-12s %10llu %12.3f %6.2f%% %10.2f %10.2f %10.2f %10.2f\n",
+                phase_names[phase], (unsigned long long)times -> count, times -> total / 1e6,
+                (100.0 * times -> total) / wall,
+                times -> count ? (times -> total / 1e3) / times -> count : 0.0,
+                percentile(times, 50) / 1e3, percentile(times, 99) / 1e3, times -> longest / 1e3);
+
+        timed   += times -> total;
+        samples += times -> count;
+    }
+
+    fprintf(out, "%-12s %10s %12.3f %6.2f%%\n", "other", "",
+            (wall > timed ? wall - timed : 0) / 1e6, (100.0 * (wall > timed ? wall - timed : 0)) / wall);
+    fprintf(out, "Timing overhead: %llu ns per phase, %.3f ms in all (%.3f%% of the run)\n",
+            (unsigned long long)sample_cost, (samples * sample_cost) / 1e6,
+            (100.0 * samples * sample_cost) / wall);
+}
+
+
+/* ============================================================================ *
+ * Timing histograms                                                            *
+ * ============================================================================ */
+
+/** Find the bucket a time falls in, in a histogram with power of two buckets:
+ *  bucket 0 is for 0, bucket b is for 2^(b-1) up to 2^b, and the last bucket is
+ *  for everything longer. The time can be in any unit, as long as the histogram's
+ *  buckets are in the same one.
+ *
+ *  \param value   The time to find the bucket for.
+ *  \param buckets The number of buckets in the histogram.
+ *  \return The bucket to count the time in.
+ */
+int time_bucket(uint64_t value, int buckets)
+{
+    int bucket = 0;
+
+    while(value && bucket < buckets - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+
+/** Read the CPU time used by the calling thread, for timing work done on it
+ *  rather than the time that passed while it was done.
+ *
+ *  \return The thread's CPU time in nanoseconds.
+ */
+long cpu_nanos(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (now.tv_sec * 1000000000L) + now.tv_nsec;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Read the monotonic clock.
+ *
+ *  \return The time in nanoseconds since an arbitrary starting point.
+ */
+static uint64_t now_nanos(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+
+/** Add one run of a phase to its times.
+ *
+ *  \param phase The phase's times.
+ *  \param nanos How long the phase took, in nanoseconds.
+ */
+static void record_time(PhaseTimes *phase, uint64_t nanos)
+{
+    ++phase -> count;
+    phase -> total += nanos;
+    ++phase -> buckets[time_bucket(nanos, PROFILE_BUCKETS)];
+    if(nanos > phase -> longest) {
+        phase -> longest = nanos;
+    }
+}
+
+
+/** Estimate a percentile of a phase's times from its histogram. This gives the top
+ *  of the bucket the percentile falls in, so it is within a factor of two, but
+ *  never more than the longest time.
+ *
+ *  \param phase   The phase's times.
+ *  \param percent The percentile to find, 1 to 100.
+ *  \return The estimated time in nanoseconds, or 0 if the phase never ran.
+ */
+static double percentile(PhaseTimes *phase, int percent)
+{
+    uint64_t wanted = ((phase -> count * percent) + 99) / 100;
+    uint64_t seen = 0;
+    int bucket;
+
+    for(bucket = 0; bucket < PROFILE_BUCKETS; ++bucket) {
+        seen += phase -> buckets[bucket];
+        if(wanted && seen >= wanted) {
+            if(bucket == PROFILE_BUCKETS - 1 || (1ULL << bucket) > phase -> longest) {
+                return (double)phase -> longest;
+            }
+            return (double)(1ULL << bucket);
+        }
+    }
+
+    return 0.0;
+}
+
+
+/** Note that the user has interrupted the program.
+ *
+ *  \param signum The signal received.
+ */
+static void interrupted(int signum)
+{
+    (void)signum;
+    stopped = 1;
+}
@@ -0,0 +1,47 @@
+/** \file profile.h
+ *  Declarations for timing the phases of the main loop.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** The number of buckets in each phase's histogram. Bucket b counts times from
+ *  2^(b-1) up to 2^b nanoseconds, and the last bucket counts everything longer.
+ */
+#define PROFILE_BUCKETS 40
+
+/** The parts of the main loop that are timed. Dispatch happens inside the prompts,
+ *  so its time is taken out of the input wait rather than counted twice.
+ */
+typedef enum {
+    PHASE_UPDATE,       //!< Updating the lifts, parking idle ones and publishing their state.
+    PHASE_RENDER,       //!< Drawing the building.
+    PHASE_INPUT,        //!< Waiting for and reading the user's input.
+    PHASE_DISPATCH,     //!< Choosing lifts for calls and setting stops.
+    PHASE_COUNT
+} Phase;
+
+/** The times recorded for one phase. */
+typedef struct {
+    uint64_t count;                     //!< Times the phase was run.
+    uint64_t total;                     //!< Nanoseconds spent in the phase.
+    uint64_t longest;                   //!< The longest the phase took, in nanoseconds.
+    uint64_t buckets[PROFILE_BUCKETS];  //!< How long the phase took each time.
+} PhaseTimes;
+
+void start_profile(void);
+void catch_interrupt(void);
+int profiling(void);
+int profile_stopped(void);
+uint64_t profile_begin(void);
+void profile_end(Phase phase, uint64_t begin);
+void print_profile(FILE *out);
+int time_bucket(uint64_t value, int buckets);
+long cpu_nanos(void);
+
+#endif
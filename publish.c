@@ -0,0 +1,384 @@
+/** \file publish.c
+ *  This file contains the shared memory state publisher. Every update, the position,
+ *  state, direction and stop markers of every lift are copied into a POSIX shared
+ *  memory object, where dashboards and analysis tools on the same machine can read
+ *  them directly, without any system calls or copying through pipes.
+ *
+ *  The object holds a ring of PUBLISH_SLOTS snapshots, each protected by its own
+ *  sequence lock. The simulation makes a slot's sequence number odd before it
+ *  starts writing the slot, and even again when it has finished. A reader notes the
+ *  sequence number, copies the snapshot, and checks that the number has not changed
+ *  and was not odd; if it had, the copy may be torn and is thrown away. Readers
+ *  never block the simulation, and as the simulation writes each snapshot into the
+ *  next slot round the ring, a reader has several updates to finish its copy before
+ *  its slot is reused.
+ *
+ *  This is only available on POSIX systems.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "publish.h"
+
+// How many times a reader tries to get an untorn snapshot before giving up
+#define READ_ATTEMPTS 16
+
+// Slots are padded out to whole cache lines
+#define CACHE_LINE 64
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static char *object_name(const char *name);
+static PublishSlot *slot_at(PublishHeader *header, uint64_t slot);
+static PublishedCar *slot_cars(PublishSlot *slot);
+static uint64_t *slot_stops(PublishHeader *header, PublishSlot *slot);
+
+
+/* ============================================================================ *
+ * Publishing                                                                   *
+ * ============================================================================ */
+
+/** Create a shared memory object to publish the state of a building in. Any old
+ *  object with the same name is replaced.
+ *
+ *  \param name       The name of the shared memory object. A leading '/' is added if missing.
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of the building.
+ *  \return A pointer to the new publisher, or NULL if the object could not be created.
+ */
+Publisher *open_publisher(const char *name, int shaftcount, int topfloor)
+{
+    Publisher *pub;
+    PublishHeader *header;
+    uint32_t stopwords = (topfloor / 64) + 1;
+    uint64_t slotsize;
+    size_t size;
+    int fd;
+
+    // Work out the size of each slot, rounded up to a whole number of cache lines
+    slotsize = sizeof(PublishSlot) + (shaftcount * sizeof(PublishedCar)) + (shaftcount * stopwords * sizeof(uint64_t));
+    slotsize = ((slotsize + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE;
+    size = CACHE_LINE + (PUBLISH_SLOTS * slotsize);
+
+    pub = (Publisher *)malloc(sizeof(Publisher));
+    if(!pub || !(pub -> name = object_name(name))) {
+        fprintf(stderr, "Unable to allocate space for the state publisher.\n");
+        exit(1);
+    }
+
+    shm_unlink(pub -> name);
+    fd = shm_open(pub -> name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0 || ftruncate(fd, size) < 0) {
+        perror("Unable to create the shared memory object");
+        if(fd >= 0) {
+            close(fd);
+            shm_unlink(pub -> name);
+        }
+        free(pub -> name);
+        free(pub);
+        return NULL;
+    }
+
+    header = (PublishHeader *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(header == MAP_FAILED) {
+        perror("Unable to map the shared memory object");
+        shm_unlink(pub -> name);
+        free(pub -> name);
+        free(pub);
+        return NULL;
+    }
+
+    // ftruncate() has zeroed the object, so only the header needs filling in
+    header -> magic      = PUBLISH_MAGIC;
+    header -> version    = PUBLISH_VERSION;
+    header -> shaftcount = shaftcount;
+    header -> topfloor   = topfloor;
+    header -> slots      = PUBLISH_SLOTS;
+    header -> stopwords  = stopwords;
+    header -> slotsize   = slotsize;
+    atomic_store_explicit(&header -> latest, 0, memory_order_release);
+
+    pub -> header = header;
+    pub -> size   = size;
+    pub -> writer = 1;
+
+    return pub;
+}
+
+
+/** Publish a snapshot of the state of every lift in the building. This should be
+ *  called once per update, after the lifts have been updated. It never waits for
+ *  readers.
+ *
+ *  \param pub    The publisher.
+ *  \param shafts A pointer to a block of memory containing pointers to Shafts. There
+ *                must be as many as were given to open_publisher().
+ *  \param tick   The number of the update just completed.
+ */
+void publish_state(Publisher *pub, Shaft **shafts, long tick)
+{
+    PublishHeader *header = pub -> header;
+    uint64_t count = atomic_load_explicit(&header -> latest, memory_order_relaxed);
+    PublishSlot *slot = slot_at(header, count % header -> slots);
+    uint64_t sequence = atomic_load_explicit(&slot -> sequence, memory_order_relaxed);
+    PublishedCar *cars = slot_cars(slot);
+    uint64_t *stops = slot_stops(header, slot);
+    uint32_t shaftnum;
+    int floor;
+    Lift *car;
+
+    // Odd sequence: readers will ignore this slot until we're done
+    atomic_store_explicit(&slot -> sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot -> tick = tick;
+    memset(stops, 0, header -> shaftcount * header -> stopwords * sizeof(uint64_t));
+
+    for(shaftnum = 0; shaftnum < header -> shaftcount; ++shaftnum) {
+        car = shafts[shaftnum] -> car;
+
+        cars[shaftnum].position  = get_position(car);
+        cars[shaftnum].time      = get_time(car);
+        cars[shaftnum].state     = get_state(car);
+        cars[shaftnum].direction = get_direction(car);
+
+        for(floor = 0; floor <= get_topfloor(car) && floor <= (int)header -> topfloor; ++floor) {
+            if(car -> stops[floor]) {
+                stops[(shaftnum * header -> stopwords) + (floor >> 6)] |= (uint64_t)1 << (floor & 63);
+            }
+        }
+    }
+
+    // Even again, and make it the latest snapshot
+    atomic_store_explicit(&slot -> sequence, sequence + 2, memory_order_release);
+    atomic_store_explicit(&header -> latest, count + 1, memory_order_release);
+}
+
+
+/* ============================================================================ *
+ * Viewing                                                                      *
+ * ============================================================================ */
+
+/** Open a shared memory object created by open_publisher(), to read snapshots from.
+ *
+ *  \param name The name of the shared memory object.
+ *  \return A pointer to the viewer, or NULL if the object could not be opened.
+ */
+Publisher *open_viewer(const char *name)
+{
+    Publisher *view;
+    struct stat info;
+    int fd;
+
+    view = (Publisher *)malloc(sizeof(Publisher));
+    if(!view || !(view -> name = object_name(name))) {
+        fprintf(stderr, "Unable to allocate space for the state viewer.\n");
+        exit(1);
+    }
+
+    fd = shm_open(view -> name, O_RDONLY, 0);
+    if(fd < 0 || fstat(fd, &info) < 0 || info.st_size < CACHE_LINE) {
+        fprintf(stderr, "Unable to open published lift state '%s'.\n", view -> name);
+        if(fd >= 0) {
+            close(fd);
+        }
+        free(view -> name);
+        free(view);
+        return NULL;
+    }
+
+    view -> size   = info.st_size;
+    view -> writer = 0;
+    view -> header = (PublishHeader *)mmap(NULL, view -> size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(view -> header == MAP_FAILED || view -> header -> magic != PUBLISH_MAGIC ||
+       view -> header -> version != PUBLISH_VERSION) {
+        fprintf(stderr, "'%s' does not contain published lift state.\n", view -> name);
+        if(view -> header != MAP_FAILED) {
+            munmap(view -> header, view -> size);
+        }
+        free(view -> name);
+        free(view);
+        return NULL;
+    }
+
+    return view;
+}
+
+
+/** Copy the latest snapshot out of the shared memory object.
+ *
+ *  \param view  The viewer to read from.
+ *  \param tick  A pointer to a variable to store the snapshot's update number in.
+ *  \param cars  Space for 'shaftcount' PublishedCars.
+ *  \param stops Space for 'shaftcount' * 'stopwords' stop mask words.
+ *  \return true if a snapshot was copied, false if none has been published yet or
+ *          the simulation kept overwriting the slot being read.
+ */
+int read_snapshot(Publisher *view, uint64_t *tick, PublishedCar *cars, uint64_t *stops)
+{
+    PublishHeader *header = view -> header;
+    PublishSlot *slot;
+    uint64_t latest, before, after;
+    int attempt;
+
+    for(attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+        latest = atomic_load_explicit(&header -> latest, memory_order_acquire);
+        if(!latest) {
+            return 0;
+        }
+
+        slot = slot_at(header, (latest - 1) % header -> slots);
+        before = atomic_load_explicit(&slot -> sequence, memory_order_acquire);
+        if(before & 1) {
+            continue; // being written right now
+        }
+
+        *tick = slot -> tick;
+        memcpy(cars, slot_cars(slot), header -> shaftcount * sizeof(PublishedCar));
+        memcpy(stops, slot_stops(header, slot), header -> shaftcount * header -> stopwords * sizeof(uint64_t));
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot -> sequence, memory_order_relaxed);
+        if(before == after) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** Close a publisher or viewer. Closing the publisher also removes the shared memory
+ *  object; viewers that still have it open can keep reading the last snapshot.
+ *
+ *  \param pub The publisher or viewer to close.
+ */
+void close_publisher(Publisher *pub)
+{
+    munmap(pub -> header, pub -> size);
+    if(pub -> writer) {
+        shm_unlink(pub -> name);
+    }
+    free(pub -> name);
+    free(pub);
+}
+
+
+/** Watch a running simulation through its published state, printing a line for each
+ *  new snapshot with the floor (or position, between floors) and display string of
+ *  every lift. This runs until the program is interrupted.
+ *
+ *  \param name The name the simulation is publishing under.
+ */
+void run_watch(const char *name)
+{
+    Publisher *view = open_viewer(name);
+    PublishedCar *cars;
+    uint64_t *stops;
+    uint64_t tick, lasttick = 0;
+    uint32_t shaftnum;
+    Lift shown;
+
+    if(!view) {
+        return;
+    }
+
+    cars  = (PublishedCar *)malloc(view -> header -> shaftcount * sizeof(PublishedCar));
+    stops = (uint64_t *)malloc(view -> header -> shaftcount * view -> header -> stopwords * sizeof(uint64_t));
+    if(!cars || !stops) {
+        fprintf(stderr, "Unable to allocate space for a snapshot.\n");
+        exit(1);
+    }
+
+    while(1) {
+        if(read_snapshot(view, &tick, cars, stops) && tick != lasttick) {
+            printf("%8lu:", (unsigned long)tick);
+            for(shaftnum = 0; shaftnum < view -> header -> shaftcount; ++shaftnum) {
+                // lift_to_string() only needs the state and direction
+                shown.state = (State)cars[shaftnum].state;
+                shown.direction = (Moving)cars[shaftnum].direction;
+
+                if(cars[shaftnum].position % FLOOR_HEIGHT == 0) {
+                    printf("  %s %3d  ", lift_to_string(&shown), cars[shaftnum].position / FLOOR_HEIGHT);
+                } else {
+                    printf("  %s %3d+%d", lift_to_string(&shown), cars[shaftnum].position / FLOOR_HEIGHT,
+                           cars[shaftnum].position % FLOOR_HEIGHT);
+                }
+            }
+            printf("\n");
+            fflush(stdout);
+            lasttick = tick;
+        }
+
+        usleep(50000);
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Make a shared memory object name, adding the leading '/' POSIX requires.
+ *
+ *  \param name The name given by the user.
+ *  \return A newly allocated copy of the name with a leading '/', or NULL.
+ */
+static char *object_name(const char *name)
+{
+    char *full = (char *)malloc(strlen(name) + 2);
+
+    if(full) {
+        sprintf(full, "%s%s", name[0] == '/' ? "" : "/", name);
+    }
+
+    return full;
+}
+
+
+/** Locate a slot in the ring. The slots start one cache line after the header.
+ *
+ *  \param header The mapped shared memory object.
+ *  \param slot   The slot number.
+ *  \return A pointer to the slot.
+ */
+static PublishSlot *slot_at(PublishHeader *header, uint64_t slot)
+{
+    return (PublishSlot *)((char *)header + CACHE_LINE + (slot * header -> slotsize));
+}
+
+
+/** Locate the lift records in a slot.
+ *
+ *  \param slot The slot.
+ *  \return A pointer to the first PublishedCar.
+ */
+static PublishedCar *slot_cars(PublishSlot *slot)
+{
+    return (PublishedCar *)(slot + 1);
+}
+
+
+/** Locate the stop masks in a slot.
+ *
+ *  \param header The mapped shared memory object.
+ *  \param slot   The slot.
+ *  \return A pointer to the first word of the first stop mask.
+ */
+static uint64_t *slot_stops(PublishHeader *header, PublishSlot *slot)
+{
+    return (uint64_t *)(slot_cars(slot) + header -> shaftcount);
+}
@@ -0,0 +1,69 @@
+/** \file publish.h
+ *  Declarations for publishing the state of the lifts through POSIX shared memory,
+ *  so that other programs on the same machine can watch the simulation.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "shaft.h"
+
+// "LIFT", used to check a shared memory object really holds published lift state
+#define PUBLISH_MAGIC 0x5446494cU
+#define PUBLISH_VERSION 1
+
+// The number of snapshots kept in the ring
+#define PUBLISH_SLOTS 4
+
+/** The header at the start of the shared memory object. Everything but 'latest'
+ *  is written once, before any snapshot is published.
+ */
+typedef struct {
+    uint32_t magic;             //!< PUBLISH_MAGIC.
+    uint32_t version;           //!< PUBLISH_VERSION.
+    uint32_t shaftcount;        //!< The number of lifts in each snapshot.
+    uint32_t topfloor;          //!< The top floor of the building.
+    uint32_t slots;             //!< The number of snapshots in the ring.
+    uint32_t stopwords;         //!< 64 bit words in each lift's stop mask.
+    uint64_t slotsize;          //!< Bytes from the start of one slot to the next.
+    _Atomic uint64_t latest;    //!< The number of snapshots published so far.
+} PublishHeader;
+
+/** One lift in a snapshot. */
+typedef struct {
+    int32_t position;   //!< Position in the shaft, 0 to topfloor * FLOOR_HEIGHT.
+    int32_t time;       //!< The FSM timer.
+    int32_t state;      //!< The FSM state, a State value.
+    int32_t direction;  //!< The direction of travel, a Moving value.
+} PublishedCar;
+
+/** The start of each slot in the ring. It is followed by 'shaftcount' PublishedCars,
+ *  and then 'shaftcount' stop masks of 'stopwords' words each, bit N of a mask
+ *  being set if the lift will stop at floor N.
+ */
+typedef struct {
+    _Atomic uint64_t sequence;  //!< Odd while the slot is being written.
+    uint64_t tick;              //!< The update the snapshot was taken after.
+} PublishSlot;
+
+/** An open shared memory object, for either publishing or viewing. */
+typedef struct {
+    char *name;                 //!< The shared memory object's name.
+    PublishHeader *header;      //!< The mapped object.
+    size_t size;                //!< The size of the mapping.
+    int writer;                 //!< true if this end publishes snapshots.
+} Publisher;
+
+Publisher *open_publisher(const char *name, int shaftcount, int topfloor);
+void publish_state(Publisher *pub, Shaft **shafts, long tick);
+Publisher *open_viewer(const char *name);
+int read_snapshot(Publisher *view, uint64_t *tick, PublishedCar *cars, uint64_t *stops);
+void close_publisher(Publisher *pub);
+void run_watch(const char *name);
+
+#endif
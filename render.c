@@ -0,0 +1,310 @@
+/** \file render.c
+ *  This file contains the render thread. Printing the shafts to the terminal is by
+ *  far the slowest part of each update, so when the simulation is running on its
+ *  own it hands copies of the building to a separate thread to draw instead. The
+ *  simulation never waits for the terminal: if the render thread is still busy
+ *  with the last frame when several more have been produced, the ones in between
+ *  are simply dropped, and the next frame drawn is the latest one.
+ *
+ *  Three copies of the building are used so that neither thread ever has to wait
+ *  for the other to finish with one - see the Renderer structure.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "render.h"
+#include "traffic.h"
+#include "viewport.h"
+
+// The traffic used when the simulation runs on its own
+#define RENDER_CALL_RATE 100
+#define RENDER_STOP_RATE 60
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static Shaft **copy_of(Shaft **shafts, int shaftcount);
+static void copy_building(Shaft **to, Shaft **from, int shaftcount);
+static void free_copy(Shaft **copy, int shaftcount);
+static void *render_thread(void *arg);
+
+
+/* ============================================================================ *
+ * Starting and stopping the render thread                                      *
+ * ============================================================================ */
+
+/** Start a render thread for a building.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param fps        The most frames to draw per second, or 0 for no limit.
+ *  \return A pointer to the new renderer.
+ */
+Renderer *start_renderer(Shaft **shafts, int shaftcount, int fps)
+{
+    Renderer *renderer = (Renderer *)calloc(1, sizeof(Renderer));
+
+    if(!renderer) {
+        fprintf(stderr, "Unable to allocate space for the renderer.\n");
+        exit(1);
+    }
+
+    renderer -> back  = copy_of(shafts, shaftcount);
+    renderer -> ready = copy_of(shafts, shaftcount);
+    renderer -> front = copy_of(shafts, shaftcount);
+    renderer -> shaftcount = shaftcount;
+    renderer -> running = 1;
+    renderer -> interval = fps > 0 ? 1000000L / fps : 0;
+
+    pthread_mutex_init(&renderer -> lock, NULL);
+    pthread_cond_init(&renderer -> wake, NULL);
+
+    if(pthread_create(&renderer -> thread, NULL, render_thread, renderer)) {
+        fprintf(stderr, "Unable to start the render thread.\n");
+        exit(1);
+    }
+
+    return renderer;
+}
+
+
+/** Stop a render thread, and release the memory used by the renderer.
+ *
+ *  \param renderer The renderer to stop.
+ */
+void stop_renderer(Renderer *renderer)
+{
+    pthread_mutex_lock(&renderer -> lock);
+    renderer -> running = 0;
+    pthread_cond_signal(&renderer -> wake);
+    pthread_mutex_unlock(&renderer -> lock);
+
+    pthread_join(renderer -> thread, NULL);
+
+    pthread_cond_destroy(&renderer -> wake);
+    pthread_mutex_destroy(&renderer -> lock);
+    free_copy(renderer -> back,  renderer -> shaftcount);
+    free_copy(renderer -> ready, renderer -> shaftcount);
+    free_copy(renderer -> front, renderer -> shaftcount);
+    free(renderer);
+}
+
+
+/* ============================================================================ *
+ * Passing frames between the threads                                           *
+ * ============================================================================ */
+
+/** Hand the current state of the building to the render thread. This copies the
+ *  building and returns straight away; it never waits for the terminal.
+ *
+ *  \param renderer The renderer.
+ *  \param shafts   A pointer to a block of memory containing pointers to Shafts.
+ *  \param tick     The number of the update just completed.
+ */
+void submit_frame(Renderer *renderer, Shaft **shafts, long tick)
+{
+    Shaft **swap;
+
+    // Only the simulation touches 'back', so this needs no lock
+    copy_building(renderer -> back, shafts, renderer -> shaftcount);
+    renderer -> backtick = tick;
+
+    pthread_mutex_lock(&renderer -> lock);
+
+    if(renderer -> fresh) {
+        ++renderer -> dropped;
+    }
+
+    swap = renderer -> ready;
+    renderer -> ready = renderer -> back;
+    renderer -> back = swap;
+    renderer -> readytick = renderer -> backtick;
+    renderer -> fresh = 1;
+
+    pthread_cond_signal(&renderer -> wake);
+    pthread_mutex_unlock(&renderer -> lock);
+}
+
+
+/** The body of the render thread: wait for a frame, take it, draw it, and wait out
+ *  the rest of the frame interval.
+ *
+ *  \param arg A pointer to the Renderer.
+ *  \return Always NULL.
+ */
+static void *render_thread(void *arg)
+{
+    Renderer *renderer = (Renderer *)arg;
+    Viewport view;
+    Shaft **swap;
+    long tick, dropped;
+
+    full_viewport(&view, renderer -> front, renderer -> shaftcount);
+
+    pthread_mutex_lock(&renderer -> lock);
+    while(1) {
+        while(!renderer -> fresh && renderer -> running) {
+            pthread_cond_wait(&renderer -> wake, &renderer -> lock);
+        }
+        if(!renderer -> running) {
+            break;
+        }
+
+        swap = renderer -> front;
+        renderer -> front = renderer -> ready;
+        renderer -> ready = swap;
+        renderer -> fronttick = renderer -> readytick;
+        renderer -> fresh = 0;
+        tick    = renderer -> fronttick;
+        dropped = renderer -> dropped;
+        pthread_mutex_unlock(&renderer -> lock);
+
+        // The front copy is ours alone until the next swap, which only we do
+        fit_viewport(&view, renderer -> front, renderer -> shaftcount);
+        print_viewport(renderer -> front, renderer -> shaftcount, &view);
+        printf("update %ld, %ld frames dropped\n", tick, dropped);
+        fflush(stdout);
+
+        if(renderer -> interval) {
+            usleep(renderer -> interval);
+        }
+
+        pthread_mutex_lock(&renderer -> lock);
+        ++renderer -> drawn;
+    }
+    pthread_mutex_unlock(&renderer -> lock);
+
+    return NULL;
+}
+
+
+/* ============================================================================ *
+ * Running with a render thread                                                 *
+ * ============================================================================ */
+
+/** Run the simulation at full speed with generated traffic, while the render thread
+ *  shows it in the terminal, then print out how fast it ran.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param ticks      The number of updates to run for.
+ *  \param fps        The most frames to draw per second, or 0 for no limit.
+ *  \param seed       The seed for the generated traffic.
+ */
+void run_rendered(Shaft **shafts, int shaftcount, int topfloor, long ticks, int fps, uint64_t seed)
+{
+    Renderer *renderer = start_renderer(shafts, shaftcount, fps);
+    Traffic traffic;
+    struct timespec start, end;
+    long tick, drawn, dropped;
+    int shaftnum, floor;
+    Moving direction;
+    double seconds;
+
+    init_traffic(&traffic, seed, topfloor, RENDER_CALL_RATE, RENDER_STOP_RATE);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(tick = 1; tick <= ticks; ++tick) {
+        update_shafts(shafts, shaftcount);
+
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            if(get_state(shafts[shaftnum] -> car) == STATE_OPEN &&
+               next_stop(&traffic, shafts[shaftnum] -> car, &floor)) {
+                set_stop(shafts[shaftnum] -> car, floor);
+            }
+        }
+        if(next_call(&traffic, &floor, &direction)) {
+            call_lift(shafts, shaftcount, floor, direction);
+        }
+
+        submit_frame(renderer, shafts, tick);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_lock(&renderer -> lock);
+    drawn   = renderer -> drawn;
+    dropped = renderer -> dropped;
+    pthread_mutex_unlock(&renderer -> lock);
+    stop_renderer(renderer);
+
+    seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    printf("%ld updates in %.3f seconds (%.0f updates per second), %ld frames drawn, %ld dropped\n",
+           ticks, seconds, ticks / (seconds > 0 ? seconds : 1e-9), drawn, dropped);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Make a copy of a building, with new shafts and lifts of the same sizes.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \return A newly allocated block of pointers to the copied Shafts.
+ */
+static Shaft **copy_of(Shaft **shafts, int shaftcount)
+{
+    Shaft **copy = (Shaft **)malloc(shaftcount * sizeof(Shaft *));
+    int shaftnum;
+
+    if(!copy) {
+        fprintf(stderr, "Unable to allocate space for a copy of the building.\n");
+        exit(1);
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        copy[shaftnum] = create_shaft(shafts[shaftnum] -> topfloor, get_speed(shafts[shaftnum] -> car));
+    }
+    copy_building(copy, shafts, shaftcount);
+
+    return copy;
+}
+
+
+/** Copy the state of every lift in one building into another of the same shape.
+ *
+ *  \param to         The building to copy into.
+ *  \param from       The building to copy from.
+ *  \param shaftcount The number of shafts in each.
+ */
+static void copy_building(Shaft **to, Shaft **from, int shaftcount)
+{
+    int shaftnum;
+    Lift *dest, *src;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        dest = to[shaftnum] -> car;
+        src  = from[shaftnum] -> car;
+
+        dest -> position  = src -> position;
+        dest -> time      = src -> time;
+        dest -> state     = src -> state;
+        dest -> direction = src -> direction;
+        memcpy(dest -> stops, src -> stops, get_topfloor(src) + 1);
+    }
+}
+
+
+/** Release a copy made by copy_of().
+ *
+ *  \param copy       The copy to free.
+ *  \param shaftcount The number of shafts in it.
+ */
+static void free_copy(Shaft **copy, int shaftcount)
+{
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        free_shaft(copy[shaftnum]);
+    }
+    free(copy);
+}
@@ -0,0 +1,42 @@
+/** \file render.h
+ *  Declarations for drawing the lifts on a separate thread from the simulation.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "shaft.h"
+
+/** A render thread and the copies of the building it draws from. The simulation
+ *  fills 'back', which is then swapped with 'ready'; the render thread swaps
+ *  'ready' with 'front' when it wants a new frame and draws 'front' at its leisure.
+ *  A frame that is replaced in 'ready' before the render thread takes it is dropped.
+ */
+typedef struct {
+    Shaft **back;           //!< The copy the simulation is filling.
+    Shaft **ready;          //!< The latest complete copy, waiting to be drawn.
+    Shaft **front;          //!< The copy the render thread is drawing.
+    long backtick;          //!< The update 'back' was copied after.
+    long readytick;         //!< The update 'ready' was copied after.
+    long fronttick;         //!< The update 'front' was copied after.
+    int shaftcount;         //!< The number of shafts in each copy.
+    int fresh;              //!< true if 'ready' has not been drawn yet.
+    int running;            //!< Cleared to stop the render thread.
+    long interval;          //!< Minimum time between frames, in microseconds.
+    long drawn;             //!< Frames drawn.
+    long dropped;           //!< Frames replaced before they could be drawn.
+    pthread_mutex_t lock;   //!< Protects the swaps and the counters.
+    pthread_cond_t wake;    //!< Signalled when a new frame is ready.
+    pthread_t thread;       //!< The render thread.
+} Renderer;
+
+Renderer *start_renderer(Shaft **shafts, int shaftcount, int fps);
+void submit_frame(Renderer *renderer, Shaft **shafts, long tick);
+void stop_renderer(Renderer *renderer);
+void run_rendered(Shaft **shafts, int shaftcount, int topfloor, long ticks, int fps, uint64_t seed);
+
+#endif
@@ -25,18 +25,17 @@
 #include <string.h>
 #include <math.h>
 #include "shaft.h"
-
-// Include a header needed for the print_shafts function if compiling on windows
-#ifdef _WIN32
-    #include <windows.h>
-#endif
+#include "shaftcall.h"
+#include "liftfsm.h"
+#include "viewport.h"
+#include "notify.h"
+#include "profile.h"
 
 
 /* ============================================================================ *
  * Prototypes for functions only visible within this file                       *
  * ============================================================================ */
 
-static const char *get_section(Shaft *shaft, int section);
 static Lift *get_car(Shaft *shaft);
 
 
@@ -54,14 +53,47 @@ static Lift *get_car(Shaft *shaft);
  *  \param direction  The direction the caller wants to go in.
  */
 void call_lift(Shaft **shafts, int shaftcount, int tofloor, Moving direction)
+{
+    int shaftnum = choose_lift(shafts, shaftcount, tofloor, direction);
+    int i, out_of_service = 0;
+
+    // Obtain the car for the selected shaft, and set a call at tofloor in it
+    if(shaftnum != -1) {
+        set_stop(shafts[shaftnum]->car, tofloor);
+        return;
+    }
+
+    // If no shaft was chosen something has gone Badly Wrong, unless every lift is out
+    // of service - then the call can't go anywhere until one comes back, and whoever
+    // took them out has to make it again
+    for(i=0; i<shaftcount; i++) {
+        if(get_state(shafts[i]->car) == STATE_OUT_OF_SERVICE) {
+            ++out_of_service;
+        }
+    }
+    if(out_of_service < shaftcount){
+        printf("/nSomething has gone badly wrong!");
+    }
+}
+
+
+/** Choose the lift call_lift() gives a call to, without setting the stop. Of the
+ *  lifts in service, the one that can service the call easily with the service time
+ *  closest to zero is chosen, and failing that the one with the smallest service time.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'
+ *  \param tofloor    The floor the call was received on.
+ *  \param direction  The direction the caller wants to go in.
+ *  \return The number of the shaft chosen, or -1 if no lift can take the call.
+ */
+int choose_lift(Shaft **shafts, int shaftcount, int tofloor, Moving direction)
 {
     // you will need two variables to return the best positive and negative times,
     // and two variables to keep track of which shafts they correspond to. Set the
     // initial times to insane values (I'd suggest -32767 and 32768 respectively)
     // and set the best shaft numbers to something like -1 to indicate they haven't
     // been set
-    printf ("\n entered call lift. \n");
-    getchar();
     int bestpos_time = 32768;
     int bestneg_time = -32767;
 
@@ -81,6 +113,11 @@ void call_lift(Shaft **shafts, int shaftcount, int tofloor, Moving direction)
 
     for(i=0; i<shaftcount; i++)
     {
+        // A lift out of service can't service anything
+        if(get_state(shafts[i]->car) == STATE_OUT_OF_SERVICE){
+            continue;
+        }
+
         service_time = service_call(shafts[i]->car, tofloor, direction);
         if(service_time < 0 && service_time > bestneg_time){
             bestneg_time = service_time;
@@ -91,24 +128,17 @@ void call_lift(Shaft **shafts, int shaftcount, int tofloor, Moving direction)
             bestpos_shaftnum=i;
         }
     }
+
     // Pick the best shaft to use - if there is a best shaft for the negative time
     // (that is, the best shaft for the negative times is not -1) , use that
     // if there is no best shaft for the negative times, try the positives (for which
-    // there should always be one - if both positive and negative shafts are -1, something
-    // has gone Badly Wrong)
-
-    // Obtain the car for the selected shaft, and set a call at tofloor in it
-
+    // there should always be one - if both positive and negative shafts are -1, no
+    // lift can take the call)
     if(bestneg_shaftnum != -1){
-        set_stop(shafts[bestneg_shaftnum]->car, tofloor);
-    }
-    else if(bestpos_shaftnum != -1)
-    {
-        set_stop(shafts[bestpos_shaftnum]->car, tofloor);
-    }
-    else{
-        printf("/nSomething has gone badly wrong!");
+        return bestneg_shaftnum;
     }
+
+    return bestpos_shaftnum;
 }
 
 
@@ -157,9 +187,6 @@ static Lift *get_car(Shaft *shaft)
  */
 Shaft *create_shaft(int topfloor, int car_speed)
 {
-    char *buffer;
-    int offset;
-
     // allocate a new shaft structure first
     Shaft *newshaft = (Shaft *)malloc(sizeof(Shaft));
     if(!newshaft) {
@@ -167,37 +194,11 @@ Shaft *create_shaft(int topfloor, int car_speed)
         exit(1);
     }
 
-    // And fill in the easy stuff
+    // And fill in the easy stuff. There is nothing else to set up: the display
+    // is worked out from the lift as it is printed (see viewport.c)
     newshaft -> car = create_lift(topfloor, car_speed);
     newshaft -> topfloor = topfloor;
 
-    // What follows is a complete cheat to reduce memory fragmentation. Do not try
-    // this at home without adult supervision. If this summons one of the Old Gods
-    // of Computing then It's Not My Fault, Honest.
-
-    // First, allocate enough space for all the 3 char + '\0' strings for the shaft
-    // representation
-    buffer = (char *)calloc((FLOOR_HEIGHT * topfloor) + 1, 4 * sizeof(char));
-    if(!buffer) {
-        fprintf(stderr, "Unable to allocate floorrep buffer.\n");
-        free(newshaft);
-        exit(1);
-    }
-
-    // Now allocate enough space for pointer for each step
-    newshaft -> floorrep = (char **)malloc(((FLOOR_HEIGHT * topfloor) + 1) * sizeof(char *));
-    if(!newshaft -> floorrep) {
-        fprintf(stderr, "Unable to allocate floorrep pointer array\n");
-        free(newshaft);
-        free(buffer);
-        exit(1);
-    }
-
-    // now set up pointers into the buffer
-    for(offset = 0; offset <= (FLOOR_HEIGHT * topfloor); ++offset) {
-        newshaft -> floorrep[offset] = buffer + (offset * 4); // 3 characters, plus '\0'
-    }
-
     return newshaft;
 }
 
@@ -209,13 +210,7 @@ Shaft *create_shaft(int topfloor, int car_speed)
  */
 void free_shaft(Shaft *release)
 {
-    // the first floorrep pointer is a pointer to the whole string block ('buffer' in create_shaft)
-    free(release -> floorrep[0]);
-
-    // Now release the pointers into the string block
-    free(release -> floorrep);
-
-    // And now the lift...
+    // The lift first...
     free_lift(release -> car);
 
     // ... finally, the shaft itself
@@ -223,145 +218,25 @@ void free_shaft(Shaft *release)
 }
 
 
-/** Obtain a section of a shaft's floor representation array. This will return a pointer to a
- *  3 character string that represents the shaft at the specified level.
- *
- *  \param shaft   The shaft to obtain the section from.
- *  \param section The section number to return, must be in the range 0 to topfloor*FLOOR_HEIGHT inclusive.
- *  \return A pointer to the string representing the shaft at the specified level.
- */
-static const char *get_section(Shaft *shaft, int section)
-{
-    // If the section requested is over the top of the lift, return a 'no shaft' string
-    if(section > ((shaft -> topfloor * FLOOR_HEIGHT) + 1)) {
-        return "###";
-    }
-
-    return shaft -> floorrep[section];
-}
-
-
-/** Fill in the string representation of the specified shaft. Each shaft has its
- *  own 'floorrep' array which stores a string representation of each level in the
- *  shaft. This function fills in that array with the current status of the shaft.
- *
- *  \param current  The shaft to generate the string representation for.
- */
-static void shaft_to_string(Shaft *current)
-{
-    int floorpos;
-
-    // First, fill in the floor representation array with the 'normal' building info
-    for(floorpos = 0; floorpos <= (FLOOR_HEIGHT * current -> topfloor); ++floorpos) {
-        if((floorpos % FLOOR_HEIGHT == 0) && get_car(current) -> stops[floorpos / FLOOR_HEIGHT]) {
-            strcpy(current -> floorrep[floorpos], "|!|");
-        } else {
-            strcpy(current -> floorrep[floorpos], "| |");
-        }
-    }
-
-    // Now work out where the lift should be...
-    int liftpos = get_position(current -> car);
-    strcpy(current -> floorrep[liftpos], lift_to_string(current -> car));
-}
-
-
-/** Print out the shaft representations for the specified shafts. This will attempt
- *  to clear the terminal prior to printing out the shafts, and provision has been
- *  made for Windows terminals (which do not support the standard methods of clearing
- *  terminals). This code contains some OS-specific Magic which you are not expected
- *  to understand, or even read closely - feel free to treat this function as a
- *  black box.
+/** Print out the shaft representations for the specified shafts. This will clear
+ *  the terminal and print every floor of every shaft; see print_viewport() for
+ *  printing just part of a building that is too big for the terminal.
  *
  *  \param shafts A pointer to a block of memory containing pointers to Shaft structures.
  *  \param shaftcount The number of shaft pointers in shafts.
  */
 void print_shafts(Shaft **shafts, int shaftcount)
 {
-    int shaftnum, floornum, floorpos;
-    int maxfloors = 0;
-
-    // start by determining how many lines we need to output. In theory, all the
-    // shafts will be the same height, but it's best to be certain...
-    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
-        if(shafts[shaftnum] -> topfloor > maxfloors) {
-            maxfloors = shafts[shaftnum] -> topfloor;
-        }
-
-        // may as well make the string representations while we're here
-        shaft_to_string(shafts[shaftnum]);
-    }
-
-    // Now we need to clear the lift display area
-
-#ifndef _WIN32  // If we're not compiling on windows...
-    // This incantation clears the terminal, and moves the cursor to the top left
-    // It should work on any Remotely Sane terminal that understands ANSI
-    printf("\033[2J\033[H");
-
-#else // otherwise, we are on windows...
-    // So does this mess, the equivalent for windows (windows command terminals do
-    // not support ANSI or VT100 escape code sequences, and operations that would
-    // be performed via them on other operating systems must be done directly via
-    // the Windows API.)
-
-    // A bunch of variables first...
-    HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
-    COORD coord = {0, 0};
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    DWORD count;
-    DWORD written;
-
-    // How many characters are there in the console?
-    GetConsoleScreenBufferInfo(handle, &csbi);
-    count = csbi.dwSize.X * csbi.dwSize.Y;
-
-    // Now clear that many characters.
-    // WARNING: This code is Full Of Spiders. You are not required or expected to
-    // know what this is doing, and in fact your sanity is safter if you do not
-    // attempt to.
-    FillConsoleOutputCharacter(handle, ' ', count, coord, &written);
-    GetConsoleScreenBufferInfo(handle, &csbi );
-    FillConsoleOutputAttribute(handle, csbi.wAttributes, count, coord, &written);
-    SetConsoleCursorPosition(handle, coord);
-#endif
-
-    // Now we get to the actual printing out part
-
-    // Header first, showing shaft numbers...
-    printf("    ");
-    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
-        printf("%d   ", shaftnum);
-    }
-    printf("\n");
-
-    // Now we want to print out. Remember that 0 is at the bottom of the terminal, not
-    // at the top!
-    for(floorpos = (FLOOR_HEIGHT * maxfloors); floorpos >= 0; -- floorpos) {
-        // If the current position corresponds to a floor, print out a floor number
-        if(floorpos % FLOOR_HEIGHT == 0) {
-            floornum = floorpos / FLOOR_HEIGHT;
-            printf("%2d ", floornum);
-
-        // Otherwise print out a bunch of spaces to align the rest of the line
-        } else {
-            printf("   ");
-        }
-
-        // Go through each shaft we have been supplied with printing out the shaft
-        // representation for the current level.
-        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
-            printf("%s ", get_section(shafts[shaftnum], floorpos));
-        }
-        printf("\n");
-    }
+    Viewport view;
 
+    full_viewport(&view, shafts, shaftcount);
+    print_viewport(shafts, shaftcount, &view);
 }
 
 
 /** Prompt the user to enter a call floor, or to press return to contine. This will
  *  return the floor number the user requested, or NO_STOPS if the user just pressed
- *  the return key without entering anything.
+ *  the return key without entering anything, or the input ended or was interrupted.
  *
  *  \param topfloor The top floor that lifts can service.
  *  \return The floor number a call has been made on, or NO_STOPS if no calls are made.
@@ -375,8 +250,11 @@ int request_call(int topfloor)
 
     // loop forever (the returns will break us out of this...)
     while(1) {
-        // Wait for input from the user
-        fgets(promptbuff, 10, stdin);
+        // Wait for input from the user; there is no call if the input has ended, or
+        // a signal interrupted the wait
+        if(!fgets(promptbuff, 10, stdin)) {
+            return NO_STOPS;
+        }
         // Does the string contain a number?
         if(string_to_int(promptbuff, &request)) {
             // Is the number in range?
@@ -403,7 +281,8 @@ int request_call(int topfloor)
  *  \param topfloor   The top floor the lift may stop at.
  *  \return DIR_UP if the user selects an up call (or the lift is at the bottom of the shaft,
  *          forcing and up call), or DIR_DOWN if the user selects a down call (or the lift is
- *          at the top of the shaft.)
+ *          at the top of the shaft.) DIR_NONE if the input ended, or was interrupted, before
+ *          a direction was given.
  */
 Moving request_direction(int call_floor, int topfloor)
 {
@@ -422,7 +301,9 @@ Moving request_direction(int call_floor, int topfloor)
     printf("Enter a lift direction for the call [U/D]: ");
     // Otherwise, request a direction
     while(1) {
-        fgets(promptbuffer, 2, stdin);
+        if(!fgets(promptbuffer, 2, stdin)) {
+            return DIR_NONE;
+        }
 
         if(toupper(promptbuffer[0]) == 'U') {
             return DIR_UP;
@@ -451,6 +332,7 @@ void prompt_user(Shaft **shafts, int shaftcount, int topfloor)
 {
     int shaftnum;
     int request;
+    Moving direction;
 
     // Start by checking whether any lifts are open
     for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
@@ -458,14 +340,23 @@ void prompt_user(Shaft **shafts, int shaftcount, int topfloor)
             request = request_stop(get_car(shafts[shaftnum]), shaftnum);
 
             if(request != NO_STOPS) {
+                uint64_t begin = profile_begin();
+
                 set_stop(get_car(shafts[shaftnum]), request);
+                profile_end(PHASE_DISPATCH, begin);
+                notify_stop(shaftnum, request);
             }
         }
     }
 
     // Now, ask for calls...
+    // (a call with no direction means the input ended before one was given)
     request = request_call(topfloor);
-    if(request != NO_STOPS) {
-        call_lift(shafts, shaftcount, request, request_direction(request, topfloor));
+    if(request != NO_STOPS && (direction = request_direction(request, topfloor)) != DIR_NONE) {
+        uint64_t begin = profile_begin();
+
+        call_lift(shafts, shaftcount, request, direction);
+        profile_end(PHASE_DISPATCH, begin);
+        notify_call(request, direction);
     }
 }
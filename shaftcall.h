@@ -0,0 +1,15 @@
+/** \file shaftcall.h
+ *  Declarations for the parts of the lift shafts in shaft.c that go beyond the
+ *  interface in shaft.h.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef SHAFTCALL_H
+#define SHAFTCALL_H
+
+#include "shaft.h"
+
+int choose_lift(Shaft **shafts, int shaftcount, int tofloor, Moving direction);
+
+#endif
@@ -0,0 +1,231 @@
+/** \file snapshot.c
+ *  This file contains building snapshots. Trying out a decision by running the
+ *  building forward needs a copy of the building to run, and a building made with
+ *  create_shaft() is two allocations per shaft, plus an array of pointers to
+ *  them; copying it that way is too slow to do for every lift, for every call.
+ *
+ *  A snapshot keeps the same structures in one flat block instead:
+ *
+ *      Snapshot | Shaft *[shaftcount] | Shaft[shaftcount] | Lift[shaftcount] | stops
+ *
+ *  with each lift's topfloor + 1 stop markers one after another at the end. Each
+ *  part is a whole number of pointer-sized words, so every part is aligned. The
+ *  only pointers in the block point into the block itself, so forking a snapshot
+ *  is one memcpy() followed by pointing them at the new copy - and into a
+ *  snapshot that already exists, not even an allocation.
+ *
+ *  Snapshots don't print or exit on failure; functions that allocate return NULL,
+ *  and the caller decides what to do.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static size_t stops_offset(int shaftcount);
+static void link_snapshot(Snapshot *snap);
+
+
+/* ============================================================================ *
+ * Taking snapshots                                                             *
+ * ============================================================================ */
+
+/** Work out how big a snapshot of a building is.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \return The size of the snapshot in bytes.
+ */
+size_t snapshot_size(Shaft **shafts, int shaftcount)
+{
+    size_t size = stops_offset(shaftcount);
+    int shaftnum;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        size += get_topfloor(shafts[shaftnum] -> car) + 1;
+    }
+
+    return size;
+}
+
+
+/** Take a snapshot of a building.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \return A pointer to the new snapshot, or NULL if there is not enough memory.
+ */
+Snapshot *take_snapshot(Shaft **shafts, int shaftcount)
+{
+    size_t size = snapshot_size(shafts, shaftcount);
+    Snapshot *snap = (Snapshot *)malloc(size);
+
+    if(!snap) {
+        return NULL;
+    }
+
+    snap -> size = size;
+    snap -> shaftcount = shaftcount;
+    capture_snapshot(snap, shafts, shaftcount);
+
+    return snap;
+}
+
+
+/** Copy a building into a snapshot that was taken of it earlier, replacing what
+ *  the snapshot held. This allocates nothing, so is the cheapest way to keep a
+ *  snapshot up to date with the building.
+ *
+ *  \param snap       The snapshot to copy into.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \return true if the building was copied, false if it has a different number
+ *          of shafts or floors from the one the snapshot was taken of.
+ */
+int capture_snapshot(Snapshot *snap, Shaft **shafts, int shaftcount)
+{
+    char *base = (char *)snap;
+    Shaft *shaft = (Shaft *)(base + sizeof(Snapshot) + shaftcount * sizeof(Shaft *));
+    Lift *car = (Lift *)(shaft + shaftcount);
+    char *stops = base + stops_offset(shaftcount);
+    int shaftnum;
+
+    if(shaftcount != snap -> shaftcount || snapshot_size(shafts, shaftcount) != snap -> size) {
+        return 0;
+    }
+
+    snap -> ticks = 0;
+    snap -> shafts = (Shaft **)(base + sizeof(Snapshot));
+
+    // Laid out as link_snapshot() expects, but using the building's top floors, as
+    // the snapshot's may not have been filled in yet
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum, ++shaft, ++car) {
+        *shaft = *shafts[shaftnum];
+        *car = *shafts[shaftnum] -> car;
+        memcpy(stops, car -> stops, get_topfloor(car) + 1);
+
+        snap -> shafts[shaftnum] = shaft;
+        shaft -> car = car;
+        car -> stops = stops;
+        stops += get_topfloor(car) + 1;
+    }
+
+    return 1;
+}
+
+
+/* ============================================================================ *
+ * Forking snapshots                                                            *
+ * ============================================================================ */
+
+/** Make a new copy of a snapshot, which can be run without changing the original.
+ *
+ *  \param from The snapshot to copy.
+ *  \return A pointer to the copy, or NULL if there is not enough memory.
+ */
+Snapshot *fork_snapshot(const Snapshot *from)
+{
+    Snapshot *snap = (Snapshot *)malloc(from -> size);
+
+    if(snap) {
+        memcpy(snap, from, from -> size);
+        link_snapshot(snap);
+    }
+
+    return snap;
+}
+
+
+/** Copy one snapshot over another of the same building, so that the same space
+ *  can be used for fork after fork.
+ *
+ *  \param to   The snapshot to overwrite.
+ *  \param from The snapshot to copy.
+ *  \return true if it was copied, false if the snapshots are of different buildings.
+ */
+int copy_snapshot(Snapshot *to, const Snapshot *from)
+{
+    if(to -> size != from -> size || to -> shaftcount != from -> shaftcount) {
+        return 0;
+    }
+
+    memcpy(to, from, from -> size);
+    link_snapshot(to);
+
+    return 1;
+}
+
+
+/** Run the lifts in a snapshot forward. Nothing outside the snapshot is told
+ *  about it, except for faults (see update_lift()).
+ *
+ *  \param snap  The snapshot to run.
+ *  \param ticks The number of updates to run it for.
+ */
+void run_snapshot(Snapshot *snap, long ticks)
+{
+    long tick;
+
+    for(tick = 0; tick < ticks; ++tick) {
+        update_shafts(snap -> shafts, snap -> shaftcount);
+    }
+
+    snap -> ticks += ticks;
+}
+
+
+/** Release the memory used by a snapshot.
+ *
+ *  \param snap The snapshot to free.
+ */
+void free_snapshot(Snapshot *snap)
+{
+    free(snap);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Work out where the stop markers start in a snapshot.
+ *
+ *  \param shaftcount The number of shafts in the snapshot.
+ *  \return The offset of the first stop marker from the start of the block.
+ */
+static size_t stops_offset(int shaftcount)
+{
+    return sizeof(Snapshot) + shaftcount * (sizeof(Shaft *) + sizeof(Shaft) + sizeof(Lift));
+}
+
+
+/** Point the pointers in a snapshot at the parts of its own block. Each lift's
+ *  stop markers follow the previous lift's, so the lifts' top floors must already
+ *  be in place, as they are in any snapshot filled in by capture_snapshot().
+ *
+ *  \param snap The snapshot to link up.
+ */
+static void link_snapshot(Snapshot *snap)
+{
+    char *base = (char *)snap;
+    Shaft *shafts = (Shaft *)(base + sizeof(Snapshot) + snap -> shaftcount * sizeof(Shaft *));
+    Lift *cars = (Lift *)(shafts + snap -> shaftcount);
+    char *stops = base + stops_offset(snap -> shaftcount);
+    int shaftnum;
+
+    snap -> shafts = (Shaft **)(base + sizeof(Snapshot));
+
+    for(shaftnum = 0; shaftnum < snap -> shaftcount; ++shaftnum) {
+        snap -> shafts[shaftnum] = &shafts[shaftnum];
+        shafts[shaftnum].car = &cars[shaftnum];
+        cars[shaftnum].stops = stops;
+        stops += cars[shaftnum].topfloor + 1;
+    }
+}
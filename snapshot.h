@@ -0,0 +1,35 @@
+/** \file snapshot.h
+ *  Declarations for building snapshots: a copy of every shaft, lift and stop
+ *  marker in one flat block of memory, which can be forked and run forward on its
+ *  own without touching the building it was taken from.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include "shaft.h"
+
+/** A snapshot of a building. The Snapshot is the start of a single block of
+ *  'size' bytes, which goes on to hold the shaft pointers, the Shafts, the Lifts
+ *  and their stop markers in that order. 'shafts' can be passed to anything that
+ *  takes a building, such as update_shafts() or call_lift().
+ */
+typedef struct {
+    size_t size;        //!< The size of the whole block, this header included.
+    int shaftcount;     //!< The number of shafts.
+    long ticks;         //!< Updates the snapshot has been run for since it was taken.
+    Shaft **shafts;     //!< The copied shafts, inside the block.
+} Snapshot;
+
+size_t snapshot_size(Shaft **shafts, int shaftcount);
+Snapshot *take_snapshot(Shaft **shafts, int shaftcount);
+int capture_snapshot(Snapshot *snap, Shaft **shafts, int shaftcount);
+Snapshot *fork_snapshot(const Snapshot *from);
+int copy_snapshot(Snapshot *to, const Snapshot *from);
+void run_snapshot(Snapshot *snap, long ticks);
+void free_snapshot(Snapshot *snap);
+
+#endif
@@ -0,0 +1,19 @@
+/** \file stops.h
+ *  The meaning of the entries in a Lift's 'stops' array. An entry of 0 is no stop,
+ *  and set_stop() marks a floor with STOP_CAR, which is the 1 it has always used.
+ *  Hall calls placed through the hall call registry use the two direction bits
+ *  instead, and a lift only stops for those when it is going the caller's way
+ *  (or turning round at that floor). Code that only needs to know whether a lift
+ *  has somewhere to go can keep treating any non-zero entry as a stop.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef STOPS_H
+#define STOPS_H
+
+#define STOP_CAR       1  //!< Somebody in the lift wants this floor.
+#define STOP_HALL_UP   2  //!< Somebody on this floor wants to go up.
+#define STOP_HALL_DOWN 4  //!< Somebody on this floor wants to go down.
+
+#endif
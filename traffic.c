@@ -0,0 +1,106 @@
+/** \file traffic.c
+ *  This file contains a small, repeatable traffic generator. It stands in for the
+ *  user at the keyboard: each update it may produce a hall call (a floor and a
+ *  direction, as request_call() and request_direction() would), and it may choose
+ *  a stop for a lift with its doors open (as request_stop() would).
+ *
+ *  The generator uses its own random number generator rather than rand(), so that
+ *  several generators can run side by side and each gives the same sequence for
+ *  the same seed on every platform.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "traffic.h"
+
+
+/** Set up a traffic generator.
+ *
+ *  \param traffic   The generator to initialise.
+ *  \param seed      The seed for the random number generator. Any value may be used.
+ *  \param topfloor  The top floor that calls and stops may be made on.
+ *  \param call_rate The chance of a hall call each update, in calls per 1000 updates.
+ *  \param stop_rate The chance, in percent, that a lift with open doors is given a stop.
+ */
+void init_traffic(Traffic *traffic, uint64_t seed, int topfloor, int call_rate, int stop_rate)
+{
+    // xorshift gets stuck at zero, so mix the seed and make sure it never is
+    traffic -> state = (seed * 0x9E3779B97F4A7C15ULL) | 1;
+    traffic -> topfloor  = topfloor;
+    traffic -> call_rate = call_rate;
+    traffic -> stop_rate = stop_rate;
+}
+
+
+/** Obtain a random number in the range 0 to limit - 1. This is a xorshift64*
+ *  generator, which is fast and more than random enough for passenger traffic.
+ *
+ *  \param traffic The generator to draw the number from.
+ *  \param limit   One more than the largest value that may be returned. Must be positive.
+ *  \return A random number from 0 to limit - 1.
+ */
+int traffic_random(Traffic *traffic, int limit)
+{
+    uint64_t x = traffic -> state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    traffic -> state = x;
+
+    return (int)(((x * 0x2545F4914F6CDD1DULL) >> 33) % (uint64_t)limit);
+}
+
+
+/** Decide whether a hall call is made this update, and if so where. The direction
+ *  follows the same rules as request_direction(): calls on the ground floor always
+ *  go up, and calls on the top floor always go down.
+ *
+ *  \param traffic   The generator to use.
+ *  \param floor     A pointer to an int to store the call floor in.
+ *  \param direction A pointer to a variable to store the call direction in.
+ *  \return true if a call has been made, false if there is no call this update.
+ */
+int next_call(Traffic *traffic, int *floor, Moving *direction)
+{
+    if(traffic_random(traffic, 1000) >= traffic -> call_rate) {
+        return 0;
+    }
+
+    *floor = traffic_random(traffic, traffic -> topfloor + 1);
+
+    if(*floor == 0) {
+        *direction = DIR_UP;
+    } else if(*floor == traffic -> topfloor) {
+        *direction = DIR_DOWN;
+    } else {
+        *direction = traffic_random(traffic, 2) ? DIR_UP : DIR_DOWN;
+    }
+
+    return 1;
+}
+
+
+/** Decide whether a passenger in a lift with open doors asks for a floor. This should
+ *  only be called for lifts in STATE_OPEN. Passengers never ask for the floor they
+ *  are already on.
+ *
+ *  \param traffic The generator to use.
+ *  \param car     The lift with open doors.
+ *  \param floor   A pointer to an int to store the requested floor in.
+ *  \return true if a stop has been requested, false otherwise.
+ */
+int next_stop(Traffic *traffic, Lift *car, int *floor)
+{
+    int here = at_floor(car);
+
+    if(traffic_random(traffic, 100) >= traffic -> stop_rate) {
+        return 0;
+    }
+
+    *floor = traffic_random(traffic, traffic -> topfloor + 1);
+
+    return *floor != here;
+}
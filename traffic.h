@@ -0,0 +1,30 @@
+/** \file traffic.h
+ *  Declarations for the repeatable traffic generator used to drive the simulation
+ *  without a user at the keyboard.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <stdint.h>
+#include "lift.h"
+
+/** The state of a traffic generator. Two generators started with the same seed and
+ *  settings produce exactly the same calls and stops, which is what lets separate
+ *  runs of the simulation be compared.
+ */
+typedef struct {
+    uint64_t state;  //!< Random number generator state, never zero.
+    int topfloor;    //!< The top floor calls and stops may be made on.
+    int call_rate;   //!< The chance of a hall call each update, in calls per 1000 updates.
+    int stop_rate;   //!< The chance, in percent, that an open lift is given a stop.
+} Traffic;
+
+void init_traffic(Traffic *traffic, uint64_t seed, int topfloor, int call_rate, int stop_rate);
+int traffic_random(Traffic *traffic, int limit);
+int next_call(Traffic *traffic, int *floor, Moving *direction);
+int next_stop(Traffic *traffic, Lift *car, int *floor);
+
+#endif
@@ -0,0 +1,651 @@
+/** \file twin.c
+ *  This file contains buildings with two or more lift cars in every shaft, one
+ *  above another, which lets a tall building carry more people without giving up
+ *  more of its floor space to shafts.
+ *
+ *  Each car runs the normal finite state machine in update_lift(). The shaft keeps
+ *  them apart: a car whose move would bring it closer than TWIN_GAP to the next
+ *  car is held where it is for that update. Holding is not enough on its own, as
+ *  two cars can each be waiting for the other to move. So a held car also deals
+ *  with whatever is in its way:
+ *
+ *    - an idle car in the way is sent one floor further off, and will carry on
+ *      being moved away for as long as it is in the way;
+ *    - if the two cars are heading towards each other, one gives way: it is given
+ *      a stop just beyond the other car's furthest stop and sent off to it, and
+ *      turns back once the other car has done what it needs to. The car that has
+ *      been held for fewer updates since it last stopped for a passenger is the
+ *      one to give way (the upper car, if it is a tie). Stopping where it was sent
+ *      doesn't count, so a car with work at the far end of its range can't be
+ *      sent away from it over and over;
+ *    - a car that is opening or closing its doors, or moving away, is waited for.
+ *
+ *  As the cars can never pass, the lowest car can't reach the top floors and the
+ *  highest can't reach the bottom ones. Hall calls are only given to cars that can
+ *  reach the floor, and the time a car would lose waiting for the car in its way
+ *  is added to its estimate, so calls go to cars with a clear run when there is one.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "twin.h"
+#include "hallcall.h"
+#include "traffic.h"
+#include "viewport.h"
+
+// How many floors each car needs to keep clear of the next
+#define TWIN_GAP_FLOORS ((TWIN_GAP + FLOOR_HEIGHT - 1) / FLOOR_HEIGHT)
+
+// The traffic used by run_twins()
+#define TWIN_CALL_RATE 150
+#define TWIN_STOP_RATE 60
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int blocked(TwinShaft *shaft, int carnum);
+static void clear_the_way(TwinBuilding *building, TwinShaft *shaft, int carnum, int blocker);
+static int blocking_cost(TwinShaft *shaft, int carnum, int floor);
+static void send_away(TwinBuilding *building, TwinShaft *shaft, int carnum, int floor, Moving direction);
+static int furthest_stop(Lift *car, Moving direction);
+static void answer_calls(TwinBuilding *building, int shaftnum, int carnum);
+
+
+/* ============================================================================ *
+ * Creating and releasing buildings                                             *
+ * ============================================================================ */
+
+/** Build a building of multi-car shafts. Every car starts idle, as low down as it
+ *  can go: car 0 on the ground floor, car 1 above it, and so on.
+ *
+ *  \param shaftcount The number of shafts.
+ *  \param carcount   The number of cars in each shaft.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of every car.
+ *  \return A pointer to the new building, or NULL if the shafts are too short for
+ *          that many cars.
+ */
+TwinBuilding *create_twins(int shaftcount, int carcount, int topfloor, int speed)
+{
+    TwinBuilding *building;
+    int shaftnum, carnum;
+
+    if(carcount < 1 || (carcount - 1) * TWIN_GAP_FLOORS > topfloor) {
+        fprintf(stderr, "A shaft with %d floors can not hold %d cars.\n", topfloor + 1, carcount);
+        return NULL;
+    }
+
+    building = (TwinBuilding *)calloc(1, sizeof(TwinBuilding));
+    if(building) {
+        building -> shafts   = (TwinShaft *)calloc(shaftcount, sizeof(TwinShaft));
+        building -> made     = (long *)malloc((topfloor + 1) * 2 * sizeof(long));
+        building -> assigned = (int *)malloc((topfloor + 1) * 2 * sizeof(int));
+    }
+    if(!building || !building -> shafts || !building -> made || !building -> assigned) {
+        fprintf(stderr, "Unable to allocate space for a building of multi-car shafts.\n");
+        exit(1);
+    }
+
+    building -> shaftcount = shaftcount;
+    building -> carcount   = carcount;
+    building -> topfloor   = topfloor;
+    building -> closest    = INT_MAX;
+
+    for(shaftnum = 0; shaftnum < (topfloor + 1) * 2; ++shaftnum) {
+        building -> made[shaftnum]     = NO_CALL;
+        building -> assigned[shaftnum] = NO_CAR;
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        TwinShaft *shaft = &building -> shafts[shaftnum];
+
+        shaft -> carcount = carcount;
+        shaft -> topfloor = topfloor;
+        shaft -> cars   = (Lift **)malloc(carcount * sizeof(Lift *));
+        shaft -> held   = (long *)calloc(carcount, sizeof(long));
+        shaft -> sentto = (int *)malloc(carcount * sizeof(int));
+        if(!shaft -> cars || !shaft -> held || !shaft -> sentto) {
+            fprintf(stderr, "Unable to allocate space for the cars in a shaft.\n");
+            exit(1);
+        }
+
+        for(carnum = 0; carnum < carcount; ++carnum) {
+            shaft -> cars[carnum] = create_lift(topfloor, speed);
+            set_position(shaft -> cars[carnum], twin_lowest_floor(building, carnum) * FLOOR_HEIGHT);
+            shaft -> sentto[carnum] = NO_STOPS;
+        }
+    }
+
+    return building;
+}
+
+
+/** Release a building created by create_twins(), and all of its cars.
+ *
+ *  \param building The building to free.
+ */
+void free_twins(TwinBuilding *building)
+{
+    int shaftnum, carnum;
+
+    for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+        for(carnum = 0; carnum < building -> carcount; ++carnum) {
+            free_lift(building -> shafts[shaftnum].cars[carnum]);
+        }
+        free(building -> shafts[shaftnum].cars);
+        free(building -> shafts[shaftnum].held);
+        free(building -> shafts[shaftnum].sentto);
+    }
+
+    free(building -> assigned);
+    free(building -> made);
+    free(building -> shafts);
+    free(building);
+}
+
+
+/** Work out the lowest floor a car can reach, leaving room for the cars below it.
+ *  This only depends on the car's place in the shaft; the building is taken so
+ *  that it matches twin_highest_floor().
+ *
+ *  \param building The building the car is in.
+ *  \param car      The number of the car in its shaft, 0 for the lowest.
+ *  \return The lowest floor the car can stop at.
+ */
+int twin_lowest_floor(TwinBuilding *building, int car)
+{
+    (void)building;
+
+    return car * TWIN_GAP_FLOORS;
+}
+
+
+/** Work out the highest floor a car can reach, leaving room for the cars above it.
+ *
+ *  \param building The building the car is in.
+ *  \param car      The number of the car in its shaft, 0 for the lowest.
+ *  \return The highest floor the car can stop at.
+ */
+int twin_highest_floor(TwinBuilding *building, int car)
+{
+    return building -> topfloor - ((building -> carcount - 1 - car) * TWIN_GAP_FLOORS);
+}
+
+
+/* ============================================================================ *
+ * Calls and stops                                                              *
+ * ============================================================================ */
+
+/** Make a hall call, and give it to the car that can answer it soonest. A car's
+ *  estimate is hall_eta() plus the time it would spend waiting for the car in its
+ *  way, and only cars that can reach the floor are considered. A call already
+ *  waiting on that floor in that direction is left with the car it was given to.
+ *
+ *  \param building  The building the call is made in.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ *  \return true if the call is waiting for a car, false if no car can reach the floor.
+ */
+int twin_call(TwinBuilding *building, int floor, Moving direction)
+{
+    int index = (floor * 2) + (direction == DIR_DOWN);
+    int best = NO_CAR, bestcost = INT_MAX;
+    int shaftnum, carnum, cost;
+
+    if(building -> made[index] != NO_CALL) {
+        return 1;
+    }
+
+    for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+        TwinShaft *shaft = &building -> shafts[shaftnum];
+
+        for(carnum = 0; carnum < shaft -> carcount; ++carnum) {
+            if(floor < twin_lowest_floor(building, carnum) || floor > twin_highest_floor(building, carnum)) {
+                continue;
+            }
+
+            cost = hall_eta(shaft -> cars[carnum], floor, direction) + blocking_cost(shaft, carnum, floor);
+            if(cost < bestcost) {
+                bestcost = cost;
+                best = (shaftnum * building -> carcount) + carnum;
+            }
+        }
+    }
+
+    if(best == NO_CAR) {
+        return 0;
+    }
+
+    set_stop(building -> shafts[best / building -> carcount].cars[best % building -> carcount], floor);
+    building -> made[index]     = building -> now;
+    building -> assigned[index] = best;
+    ++building -> calls;
+
+    return 1;
+}
+
+
+/** Set a stop for one car, as a passenger in it would. Cars can only be sent to
+ *  floors they can reach.
+ *
+ *  \param building The building the car is in.
+ *  \param shaftnum The shaft the car is in.
+ *  \param car      The number of the car in its shaft.
+ *  \param floor    The floor to stop at.
+ *  \return true if the stop was set, false if the car can not reach the floor.
+ */
+int twin_stop(TwinBuilding *building, int shaftnum, int car, int floor)
+{
+    if(floor < twin_lowest_floor(building, car) || floor > twin_highest_floor(building, car)) {
+        return 0;
+    }
+
+    set_stop(building -> shafts[shaftnum].cars[car], floor);
+    return 1;
+}
+
+
+/** Estimate how long a car would spend waiting for the cars beyond it to get out
+ *  of its way on the way to a floor. The next car along has to finish any stops
+ *  it has in the way and then move far enough to leave room, which may mean the
+ *  car beyond that has to move too, and so on.
+ *
+ *  \param shaft  The shaft the car is in.
+ *  \param carnum The car that would answer the call.
+ *  \param floor  The floor of the call.
+ *  \return The estimated number of updates lost.
+ */
+static int blocking_cost(TwinShaft *shaft, int carnum, int floor)
+{
+    int target = floor * FLOOR_HEIGHT;
+    int step, other, clear, inway, stop, cost = 0;
+    Lift *next;
+
+    if(target == get_position(shaft -> cars[carnum])) {
+        return 0;
+    }
+
+    // The car is only ever blocked by the cars on the side it is heading for
+    step  = (target > get_position(shaft -> cars[carnum])) ? 1 : -1;
+    clear = target;
+
+    for(other = carnum + step; other >= 0 && other < shaft -> carcount; other += step) {
+        next = shaft -> cars[other];
+
+        // Where this car has to get to, and how far it is from there
+        clear += step * TWIN_GAP;
+        inway = (clear - get_position(next)) * step;
+        if(inway <= 0) {
+            break;
+        }
+
+        // Its stops in the way come first
+        for(stop = 0; stop <= shaft -> topfloor; ++stop) {
+            if(next -> stops[stop] && ((stop * FLOOR_HEIGHT) - clear) * step < 0) {
+                cost += STOP_OVERHEAD;
+            }
+        }
+
+        // A car coming the other way has to stop and turn round first
+        if(get_direction(next) == ((step > 0) ? DIR_DOWN : DIR_UP)) {
+            cost += STOP_OVERHEAD;
+        }
+
+        cost += inway / get_speed(next);
+    }
+
+    return cost;
+}
+
+
+/* ============================================================================ *
+ * Updating                                                                     *
+ * ============================================================================ */
+
+/** Update every car in a building once. Each car goes through update_lift(), but
+ *  a car whose move would take it too close to the next car in its shaft is put
+ *  back where it was, and the car in its way is dealt with as described at the top
+ *  of this file.
+ *
+ *  \param building The building to update.
+ */
+void update_twins(TwinBuilding *building)
+{
+    int shaftnum, carnum, before, blocker, gap;
+    State wasstate;
+
+    ++building -> now;
+
+    for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+        TwinShaft *shaft = &building -> shafts[shaftnum];
+
+        for(carnum = 0; carnum < shaft -> carcount; ++carnum) {
+            Lift *car = shaft -> cars[carnum];
+
+            before   = get_position(car);
+            wasstate = get_state(car);
+            update_lift(car);
+
+            if((blocker = blocked(shaft, carnum)) != NO_CAR) {
+                set_position(car, before);
+                ++building -> held;
+                ++shaft -> held[carnum];
+                clear_the_way(building, shaft, carnum, blocker);
+            }
+
+            if(wasstate != STATE_OPENING && get_state(car) == STATE_OPENING) {
+                answer_calls(building, shaftnum, carnum);
+
+                // Only stopping for somebody counts as getting somewhere
+                if(at_floor(car) == shaft -> sentto[carnum]) {
+                    shaft -> sentto[carnum] = NO_STOPS;
+                } else {
+                    shaft -> held[carnum] = 0;
+                }
+            }
+        }
+
+        for(carnum = 1; carnum < shaft -> carcount; ++carnum) {
+            gap = get_position(shaft -> cars[carnum]) - get_position(shaft -> cars[carnum - 1]);
+            if(gap < building -> closest) {
+                building -> closest = gap;
+            }
+        }
+    }
+}
+
+
+/** Check whether a car has come too close to either of its neighbours.
+ *
+ *  \param shaft  The shaft the car is in.
+ *  \param carnum The car to check.
+ *  \return The number of the car it is too close to, or NO_CAR if it is clear.
+ */
+static int blocked(TwinShaft *shaft, int carnum)
+{
+    int position = get_position(shaft -> cars[carnum]);
+
+    if(carnum > 0 && position - get_position(shaft -> cars[carnum - 1]) < TWIN_GAP) {
+        return carnum - 1;
+    }
+    if(carnum < shaft -> carcount - 1 && get_position(shaft -> cars[carnum + 1]) - position < TWIN_GAP) {
+        return carnum + 1;
+    }
+
+    return NO_CAR;
+}
+
+
+/** Deal with the car in the way of a held car: move it on if it is idle, or if
+ *  the two cars are heading for each other, send one of them off out of the way.
+ *
+ *  \param building The building the cars are in.
+ *  \param shaft    The shaft the cars are in.
+ *  \param carnum   The car that was held.
+ *  \param blocker  The car in its way.
+ */
+static void clear_the_way(TwinBuilding *building, TwinShaft *shaft, int carnum, int blocker)
+{
+    Lift *other = shaft -> cars[blocker];
+    Moving away = (blocker > carnum) ? DIR_UP : DIR_DOWN;
+    int upper = (blocker > carnum) ? blocker : carnum;
+    int lower = upper - 1;
+    int floor;
+
+    if(get_state(other) == STATE_IDLE) {
+        // Nudge it a floor further off; it gets nudged again if that isn't enough
+        floor = at_floor(other) + ((away == DIR_UP) ? TWIN_GAP_FLOORS : -TWIN_GAP_FLOORS);
+        if(floor >= twin_lowest_floor(building, blocker) && floor <= twin_highest_floor(building, blocker)) {
+            set_stop(other, floor);
+            ++building -> yields;
+        }
+    } else if(get_state(other) == STATE_MOVING && get_direction(other) != away &&
+              get_direction(shaft -> cars[lower]) == DIR_UP && get_direction(shaft -> cars[upper]) == DIR_DOWN) {
+        // Head on: one car backs off past everything the other has to do
+        if(shaft -> held[upper] <= shaft -> held[lower]) {
+            send_away(building, shaft, upper, furthest_stop(shaft -> cars[lower], DIR_UP) + TWIN_GAP_FLOORS, DIR_UP);
+        } else {
+            send_away(building, shaft, lower, furthest_stop(shaft -> cars[upper], DIR_DOWN) - TWIN_GAP_FLOORS, DIR_DOWN);
+        }
+    }
+}
+
+
+/** Send a car off to a floor out of the way of the car behind it. Any cars beyond
+ *  it that would then be in its way are sent further off in turn, or the car could
+ *  find itself meeting another head on and be turned straight back.
+ *
+ *  \param building  The building the cars are in.
+ *  \param shaft     The shaft the cars are in.
+ *  \param carnum    The car to send away.
+ *  \param floor     The floor to send it to, which is kept within its reach.
+ *  \param direction The way to send it, DIR_UP or DIR_DOWN.
+ */
+static void send_away(TwinBuilding *building, TwinShaft *shaft, int carnum, int floor, Moving direction)
+{
+    int step = (direction == DIR_UP) ? 1 : -1;
+    Moving towards = (direction == DIR_UP) ? DIR_DOWN : DIR_UP;
+    Lift *next;
+
+    while(1) {
+        if(floor > twin_highest_floor(building, carnum)) {
+            floor = twin_highest_floor(building, carnum);
+        }
+        if(floor < twin_lowest_floor(building, carnum)) {
+            floor = twin_lowest_floor(building, carnum);
+        }
+
+        set_stop(shaft -> cars[carnum], floor);
+        set_direction(shaft -> cars[carnum], direction);
+        shaft -> sentto[carnum] = floor;
+        ++building -> yields;
+
+        // The next car along only has to go too if it is coming this way, or is too close
+        carnum += step;
+        floor  += step * TWIN_GAP_FLOORS;
+        if(carnum < 0 || carnum >= shaft -> carcount) {
+            break;
+        }
+
+        next = shaft -> cars[carnum];
+        if(get_direction(next) != towards && (get_position(next) - (floor * FLOOR_HEIGHT)) * step >= 0) {
+            break;
+        }
+    }
+}
+
+
+/** Find the furthest stop a car has in a direction, counting its current position.
+ *
+ *  \param car       The car to inspect.
+ *  \param direction DIR_UP to look for the highest stop, DIR_DOWN for the lowest.
+ *  \return The floor of the furthest stop, or the floor the car is at (rounded
+ *          towards 'direction') if it has none that way.
+ */
+static int furthest_stop(Lift *car, Moving direction)
+{
+    int position = get_position(car);
+    int floor;
+
+    if(direction == DIR_UP) {
+        for(floor = get_topfloor(car); floor * FLOOR_HEIGHT > position; --floor) {
+            if(car -> stops[floor]) {
+                return floor;
+            }
+        }
+        return (position + FLOOR_HEIGHT - 1) / FLOOR_HEIGHT;
+    }
+
+    for(floor = 0; floor * FLOOR_HEIGHT < position; ++floor) {
+        if(car -> stops[floor]) {
+            return floor;
+        }
+    }
+    return position / FLOOR_HEIGHT;
+}
+
+
+/** Mark the hall calls given to a car as answered when it opens its doors at
+ *  their floor.
+ *
+ *  \param building The building the car is in.
+ *  \param shaftnum The shaft the car is in.
+ *  \param carnum   The car that has just started opening.
+ */
+static void answer_calls(TwinBuilding *building, int shaftnum, int carnum)
+{
+    int floor = at_floor(building -> shafts[shaftnum].cars[carnum]);
+    int id = (shaftnum * building -> carcount) + carnum;
+    int index;
+    long wait;
+
+    for(index = floor * 2; index <= (floor * 2) + 1; ++index) {
+        if(building -> made[index] != NO_CALL && building -> assigned[index] == id) {
+            wait = building -> now - building -> made[index];
+
+            ++building -> answered;
+            building -> total_wait += wait;
+            if(wait > building -> longest_wait) {
+                building -> longest_wait = wait;
+            }
+
+            building -> made[index]     = NO_CALL;
+            building -> assigned[index] = NO_CAR;
+        }
+    }
+}
+
+
+/* ============================================================================ *
+ * Display and headless runs                                                    *
+ * ============================================================================ */
+
+/** Clear the terminal and draw the whole building, with every car in each shaft
+ *  drawn in the shaft's column. A floor is marked with a stop if any car in the
+ *  shaft is due to stop there.
+ *
+ *  \param building The building to draw.
+ */
+void print_twins(TwinBuilding *building)
+{
+    int width = snprintf(NULL, 0, "%d", building -> topfloor) + 1;
+    int shaftnum, carnum, floorpos;
+    const char *section;
+
+    clear_terminal();
+
+    printf("%*s", width + 1, "");
+    for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+        printf("%-4d", shaftnum);
+    }
+    printf("\n");
+
+    for(floorpos = building -> topfloor * FLOOR_HEIGHT; floorpos >= 0; --floorpos) {
+        if(floorpos % FLOOR_HEIGHT == 0) {
+            printf("%*d ", width - 1, floorpos / FLOOR_HEIGHT);
+        } else {
+            printf("%*s", width, "");
+        }
+
+        for(shaftnum = 0; shaftnum < building -> shaftcount; ++shaftnum) {
+            TwinShaft *shaft = &building -> shafts[shaftnum];
+
+            section = "| |";
+            for(carnum = 0; carnum < shaft -> carcount; ++carnum) {
+                Lift *car = shaft -> cars[carnum];
+
+                if(get_position(car) == floorpos) {
+                    section = lift_to_string(car);
+                    break;
+                }
+                if(floorpos % FLOOR_HEIGHT == 0 && car -> stops[floorpos / FLOOR_HEIGHT]) {
+                    section = "|!|";
+                }
+            }
+            printf("%s ", section);
+        }
+        printf("\n");
+    }
+}
+
+
+/** Run a building of multi-car shafts without prompting, driven by generated
+ *  traffic, and report how long calls waited and how much the cars got in each
+ *  other's way. Passengers who want a floor their car can't reach are turned away.
+ *
+ *  \param shaftcount The number of shafts.
+ *  \param carcount   The number of cars in each shaft.
+ *  \param topfloor   The top floor of the building.
+ *  \param speed      The speed of every car.
+ *  \param ticks      The number of updates to run for.
+ *  \param fps        If more than 0, draw the building this many times a second.
+ *  \param seed       The seed for the traffic generator.
+ */
+void run_twins(int shaftcount, int carcount, int topfloor, int speed, long ticks, int fps, uint64_t seed)
+{
+    TwinBuilding *building = create_twins(shaftcount, carcount, topfloor, speed);
+    struct timespec frame = { 0, 0 };
+    Traffic traffic;
+    long tick, unreachable = 0, unanswered = 0;
+    int shaftnum, carnum, floor;
+    Moving direction;
+
+    if(!building) {
+        return;
+    }
+
+    if(fps > 0) {
+        frame.tv_sec  = 1 / fps;
+        frame.tv_nsec = (1000000000L / fps) % 1000000000L;
+    }
+
+    init_traffic(&traffic, seed, topfloor, TWIN_CALL_RATE, TWIN_STOP_RATE);
+
+    for(tick = 1; tick <= ticks; ++tick) {
+        update_twins(building);
+
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            for(carnum = 0; carnum < carcount; ++carnum) {
+                Lift *car = building -> shafts[shaftnum].cars[carnum];
+
+                if(get_state(car) == STATE_OPEN && get_time(car) == 0 && next_stop(&traffic, car, &floor) &&
+                   !twin_stop(building, shaftnum, carnum, floor)) {
+                    ++unreachable;
+                }
+            }
+        }
+        if(next_call(&traffic, &floor, &direction)) {
+            twin_call(building, floor, direction);
+        }
+
+        if(fps > 0) {
+            print_twins(building);
+            nanosleep(&frame, NULL);
+        }
+    }
+
+    for(floor = 0; floor < (topfloor + 1) * 2; ++floor) {
+        unanswered += building -> made[floor] != NO_CALL;
+    }
+
+    printf("%d shafts of %d cars, %ld updates\n", shaftcount, carcount, ticks);
+    printf("Calls: %ld made, %ld answered, %ld still waiting\n", building -> calls, building -> answered, unanswered);
+    printf("Wait: mean %.1f updates, longest %ld\n",
+           building -> answered ? (double)building -> total_wait / building -> answered : 0.0,
+           building -> longest_wait);
+    printf("Cars held for the next car %ld times, sent out of the way %ld times\n",
+           building -> held, building -> yields);
+    if(carcount > 1) {
+        printf("Closest two cars came: %d sections (the limit is %d)\n", building -> closest, TWIN_GAP);
+    }
+    printf("Passengers turned away for floors their car can't reach: %ld\n", unreachable);
+
+    free_twins(building);
+}
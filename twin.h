@@ -0,0 +1,62 @@
+/** \file twin.h
+ *  Declarations for buildings with more than one lift car in each shaft.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef TWIN_H
+#define TWIN_H
+
+#include <stdint.h>
+#include "lift.h"
+
+// The closest two cars in the same shaft may come, in shaft sections. A car may
+// never be less than a floor from the next car up or down.
+#define TWIN_GAP FLOOR_HEIGHT
+
+/** A shaft holding several cars, one above another. The cars can never pass, so
+ *  car 0 is always the lowest, and each car can only reach the floors that leave
+ *  room for the cars below and above it. When two cars meet head on, the one that
+ *  has been held up less backs off.
+ */
+typedef struct {
+    Lift **cars;    //!< The cars, from the bottom of the shaft up.
+    int carcount;   //!< The number of cars.
+    int topfloor;   //!< The top floor of the shaft.
+    long *held;     //!< Updates each car has been held since it last stopped for someone.
+    int *sentto;    //!< The floor each car was last sent to out of the way, or NO_STOPS.
+} TwinShaft;
+
+/** A building of multi-car shafts, and the hall calls waiting for its cars. Each
+ *  floor has an up and a down call at [floor * 2] and [floor * 2 + 1], which is
+ *  either not made (NO_CALL in 'made') or assigned to one car.
+ */
+typedef struct {
+    TwinShaft *shafts;  //!< The shafts.
+    int shaftcount;     //!< The number of shafts.
+    int carcount;       //!< The number of cars in each shaft.
+    int topfloor;       //!< The top floor of the building.
+    long now;           //!< The current update.
+
+    long *made;         //!< The update each call was made on, or NO_CALL.
+    int *assigned;      //!< The car each call was given to, as shaft * carcount + car.
+    long calls;         //!< Calls made.
+    long answered;      //!< Calls answered.
+    long total_wait;    //!< Sum of the time answered calls waited.
+    long longest_wait;  //!< The longest any answered call waited.
+    long held;          //!< Car updates spent waiting for the next car to get out of the way.
+    long yields;        //!< Times a car was sent away to let the next car past.
+    int closest;        //!< The smallest gap ever seen between two cars, in sections.
+} TwinBuilding;
+
+TwinBuilding *create_twins(int shaftcount, int carcount, int topfloor, int speed);
+void free_twins(TwinBuilding *building);
+int twin_lowest_floor(TwinBuilding *building, int car);
+int twin_highest_floor(TwinBuilding *building, int car);
+int twin_call(TwinBuilding *building, int floor, Moving direction);
+int twin_stop(TwinBuilding *building, int shaftnum, int car, int floor);
+void update_twins(TwinBuilding *building);
+void print_twins(TwinBuilding *building);
+void run_twins(int shaftcount, int carcount, int topfloor, int speed, long ticks, int fps, uint64_t seed);
+
+#endif
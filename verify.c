@@ -0,0 +1,689 @@
+/** \file verify.c
+ *  This file contains the lockstep verification mode. The Shaft and Lift code -
+ *  update_lift() for the finite state machine and call_lift() for choosing which
+ *  lift answers a call - is the reference for how the simulation behaves. Faster
+ *  engines have to reproduce it exactly, and this is how that is checked: the
+ *  reference and the engine are driven by the same stream of calls and stops, and
+ *  every few updates the complete state of every lift in both is compared. The
+ *  first difference found is reported along with both versions of the lift.
+ *
+ *  Engines are listed in the 'engines' table below the reference engine.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shaft.h"
+#include "advance.h"
+#include "packed.h"
+#include "fsmtable.h"
+#include "stops.h"
+#include "traffic.h"
+#include "verify.h"
+
+// The traffic used to drive both simulations: a call every few updates, and
+// most passengers choose a floor when the doors open. Now and then, at the
+// cancel rate per 1000 updates, a moving lift loses every stop ahead of it.
+// Engines that keep hall call markers are also given those directly, at the
+// hall rate per 1000 updates.
+#define VERIFY_CALL_RATE 150
+#define VERIFY_STOP_RATE 60
+#define VERIFY_CANCEL_RATE 20
+#define VERIFY_HALL_RATE 100
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void *create_reference(int shaftcount, int topfloor, int speed);
+static void release_reference(void *engine);
+static void step_reference(void *engine, int ticks);
+static void call_reference(void *engine, int floor, Moving direction);
+static void stop_reference(void *engine, int shaft, int floor);
+static void cancel_reference(void *engine, int shaft, int floor);
+static void hall_reference(void *engine, int shaft, int floor, Moving direction);
+static void read_reference(void *engine, int shaft, CarState *out);
+static void step_advance(void *engine, int ticks);
+static void step_table(void *engine, int ticks);
+
+static void *create_packed(int shaftcount, int topfloor, int speed);
+static void release_packed(void *engine);
+static void step_packed(void *engine, int ticks);
+static void call_packed_engine(void *engine, int floor, Moving direction);
+static void stop_packed(void *engine, int shaft, int floor);
+static void cancel_packed(void *engine, int shaft, int floor);
+static void read_packed(void *engine, int shaft, CarState *out);
+
+static int stop_ahead(Lift *car, int *floor);
+static void read_lift(Lift *car, CarState *out);
+static int same_state(const CarState *a, const CarState *b, int topfloor, int exact);
+static void dump_states(const char *name, const CarState *ref, const CarState *other, int topfloor);
+static const char *state_name(State state);
+static const char *direction_name(Moving direction);
+
+
+/* ============================================================================ *
+ * The reference engine                                                         *
+ * ============================================================================ */
+
+/** The reference engine is simply a building made out of create_shaft() shafts. It
+ *  is listed as an engine so that the verification mode itself can be checked - it
+ *  must never diverge from the reference.
+ */
+typedef struct {
+    Shaft **shafts;
+    int shaftcount;
+} Reference;
+
+
+/** Create a building of reference shafts.
+ *
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of every shaft.
+ *  \param speed      The speed of every lift.
+ *  \return A pointer to the new building.
+ */
+static void *create_reference(int shaftcount, int topfloor, int speed)
+{
+    int i;
+    Reference *ref = (Reference *)malloc(sizeof(Reference));
+
+    if(ref) {
+        ref -> shafts = (Shaft **)malloc(shaftcount * sizeof(Shaft *));
+    }
+    if(!ref || !ref -> shafts) {
+        fprintf(stderr, "Unable to allocate space for the reference building.\n");
+        exit(1);
+    }
+
+    ref -> shaftcount = shaftcount;
+    for(i = 0; i < shaftcount; ++i) {
+        ref -> shafts[i] = create_shaft(topfloor, speed);
+    }
+
+    return ref;
+}
+
+
+/** Release a building created by create_reference().
+ *
+ *  \param engine The building to free.
+ */
+static void release_reference(void *engine)
+{
+    Reference *ref = (Reference *)engine;
+    int i;
+
+    for(i = 0; i < ref -> shaftcount; ++i) {
+        free_shaft(ref -> shafts[i]);
+    }
+    free(ref -> shafts);
+    free(ref);
+}
+
+
+/** Update the lifts in a reference building.
+ *
+ *  \param engine The building to update.
+ *  \param ticks  The number of times to update each lift.
+ */
+static void step_reference(void *engine, int ticks)
+{
+    Reference *ref = (Reference *)engine;
+
+    while(ticks-- > 0) {
+        update_shafts(ref -> shafts, ref -> shaftcount);
+    }
+}
+
+
+/** Make a hall call in a reference building.
+ *
+ *  \param engine    The building the call is made in.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+static void call_reference(void *engine, int floor, Moving direction)
+{
+    Reference *ref = (Reference *)engine;
+
+    call_lift(ref -> shafts, ref -> shaftcount, floor, direction);
+}
+
+
+/** Set a stop for one lift in a reference building.
+ *
+ *  \param engine The building containing the lift.
+ *  \param shaft  The number of the shaft containing the lift.
+ *  \param floor  The floor the lift should stop at.
+ */
+static void stop_reference(void *engine, int shaft, int floor)
+{
+    Reference *ref = (Reference *)engine;
+
+    set_stop(ref -> shafts[shaft] -> car, floor);
+}
+
+
+/** Clear a stop for one lift in a reference building.
+ *
+ *  \param engine The building containing the lift.
+ *  \param shaft  The number of the shaft containing the lift.
+ *  \param floor  The floor the lift should no longer stop at.
+ */
+static void cancel_reference(void *engine, int shaft, int floor)
+{
+    Reference *ref = (Reference *)engine;
+
+    clear_stop(ref -> shafts[shaft] -> car, floor);
+}
+
+
+/** Give one lift in a reference building a hall call marker.
+ *
+ *  \param engine    The building containing the lift.
+ *  \param shaft     The number of the shaft containing the lift.
+ *  \param floor     The floor the call is on.
+ *  \param direction The direction the caller wants to go in.
+ */
+static void hall_reference(void *engine, int shaft, int floor, Moving direction)
+{
+    Reference *ref = (Reference *)engine;
+
+    ref -> shafts[shaft] -> car -> stops[floor] |= (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+}
+
+
+/** Copy out the state of one lift in a reference building.
+ *
+ *  \param engine The building containing the lift.
+ *  \param shaft  The number of the shaft containing the lift.
+ *  \param out    The structure to copy the state into.
+ */
+static void read_reference(void *engine, int shaft, CarState *out)
+{
+    Reference *ref = (Reference *)engine;
+
+    read_lift(ref -> shafts[shaft] -> car, out);
+}
+
+
+/* ============================================================================ *
+ * The closed form engine                                                       *
+ * ============================================================================ */
+
+/** Update the lifts in a reference building using advance_building(). This is the
+ *  only difference between the 'advance' engine and the reference engine.
+ *
+ *  \param engine The building to update.
+ *  \param ticks  The number of times to update each lift.
+ */
+static void step_advance(void *engine, int ticks)
+{
+    Reference *ref = (Reference *)engine;
+
+    while(ticks > 0) {
+        ticks -= advance_building(ref -> shafts, ref -> shaftcount, ticks);
+    }
+}
+
+
+/* ============================================================================ *
+ * The transition table engine                                                  *
+ * ============================================================================ */
+
+/** Update the lifts in a reference building using update_lift_table(). This is the
+ *  only difference between the 'table' engine and the reference engine.
+ *
+ *  \param engine The building to update.
+ *  \param ticks  The number of times to update each lift.
+ */
+static void step_table(void *engine, int ticks)
+{
+    Reference *ref = (Reference *)engine;
+
+    while(ticks-- > 0) {
+        update_shafts_table(ref -> shafts, ref -> shaftcount);
+    }
+}
+
+
+/* ============================================================================ *
+ * The packed engine                                                            *
+ * ============================================================================ */
+
+/** Create a fleet of packed lifts, one per shaft.
+ *
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of every shaft.
+ *  \param speed      The speed of every lift.
+ *  \return A pointer to the new fleet.
+ */
+static void *create_packed(int shaftcount, int topfloor, int speed)
+{
+    return create_fleet(shaftcount, topfloor, speed);
+}
+
+
+/** Release a fleet created by create_packed().
+ *
+ *  \param engine The fleet to free.
+ */
+static void release_packed(void *engine)
+{
+    free_fleet((Fleet *)engine);
+}
+
+
+/** Update the lifts in a fleet.
+ *
+ *  \param engine The fleet to update.
+ *  \param ticks  The number of times to update each lift.
+ */
+static void step_packed(void *engine, int ticks)
+{
+    while(ticks-- > 0) {
+        update_fleet((Fleet *)engine);
+    }
+}
+
+
+/** Make a hall call in a fleet.
+ *
+ *  \param engine    The fleet the call is made in.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ */
+static void call_packed_engine(void *engine, int floor, Moving direction)
+{
+    call_packed((Fleet *)engine, floor, direction);
+}
+
+
+/** Set a stop for one lift in a fleet.
+ *
+ *  \param engine The fleet containing the lift.
+ *  \param shaft  The number of the lift in the fleet.
+ *  \param floor  The floor the lift should stop at.
+ */
+static void stop_packed(void *engine, int shaft, int floor)
+{
+    packed_set_stop((Fleet *)engine, shaft, floor);
+}
+
+
+/** Clear a stop for one lift in a fleet.
+ *
+ *  \param engine The fleet containing the lift.
+ *  \param shaft  The number of the lift in the fleet.
+ *  \param floor  The floor the lift should no longer stop at.
+ */
+static void cancel_packed(void *engine, int shaft, int floor)
+{
+    packed_clear_stop((Fleet *)engine, shaft, floor);
+}
+
+
+/** Copy out the state of one lift in a fleet.
+ *
+ *  \param engine The fleet containing the lift.
+ *  \param shaft  The number of the lift in the fleet.
+ *  \param out    The structure to copy the state into.
+ */
+static void read_packed(void *engine, int shaft, CarState *out)
+{
+    Fleet *fleet = (Fleet *)engine;
+    int floor;
+
+    out -> position  = packed_get_position(fleet, shaft);
+    out -> time      = packed_get_time(fleet, shaft);
+    out -> state     = packed_get_state(fleet, shaft);
+    out -> direction = packed_get_direction(fleet, shaft);
+
+    for(floor = 0; floor <= packed_get_topfloor(fleet, shaft); ++floor) {
+        out -> stops[floor] = packed_get_stop(fleet, shaft, floor);
+    }
+}
+
+
+/* ============================================================================ *
+ * Engine lookup                                                                *
+ * ============================================================================ */
+
+// All the engines that can be verified. New engines should be added here.
+static const Engine engines[] = {
+    { "reference", create_reference, release_reference, step_reference,
+      call_reference, stop_reference, cancel_reference, hall_reference, read_reference },
+    { "advance", create_reference, release_reference, step_advance,
+      call_reference, stop_reference, cancel_reference, hall_reference, read_reference },
+    { "table", create_reference, release_reference, step_table,
+      call_reference, stop_reference, cancel_reference, hall_reference, read_reference },
+    { "packed", create_packed, release_packed, step_packed,
+      call_packed_engine, stop_packed, cancel_packed, NULL, read_packed },
+};
+
+#define ENGINE_COUNT (int)(sizeof(engines) / sizeof(engines[0]))
+
+
+/** Find an engine by name.
+ *
+ *  \param name The name of the engine to find.
+ *  \return A pointer to the engine, or NULL if there is no engine with that name.
+ */
+const Engine *find_engine(const char *name)
+{
+    int i;
+
+    for(i = 0; i < ENGINE_COUNT; ++i) {
+        if(!strcmp(engines[i].name, name)) {
+            return &engines[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/** Print the names of all the engines that can be verified, one per line.
+ *
+ *  \param out The stream to print the names to.
+ */
+void list_engines(FILE *out)
+{
+    int i;
+
+    for(i = 0; i < ENGINE_COUNT; ++i) {
+        fprintf(out, "    %s\n", engines[i].name);
+    }
+}
+
+
+/* ============================================================================ *
+ * Verification                                                                 *
+ * ============================================================================ */
+
+/** Run an engine in lockstep with the reference implementation. Both are fed the
+ *  same generated calls and stops, in the same order the main loop would: update
+ *  every lift, give stops to the lifts with open doors, then make any hall call.
+ *  In between, a moving lift sometimes has every stop ahead of it cleared, which
+ *  makes it turn round, or go idle, at the next floor, and engines that keep hall
+ *  call markers are given some directly, so that lifts pass by calls going the
+ *  other way.
+ *  The engine is only told about the passing of time when it is next needed, so
+ *  engines that can jump several updates at once are allowed to.
+ *
+ *  Every 'interval' updates, and at the end of the run, the state of every lift in
+ *  the engine is compared with the reference. If any differ, the first differing
+ *  lift is printed out and verification stops.
+ *
+ *  \param engine     The engine to check.
+ *  \param shaftcount The number of shafts in the building.
+ *  \param topfloor   The top floor of every shaft.
+ *  \param speed      The speed of every lift.
+ *  \param ticks      The number of updates to run for.
+ *  \param interval   The number of updates between comparisons.
+ *  \param seed       The seed for the traffic generator.
+ *  \return 0 if the engine matched the reference throughout, 1 if it diverged.
+ */
+int run_verify(const Engine *engine, int shaftcount, int topfloor, int speed,
+               long ticks, int interval, uint64_t seed)
+{
+    Shaft **shafts;
+    void *other;
+    Traffic traffic;
+    CarState refstate, otherstate;
+    long tick, lastmatch = 0;
+    int pending = 0;
+    int shaftnum, floor, diverged = 0;
+    Moving direction;
+
+    shafts = (Shaft **)malloc(shaftcount * sizeof(Shaft *));
+    refstate.stops   = (char *)malloc(topfloor + 1);
+    otherstate.stops = (char *)malloc(topfloor + 1);
+    if(!shafts || !refstate.stops || !otherstate.stops) {
+        fprintf(stderr, "Unable to allocate space for verification.\n");
+        exit(1);
+    }
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        shafts[shaftnum] = create_shaft(topfloor, speed);
+    }
+    other = engine -> create(shaftcount, topfloor, speed);
+    init_traffic(&traffic, seed, topfloor, VERIFY_CALL_RATE, VERIFY_STOP_RATE);
+
+    for(tick = 1; tick <= ticks && !diverged; ++tick) {
+        update_shafts(shafts, shaftcount);
+        ++pending;
+
+        // Stops for any lifts with their doors open
+        for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+            if(get_state(shafts[shaftnum] -> car) == STATE_OPEN &&
+               next_stop(&traffic, shafts[shaftnum] -> car, &floor)) {
+                engine -> step(other, pending);
+                pending = 0;
+
+                set_stop(shafts[shaftnum] -> car, floor);
+                engine -> stop(other, shaftnum, floor);
+            }
+        }
+
+        // Sometimes take away the stops ahead of a moving lift, as when its
+        // calls are handed to another lift, so it has to turn round or stop
+        if(traffic_random(&traffic, 1000) < VERIFY_CANCEL_RATE) {
+            shaftnum = traffic_random(&traffic, shaftcount);
+            if(get_state(shafts[shaftnum] -> car) == STATE_MOVING) {
+                engine -> step(other, pending);
+                pending = 0;
+
+                while(stop_ahead(shafts[shaftnum] -> car, &floor)) {
+                    clear_stop(shafts[shaftnum] -> car, floor);
+                    engine -> cancel(other, shaftnum, floor);
+                }
+            }
+        }
+
+        // Hall call markers for engines that keep them, as the registry would place them
+        if(engine -> hall && traffic_random(&traffic, 1000) < VERIFY_HALL_RATE) {
+            shaftnum = traffic_random(&traffic, shaftcount);
+            floor = traffic_random(&traffic, topfloor + 1);
+            if(floor == 0) {
+                direction = DIR_UP;
+            } else if(floor == topfloor) {
+                direction = DIR_DOWN;
+            } else {
+                direction = traffic_random(&traffic, 2) ? DIR_UP : DIR_DOWN;
+            }
+
+            engine -> step(other, pending);
+            pending = 0;
+
+            shafts[shaftnum] -> car -> stops[floor] |= (direction == DIR_DOWN) ? STOP_HALL_DOWN : STOP_HALL_UP;
+            engine -> hall(other, shaftnum, floor, direction);
+        }
+
+        // Then any hall call
+        if(next_call(&traffic, &floor, &direction)) {
+            engine -> step(other, pending);
+            pending = 0;
+
+            call_lift(shafts, shaftcount, floor, direction);
+            engine -> call(other, floor, direction);
+        }
+
+        // Compare every lift if it's time to
+        if(tick % interval == 0 || tick == ticks) {
+            engine -> step(other, pending);
+            pending = 0;
+
+            for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+                read_lift(shafts[shaftnum] -> car, &refstate);
+                engine -> read_car(other, shaftnum, &otherstate);
+
+                if(!same_state(&refstate, &otherstate, topfloor, engine -> hall != NULL)) {
+                    printf("Engine '%s' diverged from the reference in shaft %d at update %ld (last match at update %ld)\n",
+                           engine -> name, shaftnum, tick, lastmatch);
+                    dump_states(engine -> name, &refstate, &otherstate, topfloor);
+                    diverged = 1;
+                    break;
+                }
+            }
+
+            if(!diverged) {
+                lastmatch = tick;
+            }
+        }
+    }
+
+    if(!diverged) {
+        printf("Engine '%s' matched the reference for %ld updates of %d shafts.\n",
+               engine -> name, ticks, shaftcount);
+    }
+
+    engine -> release(other);
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        free_shaft(shafts[shaftnum]);
+    }
+    free(shafts);
+    free(refstate.stops);
+    free(otherstate.stops);
+
+    return diverged;
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Find a stop ahead of a lift in its direction of travel, not counting the floor
+ *  it is at.
+ *
+ *  \param car   The lift to inspect.
+ *  \param floor A pointer to an int to store the stop floor in.
+ *  \return true if a stop was found, false if there are none ahead.
+ */
+static int stop_ahead(Lift *car, int *floor)
+{
+    int stop;
+
+    for(stop = 0; stop <= get_topfloor(car); ++stop) {
+        if(car -> stops[stop] &&
+           ((get_direction(car) == DIR_UP && stop * FLOOR_HEIGHT > get_position(car)) ||
+            (get_direction(car) == DIR_DOWN && stop * FLOOR_HEIGHT < get_position(car)))) {
+            *floor = stop;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** Copy the state of a Lift into a CarState.
+ *
+ *  \param car The lift to copy.
+ *  \param out The structure to copy the state into.
+ */
+static void read_lift(Lift *car, CarState *out)
+{
+    out -> position  = get_position(car);
+    out -> time      = get_time(car);
+    out -> state     = get_state(car);
+    out -> direction = get_direction(car);
+    memcpy(out -> stops, car -> stops, get_topfloor(car) + 1);
+}
+
+
+/** Determine whether two lift states are identical.
+ *
+ *  \param a        The first state.
+ *  \param b        The second state.
+ *  \param topfloor The top floor of the lifts.
+ *  \param exact    true if the stop markers must be the same, false if they only
+ *                  need to agree on whether they are set.
+ *  \return true if every field and every stop marker match, false otherwise.
+ */
+static int same_state(const CarState *a, const CarState *b, int topfloor, int exact)
+{
+    int floor;
+
+    if(a -> position != b -> position || a -> time != b -> time ||
+       a -> state != b -> state || a -> direction != b -> direction) {
+        return 0;
+    }
+
+    for(floor = 0; floor <= topfloor; ++floor) {
+        if(exact ? a -> stops[floor] != b -> stops[floor] : !a -> stops[floor] != !b -> stops[floor]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/** Print the reference and engine versions of a lift side by side.
+ *
+ *  \param name     The name of the engine.
+ *  \param ref      The state of the lift in the reference.
+ *  \param other    The state of the lift in the engine.
+ *  \param topfloor The top floor of the lifts.
+ */
+static void dump_states(const char *name, const CarState *ref, const CarState *other, int topfloor)
+{
+    const CarState *states[2] = { ref, other };
+    int i, floor;
+
+    printf("%-10s %-14s %s\n", "", "reference", name);
+    printf("%-10s %-14d %d\n", "position",  ref -> position, other -> position);
+    printf("%-10s %-14d %d\n", "time",      ref -> time, other -> time);
+    printf("%-10s %-14s %s\n", "state",     state_name(ref -> state), state_name(other -> state));
+    printf("%-10s %-14s %s\n", "direction", direction_name(ref -> direction), direction_name(other -> direction));
+
+    // Stops are shown as one character per floor from the ground up, '!' where set
+    for(i = 0; i < 2; ++i) {
+        printf("%-10s ", i ? name : "stops");
+        for(floor = 0; floor <= topfloor; ++floor) {
+            putchar(states[i] -> stops[floor] ? '!' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+
+/** Obtain a printable name for a lift state.
+ *
+ *  \param state The state to name.
+ *  \return The name of the state.
+ */
+static const char *state_name(State state)
+{
+    switch(state) {
+        case STATE_IDLE   : return "IDLE";
+        case STATE_MOVING : return "MOVING";
+        case STATE_OPENING: return "OPENING";
+        case STATE_OPEN   : return "OPEN";
+        case STATE_CLOSING: return "CLOSING";
+        case STATE_WAIT   : return "WAIT";
+        default: return "BAD";
+    }
+}
+
+
+/** Obtain a printable name for a direction.
+ *
+ *  \param direction The direction to name.
+ *  \return The name of the direction.
+ */
+static const char *direction_name(Moving direction)
+{
+    switch(direction) {
+        case DIR_NONE: return "NONE";
+        case DIR_UP  : return "UP";
+        case DIR_DOWN: return "DOWN";
+        default: return "BAD";
+    }
+}
@@ -0,0 +1,51 @@
+/** \file verify.h
+ *  Declarations for the lockstep verification mode, which checks an alternative
+ *  simulation engine against update_lift() and call_lift().
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "lift.h"
+
+/** A copy of everything that describes one lift at a point in time. The caller
+ *  provides the stops array, which must have room for topfloor + 1 markers.
+ */
+typedef struct {
+    int position;       //!< Position in the shaft, 0 to topfloor * FLOOR_HEIGHT.
+    int time;           //!< The FSM timer.
+    State state;        //!< The FSM state.
+    Moving direction;   //!< The direction of travel.
+    char *stops;        //!< One marker per floor, non-zero where the lift will stop.
+} CarState;
+
+/** A simulation engine that can be checked against the reference implementation.
+ *  An engine simulates a whole building of identical shafts, and must behave exactly
+ *  as the Shaft/Lift code does: step() is update_shafts() run 'ticks' times, call()
+ *  is call_lift(), stop() is set_stop() on one shaft's lift, and cancel() is
+ *  clear_stop(). hall() gives one lift a hall call marker from stops.h, as the hall
+ *  call registry does; engines that can't keep those leave it NULL, and then stop
+ *  markers are only compared on whether they are set.
+ */
+typedef struct {
+    const char *name;                                           //!< Name used to select the engine.
+    void *(*create)(int shaftcount, int topfloor, int speed);   //!< Build an idle building.
+    void (*release)(void *engine);                              //!< Free the building.
+    void (*step)(void *engine, int ticks);                      //!< Update every lift 'ticks' times.
+    void (*call)(void *engine, int floor, Moving direction);    //!< Make a hall call.
+    void (*stop)(void *engine, int shaft, int floor);           //!< Set a stop in one lift.
+    void (*cancel)(void *engine, int shaft, int floor);         //!< Clear a stop in one lift.
+    void (*hall)(void *engine, int shaft, int floor, Moving direction); //!< Mark a hall call in one lift, or NULL.
+    void (*read_car)(void *engine, int shaft, CarState *out);   //!< Copy out one lift's state.
+} Engine;
+
+const Engine *find_engine(const char *name);
+void list_engines(FILE *out);
+int run_verify(const Engine *engine, int shaftcount, int topfloor, int speed,
+               long ticks, int interval, uint64_t seed);
+
+#endif
@@ -0,0 +1,370 @@
+/** \file viewport.c
+ *  This file contains the code that draws the lift shafts to the terminal. Rather
+ *  than keeping a string for every section of every shaft, each cell of the display
+ *  is worked out from the Lift state as it is printed, and only the floors and
+ *  shafts inside a Viewport are visited at all. This keeps the display cheap for
+ *  very tall buildings with many shafts.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "viewport.h"
+
+// Include the headers needed to clear the screen and find its size
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+// Lines of the terminal left free for the header and the prompts below the shafts
+#define RESERVED_LINES 4
+
+// Each shaft cell is 3 characters wide, plus a separating space
+#define CELL_WIDTH 4
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static int building_top(Shaft **shafts, int shaftcount);
+static int label_width(int topfloor);
+static void terminal_size(int *rows, int *columns);
+static void clamp_viewport(Viewport *view, Shaft **shafts, int shaftcount);
+static const char *section_to_string(Shaft *shaft, int section);
+
+
+/* ============================================================================ *
+ * Viewport handling                                                            *
+ * ============================================================================ */
+
+/** Set the viewport to cover the whole building - every floor of every shaft.
+ *
+ *  \param view       The viewport to set.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ */
+void full_viewport(Viewport *view, Shaft **shafts, int shaftcount)
+{
+    view -> bottom     = 0;
+    view -> top        = building_top(shafts, shaftcount);
+    view -> firstshaft = 0;
+    view -> lastshaft  = shaftcount - 1;
+}
+
+
+/** Resize the viewport so that it fits in the terminal. The bottom floor and the
+ *  leftmost shaft stay where they are (unless that would push the view off the
+ *  building), and the top floor and rightmost shaft are chosen to fill the screen.
+ *
+ *  \param view       The viewport to resize.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ */
+void fit_viewport(Viewport *view, Shaft **shafts, int shaftcount)
+{
+    int rows, columns;
+    int lines, cells;
+
+    terminal_size(&rows, &columns);
+
+    // The floors from bottom to top take (top - bottom) * FLOOR_HEIGHT + 1 lines
+    lines = rows - RESERVED_LINES;
+    if(lines < 1) {
+        lines = 1;
+    }
+
+    cells = (columns - label_width(building_top(shafts, shaftcount))) / CELL_WIDTH;
+    if(cells < 1) {
+        cells = 1;
+    }
+
+    view -> top       = view -> bottom + (lines - 1) / FLOOR_HEIGHT;
+    view -> lastshaft = view -> firstshaft + cells - 1;
+
+    clamp_viewport(view, shafts, shaftcount);
+}
+
+
+/** Move the viewport around the building without changing its size. Positive
+ *  values move the view up and to the right, negative values down and to the left.
+ *  The view stops at the edges of the building.
+ *
+ *  \param view       The viewport to move.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ *  \param floors     The number of floors to move the view by.
+ *  \param columns    The number of shafts to move the view by.
+ */
+void scroll_viewport(Viewport *view, Shaft **shafts, int shaftcount, int floors, int columns)
+{
+    view -> bottom     += floors;
+    view -> top        += floors;
+    view -> firstshaft += columns;
+    view -> lastshaft  += columns;
+
+    clamp_viewport(view, shafts, shaftcount);
+}
+
+
+/** Keep a viewport inside the building. If the view hangs over an edge it is
+ *  slid back inside, and if it is bigger than the building it is cut down to fit.
+ *
+ *  \param view       The viewport to clamp.
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ */
+static void clamp_viewport(Viewport *view, Shaft **shafts, int shaftcount)
+{
+    int maxfloors = building_top(shafts, shaftcount);
+    int height = view -> top - view -> bottom;
+    int width  = view -> lastshaft - view -> firstshaft;
+
+    if(height > maxfloors) {
+        height = maxfloors;
+    }
+    if(width > shaftcount - 1) {
+        width = shaftcount - 1;
+    }
+
+    if(view -> bottom < 0) {
+        view -> bottom = 0;
+    }
+    if(view -> bottom + height > maxfloors) {
+        view -> bottom = maxfloors - height;
+    }
+    view -> top = view -> bottom + height;
+
+    if(view -> firstshaft < 0) {
+        view -> firstshaft = 0;
+    }
+    if(view -> firstshaft + width > shaftcount - 1) {
+        view -> firstshaft = shaftcount - 1 - width;
+    }
+    view -> lastshaft = view -> firstshaft + width;
+}
+
+
+/* ============================================================================ *
+ * Drawing                                                                      *
+ * ============================================================================ */
+
+/** Obtain the string representation of one section of a shaft. This is worked out
+ *  from the state of the lift in the shaft each time it is needed: the lift itself
+ *  if it is at this section, a stop marker if the section is a floor the lift has
+ *  been asked to stop at, and an empty piece of shaft otherwise.
+ *
+ *  \param shaft   The shaft to obtain the section from.
+ *  \param section The section number to return, in the range 0 to topfloor*FLOOR_HEIGHT.
+ *                 Sections above the top of the shaft are drawn as solid building.
+ *  \return A pointer to a 3 character string representing the shaft at the specified level.
+ */
+static const char *section_to_string(Shaft *shaft, int section)
+{
+    Lift *car = shaft -> car;
+
+    // If the section requested is over the top of the lift, return a 'no shaft' string
+    if(section > (shaft -> topfloor * FLOOR_HEIGHT)) {
+        return "###";
+    }
+
+    if(section == get_position(car)) {
+        return lift_to_string(car);
+    }
+
+    if((section % FLOOR_HEIGHT == 0) && car -> stops[section / FLOOR_HEIGHT]) {
+        return "|!|";
+    }
+
+    return "| |";
+}
+
+
+/** Clear the terminal and move the cursor to the top left, ready for a new frame.
+ *  This code contains some OS-specific Magic - Windows terminals do not support the
+ *  standard methods of clearing terminals.
+ */
+void clear_terminal(void)
+{
+#ifndef _WIN32  // If we're not compiling on windows...
+    // This incantation clears the terminal, and moves the cursor to the top left
+    // It should work on any Remotely Sane terminal that understands ANSI
+    printf("\033[2J\033[H");
+
+#else // otherwise, we are on windows...
+    // So does this mess, the equivalent for windows (windows command terminals do
+    // not support ANSI or VT100 escape code sequences, and operations that would
+    // be performed via them on other operating systems must be done directly via
+    // the Windows API.)
+
+    // A bunch of variables first...
+    HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+    COORD coord = {0, 0};
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    DWORD count;
+    DWORD written;
+
+    // How many characters are there in the console?
+    GetConsoleScreenBufferInfo(handle, &csbi);
+    count = csbi.dwSize.X * csbi.dwSize.Y;
+
+    // Now clear that many characters.
+    // WARNING: This code is Full Of Spiders. You are not required or expected to
+    // know what this is doing, and in fact your sanity is safter if you do not
+    // attempt to.
+    FillConsoleOutputCharacter(handle, ' ', count, coord, &written);
+    GetConsoleScreenBufferInfo(handle, &csbi );
+    FillConsoleOutputAttribute(handle, csbi.wAttributes, count, coord, &written);
+    SetConsoleCursorPosition(handle, coord);
+#endif
+}
+
+
+/** Print out the part of the building covered by a viewport. The terminal is cleared
+ *  first, then a header showing the shaft numbers, then one line per shaft section
+ *  from the top floor of the view down to the bottom floor.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ *  \param view       The floors and shafts to print.
+ */
+void print_viewport(Shaft **shafts, int shaftcount, const Viewport *view)
+{
+    int shaftnum, floorpos;
+    int width = label_width(building_top(shafts, shaftcount));
+    int lastshaft = view -> lastshaft;
+    int length;
+    char number[12];
+    char *line, *out;
+
+    if(lastshaft > shaftcount - 1) {
+        lastshaft = shaftcount - 1;
+    }
+
+    // One line of the display: the floor label, then each visible shaft, then "\n\0"
+    line = (char *)malloc(width + ((lastshaft - view -> firstshaft + 1) * CELL_WIDTH) + 2);
+    if(!line) {
+        fprintf(stderr, "Unable to allocate display line buffer.\n");
+        exit(1);
+    }
+
+    clear_terminal();
+
+    // Header first, showing shaft numbers...
+    printf("%*s", width + 1, "");
+    for(shaftnum = view -> firstshaft; shaftnum <= lastshaft; ++shaftnum) {
+        printf("%-*d", CELL_WIDTH, shaftnum);
+    }
+    printf("\n");
+
+    // Now we want to print out. Remember that 0 is at the bottom of the terminal, not
+    // at the top!
+    for(floorpos = view -> top * FLOOR_HEIGHT; floorpos >= view -> bottom * FLOOR_HEIGHT; --floorpos) {
+        out = line;
+
+        // If the current position corresponds to a floor, print out a floor number,
+        // otherwise pad with spaces to align the rest of the line. The number is
+        // right aligned, with a space after it; label_width() leaves room for it.
+        memset(out, ' ', width);
+        if(floorpos % FLOOR_HEIGHT == 0) {
+            length = snprintf(number, sizeof(number), "%d", floorpos / FLOOR_HEIGHT);
+            memcpy(out + width - 1 - length, number, length);
+        }
+        out += width;
+
+        for(shaftnum = view -> firstshaft; shaftnum <= lastshaft; ++shaftnum) {
+            memcpy(out, section_to_string(shafts[shaftnum], floorpos), 3);
+            out[3] = ' ';
+            out += CELL_WIDTH;
+        }
+        strcpy(out, "\n");
+
+        fputs(line, stdout);
+    }
+
+    free(line);
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Determine the highest floor of any shaft in the building. In theory, all the
+ *  shafts will be the same height, but it's best to be certain...
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shaft structures.
+ *  \param shaftcount The number of shaft pointers in shafts.
+ *  \return The highest top floor of the shafts.
+ */
+static int building_top(Shaft **shafts, int shaftcount)
+{
+    int shaftnum;
+    int maxfloors = 0;
+
+    for(shaftnum = 0; shaftnum < shaftcount; ++shaftnum) {
+        if(shafts[shaftnum] -> topfloor > maxfloors) {
+            maxfloors = shafts[shaftnum] -> topfloor;
+        }
+    }
+
+    return maxfloors;
+}
+
+
+/** Work out how many characters the floor numbers take at the start of each line,
+ *  including the space separating them from the shafts.
+ *
+ *  \param topfloor The highest floor that will be labelled.
+ *  \return The width of the floor label column.
+ */
+static int label_width(int topfloor)
+{
+    int digits = 1;
+
+    while(topfloor >= 10) {
+        topfloor /= 10;
+        ++digits;
+    }
+
+    // Small buildings keep the original two digit labels
+    if(digits < 2) {
+        digits = 2;
+    }
+
+    return digits + 1;
+}
+
+
+/** Find out how big the terminal is. If the size can not be determined (for example
+ *  when output is redirected to a file) a standard 24x80 terminal is assumed.
+ *
+ *  \param rows    A pointer to an int to store the number of lines in.
+ *  \param columns A pointer to an int to store the number of columns in.
+ */
+static void terminal_size(int *rows, int *columns)
+{
+    *rows    = 24;
+    *columns = 80;
+
+#ifndef _WIN32
+    struct winsize size;
+
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        *rows    = size.ws_row;
+        *columns = size.ws_col;
+    }
+#else
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+
+    if(GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        *rows    = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+        *columns = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+    }
+#endif
+}
@@ -0,0 +1,30 @@
+/** \file viewport.h
+ *  Declarations for the scrollable shaft display. A Viewport selects a range of
+ *  floors and a range of shafts to draw, so buildings taller or wider than the
+ *  terminal can still be watched a piece at a time.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "shaft.h"
+
+/** The part of the building shown by print_viewport(). All four values are
+ *  inclusive, and are clamped to the building by the functions that set them.
+ */
+typedef struct {
+    int bottom;     //!< The lowest floor shown.
+    int top;        //!< The highest floor shown.
+    int firstshaft; //!< The leftmost shaft shown.
+    int lastshaft;  //!< The rightmost shaft shown.
+} Viewport;
+
+void full_viewport(Viewport *view, Shaft **shafts, int shaftcount);
+void fit_viewport(Viewport *view, Shaft **shafts, int shaftcount);
+void scroll_viewport(Viewport *view, Shaft **shafts, int shaftcount, int floors, int columns);
+void clear_terminal(void);
+void print_viewport(Shaft **shafts, int shaftcount, const Viewport *view);
+
+#endif
@@ -0,0 +1,612 @@
+/** \file zone.c
+ *  This file contains the implementation of zoned lift groups, as used in tall
+ *  buildings with sky lobbies. The shafts of the building are split into groups
+ *  (zones), and each zone serves a range of floors: the zone at the bottom serves
+ *  the ground floor up to the first transfer floor, the next serves that transfer
+ *  floor up to the next one, and so on. Adjacent zones share their transfer floor.
+ *
+ *  Each zone has its own call queue and its own thread. At each update every zone
+ *  thread gives its queued calls to its lifts with call_lift() - which only looks
+ *  at the zone's own shafts - and then updates those lifts. Zones only talk to each
+ *  other when a passenger reaches a transfer floor and needs a lift in the next zone.
+ *  The call for that lift, with the floor the passenger is going to, goes into the
+ *  zone's outbox, and once every zone has finished the update the main thread moves
+ *  the outboxes, bottom zone first, into the queues of the zones the calls are for.
+ *  That way the calls are given out at the next update whichever thread finishes
+ *  first, and a run is repeatable. The passenger then gets into whichever lift in
+ *  the next zone opens at the transfer floor first, and asks it for their floor, or
+ *  for the next transfer floor if they have further still to go.
+ *
+ *  The zones only need to meet after every update while passengers are changing
+ *  zones. The rest of the time no zone can make a call for another, so each zone
+ *  thread runs through a whole batch of updates without waiting for the others.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "notify.h"
+#include "profile.h"
+#include "zone.h"
+
+// Initial space in each zone's call queue and transfer list; both grow as needed.
+#define ZONE_QUEUE_SIZE 16
+
+
+/* ============================================================================ *
+ * Prototypes for functions only visible within this file                       *
+ * ============================================================================ */
+
+static void *zone_thread(void *arg);
+static void run_zone(Zone *zone);
+static int zones_quiet(ZonedBuilding *building);
+static void route_stop(Zone *zone, int shaft, int floor);
+static void post_call(Zone *zone, int floor, Moving direction, int destination);
+static void send_call(Zone *zone, int floor, Moving direction, int destination);
+static void deliver_calls(ZonedBuilding *building);
+static void add_transfer(Zone *zone, int shaft, int floor, Moving direction, int destination);
+static int take_transfer(Zone *zone, Transfer *due, int *shaft);
+static Zone *find_zone(ZonedBuilding *building, int shaftnum);
+
+
+/* ============================================================================ *
+ * Creating and releasing zones                                                 *
+ * ============================================================================ */
+
+/** Split a building into zones and start a thread for each zone. The shafts are
+ *  shared out as evenly as possible, as are the floors, and the lift in each zone
+ *  is moved to the lowest floor the zone serves. There can be no more zones than
+ *  there are shafts or floors.
+ *
+ *  \param shafts     A pointer to a block of memory containing pointers to Shafts.
+ *  \param shaftcount The number of shafts pointed to by 'shafts'.
+ *  \param topfloor   The top floor of the building.
+ *  \param zonecount  The number of zones to create.
+ *  \return A pointer to the new zoned building.
+ */
+ZonedBuilding *create_zones(Shaft **shafts, int shaftcount, int topfloor, int zonecount)
+{
+    ZonedBuilding *building;
+    Zone *zone;
+    int zonenum, shaftnum;
+
+    if(zonecount > shaftcount) {
+        zonecount = shaftcount;
+    }
+    if(zonecount > topfloor) {
+        zonecount = topfloor;
+    }
+    if(zonecount < 1) {
+        zonecount = 1;
+    }
+
+    building = (ZonedBuilding *)malloc(sizeof(ZonedBuilding));
+    if(building) {
+        building -> zones = (Zone *)calloc(zonecount, sizeof(Zone));
+    }
+    if(!building || !building -> zones) {
+        fprintf(stderr, "Unable to allocate space for lift zones.\n");
+        exit(1);
+    }
+
+    building -> zonecount = zonecount;
+    building -> running   = 1;
+
+    // The zone threads and the main thread all meet at the barriers
+    pthread_barrier_init(&building -> start, NULL, zonecount + 1);
+    pthread_barrier_init(&building -> done,  NULL, zonecount + 1);
+
+    for(zonenum = 0; zonenum < zonecount; ++zonenum) {
+        zone = &building -> zones[zonenum];
+
+        zone -> firstshaft = (zonenum * shaftcount) / zonecount;
+        zone -> shaftcount = (((zonenum + 1) * shaftcount) / zonecount) - zone -> firstshaft;
+        zone -> shafts     = shafts + zone -> firstshaft;
+        zone -> lowfloor   = (zonenum * topfloor) / zonecount;
+        zone -> highfloor  = ((zonenum + 1) * topfloor) / zonecount;
+
+        zone -> below = zonenum > 0 ? &building -> zones[zonenum - 1] : NULL;
+        zone -> above = zonenum < zonecount - 1 ? &building -> zones[zonenum + 1] : NULL;
+        zone -> building = building;
+
+        zone -> capacity = ZONE_QUEUE_SIZE;
+        zone -> queue = (ZoneCall *)malloc(zone -> capacity * sizeof(ZoneCall));
+        zone -> transfercapacity = ZONE_QUEUE_SIZE;
+        zone -> transfers = (Transfer *)malloc(zone -> transfercapacity * sizeof(Transfer));
+        zone -> outcapacity = ZONE_QUEUE_SIZE;
+        zone -> outbox = (ZoneCall *)malloc(zone -> outcapacity * sizeof(ZoneCall));
+        if(!zone -> queue || !zone -> transfers || !zone -> outbox) {
+            fprintf(stderr, "Unable to allocate space for a zone call queue.\n");
+            exit(1);
+        }
+
+        // Lifts wait at the bottom of their zone
+        for(shaftnum = 0; shaftnum < zone -> shaftcount; ++shaftnum) {
+            set_position(zone -> shafts[shaftnum] -> car, zone -> lowfloor * FLOOR_HEIGHT);
+        }
+
+        pthread_mutex_init(&zone -> lock, NULL);
+    }
+
+    // Only start the threads once every zone is set up, as they look at their neighbours
+    for(zonenum = 0; zonenum < zonecount; ++zonenum) {
+        if(pthread_create(&building -> zones[zonenum].thread, NULL, zone_thread, &building -> zones[zonenum])) {
+            fprintf(stderr, "Unable to start a thread for lift zone %d.\n", zonenum);
+            exit(1);
+        }
+    }
+
+    return building;
+}
+
+
+/** Stop the zone threads and release the memory used by a zoned building. The
+ *  shafts themselves are left alone, as they belong to the caller.
+ *
+ *  \param building The zoned building to free.
+ */
+void free_zones(ZonedBuilding *building)
+{
+    int zonenum;
+
+    // Wake the threads up with running cleared, which makes them exit
+    building -> running = 0;
+    pthread_barrier_wait(&building -> start);
+
+    for(zonenum = 0; zonenum < building -> zonecount; ++zonenum) {
+        pthread_join(building -> zones[zonenum].thread, NULL);
+        pthread_mutex_destroy(&building -> zones[zonenum].lock);
+        free(building -> zones[zonenum].queue);
+        free(building -> zones[zonenum].transfers);
+        free(building -> zones[zonenum].outbox);
+    }
+
+    pthread_barrier_destroy(&building -> start);
+    pthread_barrier_destroy(&building -> done);
+    free(building -> zones);
+    free(building);
+}
+
+
+/* ============================================================================ *
+ * Calls and stops                                                              *
+ * ============================================================================ */
+
+/** Make a hall call in a zoned building. The call is queued in the zone serving the
+ *  call floor, and will be given to one of that zone's lifts at the next update.
+ *  Calls on a transfer floor go to the zone above if the caller is going up, and
+ *  the zone below if they are going down.
+ *
+ *  \param building  The zoned building the call is made in.
+ *  \param floor     The floor the call was made on.
+ *  \param direction The direction the caller wants to go in.
+ *  \return The number of the zone the call was queued in.
+ */
+int zone_call(ZonedBuilding *building, int floor, Moving direction)
+{
+    int zonenum;
+    Zone *zone;
+
+    for(zonenum = 0; zonenum < building -> zonecount - 1; ++zonenum) {
+        zone = &building -> zones[zonenum];
+
+        if(floor < zone -> highfloor || (floor == zone -> highfloor && direction != DIR_UP)) {
+            break;
+        }
+    }
+
+    post_call(&building -> zones[zonenum], floor, direction, NO_STOPS);
+
+    return zonenum;
+}
+
+
+/** Set a stop for a lift in a zoned building. If the floor is outside the lift's
+ *  zone, the lift stops at the transfer floor on the way instead, and when its doors
+ *  open there a call is made in the next zone so the passenger can carry on to the
+ *  floor, changing lifts again at each zone they pass through.
+ *
+ *  \param building The zoned building containing the lift.
+ *  \param shaftnum The number of the shaft, counting across the whole building.
+ *  \param floor    The floor the passenger wants to go to.
+ */
+void zone_stop(ZonedBuilding *building, int shaftnum, int floor)
+{
+    Zone *zone = find_zone(building, shaftnum);
+
+    route_stop(zone, shaftnum - zone -> firstshaft, floor);
+}
+
+
+/** Prompt the user for stops and calls in a zoned building. This does the same job
+ *  as prompt_user(), but stops and calls are routed through the zones.
+ *
+ *  \param building The zoned building.
+ *  \param topfloor The top floor that lifts can service.
+ */
+void prompt_zones(ZonedBuilding *building, int topfloor)
+{
+    Zone *zone;
+    int zonenum, shaftnum;
+    int request;
+    Moving direction;
+
+    // Start by checking whether any lifts are open
+    for(zonenum = 0; zonenum < building -> zonecount; ++zonenum) {
+        zone = &building -> zones[zonenum];
+
+        for(shaftnum = 0; shaftnum < zone -> shaftcount; ++shaftnum) {
+            if(get_state(zone -> shafts[shaftnum] -> car) == STATE_OPEN) {
+                request = request_stop(zone -> shafts[shaftnum] -> car, zone -> firstshaft + shaftnum);
+
+                if(request != NO_STOPS) {
+                    uint64_t begin = profile_begin();
+
+                    zone_stop(building, zone -> firstshaft + shaftnum, request);
+                    profile_end(PHASE_DISPATCH, begin);
+                    notify_stop(zone -> firstshaft + shaftnum, request);
+                }
+            }
+        }
+    }
+
+    // Now, ask for calls...
+    // (a call with no direction means the input ended before one was given)
+    request = request_call(topfloor);
+    if(request != NO_STOPS && (direction = request_direction(request, topfloor)) != DIR_NONE) {
+        uint64_t begin = profile_begin();
+
+        zone_call(building, request, direction);
+        profile_end(PHASE_DISPATCH, begin);
+        notify_call(request, direction);
+    }
+}
+
+
+/* ============================================================================ *
+ * Updating zones                                                               *
+ * ============================================================================ */
+
+/** Update every lift in a zoned building a number of times. All the zones are
+ *  updated at the same time on their own threads. While passengers are changing
+ *  zones the threads meet after every update, so that the calls they make for each
+ *  other are queued in the next zones in time for the update after; otherwise
+ *  each thread runs on through the updates by itself. This returns when every zone
+ *  has finished and the calls they made have been queued.
+ *
+ *  \param building The zoned building to update.
+ *  \param updates  The number of updates to run.
+ */
+void update_zones(ZonedBuilding *building, long updates)
+{
+    while(updates > 0) {
+        building -> batch = zones_quiet(building) ? updates : 1;
+
+        pthread_barrier_wait(&building -> start);
+        pthread_barrier_wait(&building -> done);
+        deliver_calls(building);
+
+        updates -= building -> batch;
+    }
+}
+
+
+/** The body of each zone's thread: wait for a batch of updates to start, run them,
+ *  and report that they are done, until the building is freed.
+ *
+ *  \param arg A pointer to the Zone this thread updates.
+ *  \return Always NULL.
+ */
+static void *zone_thread(void *arg)
+{
+    Zone *zone = (Zone *)arg;
+    long update;
+
+    while(1) {
+        pthread_barrier_wait(&zone -> building -> start);
+        if(!zone -> building -> running) {
+            break;
+        }
+
+        for(update = 0; update < zone -> building -> batch; ++update) {
+            run_zone(zone);
+        }
+        pthread_barrier_wait(&zone -> building -> done);
+    }
+
+    return NULL;
+}
+
+
+/** Run one update of a zone: give any queued calls to the zone's lifts, update
+ *  the lifts, and then move on any passengers who are changing zones: those who
+ *  have reached a transfer floor call a lift in the next zone, and those who were
+ *  waiting for a lift get into the first to open for them.
+ *
+ *  \param zone The zone to update.
+ */
+static void run_zone(Zone *zone)
+{
+    ZoneCall call;
+    Transfer due;
+    int shaft;
+
+    // Hand out the queued calls. Nobody else adds to the queue during an update,
+    // but the lock is dropped around call_lift() all the same.
+    pthread_mutex_lock(&zone -> lock);
+    while(zone -> count > 0) {
+        call = zone -> queue[zone -> head];
+        zone -> head = (zone -> head + 1) % zone -> capacity;
+        --zone -> count;
+
+        pthread_mutex_unlock(&zone -> lock);
+        call_lift(zone -> shafts, zone -> shaftcount, call.floor, call.direction);
+        if(call.destination != NO_STOPS) {
+            add_transfer(zone, -1, call.floor, call.direction, call.destination);
+        }
+        pthread_mutex_lock(&zone -> lock);
+    }
+    pthread_mutex_unlock(&zone -> lock);
+
+    update_shafts(zone -> shafts, zone -> shaftcount);
+
+    // Passengers whose lift has opened at their transfer floor call a lift in the
+    // next zone, which is posted once every zone has finished. Passengers waiting
+    // for a lift get into the one that has opened and ask it for their floor.
+    while(take_transfer(zone, &due, &shaft)) {
+        if(due.shaft == -1) {
+            route_stop(zone, shaft, due.destination);
+        } else if((due.direction == DIR_UP && zone -> above) || (due.direction == DIR_DOWN && zone -> below)) {
+            send_call(zone, due.floor, due.direction, due.destination);
+        }
+    }
+}
+
+
+/** Move the calls in every zone's outbox into the queue of the zone they are for:
+ *  the zone above for calls going up, and the zone below for calls going down. The
+ *  zones are emptied from the bottom up, so the queues always end up in the same
+ *  order. This must only be called while the zone threads are waiting to start.
+ *
+ *  \param building The zoned building.
+ */
+static void deliver_calls(ZonedBuilding *building)
+{
+    Zone *zone;
+    int zonenum, i;
+
+    for(zonenum = 0; zonenum < building -> zonecount; ++zonenum) {
+        zone = &building -> zones[zonenum];
+
+        for(i = 0; i < zone -> outcount; ++i) {
+            post_call(zone -> outbox[i].direction == DIR_UP ? zone -> above : zone -> below,
+                      zone -> outbox[i].floor, zone -> outbox[i].direction, zone -> outbox[i].destination);
+        }
+        zone -> outcount = 0;
+    }
+}
+
+
+/* ============================================================================ *
+ * Utility functions                                                            *
+ * ============================================================================ */
+
+/** Determine whether no passengers are changing zones, so that no zone can make a
+ *  call for another however many updates are run. This must only be called while
+ *  the zone threads are waiting to start.
+ *
+ *  \param building The zoned building.
+ *  \return true if the zones can run on by themselves, false otherwise.
+ */
+static int zones_quiet(ZonedBuilding *building)
+{
+    Zone *zone;
+    int zonenum, i;
+
+    for(zonenum = 0; zonenum < building -> zonecount; ++zonenum) {
+        zone = &building -> zones[zonenum];
+
+        if(zone -> transfercount > 0) {
+            return 0;
+        }
+        for(i = 0; i < zone -> count; ++i) {
+            if(zone -> queue[(zone -> head + i) % zone -> capacity].destination != NO_STOPS) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+/** Set a stop for a lift in a zone, for a passenger going to a floor. If the floor
+ *  is outside the zone, the lift stops at the transfer floor on the way instead,
+ *  and the passenger is recorded as changing lifts there.
+ *
+ *  \param zone  The zone containing the lift.
+ *  \param shaft The shaft, within the zone, of the lift.
+ *  \param floor The floor the passenger wants to go to.
+ */
+static void route_stop(Zone *zone, int shaft, int floor)
+{
+    Lift *car = zone -> shafts[shaft] -> car;
+
+    if(floor > zone -> highfloor) {
+        set_stop(car, zone -> highfloor);
+        add_transfer(zone, shaft, zone -> highfloor, DIR_UP, floor);
+    } else if(floor < zone -> lowfloor) {
+        set_stop(car, zone -> lowfloor);
+        add_transfer(zone, shaft, zone -> lowfloor, DIR_DOWN, floor);
+    } else {
+        set_stop(car, floor);
+    }
+}
+
+/** Add a call to a zone's queue, making the queue bigger if it is full.
+ *
+ *  \param zone        The zone to add the call to.
+ *  \param floor       The floor the call was made on.
+ *  \param direction   The direction the caller wants to go in.
+ *  \param destination The floor a passenger changing zones is going to, or NO_STOPS.
+ */
+static void post_call(Zone *zone, int floor, Moving direction, int destination)
+{
+    pthread_mutex_lock(&zone -> lock);
+
+    if(zone -> count == zone -> capacity) {
+        ZoneCall *bigger = (ZoneCall *)malloc(zone -> capacity * 2 * sizeof(ZoneCall));
+        int i;
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to enlarge a zone call queue.\n");
+            exit(1);
+        }
+
+        // Unwrap the ring into the start of the new queue
+        for(i = 0; i < zone -> count; ++i) {
+            bigger[i] = zone -> queue[(zone -> head + i) % zone -> capacity];
+        }
+
+        free(zone -> queue);
+        zone -> queue = bigger;
+        zone -> head = 0;
+        zone -> capacity *= 2;
+    }
+
+    zone -> queue[(zone -> head + zone -> count) % zone -> capacity].floor = floor;
+    zone -> queue[(zone -> head + zone -> count) % zone -> capacity].direction = direction;
+    zone -> queue[(zone -> head + zone -> count) % zone -> capacity].destination = destination;
+    ++zone -> count;
+
+    pthread_mutex_unlock(&zone -> lock);
+}
+
+
+/** Add a call to a zone's outbox, to be posted to a neighbouring zone after the
+ *  update. Only the zone's own thread adds to its outbox, so it needs no lock.
+ *
+ *  \param zone        The zone making the call.
+ *  \param floor       The transfer floor the call is made on.
+ *  \param direction   The direction the caller wants to go in.
+ *  \param destination The floor the caller is going to.
+ */
+static void send_call(Zone *zone, int floor, Moving direction, int destination)
+{
+    if(zone -> outcount == zone -> outcapacity) {
+        ZoneCall *bigger = (ZoneCall *)realloc(zone -> outbox, zone -> outcapacity * 2 * sizeof(ZoneCall));
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to enlarge a zone outbox.\n");
+            exit(1);
+        }
+
+        zone -> outbox = bigger;
+        zone -> outcapacity *= 2;
+    }
+
+    zone -> outbox[zone -> outcount].floor = floor;
+    zone -> outbox[zone -> outcount].direction = direction;
+    zone -> outbox[zone -> outcount].destination = destination;
+    ++zone -> outcount;
+}
+
+
+/** Record that a passenger is changing lifts at a transfer floor: either they are in
+ *  one of a zone's lifts and will get out there, or they are waiting there for one.
+ *
+ *  \param zone        The zone the passenger is riding or waiting in.
+ *  \param shaft       The shaft, within the zone, of the lift they are in, or -1 if
+ *                     they are waiting.
+ *  \param floor       The transfer floor.
+ *  \param direction   The direction they are going in.
+ *  \param destination The floor they are going to in the end.
+ */
+static void add_transfer(Zone *zone, int shaft, int floor, Moving direction, int destination)
+{
+    pthread_mutex_lock(&zone -> lock);
+
+    if(zone -> transfercount == zone -> transfercapacity) {
+        Transfer *bigger = (Transfer *)realloc(zone -> transfers, zone -> transfercapacity * 2 * sizeof(Transfer));
+
+        if(!bigger) {
+            fprintf(stderr, "Unable to enlarge a zone transfer list.\n");
+            exit(1);
+        }
+
+        zone -> transfers = bigger;
+        zone -> transfercapacity *= 2;
+    }
+
+    zone -> transfers[zone -> transfercount].shaft = shaft;
+    zone -> transfers[zone -> transfercount].floor = floor;
+    zone -> transfers[zone -> transfercount].direction = direction;
+    zone -> transfers[zone -> transfercount].destination = destination;
+    ++zone -> transfercount;
+
+    pthread_mutex_unlock(&zone -> lock);
+}
+
+
+/** Remove a transfer that is due: the passenger's lift has opened its doors at the
+ *  transfer floor, or, for a waiting passenger, any of the zone's lifts has.
+ *
+ *  \param zone  The zone to look in.
+ *  \param due   A pointer to a Transfer to copy the removed transfer into.
+ *  \param shaft A pointer to an int to store the shaft, within the zone, of the lift
+ *               that has opened in.
+ *  \return true if a transfer was removed, false if none are due.
+ */
+static int take_transfer(Zone *zone, Transfer *due, int *shaft)
+{
+    Lift *car;
+    int i, num, found = 0;
+
+    pthread_mutex_lock(&zone -> lock);
+
+    for(i = 0; i < zone -> transfercount; ++i) {
+        // A waiting passenger gets into any lift, a riding one only gets out of theirs
+        for(num = 0; num < zone -> shaftcount; ++num) {
+            car = zone -> shafts[num] -> car;
+
+            if((zone -> transfers[i].shaft == -1 || zone -> transfers[i].shaft == num) &&
+               get_state(car) == STATE_OPEN && at_floor(car) == zone -> transfers[i].floor) {
+                break;
+            }
+        }
+
+        if(num < zone -> shaftcount) {
+            *due = zone -> transfers[i];
+            *shaft = num;
+            zone -> transfers[i] = zone -> transfers[--zone -> transfercount];
+            found = 1;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&zone -> lock);
+
+    return found;
+}
+
+
+/** Find the zone a shaft belongs to.
+ *
+ *  \param building The zoned building.
+ *  \param shaftnum The number of the shaft, counting across the whole building.
+ *  \return A pointer to the zone containing the shaft.
+ */
+static Zone *find_zone(ZonedBuilding *building, int shaftnum)
+{
+    int zonenum;
+
+    for(zonenum = building -> zonecount - 1; zonenum > 0; --zonenum) {
+        if(shaftnum >= building -> zones[zonenum].firstshaft) {
+            break;
+        }
+    }
+
+    return &building -> zones[zonenum];
+}
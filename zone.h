@@ -0,0 +1,85 @@
+/** \file zone.h
+ *  Declarations for zoned lift groups. The shafts of a building are split into
+ *  groups that each serve their own range of floors, with their own call queue,
+ *  and each group is updated on its own thread.
+ *
+ * \author Kate Wood <kate.wood@hotmail.co.uk>
+ * \version 1
+ */
+#ifndef ZONE_H
+#define ZONE_H
+
+#include <pthread.h>
+#include "shaft.h"
+
+/** A hall call waiting to be given to a lift in a zone. */
+typedef struct {
+    int floor;          //!< The floor the call was made on.
+    Moving direction;   //!< The direction the caller wants to go in.
+    int destination;    //!< Where a passenger changing zones is going, or NO_STOPS for a hall call.
+} ZoneCall;
+
+/** A passenger changing lifts on the way to a floor outside the zone they started
+ *  in. Either they are riding to a transfer floor in one of the zone's lifts, or
+ *  they are waiting at a transfer floor for whichever of the zone's lifts opens
+ *  there first.
+ */
+typedef struct {
+    int shaft;          //!< The shaft (within the zone) the passenger is riding in, or -1 if they are waiting.
+    int floor;          //!< The transfer floor they will get out at, or are waiting at.
+    Moving direction;   //!< The direction they are going in.
+    int destination;    //!< The floor they are going to in the end.
+} Transfer;
+
+/** A group of shafts serving a range of floors. The queue holds calls that have
+ *  been routed to the zone but not yet given to a lift. The outbox holds calls the
+ *  zone's own thread has made for passengers changing into a neighbouring zone;
+ *  they are moved into that zone's queue once every zone has finished the update,
+ *  so other zones' threads never touch the queue. The queue and transfer list are
+ *  still protected by 'lock'.
+ */
+typedef struct Zone {
+    Shaft **shafts;         //!< The shafts in this zone.
+    int shaftcount;         //!< The number of shafts in this zone.
+    int firstshaft;         //!< The building number of the first shaft in the zone.
+    int lowfloor;           //!< The lowest floor the zone serves.
+    int highfloor;          //!< The highest floor the zone serves.
+
+    ZoneCall *queue;        //!< Ring buffer of waiting calls.
+    int head, count;        //!< Index of the oldest call, and number of calls waiting.
+    int capacity;           //!< Space in the ring buffer.
+
+    ZoneCall *outbox;       //!< Calls to post to the zones above and below.
+    int outcount;           //!< The number of calls in the outbox.
+    int outcapacity;        //!< Space in the outbox.
+
+    Transfer *transfers;    //!< Passengers heading for a transfer floor.
+    int transfercount;      //!< The number of transfers in progress.
+    int transfercapacity;   //!< Space in the transfer list.
+
+    struct Zone *below;     //!< The zone sharing this zone's lowest floor, or NULL.
+    struct Zone *above;     //!< The zone sharing this zone's highest floor, or NULL.
+
+    pthread_mutex_t lock;   //!< Protects the queue and transfer list.
+    pthread_t thread;       //!< The thread that updates this zone.
+    struct ZonedBuilding *building;
+} Zone;
+
+/** A building whose shafts have been split into zones. */
+typedef struct ZonedBuilding {
+    Zone *zones;                //!< The zones, from the bottom of the building up.
+    int zonecount;              //!< The number of zones.
+    int running;                //!< Cleared to tell the zone threads to finish.
+    long batch;                 //!< The number of updates the zone threads run when they next start.
+    pthread_barrier_t start;    //!< Zone threads wait here for the next update.
+    pthread_barrier_t done;     //!< And here once they have finished it.
+} ZonedBuilding;
+
+ZonedBuilding *create_zones(Shaft **shafts, int shaftcount, int topfloor, int zonecount);
+void free_zones(ZonedBuilding *building);
+int zone_call(ZonedBuilding *building, int floor, Moving direction);
+void zone_stop(ZonedBuilding *building, int shaftnum, int floor);
+void update_zones(ZonedBuilding *building, long updates);
+void prompt_zones(ZonedBuilding *building, int topfloor);
+
+#endif